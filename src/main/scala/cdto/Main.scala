@@ -1,48 +1,223 @@
 package cdto
 
+import codegen.cpp.MessageCppHeader
 import codegen.json._
 import codegen.messagetypes._
+import codegen.xml.MessageXMLFiles
 import compiler._
 import datamodel.Protocol
 
 import io.Source
-import java.nio.file.Paths
-import java.io.{File, PrintWriter}
+import java.nio.charset.StandardCharsets
+import java.nio.file.{Files, Paths}
+import java.util.concurrent.Executors
 
-import codegen.sourcefile.FileDefinition
+import scala.collection.JavaConverters._
+import scala.concurrent.{Await, ExecutionContext, Future}
+import scala.concurrent.duration.Duration
+import scala.util.{Failure, Success, Try}
+
+import codegen.sourcefile.{CMakeFragment, FileDefinition}
 import org.rogach.scallop._
 
 
 object Main  {
 
-  private class ArgConfig(arguments: Seq[String]) extends ScallopConf(arguments) {
-    val protocol = opt[String](required = true, descr = "Path to the protocol definition file")
+  private[cdto] class ArgConfig(arguments: Seq[String]) extends ScallopConf(arguments) {
+    val protocol = opt[List[String]](
+      required = true,
+      descr = "Paths to protocol definition files, or to directories whose .cdto files are all compiled"
+    )
     val outputDir = opt[String](required = true, descr = "Path to the directory to write the generated files")
     val typeHeaders = opt[List[String]](descr = "List of headers containing C-type definitions used in message fields")
+    val shards = opt[Int](
+      descr = "Split the JSON functions into this many C source files by message and generate a CMake fragment listing them",
+      validate = _ > 0
+    )
+    val jobs = opt[Int](
+      descr = "Number of protocols to compile in parallel. Defaults to the number of available processors",
+      validate = _ > 0
+    )
+    val timing = opt[Boolean](descr = "Print the total time spent compiling all protocols")
+    val codegen = opt[String](
+      default = Some("specialized"),
+      descr = "JSON code generation strategy: 'specialized' generates code for every field, 'tables' generates descriptor tables interpreted by a generic runtime",
+      validate = JSONCodegen.byName.contains
+    )
+    val features = opt[List[String]](
+      descr = "Optional JSON functions to generate: 'validate', 'extract', 'writer', 'buffers' and 'limits'. Only the functions to parse and serialize strings are generated by default",
+      validate = _.forall(JSONFeature.byName.contains)
+    )
+    val cpp = opt[Boolean](descr = "Also generate a C++ header wrapping each message in a move-only RAII class")
+    val xml = opt[Boolean](descr = "Also generate functions to parse and serialize messages to and from XML")
 
     verify()
   }
 
+  /**
+    * Options controlling which files are generated for each protocol
+    * @param typeHeaders List of headers containing definitions for custom C-types
+    * @param shards Number of C source files to split each protocol's JSON functions into, if any
+    * @param codegen JSON code generation strategy
+    * @param features Optional families of JSON functions to generate
+    * @param cppHeader True to generate the C++ wrapper header
+    * @param xmlFiles True to generate the XML parsing/serialization files
+    */
+  private[cdto] case class OutputOptions(typeHeaders: Seq[String],
+                                         shards: Option[Int],
+                                         codegen: JSONCodegen,
+                                         features: Set[JSONFeature],
+                                         cppHeader: Boolean,
+                                         xmlFiles: Boolean)
+
+  private val protocolFileExtension = ".cdto"
+
   def main(args: Array[String]): Unit = {
     val parsedArgs = new ArgConfig(args)
 
-    val protocolFile = parsedArgs.protocol()
     val outputDir = parsedArgs.outputDir()
-    val typeHeaders = parsedArgs.typeHeaders.getOrElse(Nil)
+    val jobs = jobCount(parsedArgs)
+    val options = OutputOptions(
+      typeHeaders = parsedArgs.typeHeaders.getOrElse(Nil),
+      shards = parsedArgs.shards.toOption,
+      codegen = JSONCodegen.byName(parsedArgs.codegen()),
+      features = parsedArgs.features.getOrElse(Nil).map(JSONFeature.byName).toSet,
+      cppHeader = parsedArgs.cpp(),
+      xmlFiles = parsedArgs.xml()
+    )
+
+    val startTime = System.nanoTime
+
+    val protocolFiles = parsedArgs.protocol().flatMap(protocolFilesFromPath).distinct
+    val errors = duplicateProtocolNameErrors(protocolFiles) match {
+      case Nil => compileProtocols(protocolFiles, options, outputDir, jobs)
+      case duplicateErrors => duplicateErrors
+    }
+
+    errors.foreach(println)
+
+    if(parsedArgs.timing()) {
+      val elapsedMillis = (System.nanoTime - startTime) / 1000000
+      println(s"Compiled ${protocolFiles.length} protocol(s) in $elapsedMillis ms using $jobs thread(s)")
+    }
+
+    if(errors.nonEmpty) {
+      sys.exit(1)
+    }
+  }
+
+  /**
+    * Gets the number of protocols to compile in parallel
+    * @param parsedArgs Parsed command-line arguments
+    * @return The --jobs argument, or the number of available processors if not given
+    */
+  private[cdto] def jobCount(parsedArgs: ArgConfig): Int = {
+    parsedArgs.jobs.getOrElse(Runtime.getRuntime.availableProcessors)
+  }
+
+  /**
+    * Compiles all protocols and writes their generated files, running up to the given
+    * number of protocols in parallel.
+    * @param protocolFiles Paths to the protocol definition files
+    * @param options Options controlling which files are generated
+    * @param outputDir Directory to which the generated files are to be written
+    * @param jobs Number of protocols to compile in parallel
+    * @return Error messages of all protocols that failed to compile, in the order the
+    *         protocols were provided
+    */
+  private[cdto] def compileProtocols(protocolFiles: Seq[String],
+                                     options: OutputOptions,
+                                     outputDir: String,
+                                     jobs: Int): Seq[String] = {
+    val executor = Executors.newFixedThreadPool(jobs)
+    implicit val executionContext: ExecutionContext = ExecutionContext.fromExecutorService(executor)
+
+    try {
+      val results = protocolFiles.map(protocolFile => Future {
+        Try(compileProtocol(protocolFile, options, outputDir)) match {
+          case Success(error) => error
+          case Failure(exception) => Some(exception.toString)
+        }
+      })
+
+      val errors = Await.result(Future.sequence(results), Duration.Inf)
 
+      protocolFiles.zip(errors).collect({ case (protocolFile, Some(error)) => s"$protocolFile: $error" })
+    } finally {
+      executor.shutdown()
+    }
+  }
+
+  /**
+    * Compiles a single protocol and writes its generated files
+    * @param protocolFile Path to the protocol definition file
+    * @param options Options controlling which files are generated
+    * @param outputDir Directory to which the generated files are to be written
+    * @return The compiler error if the protocol is invalid, None otherwise
+    */
+  private def compileProtocol(protocolFile: String, options: OutputOptions, outputDir: String): Option[String] = {
     val protocolName = protocolNameFromPath(protocolFile)
-    val definition = readProtocolDefinition(parsedArgs.protocol())
+    val definition = readProtocolDefinition(protocolFile)
     val compilerResult = ProtocolCompiler(definition, protocolName)
 
     compilerResult match {
-      case Left(error) => println(error)
+      case Left(error) => Some(error.toString)
       case Right(protocol) => {
-        writeProtocolTypeFiles(protocol, typeHeaders, outputDir)
-        writeProtocolJSONFiles(protocol, outputDir)
+        writeProtocolTypeFiles(protocol, options.typeHeaders, outputDir)
+        options.shards match {
+          case Some(shardCount) => writeShardedProtocolJSONFiles(protocol, shardCount, options, outputDir)
+          case None => writeProtocolJSONFiles(protocol, options, outputDir)
+        }
+        if(options.cppHeader) {
+          writeFile(outputDir, MessageCppHeader(protocol))
+        }
+        if(options.xmlFiles) {
+          writeProtocolXMLFiles(protocol, outputDir)
+        }
+        None
       }
     }
   }
 
+  /**
+    * Gets the protocol definition files at the given path. If the path is a directory,
+    * this is every regular file directly inside of it with the .cdto extension, in name
+    * order. Otherwise the path itself is the protocol definition file.
+    * @param path Path to a protocol definition file or a directory
+    * @return Paths to protocol definition files
+    */
+  private[cdto] def protocolFilesFromPath(path: String): Seq[String] = {
+    val filePath = Paths.get(path)
+
+    if(Files.isDirectory(filePath)) {
+      val directoryStream = Files.newDirectoryStream(filePath, "*" + protocolFileExtension)
+
+      try {
+        directoryStream.asScala.toList.filter(Files.isRegularFile(_)).map(_.toString).sorted
+      } finally {
+        directoryStream.close()
+      }
+    } else {
+      List(path)
+    }
+  }
+
+  /**
+    * Protocols write their generated files into the same output directory, so two
+    * protocol definition files with the same file name would overwrite each other's
+    * generated files.
+    * @param protocolFiles Paths to the protocol definition files
+    * @return Error messages for each protocol name used by more than one file
+    */
+  private[cdto] def duplicateProtocolNameErrors(protocolFiles: Seq[String]): Seq[String] = {
+    protocolFiles
+      .groupBy(protocolNameFromPath)
+      .filter({ case (_, files) => files.length > 1 })
+      .toSeq
+      .sortBy(_._1)
+      .map({ case (protocolName, files) => s"Multiple protocol definitions named $protocolName: ${files.mkString(", ")}" })
+  }
+
   /**
     * Gets the name of the protocol from the provided path to the protocol
     * definition file
@@ -52,14 +227,20 @@ object Main  {
   }
 
   /**
-    * Reads the protocol definition file. Note: This ignores all errors reading
-    * the file.
+    * Reads the protocol definition file. Errors reading the file are thrown and
+    * reported as errors of the protocol.
     * @param definitionPath Absolute path to the protocol definition file
     * @return Contents of the protocol definition file
     */
   private def readProtocolDefinition(definitionPath: String): String = {
-    // TODO: Handle errors
-    Source.fromFile(definitionPath).getLines.mkString
+    val source = Source.fromFile(definitionPath)
+
+    // Close each file once read, since a single run may read hundreds of protocols
+    try {
+      source.getLines.mkString
+    } finally {
+      source.close()
+    }
   }
 
   /**
@@ -79,27 +260,79 @@ object Main  {
   /**
     * Writes the protocol JSON parsing/serialization files to the specified directory
     * @param protocol Protocol
+    * @param options Options controlling which files are generated
     * @param outputDir Directory to which the files are to be written
     */
-  private def writeProtocolJSONFiles(protocol: Protocol, outputDir: String): Unit = {
-    val jsonFiles = MessageJSONFiles(protocol)
+  private def writeProtocolJSONFiles(protocol: Protocol, options: OutputOptions, outputDir: String): Unit = {
+    val jsonFiles = MessageJSONFiles(protocol, options.codegen, options.features)
 
     writeFile(outputDir, jsonFiles.headerFile)
     writeFile(outputDir, jsonFiles.cFile)
   }
 
   /**
-    * Writes the given file to the specified output directory. Note: This ignores
+    * Writes the protocol XML parsing/serialization files
+    * @param protocol Protocol
+    * @param outputDir Directory to which the files are to be written
+    */
+  private def writeProtocolXMLFiles(protocol: Protocol, outputDir: String): Unit = {
+    val xmlFiles = MessageXMLFiles(protocol)
+
+    writeFile(outputDir, xmlFiles.headerFile)
+    writeFile(outputDir, xmlFiles.cFile)
+  }
+
+  /**
+    * Writes the protocol JSON parsing/serialization files split into the given number of
+    * C source files, along with a CMake fragment listing all of the protocol's generated files
+    * @param protocol Protocol
+    * @param shardCount Number of C source files to split the JSON functions into
+    * @param options Options controlling which files are generated
+    * @param outputDir Directory to which the files are to be written
+    */
+  private def writeShardedProtocolJSONFiles(protocol: Protocol,
+                                            shardCount: Int,
+                                            options: OutputOptions,
+                                            outputDir: String): Unit = {
+    val jsonFiles = MessageJSONFiles.sharded(protocol, shardCount, options.codegen, options.features)
+    val cppHeaders = if(options.cppHeader) List(MessageCppHeader.fileName(protocol.name)) else Nil
+    val xmlHeaders = if(options.xmlFiles) List(MessageXMLFiles.headerFileName(protocol.name)) else Nil
+    val xmlCFiles = if(options.xmlFiles) List(MessageXMLFiles.cFileName(protocol.name)) else Nil
+
+    writeFile(outputDir, jsonFiles.headerFile)
+    writeFile(outputDir, jsonFiles.internalHeaderFile)
+    jsonFiles.cFiles.foreach(writeFile(outputDir, _))
+
+    val cmakeFragment = CMakeFragment(
+      protocolName = protocol.name,
+      headerFiles = List(
+        MessageTypeFiles.headerFileName(protocol.name),
+        jsonFiles.headerFile.name,
+        jsonFiles.internalHeaderFile.name
+      ) ++ cppHeaders ++ xmlHeaders,
+      cFiles = (MessageTypeFiles.cFileName(protocol.name) +: jsonFiles.cFiles.map(_.name)) ++ xmlCFiles
+    )
+
+    writeFile(outputDir, cmakeFragment)
+  }
+
+  /**
+    * Writes the given file to the specified output directory. If the file already
+    * exists with the same contents, it is left untouched so that its modification
+    * time is preserved and build tools do not recompile it. Note: This ignores
     * all errors writing the file
     * @param outputDir Absolute path to the directory which the file is to be written
     * @param file File to write
     */
   private def writeFile(outputDir: String, file: FileDefinition): Unit = {
-    val path = Paths.get(outputDir, file.name)
+    val path = Paths.get(outputDir, file.name).toAbsolutePath
+    val contents = file.contents.getBytes(StandardCharsets.UTF_8)
+
+    val unchanged = Files.isRegularFile(path) && java.util.Arrays.equals(Files.readAllBytes(path), contents)
 
     // TODO: Handle errors
-    val writer = new PrintWriter(new File(path.toAbsolutePath.toString))
-    writer.write(file.contents)
-    writer.close()
+    if(!unchanged) {
+      Files.write(path, contents)
+    }
   }
 }
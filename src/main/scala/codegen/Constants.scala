@@ -12,11 +12,14 @@ object Constants {
   val defaultCharacterCType = "char"
   val defaultIntCType = "int"
   val defaultNumberCType = "double"
+  val defaultTimestampCType = "int64_t"
 
   val voidCType = "void"
 
-  val defaultFreeFunction = "free"
-
+  val ctypeHeader = "<ctype.h>"
+  val limitsHeader = "<limits.h>"
+  val stddefHeader = "<stddef.h>"
+  val stdintHeader = "<stdint.h>"
   val stdioHeader = "<stdio.h>"
   val stdlibHeader = "<stdlib.h>"
   val stringHeader = "<string.h>"
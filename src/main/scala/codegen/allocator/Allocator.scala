@@ -0,0 +1,319 @@
+package codegen.allocator
+
+import codegen.Constants
+import codegen.functions._
+import datamodel._
+
+/**
+  * Contains the definition of the cdto_allocator vtable and the static helper functions
+  * generated code uses for all of its dynamic memory management. Every helper takes the
+  * allocator as a parameter and falls back to the C standard library when it is NULL.
+  * The allocator may also provide an intern function for fields declared with intern=true;
+  * interned strings are owned by the caller's intern table instead of the message.
+  */
+object Allocator {
+
+  /**
+    * Name of the allocator vtable type
+    */
+  val typeName: String = "cdto_allocator"
+
+  /**
+    * Name used for allocator parameters of generated functions
+    */
+  val paramName: String = "allocator"
+
+  /**
+    * Allocator argument used by the non-_ex functions to select the C standard library
+    */
+  val defaultAllocator: String = "NULL"
+
+  /**
+    * Suffix appended to the names of functions that take an allocator parameter
+    */
+  val functionNameSuffix: String = "_ex"
+
+  private val sizeParam = "size"
+  private val countParam = "count"
+  private val pointerParam = "ptr"
+  private val stringParam = "str"
+
+  /**
+    * Parameter to pass an allocator to a generated function
+    */
+  val parameter: FunctionParameter = FunctionParameter(paramType = s"$typeName const*", paramName = paramName)
+
+  /**
+    * Type definition of the allocator vtable to place in the protocol's type header. The
+    * definition is shared by all protocols so it is protected against multiple definitions.
+    */
+  val typeDefinition: String =
+    s"""#ifndef CDTO_ALLOCATOR_DEFINED
+       |#define CDTO_ALLOCATOR_DEFINED
+       |
+       |typedef struct
+       |    {
+       |    void*          ( *malloc_fn )( void* ctx, size_t size );
+       |    void           ( *free_fn )( void* ctx, void* ptr );
+       |    void*          ctx;
+       |    char const*    ( *intern_fn )( void* ctx, char const* str );
+       |    } $typeName;
+       |
+       |#endif /* #ifndef CDTO_ALLOCATOR_DEFINED */""".stripMargin
+
+  /**
+    * Gets the call to allocate memory through the allocator parameter
+    * @param size C expression for the number of bytes to allocate
+    * @return Allocation call
+    */
+  def malloc(size: String): String = {
+    s"${mallocFunction.name}( $paramName, $size )"
+  }
+
+  /**
+    * Gets the call to allocate zeroed memory through the allocator parameter
+    * @param count C expression for the number of elements to allocate
+    * @param size C expression for the size of each element
+    * @return Allocation call
+    */
+  def calloc(count: String, size: String): String = {
+    s"${callocFunction.name}( $paramName, $count, $size )"
+  }
+
+  /**
+    * Gets the call to duplicate a string through the allocator parameter
+    * @param string C expression for the string to duplicate
+    * @return String duplication call
+    */
+  def strdup(string: String): String = {
+    s"${strdupFunction.name}( $paramName, $string )"
+  }
+
+  /**
+    * Checks whether a field's strings are interned
+    * @param fieldType Type of the field
+    * @return Whether the field or its elements are interned strings
+    */
+  def isInterned(fieldType: FieldType): Boolean = {
+    fieldType match {
+      case ArrayType(elementType) => isInterned(elementType)
+      case InlineArrayType(elementType, _) => isInterned(elementType)
+      case AliasedType(_, underlyingType) => isInterned(underlyingType)
+      case InternedStringType => true
+      case _ => false
+    }
+  }
+
+  /**
+    * Gets the call to intern a string through the allocator parameter
+    * @param string C expression for the string to intern
+    * @return String interning call
+    */
+  def intern(string: String): String = {
+    s"${internFunction.name}( $paramName, $string )"
+  }
+
+  /**
+    * Gets the call to release a string that was interned through the allocator parameter
+    * @param string C expression for the interned string
+    * @return Interned string release call
+    */
+  def internFree(string: String): String = {
+    s"${internFreeFunction.name}( $paramName, $string )"
+  }
+
+  /**
+    * Gets the call to free memory through the allocator parameter
+    * @param pointer C expression for the memory to free
+    * @return Free call
+    */
+  def free(pointer: String): String = {
+    s"${freeFunction.name}( $paramName, $pointer )"
+  }
+
+  /**
+    * Static function to allocate memory through an allocator
+    */
+  val mallocFunction: FunctionDefinition = FunctionDefinition(
+    name = "cdto_malloc",
+    documentation = FunctionDocumentation(
+      shortSummary = "Allocate memory",
+      description = s"Allocates $sizeParam bytes through the allocator, or through malloc() if the allocator is NULL."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = "void*",
+      parameters = List(
+        parameter,
+        FunctionParameter(paramType = "size_t", paramName = sizeParam)
+      )
+    ),
+    body =
+      s"""if( NULL == $paramName )
+         |    {
+         |    return malloc( $sizeParam );
+         |    }
+         |
+         |return $paramName->malloc_fn( $paramName->ctx, $sizeParam );""".stripMargin
+  )
+
+  /**
+    * Static function to allocate zeroed memory through an allocator
+    */
+  val callocFunction: FunctionDefinition = FunctionDefinition(
+    name = "cdto_calloc",
+    documentation = FunctionDocumentation(
+      shortSummary = "Allocate zeroed memory",
+      description = s"Allocates $countParam zeroed elements of $sizeParam bytes through the allocator, or through calloc() if the allocator is NULL."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = "void*",
+      parameters = List(
+        parameter,
+        FunctionParameter(paramType = "size_t", paramName = countParam),
+        FunctionParameter(paramType = "size_t", paramName = sizeParam)
+      )
+    ),
+    body =
+      s"""void* memory;
+         |
+         |if( NULL == $paramName )
+         |    {
+         |    return calloc( $countParam, $sizeParam );
+         |    }
+         |
+         |// Guard against overflow when computing the total size
+         |if( ( 0 != $sizeParam ) && ( $countParam > ( (size_t)-1 ) / $sizeParam ) )
+         |    {
+         |    return NULL;
+         |    }
+         |
+         |memory = $paramName->malloc_fn( $paramName->ctx, $countParam * $sizeParam );
+         |if( NULL != memory )
+         |    {
+         |    memset( memory, 0, $countParam * $sizeParam );
+         |    }
+         |
+         |return memory;""".stripMargin
+  )
+
+  /**
+    * Static function to duplicate a string through an allocator
+    */
+  val strdupFunction: FunctionDefinition = FunctionDefinition(
+    name = "cdto_strdup",
+    documentation = FunctionDocumentation(
+      shortSummary = "Duplicate string",
+      description = s"Duplicates $stringParam through the allocator, or through malloc() if the allocator is NULL."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = s"${Constants.defaultCharacterCType}*",
+      parameters = List(
+        parameter,
+        FunctionParameter(paramType = s"${Constants.defaultCharacterCType} const*", paramName = stringParam)
+      )
+    ),
+    body =
+      s"""size_t length;
+         |${Constants.defaultCharacterCType}* copy;
+         |
+         |length = strlen( $stringParam ) + 1;
+         |copy = ${mallocFunction.name}( $paramName, length );
+         |if( NULL != copy )
+         |    {
+         |    memcpy( copy, $stringParam, length );
+         |    }
+         |
+         |return copy;""".stripMargin
+  )
+
+  /**
+    * Static function to free memory through an allocator
+    */
+  val freeFunction: FunctionDefinition = FunctionDefinition(
+    name = "cdto_free",
+    documentation = FunctionDocumentation(
+      shortSummary = "Free memory",
+      description = s"Frees $pointerParam through the allocator, or through free() if the allocator is NULL. NULL pointers are ignored."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.voidCType,
+      parameters = List(
+        parameter,
+        FunctionParameter(paramType = "void*", paramName = pointerParam)
+      )
+    ),
+    body =
+      s"""if( NULL == $pointerParam )
+         |    {
+         |    return;
+         |    }
+         |
+         |if( NULL == $paramName )
+         |    {
+         |    free( $pointerParam );
+         |    }
+         |else
+         |    {
+         |    $paramName->free_fn( $paramName->ctx, $pointerParam );
+         |    }""".stripMargin
+  )
+
+  /**
+    * Static function to intern a string through an allocator
+    */
+  val internFunction: FunctionDefinition = FunctionDefinition(
+    name = "cdto_strintern",
+    documentation = FunctionDocumentation(
+      shortSummary = "Intern string",
+      description = s"Looks $stringParam up in the allocator's intern table and returns the shared copy. If the allocator is NULL or has no intern function, $stringParam is duplicated instead."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = s"${Constants.defaultCharacterCType} const*",
+      parameters = List(
+        parameter,
+        FunctionParameter(paramType = s"${Constants.defaultCharacterCType} const*", paramName = stringParam)
+      )
+    ),
+    body =
+      s"""if( ( NULL == $paramName ) || ( NULL == $paramName->intern_fn ) )
+         |    {
+         |    return ${strdupFunction.name}( $paramName, $stringParam );
+         |    }
+         |
+         |return $paramName->intern_fn( $paramName->ctx, $stringParam );""".stripMargin
+  )
+
+  /**
+    * Static function to release a string that was interned through an allocator
+    */
+  val internFreeFunction: FunctionDefinition = FunctionDefinition(
+    name = "cdto_strintern_free",
+    documentation = FunctionDocumentation(
+      shortSummary = "Release interned string",
+      description = s"Frees $stringParam if it was duplicated by cdto_strintern(). Strings owned by the allocator's intern table are left alone."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.voidCType,
+      parameters = List(
+        parameter,
+        FunctionParameter(paramType = s"${Constants.defaultCharacterCType} const*", paramName = stringParam)
+      )
+    ),
+    body =
+      s"""if( ( NULL == $paramName ) || ( NULL == $paramName->intern_fn ) )
+         |    {
+         |    ${freeFunction.name}( $paramName, ( void* )$stringParam );
+         |    }""".stripMargin
+  )
+
+  /**
+    * All functions needed to allocate memory through an allocator
+    */
+  val allocationFunctions: Seq[FunctionDefinition] = List(mallocFunction, callocFunction, strdupFunction)
+}
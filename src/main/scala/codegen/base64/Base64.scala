@@ -0,0 +1,265 @@
+package codegen.base64
+
+import codegen.Constants
+import codegen.allocator.Allocator
+import codegen.functions._
+
+/**
+  * The base64 codec of bytes fields. Bytes are written to JSON and XML as padded base64 text
+  * of the standard alphabet. If the C source file is compiled for a CPU with SSSE3, the codec
+  * translates 16 characters to 12 bytes and back per instruction sequence, and falls back to a
+  * table-driven scalar loop for the rest of the data. Defining CDTO_BASE64_NO_SIMD forces the
+  * scalar code.
+  */
+object Base64 {
+
+  val encodeName = "cdto_base64_encode"
+  val decodeName = "cdto_base64_decode"
+
+  private val simdMacro = "CDTO_BASE64_SSSE3"
+
+  private val alphabet = (('A' to 'Z') ++ ('a' to 'z') ++ ('0' to '9')).mkString + "+/"
+
+  /**
+    * Definitions to place in C source files that use the codec. These select the SSSE3 code
+    * if the compiler targets a CPU that has it.
+    */
+  val sourceDefinitions: String =
+    s"""#if defined( __SSSE3__ ) && !defined( CDTO_BASE64_NO_SIMD )
+       |#define $simdMacro
+       |#include <tmmintrin.h>
+       |#endif""".stripMargin
+
+  /**
+    * Gets the number of characters of the base64 text of some bytes
+    * @param length Expression of the number of bytes
+    * @return Expression of the length of the text, without a NUL terminator
+    */
+  def encodedLength(length: String): String = {
+    s"( 4 * ( ( $length + 2 ) / 3 ) )"
+  }
+
+  /**
+    * Gets the check that the base64 text of some bytes can be allocated
+    * @param length Expression of the number of bytes
+    * @return Expression that is true if the length of the text, including a NUL
+    *         terminator, does not overflow
+    */
+  def lengthCheck(length: String): String = {
+    s"( $length < ( size_t )-1 / 4 * 3 - 3 )"
+  }
+
+  /**
+    * Static function to encode bytes as base64 text
+    */
+  val encodeFunction: FunctionDefinition = FunctionDefinition(
+    name = encodeName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Encode base64",
+      description = s"Writes the padded base64 text of len bytes of data to text, which must hold ${encodedLength("len")} characters. The text is not NUL-terminated."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.voidCType,
+      parameters = List(
+        FunctionParameter("uint8_t const*", "data"),
+        FunctionParameter("size_t", "len"),
+        FunctionParameter("char*", "text")
+      )
+    ),
+    body =
+      s"""static char const digits[] = "$alphabet";
+         |size_t i;
+         |uint32_t group;
+         |#if defined( $simdMacro )
+         |__m128i block;
+         |__m128i indices;
+         |__m128i shifts;
+         |#endif
+         |
+         |i = 0;
+         |
+         |#if defined( $simdMacro )
+         |// Spread 12 bytes over the 16 bytes of a vector, split them into 6-bit indices
+         |// and add the offset of each index's range of the alphabet. A block reads 16 bytes.
+         |for( ; i + 16 <= len; i += 12 )
+         |    {
+         |    block = _mm_loadu_si128( ( __m128i const* )( data + i ) );
+         |    block = _mm_shuffle_epi8( block, _mm_set_epi8( 10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1 ) );
+         |    indices = _mm_or_si128( _mm_mulhi_epu16( _mm_and_si128( block, _mm_set1_epi32( 0x0FC0FC00 ) ), _mm_set1_epi32( 0x04000040 ) ),
+         |                            _mm_mullo_epi16( _mm_and_si128( block, _mm_set1_epi32( 0x003F03F0 ) ), _mm_set1_epi32( 0x01000010 ) ) );
+         |
+         |    shifts = _mm_subs_epu8( indices, _mm_set1_epi8( 51 ) );
+         |    shifts = _mm_or_si128( shifts, _mm_and_si128( _mm_cmpgt_epi8( _mm_set1_epi8( 26 ), indices ), _mm_set1_epi8( 13 ) ) );
+         |    shifts = _mm_shuffle_epi8( _mm_setr_epi8( 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0 ), shifts );
+         |
+         |    _mm_storeu_si128( ( __m128i* )text, _mm_add_epi8( indices, shifts ) );
+         |    text += 16;
+         |    }
+         |#endif
+         |
+         |for( ; i + 3 <= len; i += 3 )
+         |    {
+         |    group = ( ( uint32_t )data[i] << 16 ) | ( ( uint32_t )data[i + 1] << 8 ) | data[i + 2];
+         |    text[0] = digits[( group >> 18 ) & 0x3F];
+         |    text[1] = digits[( group >> 12 ) & 0x3F];
+         |    text[2] = digits[( group >> 6 ) & 0x3F];
+         |    text[3] = digits[group & 0x3F];
+         |    text += 4;
+         |    }
+         |
+         |// Pad the last group of one or two bytes
+         |if( i < len )
+         |    {
+         |    group = ( uint32_t )data[i] << 16;
+         |    group |= ( i + 1 < len ) ? ( ( uint32_t )data[i + 1] << 8 ) : 0;
+         |    text[0] = digits[( group >> 18 ) & 0x3F];
+         |    text[1] = digits[( group >> 12 ) & 0x3F];
+         |    text[2] = ( i + 1 < len ) ? digits[( group >> 6 ) & 0x3F] : '=';
+         |    text[3] = '=';
+         |    }""".stripMargin
+  )
+
+  /**
+    * Static function to decode base64 text into a single allocation
+    */
+  val decodeFunction: FunctionDefinition = FunctionDefinition(
+    name = decodeName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Decode base64",
+      description = "Decodes text_len characters of padded base64 text into a buffer allocated with the allocator, which is NULL if the text is empty. The length of the data is known from the length of the text, so the buffer is allocated once and filled in a single pass. Returns 1 if the text is valid base64, 0 otherwise. The caller must free data_out with the allocator."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter("char const*", "text"),
+        FunctionParameter("size_t", "text_len"),
+        FunctionParameter("uint8_t**", "data_out"),
+        FunctionParameter("size_t*", "len_out"),
+        Allocator.parameter
+      )
+    ),
+    body =
+      s"""static uint8_t const values[256] =
+         |    {
+         |$valuesTable
+         |    };
+         |${Constants.defaultBooleanCType} success;
+         |uint8_t* data;
+         |size_t len;
+         |size_t padding;
+         |size_t i;
+         |size_t j;
+         |size_t k;
+         |uint32_t group;
+         |uint8_t value;
+         |#if defined( $simdMacro )
+         |__m128i block;
+         |__m128i hi_nibbles;
+         |__m128i lo_nibbles;
+         |uint8_t decoded[16];
+         |#endif
+         |
+         |*data_out = NULL;
+         |*len_out = 0;
+         |
+         |success = ( 0 == text_len % 4 );
+         |
+         |padding = 0;
+         |if( success && ( text_len > 0 ) && ( '=' == text[text_len - 1] ) )
+         |    {
+         |    padding = ( '=' == text[text_len - 2] ) ? 2 : 1;
+         |    }
+         |
+         |len = success ? text_len / 4 * 3 - padding : 0;
+         |data = NULL;
+         |
+         |if( success && ( len > 0 ) )
+         |    {
+         |    data = ${Allocator.malloc("len")};
+         |    success = ( NULL != data );
+         |    }
+         |
+         |i = 0;
+         |j = 0;
+         |
+         |#if defined( $simdMacro )
+         |// Translate 16 characters to their 6-bit values, then pack those into 12 bytes. The
+         |// last 4 characters may be padding, so they are left to the scalar loop, as is the
+         |// rest of the text after an invalid character so that the loop reports it.
+         |while( success && ( i + 16 < text_len ) )
+         |    {
+         |    block = _mm_loadu_si128( ( __m128i const* )( text + i ) );
+         |    hi_nibbles = _mm_and_si128( _mm_srli_epi32( block, 4 ), _mm_set1_epi8( 0x2F ) );
+         |    lo_nibbles = _mm_and_si128( block, _mm_set1_epi8( 0x2F ) );
+         |
+         |    if( 0 != _mm_movemask_epi8( _mm_cmpgt_epi8( _mm_and_si128( _mm_shuffle_epi8( _mm_setr_epi8( 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A ), lo_nibbles ),
+         |                                                                 _mm_shuffle_epi8( _mm_setr_epi8( 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10 ), hi_nibbles ) ),
+         |                                                  _mm_setzero_si128() ) ) )
+         |        {
+         |        break;
+         |        }
+         |
+         |    hi_nibbles = _mm_add_epi8( hi_nibbles, _mm_cmpeq_epi8( block, _mm_set1_epi8( 0x2F ) ) );
+         |    block = _mm_add_epi8( block, _mm_shuffle_epi8( _mm_setr_epi8( 0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0 ), hi_nibbles ) );
+         |
+         |    block = _mm_madd_epi16( _mm_maddubs_epi16( block, _mm_set1_epi32( 0x01400140 ) ), _mm_set1_epi32( 0x00011000 ) );
+         |    block = _mm_shuffle_epi8( block, _mm_setr_epi8( 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 ) );
+         |    _mm_storeu_si128( ( __m128i* )decoded, block );
+         |
+         |    memcpy( data + j, decoded, 12 );
+         |    i += 16;
+         |    j += 12;
+         |    }
+         |#endif
+         |
+         |for( ; success && ( i < text_len ); i += 4 )
+         |    {
+         |    group = 0;
+         |    for( k = 0; k < 4; k++ )
+         |        {
+         |        value = values[( unsigned char )text[i + k]];
+         |
+         |        // Padding is only allowed at the end of the text
+         |        if( ( i + 4 == text_len ) && ( k >= 4 - padding ) )
+         |            {
+         |            value = 0;
+         |            }
+         |
+         |        success = success && ( value < 64 );
+         |        group = ( group << 6 ) | value;
+         |        }
+         |
+         |    for( k = 0; success && ( k < 3 ) && ( j < len ); k++ )
+         |        {
+         |        data[j++] = ( uint8_t )( group >> ( 16 - 8 * k ) );
+         |        }
+         |    }
+         |
+         |if( success )
+         |    {
+         |    *data_out = data;
+         |    *len_out = len;
+         |    }
+         |else
+         |    {
+         |    ${Allocator.free("data")};
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+
+  /**
+    * Rows of the table of the 6-bit values of characters, 0xFF for characters that are not
+    * in the alphabet
+    */
+  private def valuesTable: String = {
+    val values = (0 until 256).map(c => alphabet.indexOf(c.toChar) match {
+      case -1 => "0xFF"
+      case value => f"0x$value%02X"
+    })
+
+    values.grouped(16).map(row => "    " + row.mkString(", ")).mkString(",\n")
+  }
+}
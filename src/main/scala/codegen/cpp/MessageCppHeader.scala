@@ -0,0 +1,332 @@
+package codegen.cpp
+
+import codegen.Constants
+import codegen.json.MessageJSONFiles
+import codegen.json.parsing.MessageJSONStringParser
+import codegen.json.serialization.{MessageJSONPrettyStringSerializer, MessageJSONStringSerializer}
+import codegen.messagetypes._
+import codegen.sourcefile._
+import datamodel._
+
+/**
+  * Generates a C++ header that wraps each message struct in a move-only RAII class. The
+  * wrapper owns a single C struct, frees it through the message's free function, and exposes
+  * its fields through std::string_view and span accessors that point into the struct without
+  * copying. Parsing and serialization delegate to the generated JSON functions and report
+  * errors through their return values rather than exceptions.
+  */
+object MessageCppHeader {
+
+  private val structMember = "m_obj"
+
+  /**
+    * Names of the members every wrapper class defines. Accessors of fields with these names
+    * get a suffix so they do not collide.
+    */
+  private val memberNames = Set("get", "parse", "serialize", "serialize_pretty", "swap", structMember)
+
+  /**
+    * Types shared by the C++ headers of all protocols, protected against multiple definitions.
+    * cdto::span is std::span when the standard library provides it, otherwise a minimal
+    * equivalent so the header only needs C++17.
+    */
+  private val supportDefinitions: String =
+    """#ifndef CDTO_CPP_SUPPORT_DEFINED
+      |#define CDTO_CPP_SUPPORT_DEFINED
+      |
+      |namespace cdto
+      |{
+      |
+      |#if defined( __cpp_lib_span )
+      |
+      |template<typename T>
+      |using span = std::span<T>;
+      |
+      |#else
+      |
+      |// Non-owning view of a contiguous array
+      |template<typename T>
+      |class span
+      |    {
+      |public:
+      |    constexpr span() noexcept : m_data( nullptr ), m_size( 0 ) {}
+      |    constexpr span( T* data, std::size_t size ) noexcept : m_data( data ), m_size( size ) {}
+      |
+      |    constexpr T* data() const noexcept { return m_data; }
+      |    constexpr std::size_t size() const noexcept { return m_size; }
+      |    constexpr bool empty() const noexcept { return 0 == m_size; }
+      |    constexpr T* begin() const noexcept { return m_data; }
+      |    constexpr T* end() const noexcept { return m_data + m_size; }
+      |    constexpr T& operator[]( std::size_t index ) const noexcept { return m_data[index]; }
+      |
+      |private:
+      |    T*             m_data;
+      |    std::size_t    m_size;
+      |    };
+      |
+      |#endif /* #if defined( __cpp_lib_span ) */
+      |
+      |// Frees strings returned by the generated JSON serialize functions
+      |struct json_string_deleter
+      |    {
+      |    void operator()( char* json ) const noexcept { std::free( json ); }
+      |    };
+      |
+      |// Owning JSON string returned by the serialize methods of the wrapper classes
+      |using json_string = std::unique_ptr<char, json_string_deleter>;
+      |
+      |} /* namespace cdto */
+      |
+      |#endif /* #ifndef CDTO_CPP_SUPPORT_DEFINED */""".stripMargin
+
+  /**
+    * Creates the C++ header wrapping all messages of the protocol
+    * @param protocol Message protocol
+    * @return Definition of the protocol's C++ header
+    */
+  def apply(protocol: Protocol): FileDefinition = {
+    val name = fileName(protocol.name)
+    val guard = name.replaceAll("[^A-Za-z0-9_]", "_").toUpperCase
+
+    // The generated C headers have no C++ linkage specification of their own
+    val cHeaderIncludes =
+      s"""extern "C" {
+         |#include ${MessageTypeFiles.headerFileInclude(protocol.name)}
+         |#include ${MessageJSONFiles.headerFileInclude(protocol.name)}
+         |}""".stripMargin
+
+    val includes =
+      s"""#include <cstddef>
+         |#include <cstdint>
+         |#include <cstdlib>
+         |#include <memory>
+         |#include <string_view>
+         |
+         |#if defined( __has_include )
+         |#if __has_include( <span> ) && ( __cplusplus >= 202002L )
+         |#include <span>
+         |#endif
+         |#endif
+         |
+         |$cHeaderIncludes""".stripMargin
+
+    val classes = protocol.messages.map(wrapperClass).mkString("\n\n")
+
+    val contents = List(
+      SourceFile.prelude(name, s"Contains C++ wrappers for ${protocol.name} types."),
+      s"#ifndef $guard\n#define $guard\n",
+      includes,
+      "",
+      SourceFile.definitions(List(
+        supportDefinitions,
+        s"namespace ${namespaceName(protocol.name)}\n{\n\n$classes\n\n} /* namespace ${namespaceName(protocol.name)} */"
+      )),
+      s"#endif /* #ifndef $guard */",
+      ""
+    ).mkString("\n")
+
+    FileDefinition(name, contents)
+  }
+
+  /**
+    * Gets the name of the C++ header wrapping the protocol's messages
+    * @param protocolName Name of the message protocol
+    * @return Name of the protocol's C++ header
+    */
+  def fileName(protocolName: String): String = {
+    s"$protocolName.hpp"
+  }
+
+  /**
+    * Gets the namespace containing the wrapper classes. The conversion will be:
+    * my_protocol.cdto -> my_protocol_cdto
+    * @param protocolName Name of the message protocol
+    * @return Name of the protocol's C++ namespace
+    */
+  def namespaceName(protocolName: String): String = {
+    protocolName.replaceAll("[^A-Za-z0-9_]", "_")
+  }
+
+  /**
+    * Gets the name of the accessor of a field
+    * @param message Message containing the field
+    * @param field Field to access
+    * @return Name of the field's accessor method
+    */
+  def accessorName(message: Message, field: Field): String = {
+    if(memberNames.contains(field.name) || field.name == message.name) {
+      s"${field.name}_field"
+    } else {
+      field.name
+    }
+  }
+
+  /**
+    * @param message Message to wrap
+    * @return Definition of the message's wrapper class
+    */
+  private def wrapperClass(message: Message): String = {
+    val className = message.name
+    val cStruct = s"::${MessageStruct.structName(message)}"
+    val init = s"::${MessageInitFunction.name(message.name)}"
+    val free = s"::${MessageFreeFunction.name(message.name)}"
+
+    val accessors = message.fields.map(fieldAccessor(message, _)).mkString("\n\n")
+
+    s"""// Owns a $className and frees it when destroyed
+       |class $className
+       |    {
+       |public:
+       |    $className() noexcept { $init( &$structMember ); }
+       |    ~$className() { $free( &$structMember ); }
+       |
+       |    $className( $className const& ) = delete;
+       |    $className& operator=( $className const& ) = delete;
+       |
+       |    // Takes ownership of the other message's memory, leaving it empty
+       |    $className( $className&& other ) noexcept : $structMember( other.$structMember ) { $init( &other.$structMember ); }
+       |
+       |    $className& operator=( $className&& other ) noexcept
+       |        {
+       |        if( this != &other )
+       |            {
+       |            $free( &$structMember );
+       |            $structMember = other.$structMember;
+       |            $init( &other.$structMember );
+       |            }
+       |
+       |        return *this;
+       |        }
+       |
+       |    void swap( $className& other ) noexcept
+       |        {
+       |        $cStruct temp = $structMember;
+       |        $structMember = other.$structMember;
+       |        other.$structMember = temp;
+       |        }
+       |
+       |    // Gets the wrapped C struct. Memory stored into it is owned by this object.
+       |    $cStruct& get() noexcept { return $structMember; }
+       |    $cStruct const& get() const noexcept { return $structMember; }
+       |
+       |$accessors
+       |
+       |    // Replaces the contents with the message parsed from the JSON string. On error,
+       |    // returns false and leaves the message empty.
+       |    bool parse( char const* json ) noexcept
+       |        {
+       |        $free( &$structMember );
+       |        return 0 != ::${MessageJSONStringParser.name(message.name)}( json, &$structMember );
+       |        }
+       |
+       |    // Serializes the message to an unformatted JSON string. Returns false on error.
+       |    bool serialize( cdto::json_string& json_out ) const noexcept
+       |        {
+       |        return serialize( ::${MessageJSONStringSerializer.name(message.name)}, json_out );
+       |        }
+       |
+       |    // Serializes the message to a formatted JSON string. Returns false on error.
+       |    bool serialize_pretty( cdto::json_string& json_out ) const noexcept
+       |        {
+       |        return serialize( ::${MessageJSONPrettyStringSerializer.name(message.name)}, json_out );
+       |        }
+       |
+       |private:
+       |    bool serialize( int ( *serializer )( $cStruct const*, char** ), cdto::json_string& json_out ) const noexcept
+       |        {
+       |        char* json;
+       |        bool success;
+       |
+       |        json = nullptr;
+       |        success = ( 0 != serializer( &$structMember, &json ) );
+       |        json_out.reset( success ? json : nullptr );
+       |
+       |        return success;
+       |        }
+       |
+       |    $cStruct $structMember;
+       |    };""".stripMargin
+  }
+
+  /**
+    * @param message Message containing the field
+    * @param field Field to access
+    * @return Definition of the field's read-only accessor
+    */
+  private def fieldAccessor(message: Message, field: Field): String = {
+    val name = accessorName(message, field)
+    val member = s"$structMember.${field.name}"
+
+    field.fieldType match {
+      case ArrayType(elementType) => arrayAccessor(name, member, field, elementType)
+      case InlineArrayType(elementType, _) => arrayAccessor(name, InlineArray.elements(member), field, elementType)
+      case BytesType =>
+        val spanType = "cdto::span<std::uint8_t const>"
+        s"    $spanType $name() const noexcept { return $spanType( ${Bytes.data(member)}, ${Bytes.length(member)} ); }"
+      case simpleType: SimpleFieldType => simpleAccessor(name, member, simpleType)
+    }
+  }
+
+  /**
+    * @param name Name of the accessor
+    * @param array Expression of the array's elements
+    * @param field Array field to access
+    * @param elementType Type of elements contained in the array
+    * @return Definition of the accessor of an array field, as a span of its elements
+    */
+  private def arrayAccessor(name: String, array: String, field: Field, elementType: SimpleFieldType): String = {
+    val spanType = s"cdto::span<${elementCType(elementType)} const>"
+    val count = s"$structMember.${MessageStruct.arrayCountFieldName(field.name)}"
+    s"    $spanType $name() const noexcept { return $spanType( $array, static_cast<std::size_t>( $count ) ); }"
+  }
+
+  /**
+    * @param name Name of the accessor
+    * @param member Expression of the struct member to access
+    * @param fieldType Type of the field
+    * @return Definition of the accessor of a field that is not an array
+    */
+  private def simpleAccessor(name: String, member: String, fieldType: SimpleFieldType): String = {
+    fieldType match {
+      case ObjectType(objectName) =>
+        s"    ::$objectName const& $name() const noexcept { return $member; }"
+
+      case BooleanType | AliasedType(_, BooleanType) =>
+        s"    bool $name() const noexcept { return 0 != $member; }"
+
+      case DynamicStringType | InternedStringType | AliasedType(_, DynamicStringType | InternedStringType) =>
+        s"    std::string_view $name() const noexcept { return ( nullptr == $member ) ? std::string_view() : std::string_view( $member ); }"
+
+      case FixedStringType(_) | AliasedType(_, FixedStringType(_)) =>
+        s"    std::string_view $name() const noexcept { return std::string_view( $member ); }"
+
+      case InlineStringType(_) =>
+        s"    std::string_view $name() const noexcept { return std::string_view( ${InlineString.value(member)} ); }"
+
+      case NumberType =>
+        s"    ${Constants.defaultNumberCType} $name() const noexcept { return $member; }"
+
+      case TimestampType =>
+        s"    std::int64_t $name() const noexcept { return $member; }"
+
+      case EnumType(enumName, _) =>
+        s"    ::$enumName $name() const noexcept { return $member; }"
+
+      case AliasedType(alias, NumberType | TimestampType) =>
+        s"    $alias $name() const noexcept { return $member; }"
+    }
+  }
+
+  /**
+    * @param elementType Type of elements contained in an array
+    * @return C type of one element of the array as seen from the wrapper's namespace
+    */
+  private def elementCType(elementType: SimpleFieldType): String = {
+    val pointerType = MessageStruct.arrayFieldType(elementType).stripSuffix("*")
+
+    elementType match {
+      case ObjectType(_) | EnumType(_, _) => s"::$pointerType"
+      case _ => pointerType
+    }
+  }
+}
@@ -16,8 +16,14 @@ case class CFunction(declaration: String, implementation: String)
   * @param prototype Function's prototype
   * @param body Body of the function. This should contain all statements for the function separated by semicolons and
   *             newlines. Do NOT include the surrounding braces in this string.
+  * @param preprocessorGuard Name of a macro that must be defined for the function to be declared and defined. If None,
+  *                          the function is always declared and defined.
   */
-case class FunctionDefinition(name: String, documentation: FunctionDocumentation, prototype: FunctionPrototype, body: String)
+case class FunctionDefinition(name: String,
+                              documentation: FunctionDocumentation,
+                              prototype: FunctionPrototype,
+                              body: String,
+                              preprocessorGuard: Option[String] = None)
 
 /**
   * Contains documentation for a C function.
@@ -12,11 +12,43 @@ object FunctionGenerator {
     */
   def apply(definition: FunctionDefinition): CFunction = {
     CFunction(
-      declaration = functionDeclaration(definition),
-      implementation = functionImplementation(definition)
+      declaration = declaration(definition),
+      implementation = implementation(definition)
     )
   }
 
+  /**
+    * Generates only the string necessary to declare a C function
+    * @param definition Definition of function to generate
+    * @return String to declare the function
+    */
+  def declaration(definition: FunctionDefinition): String = {
+    guarded(definition, functionDeclaration(definition))
+  }
+
+  /**
+    * Generates only the string necessary to define a C function
+    * @param definition Definition of function to generate
+    * @return String to define the function
+    */
+  def implementation(definition: FunctionDefinition): String = {
+    guarded(definition, functionImplementation(definition))
+  }
+
+  /**
+    * Surrounds the given declaration or implementation string with #ifdef/#endif
+    * directives if the function has a preprocessor guard
+    * @param definition Definition of the function
+    * @param code Declaration or implementation string of the function
+    * @return Code string that is only compiled when the function's guard macro is defined
+    */
+  private def guarded(definition: FunctionDefinition, code: String): String = {
+    definition.preprocessorGuard match {
+      case None => code
+      case Some(guard) => s"#ifdef $guard\n$code\n#endif /* #ifdef $guard */"
+    }
+  }
+
   /**
     * Generates the declaration string for the function
     * @param definition Definition of the function
@@ -85,11 +117,15 @@ object FunctionGenerator {
     * @return String containing the implementation of the C function
     */
   private def functionImplementation(definition: FunctionDefinition): String = {
-    s"""${functionDocumentationHeader(definition)}
-       |${functionSignature(definition)}
-       |{
-       |${definition.body.trim}
-       |}    /* ${definition.name}()    */""".stripMargin
+    // The body is appended as-is rather than margin-stripped with the rest of the
+    // implementation, which would rescan every line of the body
+    List(
+      functionDocumentationHeader(definition),
+      functionSignature(definition),
+      "{",
+      definition.body.trim,
+      s"}    /* ${definition.name}()    */"
+    ).mkString("\n")
   }
 
   /**
@@ -0,0 +1,67 @@
+package codegen.functions
+
+import scala.collection.mutable
+
+object ReferencedFunctions {
+
+  private val identifierPattern = "[A-Za-z_][A-Za-z0-9_]*".r
+
+  /**
+    * Removes the static functions of a C source file that are never called. Static helpers
+    * are collected for a whole source file, and compilers warn about the ones that none of
+    * the file's functions use. A static function that is only called by functions with the
+    * same preprocessor guard is placed under that guard, so that it is not left unused when
+    * the guard's macro is not defined.
+    * @param functions Functions to define in a C source file
+    * @param definitions Macro and variable definitions of the C source file, which may refer
+    *                    to static functions
+    * @return The non-static functions and the static functions that they or the definitions
+    *         call, directly or indirectly, in their original order
+    */
+  def apply(functions: Seq[FunctionDefinition], definitions: Seq[String]): Seq[FunctionDefinition] = {
+    val staticFunctions = functions.filter(_.prototype.isStatic).map(function => function.name -> function).toMap
+
+    // Guard under which each static function is called, None if it is called unguarded
+    val guards = mutable.Map[String, Option[String]]()
+    val pending = mutable.Queue[(String, Option[String])]()
+
+    pending ++= functions.filterNot(_.prototype.isStatic).map(function => (function.body, function.preprocessorGuard))
+    pending ++= definitions.map(definition => (definition, None))
+
+    while(pending.nonEmpty) {
+      val (code, guard) = pending.dequeue()
+
+      for(name <- calledNames(code, staticFunctions.keySet)) {
+        val function = staticFunctions(name)
+        val calledGuard = function.preprocessorGuard.orElse(guard)
+
+        // A function called under different guards can only be left unguarded
+        val updatedGuard = guards.get(name) match {
+          case None => Some(calledGuard)
+          case Some(None) => None
+          case Some(currentGuard) if currentGuard == calledGuard => None
+          case Some(_) => Some(None)
+        }
+
+        updatedGuard.foreach(newGuard => {
+          guards(name) = newGuard
+          pending.enqueue((function.body, newGuard))
+        })
+      }
+    }
+
+    functions.flatMap(function => {
+      if(!function.prototype.isStatic) Some(function)
+      else guards.get(function.name).map(guard => function.copy(preprocessorGuard = guard))
+    })
+  }
+
+  /**
+    * @param code C code
+    * @param names Names of functions
+    * @return Names of the given functions that appear in the code
+    */
+  private def calledNames(code: String, names: collection.Set[String]): Set[String] = {
+    identifierPattern.findAllIn(code).filter(names.contains).toSet
+  }
+}
@@ -0,0 +1,212 @@
+package codegen.json
+
+import codegen.Constants
+import codegen.allocator.Allocator
+import codegen.functions._
+import codegen.json.stats.MessageJSONStats
+
+/**
+  * cJSON only supports process-wide allocation hooks. To route cJSON's internal allocations
+  * through the allocator passed to a generated _ex function, the generated code installs
+  * hooks that forward to the allocator of the _ex call currently running on the calling
+  * thread, and to malloc()/free() when no such call is running. The thread-local allocator
+  * and the installation state are shared by every generated translation unit of a program,
+  * so the hooks installed by any of them allocate and free through the same allocator.
+  */
+object CJSONAllocatorHooks {
+
+  private val threadLocalName = "cdto_cjson_allocator"
+  private val hooksStateName = "cdto_cjson_hooks_state"
+  private val sizeParam = "size"
+  private val pointerParam = "ptr"
+  private val previousParam = "previous"
+
+  /**
+    * Expression of the calling thread's cJSON allocator, which allocates the memory of
+    * the cJSON trees and strings of the running _ex call
+    */
+  val activeAllocator: String = threadLocalName
+
+  /**
+    * Name of the local variable that saves the thread's previous cJSON allocator
+    */
+  val previousAllocatorVar: String = "previous_allocator"
+
+  /**
+    * Declaration of the local variable needed by the push and pop statements
+    */
+  val previousAllocatorDeclaration: String = s"${Allocator.parameter.paramType} $previousAllocatorVar;"
+
+  /**
+    * Statement that makes the allocator parameter the calling thread's cJSON allocator
+    */
+  val push: String = s"$previousAllocatorVar = ${pushFunction.name}( ${Allocator.paramName} );"
+
+  /**
+    * Statement that restores the calling thread's previous cJSON allocator
+    */
+  val pop: String = s"${popFunction.name}( $previousAllocatorVar );"
+
+  /**
+    * Definitions of the thread-local allocator and the hook installation state. They are weak
+    * symbols so that every generated translation unit linked into a program, of any protocol
+    * or shard, shares a single definition. Compilers without weak symbols are only supported
+    * when CDTO_SINGLE_UNIT declares that a single generated JSON source file is linked into
+    * the program. The state is 0 before the hooks are installed, 1 while a thread installs
+    * them and 2 afterwards, and is accessed atomically.
+    */
+  val definitions: String =
+    s"""#if defined( __STDC_VERSION__ ) && ( __STDC_VERSION__ >= 201112L )
+       |#define CDTO_THREAD_LOCAL _Thread_local
+       |#else
+       |#define CDTO_THREAD_LOCAL __thread
+       |#endif
+       |
+       |#if defined( __GNUC__ )
+       |#define CDTO_SHARED __attribute__(( weak ))
+       |#elif defined( CDTO_SINGLE_UNIT )
+       |#define CDTO_SHARED static
+       |#else
+       |#error "Sharing the cJSON allocator between generated source files requires weak symbols, define CDTO_SINGLE_UNIT if only one is linked into the program"
+       |#endif
+       |
+       |#if defined( __STDC_VERSION__ ) && ( __STDC_VERSION__ >= 201112L ) && !defined( __STDC_NO_ATOMICS__ )
+       |#include <stdatomic.h>
+       |#define CDTO_ATOMIC_INT atomic_int
+       |#define CDTO_ATOMIC_LOAD( _obj ) atomic_load( _obj )
+       |#define CDTO_ATOMIC_STORE( _obj, _value ) atomic_store( _obj, _value )
+       |#define CDTO_ATOMIC_EXCHANGE_IF( _obj, _expected, _value ) atomic_compare_exchange_strong( _obj, _expected, _value )
+       |#elif defined( __GNUC__ )
+       |#define CDTO_ATOMIC_INT int
+       |#define CDTO_ATOMIC_LOAD( _obj ) __atomic_load_n( _obj, __ATOMIC_SEQ_CST )
+       |#define CDTO_ATOMIC_STORE( _obj, _value ) __atomic_store_n( _obj, _value, __ATOMIC_SEQ_CST )
+       |#define CDTO_ATOMIC_EXCHANGE_IF( _obj, _expected, _value ) __atomic_compare_exchange_n( _obj, _expected, _value, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST )
+       |#else
+       |#error "Installing the cJSON allocation hooks requires C11 atomics or GCC-compatible atomic builtins"
+       |#endif
+       |
+       |CDTO_SHARED CDTO_THREAD_LOCAL ${Allocator.parameter.paramType} $threadLocalName;
+       |CDTO_SHARED CDTO_ATOMIC_INT $hooksStateName;""".stripMargin
+
+  /**
+    * Gets the expression to allocate memory through the calling thread's cJSON allocator.
+    * This is for temporary buffers of functions that have no allocator parameter.
+    * @param size Expression of the number of bytes to allocate
+    * @return Expression allocating the memory
+    */
+  def malloc(size: String): String = {
+    s"${Allocator.mallocFunction.name}( $threadLocalName, $size )"
+  }
+
+  /**
+    * Gets the statement to free memory allocated with malloc
+    * @param pointer Expression of the memory to free
+    * @return Statement freeing the memory
+    */
+  def free(pointer: String): String = {
+    s"${Allocator.freeFunction.name}( $threadLocalName, $pointer )"
+  }
+
+  /**
+    * All functions needed to install and use the cJSON allocation hooks
+    */
+  def functions: Seq[FunctionDefinition] = List(mallocHook, freeHook, pushFunction, popFunction)
+
+  private def mallocHook: FunctionDefinition = FunctionDefinition(
+    name = "cdto_cjson_malloc",
+    documentation = FunctionDocumentation(
+      shortSummary = "cJSON allocation hook",
+      description = "Allocates memory for cJSON through the calling thread's active allocator and counts the allocation when CDTO_STATS is defined."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = "void*",
+      parameters = List(FunctionParameter(paramType = "size_t", paramName = sizeParam))
+    ),
+    body =
+      s"""void* memory;
+         |
+         |memory = ${Allocator.mallocFunction.name}( $threadLocalName, $sizeParam );
+         |${MessageJSONStats.allocated("memory")}
+         |
+         |return memory;""".stripMargin
+  )
+
+  private def freeHook: FunctionDefinition = FunctionDefinition(
+    name = "cdto_cjson_free",
+    documentation = FunctionDocumentation(
+      shortSummary = "cJSON free hook",
+      description = "Frees cJSON memory through the calling thread's active allocator and counts the free when CDTO_STATS is defined."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.voidCType,
+      parameters = List(FunctionParameter(paramType = "void*", paramName = pointerParam))
+    ),
+    body =
+      s"""${MessageJSONStats.freed(pointerParam)}
+         |${Allocator.freeFunction.name}( $threadLocalName, $pointerParam );""".stripMargin
+  )
+
+  private def pushFunction: FunctionDefinition = FunctionDefinition(
+    name = "cdto_cjson_allocator_push",
+    documentation = FunctionDocumentation(
+      shortSummary = "Set cJSON allocator",
+      description = "Makes the allocator the calling thread's cJSON allocator and returns the previous one. The hooks are only installed once a non-NULL allocator is used so programs that never pass an allocator keep cJSON's default allocation, unless CDTO_STATS is defined and the hooks count cJSON's allocations. Threads that pass an allocator while another thread installs the hooks wait until they are installed."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Allocator.parameter.paramType,
+      parameters = List(Allocator.parameter)
+    ),
+    body =
+      s"""${Allocator.parameter.paramType} $previousParam;
+         |cJSON_Hooks hooks;
+         |int install;
+         |int state;
+         |
+         |#ifdef ${MessageJSONStats.guard}
+         |// The hooks count cJSON's allocations, so they are needed even without an allocator
+         |install = 1;
+         |#else
+         |install = ( NULL != ${Allocator.paramName} );
+         |#endif
+         |
+         |if( install && ( 2 != CDTO_ATOMIC_LOAD( &$hooksStateName ) ) )
+         |    {
+         |    state = 0;
+         |    if( CDTO_ATOMIC_EXCHANGE_IF( &$hooksStateName, &state, 1 ) )
+         |        {
+         |        hooks.malloc_fn = ${mallocHook.name};
+         |        hooks.free_fn = ${freeHook.name};
+         |        cJSON_InitHooks( &hooks );
+         |        CDTO_ATOMIC_STORE( &$hooksStateName, 2 );
+         |        }
+         |
+         |    // Memory cJSON allocates before the hooks are installed would be freed through the
+         |    // allocator, so wait for the thread installing them
+         |    while( 2 != CDTO_ATOMIC_LOAD( &$hooksStateName ) )
+         |        {
+         |        }
+         |    }
+         |
+         |$previousParam = $threadLocalName;
+         |$threadLocalName = ${Allocator.paramName};
+         |
+         |return $previousParam;""".stripMargin
+  )
+
+  private def popFunction: FunctionDefinition = FunctionDefinition(
+    name = "cdto_cjson_allocator_pop",
+    documentation = FunctionDocumentation(
+      shortSummary = "Restore cJSON allocator",
+      description = "Restores the calling thread's previous cJSON allocator."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.voidCType,
+      parameters = List(FunctionParameter(paramType = Allocator.parameter.paramType, paramName = previousParam))
+    ),
+    body = s"$threadLocalName = $previousParam;"
+  )
+}
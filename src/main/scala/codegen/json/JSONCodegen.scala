@@ -0,0 +1,30 @@
+package codegen.json
+
+/**
+  * Strategies for generating the code that parses and serializes messages to and from JSON
+  */
+sealed trait JSONCodegen
+
+/**
+  * Generates specialized parse and serialize code for every field of every message. This
+  * is the fastest code, but its size grows with the number of fields in the protocol.
+  */
+case object SpecializedJSONCodegen extends JSONCodegen
+
+/**
+  * Generates a constant descriptor table for every message along with a single generic
+  * runtime that parses and serializes messages by interpreting the tables. The code size
+  * is nearly independent of the number of fields in the protocol.
+  */
+case object TableJSONCodegen extends JSONCodegen
+
+object JSONCodegen {
+
+  /**
+    * Code generation strategies by their command-line names
+    */
+  val byName: Map[String, JSONCodegen] = Map(
+    "specialized" -> SpecializedJSONCodegen,
+    "tables" -> TableJSONCodegen
+  )
+}
@@ -0,0 +1,62 @@
+package codegen.json
+
+/**
+  * Optional families of JSON functions. Every message always gets functions to parse
+  * JSON strings and serialize to JSON strings; the functions of each feature are only
+  * generated when the feature is enabled, along with the runtime they use.
+  */
+sealed trait JSONFeature
+
+/**
+  * Functions to validate JSON without parsing it, see MessageJSONValidator
+  */
+case object ValidateJSONFeature extends JSONFeature
+
+/**
+  * Functions to extract single fields from JSON, see MessageJSONExtractor
+  */
+case object ExtractJSONFeature extends JSONFeature
+
+/**
+  * Resumable serializers that write JSON into caller-provided buffers, see MessageJSONWriter
+  */
+case object WriterJSONFeature extends JSONFeature
+
+/**
+  * Functions to parse length-delimited buffers and memory-mapped files
+  */
+case object BuffersJSONFeature extends JSONFeature
+
+/**
+  * Functions to parse length-delimited buffers within resource limits. These build on the
+  * buffer parse functions, so this feature also enables BuffersJSONFeature.
+  */
+case object LimitsJSONFeature extends JSONFeature
+
+object JSONFeature {
+
+  /**
+    * Features by their command-line names
+    */
+  val byName: Map[String, JSONFeature] = Map(
+    "validate" -> ValidateJSONFeature,
+    "extract" -> ExtractJSONFeature,
+    "writer" -> WriterJSONFeature,
+    "buffers" -> BuffersJSONFeature,
+    "limits" -> LimitsJSONFeature
+  )
+
+  /**
+    * All features
+    */
+  val all: Set[JSONFeature] = byName.values.toSet
+
+  /**
+    * Adds the features that the given features build on
+    * @param features Requested features
+    * @return Requested features along with the features they need
+    */
+  def withDependencies(features: Set[JSONFeature]): Set[JSONFeature] = {
+    if(features.contains(LimitsJSONFeature)) features + BuffersJSONFeature else features
+  }
+}
@@ -1,11 +1,20 @@
 package codegen.json
 
 import codegen.Constants
+import codegen.allocator.Allocator
+import codegen.base64.Base64
 import codegen.functions._
+import codegen.json.extraction.MessageJSONExtractor
+import codegen.json.parallel._
 import codegen.json.parsing._
 import codegen.json.serialization._
+import codegen.json.scanning.JSONScanner
+import codegen.json.stats.MessageJSONStats
+import codegen.json.tables._
+import codegen.json.validation.MessageJSONValidator
 import codegen.messagetypes._
 import codegen.sourcefile._
+import codegen.timestamp.Timestamp
 import datamodel._
 
 object MessageJSONFiles {
@@ -14,15 +23,20 @@ object MessageJSONFiles {
     * Gets the header and C source file definitions that contain functions
     * to parse and serialize messages to and from JSON
     * @param protocol Message protocol
+    * @param codegen Strategy for generating the parse and serialize code
+    * @param features Optional families of functions to generate
     * @return Files containing functions to parse and serialize all messages
     *         in the protocol to and from JSON.
     */
-  def apply(protocol: Protocol): SourceFilePair = {
-    val functions = protocolJSONFunctions(protocol)
+  def apply(protocol: Protocol,
+            codegen: JSONCodegen = SpecializedJSONCodegen,
+            features: Set[JSONFeature] = Set.empty): SourceFilePair = {
+    val enabledFeatures = JSONFeature.withDependencies(features)
+    val functions = protocolJSONFunctions(protocol, codegen, enabledFeatures)
 
     SourceFilePair(
-      headerFile = headerFile(protocol.name, functions),
-      cFile = cFile(protocol.name, functions)
+      headerFile = headerFile(protocol, functions, enabledFeatures),
+      cFile = cFile(protocol, functions, codegen, enabledFeatures)
     )
   }
 
@@ -57,161 +71,606 @@ object MessageJSONFiles {
     s"$protocolName.json.h"
   }
 
+  /**
+    * Gets the header and C source file definitions that contain functions to parse and
+    * serialize messages to and from JSON, with the functions split into multiple C source
+    * files by message. Each message is assigned to a shard by the hash of its name so that
+    * adding or removing a message only changes the contents of a single shard. Functions
+    * that are called across shards are declared in an internal header.
+    * @param protocol Message protocol
+    * @param shardCount Number of C source files to split the functions into
+    * @param codegen Strategy for generating the parse and serialize code
+    * @param features Optional families of functions to generate
+    * @return Files containing functions to parse and serialize all messages in the protocol
+    *         to and from JSON
+    */
+  def sharded(protocol: Protocol,
+              shardCount: Int,
+              codegen: JSONCodegen = SpecializedJSONCodegen,
+              features: Set[JSONFeature] = Set.empty): ShardedSourceFiles = {
+    require(shardCount > 0)
+
+    val enabledFeatures = JSONFeature.withDependencies(features)
+    val context = ProtocolContext(protocol)
+    val messagesByShard = protocol.messages.groupBy(shardIndex(_, shardCount))
+
+    val internalFunctions = protocol.messages.flatMap(messageFunctions(context, _, codegen, enabledFeatures)).filter(_.prototype.isStatic)
+
+    val cFiles = (0 until shardCount).map(shard => {
+      val messages = messagesByShard.getOrElse(shard, Nil)
+      shardCFile(protocol.name, shard, messages, shardFunctions(context, messages, codegen, enabledFeatures), codegen, enabledFeatures)
+    })
+
+    ShardedSourceFiles(
+      headerFile = headerFile(protocol, protocolJSONFunctions(protocol, codegen, enabledFeatures), enabledFeatures),
+      internalHeaderFile = internalHeaderFile(protocol, internalFunctions.map(exported), codegen),
+      cFiles = cFiles
+    )
+  }
+
+  /**
+    * Gets the name of the C source file containing the JSON parsing/serialization functions
+    * of a single shard
+    * @param protocolName Name of the protocol
+    * @param shard Index of the shard
+    * @return Name of the shard's C source file
+    */
+  def shardCFileName(protocolName: String, shard: Int): String = {
+    s"$protocolName.json.$shard.c"
+  }
+
+  /**
+    * Gets the name of the header file declaring the functions that are shared between
+    * the shards of a protocol's JSON functions
+    * @param protocolName Name of the protocol
+    * @return Name of protocol's internal JSON header
+    */
+  def internalHeaderFileName(protocolName: String): String = {
+    s"$protocolName.json.internal.h"
+  }
+
   /**
     * Gets the list of all functions necessary to transform protocol messages to and
     * from JSON
     * @param protocol Protocol
+    * @param codegen Strategy for generating the parse and serialize code
+    * @param features Optional families of functions to generate
     * @return List of all functions needed to transform protocol messages to and from
     *         JSON
     */
-  private def protocolJSONFunctions(protocol: Protocol): Seq[FunctionDefinition] = {
-    protocolParseFunctions(protocol) ++ protocolSerializeFunctions(protocol)
+  private def protocolJSONFunctions(protocol: Protocol, codegen: JSONCodegen, features: Set[JSONFeature]): Seq[FunctionDefinition] = {
+    val context = ProtocolContext(protocol)
+
+    protocol.messages.flatMap(messageFunctions(context, _, codegen, features)) ++ fileFunctions(protocol.messages, codegen)
   }
 
   /**
-    * Gets the list of all functions necessary to parse protocol
-    * @param protocol Protocol
-    * @return List of all functions to parse protocol messages from JSOn
+    * Gets the functions to place in a single shard: the functions of the shard's messages
+    * along with private copies of the helpers they use
+    * @param context Properties of the whole protocol
+    * @param messages Messages assigned to the shard
+    * @param codegen Strategy for generating the parse and serialize code
+    * @param features Optional families of functions to generate
+    * @return List of functions to define in the shard
     */
-  private def protocolParseFunctions(protocol: Protocol): Seq[FunctionDefinition] = {
-    val messageParseFunctions = protocol.messages.flatMap(message => List(
-      MessageJSONStringParser(message),
-      MessageJSONObjectParser(message)
+  private def shardFunctions(context: ProtocolContext,
+                             messages: Seq[Message],
+                             codegen: JSONCodegen,
+                             features: Set[JSONFeature]): Seq[FunctionDefinition] = {
+    if(messages.isEmpty) {
+      Nil
+    } else {
+      messages.flatMap(messageFunctions(context, _, codegen, features)).map(exported) ++ fileFunctions(messages, codegen)
+    }
+  }
+
+  /**
+    * Gets the static helper functions that the functions of the given messages may need. These
+    * are defined once in every C source file that uses them; CFile leaves out the ones that
+    * none of the file's functions call, e.g. the writer runtime without writers.
+    * @param messages Messages defined in the C source file
+    * @param codegen Strategy for generating the parse and serialize code
+    * @return List of static helper functions
+    */
+  private def fileFunctions(messages: Seq[Message], codegen: JSONCodegen): Seq[FunctionDefinition] = {
+    val codecFunctions = codegen match {
+      case SpecializedJSONCodegen => helperFunctions(messageFieldTypes(messages))
+      case TableJSONCodegen => JSONTableRuntime.functions
+    }
+
+    codecFunctions ++
+      bytesFunctions(messages, codegen) ++
+      timestampFunctions(messages, codegen) ++
+      JSONScanner.functions ++
+      JSONWriterRuntime.functions ++
+      Allocator.allocationFunctions ++
+      (Allocator.freeFunction +: JSONInput.parseLengthFunction +: CJSONAllocatorHooks.functions) ++
+      JSONParseLimits.functions ++
+      MessageJSONStats.functions(messages) ++
+      parallelRuntimeFunctions(messages) ++
+      cacheFunctions(messages, codegen) ++
+      internFunctions(messages, codegen) ++
+      enumFunctions(messages)
+  }
+
+  /**
+    * Gets the functions to decode and serialize bytes if the given messages have bytes
+    * fields. The table-driven runtime handles every type, so it always needs them. The
+    * base64 encode function is part of the writer runtime, which is always needed.
+    * @param messages Messages defined in the C source file
+    * @param codegen Strategy for generating the parse and serialize code
+    * @return List of bytes functions, empty if no message uses them
+    */
+  private def bytesFunctions(messages: Seq[Message], codegen: JSONCodegen): Seq[FunctionDefinition] = {
+    if(codegen == TableJSONCodegen || Bytes.isUsed(messages)) List(Base64.decodeFunction, BytesJSONSerializer.definition) else Nil
+  }
+
+  /**
+    * Gets the functions to scan and serialize timestamps if the given messages have
+    * timestamp fields. The table-driven runtime handles every type, so it always needs
+    * them. The timestamp codec is part of the writer runtime, which is always needed.
+    * @param messages Messages defined in the C source file
+    * @param codegen Strategy for generating the parse and serialize code
+    * @return List of timestamp functions, empty if no message uses them
+    */
+  private def timestampFunctions(messages: Seq[Message], codegen: JSONCodegen): Seq[FunctionDefinition] = {
+    if(codegen == TableJSONCodegen || Timestamp.isUsed(messages)) List(TimestampJSONParser.scanFunction, TimestampJSONSerializer.definition) else Nil
+  }
+
+  /**
+    * Gets the functions to convert the enums used by the given messages to and from their
+    * strings. The writers, validators and extractors use them with both code generation
+    * strategies.
+    * @param messages Messages defined in the C source file
+    * @return List of enum conversion functions, empty if no message uses enums
+    */
+  private def enumFunctions(messages: Seq[Message]): Seq[FunctionDefinition] = {
+    MessageEnum.enumTypes(messages).flatMap(enumType => List(
+      EnumJSONParser.fromStringFunction(enumType),
+      EnumJSONParser.scanFunction(enumType),
+      EnumJSONSerializer.toStringFunction(enumType)
     ))
-    val baseTypeParseFunctions = protocolFieldTypes(protocol).flatMap(baseTypeParseFunction)
+  }
+
+  /**
+    * Gets the function to intern strings if the given messages parse interned strings. The
+    * table-driven runtime handles every type, so it always needs it.
+    * @param messages Messages defined in the C source file
+    * @param codegen Strategy for generating the parse and serialize code
+    * @return List containing the intern function, empty if no message uses it
+    */
+  private def internFunctions(messages: Seq[Message], codegen: JSONCodegen): Seq[FunctionDefinition] = {
+    val usesInterning = codegen == TableJSONCodegen || messages.exists(_.fields.exists(field => Allocator.isInterned(field.fieldType)))
 
-    messageParseFunctions ++ baseTypeParseFunctions ++ arrayParseFunctions(protocol)
+    if(usesInterning) List(Allocator.internFunction) else Nil
   }
 
   /**
-    * Gets the list of functions to parse all array types used in the protocol
-    * @param protocol Message protocol
-    * @return List of functions to parse all array types used in the protocol
+    * Gets the function to update the JSON caches if any of the given messages is cached
+    * @param messages Messages defined in the C source file
+    * @param codegen Strategy for generating the parse and serialize code
+    * @return List containing the cache update function, empty if no message uses it
+    */
+  private def cacheFunctions(messages: Seq[Message], codegen: JSONCodegen): Seq[FunctionDefinition] = {
+    if(codegen == SpecializedJSONCodegen && messages.exists(_.cached)) List(MessageJSONCache.storeFunction) else Nil
+  }
+
+  /**
+    * Gets the definition of the cache lock if any of the given messages is cached
+    * @param messages Messages defined in the C source file
+    * @param codegen Strategy for generating the parse and serialize code
+    * @return List containing the cache lock definition, empty if no message uses it
+    */
+  private def cacheDefinitions(messages: Seq[Message], codegen: JSONCodegen): Seq[String] = {
+    if(codegen == SpecializedJSONCodegen && messages.exists(_.cached)) List(MessageJSONCache.definitions) else Nil
+  }
+
+  /**
+    * Gets the parallel parse runtime functions if any of the given messages can be parsed
+    * in parallel
+    * @param messages Messages defined in the C source file
+    * @return List of parallel parse runtime functions, empty if no message uses them
+    */
+  private def parallelRuntimeFunctions(messages: Seq[Message]): Seq[FunctionDefinition] = {
+    if(messages.exists(MessageJSONParallelParser.parallelFields(_).nonEmpty)) JSONParallelRuntime.functions else Nil
+  }
+
+  /**
+    * Gets all functions that are specific to a single message: the public parse and serialize
+    * functions, the static object parse and serialize functions, the functions to parse and
+    * serialize arrays of the message if any field uses them, the parallel parse functions, the
+    * cached serializers of cached messages, and the functions of the enabled features.
+    * With table-driven code generation, the object functions delegate to the runtime,
+    * which also handles arrays.
+    * @param context Properties of the whole protocol
+    * @param message Message
+    * @param codegen Strategy for generating the parse and serialize code
+    * @param features Optional families of functions to generate
+    * @return List of the message's JSON functions
+    */
+  private def messageFunctions(context: ProtocolContext,
+                               message: Message,
+                               codegen: JSONCodegen,
+                               features: Set[JSONFeature]): Seq[FunctionDefinition] = {
+    val inlineArrayParser =
+      if(context.inlineObjectArrays.contains(message.name)) List(ArrayJSONParser.inlineFunction(ObjectType(message.name)))
+      else Nil
+
+    val objectFunctions = codegen match {
+      case SpecializedJSONCodegen if context.usedInArrays(message.name) => List(
+        MessageJSONObjectParser(message),
+        MessageJSONObjectSerializer(message),
+        ArrayJSONParser(ObjectType(message.name))
+      ) ++ inlineArrayParser :+ MessageArrayJSONSerializer(message.name)
+      case SpecializedJSONCodegen => List(MessageJSONObjectParser(message), MessageJSONObjectSerializer(message))
+      case TableJSONCodegen => List(MessageJSONObjectParser.tableDriven(message), MessageJSONObjectSerializer.tableDriven(message))
+    }
+
+    val elementParser =
+      if(context.objectArrays.contains(message.name)) List(MessageJSONParallelParser.elementParser(message))
+      else Nil
+
+    val parallelParsers =
+      if(MessageJSONParallelParser.parallelFields(message).nonEmpty) List(MessageJSONParallelParser(message), MessageJSONParallelParser.withAllocator(message))
+      else Nil
+
+    // Only the specialized serializers use the JSON kept by cached messages
+    val usesCache = codegen == SpecializedJSONCodegen && message.cached
+    val cacheFunctions =
+      if(!usesCache) Nil
+      else if(context.cachedObjectArrays.contains(message.name)) List(
+        MessageJSONCache.validFunction(message, context.cachedMessages),
+        MessageJSONCache.arrayValidFunction(message),
+        MessageJSONObjectSerializer.cached(message, context.cachedMessages),
+        MessageArrayJSONSerializer.cached(message.name)
+      )
+      else List(
+        MessageJSONCache.validFunction(message, context.cachedMessages),
+        MessageJSONObjectSerializer.cached(message, context.cachedMessages)
+      )
+
+    val stringFunctions = List(
+      MessageJSONStringParser(message),
+      MessageJSONStringParser.withAllocator(message),
+      MessageJSONStringSerializer(message),
+      MessageJSONStringSerializer.withAllocator(message, usesCache),
+      MessageJSONPrettyStringSerializer(message),
+      MessageJSONPrettyStringSerializer.withAllocator(message)
+    )
+
+    objectFunctions ++ elementParser ++ parallelParsers ++ cacheFunctions ++ stringFunctions ++ features.toSeq.flatMap({
+      case ValidateJSONFeature => List(MessageJSONValidator(message), MessageJSONValidator.objectValidator(message))
+      case ExtractJSONFeature => MessageJSONExtractor(message, context.messagesByName)
+      case WriterJSONFeature => List(MessageJSONWriter.init(message), MessageJSONWriter.fill(message), MessageJSONWriter.step(message))
+      case BuffersJSONFeature => List(
+        MessageJSONStringParser.withLength(message),
+        MessageJSONStringParser.withLengthAndAllocator(message),
+        MessageJSONStringParser.fromFile(message),
+        MessageJSONStringParser.fromFileWithAllocator(message)
+      )
+      case LimitsJSONFeature => List(MessageJSONStringParser.withLimits(message), MessageJSONStringParser.withLimitsAndAllocator(message))
+    })
+  }
+
+  /**
+    * Gets the static functions to parse and serialize the base types and arrays of base
+    * types used by the given field types. Several field types share the same helper, e.g.
+    * arrays of dynamic and fixed-length strings, so each helper is only returned once.
+    * @param fieldTypes Field types used in a C source file
+    * @return List of helper functions, without duplicates
     */
-  private def arrayParseFunctions(protocol: Protocol): Seq[FunctionDefinition] = {
-    val arrayFields = protocolFieldTypes(protocol).collect({ case array @ ArrayType(_) => array })
+  private def helperFunctions(fieldTypes: Set[FieldType]): Seq[FunctionDefinition] = {
+    // Inline arrays spill onto the heap, so they also need the helpers of plain arrays
+    val allFieldTypes = fieldTypes ++ fieldTypes.collect({ case InlineArrayType(elementType, _) => ArrayType(elementType) })
+
+    val baseTypeParseFunctions = allFieldTypes.flatMap(baseTypeParseFunction)
+    val arrayParseFunctions = allFieldTypes.collect({
+      case ArrayType(elementType) if !isObjectType(elementType) => ArrayJSONParser(elementType)
+    })
+    val inlineArrayParseFunctions = allFieldTypes.collect({
+      case InlineArrayType(elementType, _) if !isObjectType(elementType) => ArrayJSONParser.inlineFunction(elementType)
+    })
+    val booleanArrayFunctions = allFieldTypes.collect({
+      case ArrayType(BooleanType) | ArrayType(AliasedType(_, BooleanType)) => BooleanArrayJSONSerializer.definition
+    })
+    val enumArrayFunctions = allFieldTypes.collect({
+      case ArrayType(enumType: EnumType) => EnumJSONSerializer.arrayFunction(enumType)
+    })
+    val aliasedNumberArrayFunctions = allFieldTypes.collect({
+      case ArrayType(AliasedType(alias, NumberType)) => AliasedNumberArrayJSONSerializer.definition(alias)
+    })
+    val timestampArrayFunctions = allFieldTypes.collect({
+      case ArrayType(TimestampType) | ArrayType(AliasedType(_, TimestampType)) => TimestampJSONSerializer.arrayDefinition
+    })
+
+    val allFunctions = baseTypeParseFunctions.toSeq ++ arrayParseFunctions ++ inlineArrayParseFunctions ++ booleanArrayFunctions ++ enumArrayFunctions ++ aliasedNumberArrayFunctions ++ timestampArrayFunctions
 
-    arrayFields.map(array => ArrayJSONParser(array.elementType)).toSeq
+    allFunctions.groupBy(_.name).values.map(_.head).toSeq.sortBy(_.name)
   }
 
   /**
-    * Gets the function for parsing the provided type if it is a base field type
+    * Gets the function for parsing the provided type if it is a base field type or an
+    * array of base field types
     * @param fieldType Type of field to parse
-    * @return None if the provided type is not a base field type, the definition
+    * @return None if the provided type does not use a base field type, the definition
     *         of the function to parse the type otherwise
     */
   private def baseTypeParseFunction(fieldType: FieldType): Option[FunctionDefinition] = {
     fieldType match {
-      case ArrayType(_) => None
+      case ArrayType(aliasedType @ AliasedType(_, NumberType)) => baseTypeParseFunction(aliasedType)
+      case ArrayType(AliasedType(_, underlyingType)) => baseTypeParseFunction(ArrayType(underlyingType))
+      // In arrays, fixed-length strings are dynamically-allocated
+      case ArrayType(FixedStringType(_) | InlineStringType(_)) => Some(DynamicStringJSONParser.parseFunction)
+      case ArrayType(elementType) => baseTypeParseFunction(elementType)
+      case InlineArrayType(elementType, _) => baseTypeParseFunction(ArrayType(elementType))
+      case BytesType => Some(BytesJSONParser.parseFunction)
+      case AliasedType(alias, NumberType) => Some(AliasedNumberJSONParser.parseFunction(alias))
       case AliasedType(_, underlyingType) => baseTypeParseFunction(underlyingType)
       case ObjectType(_) => None
       case BooleanType => Some(BooleanJSONParser.parseFunction)
       case DynamicStringType => Some(DynamicStringJSONParser.parseFunction)
+      case InternedStringType => Some(InternedStringJSONParser.parseFunction)
       case FixedStringType(_) => Some(FixedStringJSONParser.parseFunction)
+      case InlineStringType(_) => Some(InlineStringJSONParser.parseFunction)
       case NumberType => Some(NumberJSONParser.parseFunction)
+      case TimestampType => Some(TimestampJSONParser.parseFunction)
+      case enumType: EnumType => Some(EnumJSONParser.parseFunction(enumType))
     }
   }
 
-  /** Gets the list of all functions necessary to serialize protocol messages
-    * to JSON
-    * @param protocol Protocol
-    * @return List of all functions to serialize protocol messages to JSON
+  /**
+    * Gets the definition of the protocol's JSON parsing/serialization header file
+    * @param protocol Message protocol
+    * @param parseFunctions List of functions to to declare.
+    * @param features Optional families of functions to generate
+    * @return Definition for the protocol's JSON parsing/serialization header file
     */
-  private def protocolSerializeFunctions(protocol: Protocol): Seq[FunctionDefinition] = {
-    val messageSerializeFunctions = protocol.messages.flatMap(message => List(
-      MessageJSONObjectSerializer(message),
-      MessageJSONStringSerializer(message),
-      MessageJSONPrettyStringSerializer(message)
-    ))
+  private def headerFile(protocol: Protocol, parseFunctions: Seq[FunctionDefinition], features: Set[JSONFeature]): FileDefinition = {
+    val name = headerFileName(protocol.name)
 
-    val arraySerializeFunctions = messageArraySerializeFunctions(protocol) ++ booleanArraySerializeFunction(protocol)
+    val inputDefinitions = if(features.contains(BuffersJSONFeature)) List(JSONInput.headerDefinitions) else Nil
+    val limitsDefinitions = if(features.contains(LimitsJSONFeature)) List(JSONParseLimits.headerDefinitions) else Nil
+    val writerDefinitions =
+      if(features.contains(WriterJSONFeature)) List(JSONWriterRuntime.typeDefinition, JSONWriterRuntime.depthCheck(MessageJSONWriter.maxDepth(protocol)))
+      else Nil
+
+    val contents = HeaderFile(
+      name = name,
+      description = "Declares functions for parsing and serializing messages to and from JSON",
+      includes = List(MessageTypeFiles.headerFileInclude(protocol.name)),
+      types = Nil,
+      functions = parseFunctions,
+      definitions = MessageJSONStats.headerDefinitions +: (inputDefinitions ++ limitsDefinitions ++ writerDefinitions)
+    )
 
-    messageSerializeFunctions ++ arraySerializeFunctions
+    FileDefinition(name, contents)
   }
 
   /**
-    * If any messages contain fields of arrays of other messages, then this
-    * returns the functions necessary to serialize any arrays of messages
-    * used in the protocol
+    * Gets the definition of the header file declaring the functions shared between the
+    * shards of the protocol's JSON parsing/serialization functions
     * @param protocol Message protocol
-    * @return List of functions necessary to serialize any arrays of messages
-    *         that are defined in the protocol
+    * @param internalFunctions List of functions called across shards
+    * @param codegen Strategy for generating the parse and serialize code
+    * @return Definition for the protocol's internal JSON header file
     */
-  private def messageArraySerializeFunctions(protocol: Protocol): Seq[FunctionDefinition] = {
-    val objectArrayFields = protocolFieldTypes(protocol).collect({ case ArrayType(ObjectType(objectName)) => objectName})
+  private def internalHeaderFile(protocol: Protocol,
+                                 internalFunctions: Seq[FunctionDefinition],
+                                 codegen: JSONCodegen): FileDefinition = {
+    val name = internalHeaderFileName(protocol.name)
 
-    objectArrayFields.map(MessageArrayJSONSerializer(_)).toSeq
+    // Message validators and descriptors refer to each other across shards
+    val definitions = JSONScanner.typeDefinition +: (codegen match {
+      case SpecializedJSONCodegen => Nil
+      // The runtime handles bytes even if the protocol has none
+      case TableJSONCodegen => List(
+        Bytes.typeDefinition,
+        MessageJSONDescriptor.typeDefinitions,
+        MessageJSONDescriptor.declarations(protocol.messages, isStatic = false)
+      )
+    })
+
+    val contents = HeaderFile(
+      name = name,
+      description = "Declares functions shared between the JSON parsing and serialization source files",
+      includes = List(Constants.stdintHeader, Constants.cJSONHeader, headerFileInclude(protocol.name)),
+      types = Nil,
+      functions = internalFunctions,
+      definitions = definitions
+    )
+
+    FileDefinition(name, contents)
   }
 
   /**
-    * If any messages have a field of an array of boolean values, then this gets
-    * the function to serialize an array of boolean values to JSON. If no messages
-    * contain such a field, then None is returned
+    * Gets the definition for the C source file containing the JSON parsing/serialization
+    * functions for the protocol
     * @param protocol Message protocol
-    * @return Definition of function to serialize an array of boolean values if any
-    *         messages contain such a field, None otherwise
+    * @param parseFunctions List of all function definitions to include in the C source file
+    * @param codegen Strategy for generating the parse and serialize code
+    * @param features Optional families of functions to generate
+    * @return Definition for the protocol's JSON parsing/serialization C source file
     */
-  private def booleanArraySerializeFunction(protocol: Protocol): Option[FunctionDefinition] = {
-    val booleanArrayFields = protocolFieldTypes(protocol).collect({ case ArrayType(BooleanType) => BooleanType })
+  private def cFile(protocol: Protocol,
+                    parseFunctions: Seq[FunctionDefinition],
+                    codegen: JSONCodegen,
+                    features: Set[JSONFeature]): FileDefinition = {
+    val protocolName = protocol.name
+    val name = cFileName(protocolName)
+
+    val descriptorDefinitions = codegen match {
+      case SpecializedJSONCodegen => Nil
+      case TableJSONCodegen => List(
+        Bytes.typeDefinition,
+        MessageJSONDescriptor.typeDefinitions,
+        MessageJSONDescriptor.declarations(protocol.messages, isStatic = true),
+        MessageJSONDescriptor.definitions(protocol.messages, isStatic = true)
+      )
+    }
+
+    val contents = CFile(
+      name = name,
+      description = "Contains functions for parsing and serializing messages to and from JSON",
+      includes = cFileIncludes(headerFileInclude(protocolName)),
+      functions = parseFunctions,
+      definitions = List(
+        CJSONAllocatorHooks.definitions,
+        MessageJSONStats.sourceDefinitions(protocol.messages),
+        JSONScanner.typeDefinition
+      ) ++ cacheDefinitions(protocol.messages, codegen) ++ featureSourceDefinitions(features) ++ List(
+        JSONParallelRuntime.definitions,
+        Base64.sourceDefinitions
+      ) ++ descriptorDefinitions
+    )
 
-    if(booleanArrayFields.isEmpty) None else Some(BooleanArrayJSONSerializer.definition)
+    FileDefinition(name, contents)
   }
 
   /**
-    * Gets the definition of the protocol's JSON parsing/serialization header file
+    * Gets the definition for the C source file containing the JSON parsing/serialization
+    * functions of a single shard
     * @param protocolName Name of the protocol
-    * @param parseFunctions List of functions to to declare.
-    * @return Definition for the protocol's JSON parsing/serialization header file
+    * @param shard Index of the shard
+    * @param messages Messages assigned to the shard
+    * @param parseFunctions List of all function definitions to include in the shard
+    * @param codegen Strategy for generating the parse and serialize code
+    * @param features Optional families of functions to generate
+    * @return Definition for the shard's C source file
     */
-  private def headerFile(protocolName: String, parseFunctions: Seq[FunctionDefinition]): FileDefinition = {
-    val name = headerFileName(protocolName)
+  private def shardCFile(protocolName: String,
+                         shard: Int,
+                         messages: Seq[Message],
+                         parseFunctions: Seq[FunctionDefinition],
+                         codegen: JSONCodegen,
+                         features: Set[JSONFeature]): FileDefinition = {
+    val name = shardCFileName(protocolName, shard)
 
-    val contents = HeaderFile(
+    val descriptorDefinitions = codegen match {
+      case SpecializedJSONCodegen => Nil
+      case TableJSONCodegen => List(MessageJSONDescriptor.definitions(messages, isStatic = false))
+    }
+
+    val definitions = if(messages.isEmpty) {
+      Nil
+    } else {
+      List(CJSONAllocatorHooks.definitions, MessageJSONStats.sourceDefinitions(messages)) ++
+        cacheDefinitions(messages, codegen) ++
+        featureSourceDefinitions(features) ++
+        List(JSONParallelRuntime.definitions, Base64.sourceDefinitions) ++
+        descriptorDefinitions
+    }
+
+    val contents = CFile(
       name = name,
-      description = "Declares functions for parsing and serializing messages to and from JSON",
-      includes = List(MessageTypeFiles.headerFileInclude(protocolName)),
-      types = Nil,
-      functions = parseFunctions
+      description = "Contains functions for parsing and serializing a subset of messages to and from JSON",
+      includes = cFileIncludes(s""""${internalHeaderFileName(protocolName)}""""),
+      functions = parseFunctions,
+      definitions = definitions
     )
 
     FileDefinition(name, contents)
   }
 
   /**
-    * Gets the definition for the C source file containing the JSON parsing/serialization
-    * functions for the protocol
-    * @param protocolName Name of the protocol
-    * @param parseFunctions List of all function definitions to include in the C source file
-    * @return Definition for the protocol's JSON parsing/serialization C source file
+    * Gets the definitions that the functions of the enabled features need in a JSON C
+    * source file
+    * @param features Optional families of functions to generate
+    * @return List of definitions, in a fixed order
     */
-  private def cFile(protocolName: String, parseFunctions: Seq[FunctionDefinition]): FileDefinition = {
-    val name = cFileName(protocolName)
-    val includes = List(
+  private def featureSourceDefinitions(features: Set[JSONFeature]): Seq[String] = {
+    val inputDefinitions = if(features.contains(BuffersJSONFeature)) List(JSONInput.sourceDefinitions) else Nil
+    val limitsDefinitions = if(features.contains(LimitsJSONFeature)) List(JSONParseLimits.sourceDefinitions) else Nil
+
+    inputDefinitions ++ limitsDefinitions
+  }
+
+  /**
+    * Gets the headers to include in a JSON C source file
+    * @param protocolHeader Include string of the protocol header declaring the file's functions
+    * @return List of headers to include
+    */
+  private def cFileIncludes(protocolHeader: String): Seq[String] = {
+    List(
+      Constants.ctypeHeader,
+      Constants.limitsHeader,
       Constants.stdioHeader,
+      Constants.stdintHeader,
       Constants.stdlibHeader,
       Constants.stringHeader,
       Constants.cJSONHeader,
-      headerFileInclude(protocolName)
+      protocolHeader
     )
+  }
 
-    val contents = CFile(
-      name = name,
-      description = "Contains functions for parsing and serializing messages to and from JSON",
-      includes = includes,
-      functions = parseFunctions
-    )
+  /**
+    * Gets the shard that the functions of a message are placed in
+    * @param message Message
+    * @param shardCount Total number of shards
+    * @return Index of the message's shard
+    */
+  private def shardIndex(message: Message, shardCount: Int): Int = {
+    Math.floorMod(message.name.hashCode, shardCount)
+  }
 
-    FileDefinition(name, contents)
+  /**
+    * Message functions that are static in a single C source file have external linkage
+    * when sharded so they can be called from other shards
+    * @param function Message function
+    * @return Function with external linkage
+    */
+  private def exported(function: FunctionDefinition): FunctionDefinition = {
+    function.copy(prototype = function.prototype.copy(isStatic = false))
   }
 
   /**
-    * Gets the set of all field types used in the protocol messages
-    * @param protocol Message protocol
-    * @return Set of field types used in the protocol messages
+    * @param fieldType Field type
+    * @return True if the field type is a message object, false otherwise
+    */
+  private def isObjectType(fieldType: SimpleFieldType): Boolean = {
+    fieldType match {
+      case ObjectType(_) => true
+      case _ => false
+    }
+  }
+
+  /**
+    * Properties of the whole protocol that the functions of individual messages depend on.
+    * They are computed once per protocol rather than once per message.
+    * @param objectArrays Names of messages used as the elements of array fields
+    * @param inlineObjectArrays Names of messages used as the elements of inline array fields
+    * @param messagesByName All messages of the protocol, by name
+    */
+  private case class ProtocolContext(objectArrays: Set[String], inlineObjectArrays: Set[String], messagesByName: Map[String, Message],
+                                     cachedMessages: Set[String], cachedObjectArrays: Set[String]) {
+    def usedInArrays(messageName: String): Boolean = objectArrays.contains(messageName) || inlineObjectArrays.contains(messageName)
+  }
+
+  private object ProtocolContext {
+    def apply(protocol: Protocol): ProtocolContext = {
+      val cachedMessages = protocol.messages.filter(_.cached).map(_.name).toSet
+
+      ProtocolContext(
+        objectArrays = messageFieldTypes(protocol.messages).collect({ case ArrayType(ObjectType(objectName)) => objectName }),
+        inlineObjectArrays = messageFieldTypes(protocol.messages).collect({ case InlineArrayType(ObjectType(objectName), _) => objectName }),
+        messagesByName = protocol.messages.map(message => message.name -> message).toMap,
+        cachedMessages = cachedMessages,
+        // Arrays of cached messages only reuse the cached JSON of their elements in cached messages
+        cachedObjectArrays = messageFieldTypes(protocol.messages.filter(_.cached)).collect({
+          case ArrayType(ObjectType(objectName)) if cachedMessages.contains(objectName) => objectName
+          case InlineArrayType(ObjectType(objectName), _) if cachedMessages.contains(objectName) => objectName
+        })
+      )
+    }
+  }
+
+  /**
+    * Gets the set of all field types used by the given messages
+    * @param messages Messages
+    * @return Set of field types used in the messages
     */
-  private def protocolFieldTypes(protocol: Protocol): Set[FieldType] = {
+  private def messageFieldTypes(messages: Seq[Message]): Set[FieldType] = {
     val fieldTypes = for {
-      message <- protocol.messages
+      message <- messages
       field <- message.fields
     } yield field.fieldType
 
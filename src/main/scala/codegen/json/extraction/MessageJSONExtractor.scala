@@ -0,0 +1,187 @@
+package codegen.json.extraction
+
+import codegen.Constants
+import codegen.functions._
+import codegen.json.parsing.{AliasedNumberJSONParser, EnumJSONParser, TimestampJSONParser}
+import codegen.json.scanning.JSONScanner
+import datamodel._
+
+/**
+  * Generates functions that read a single field out of a JSON message without parsing the
+  * whole message. An extractor is generated for every field path that leads through object
+  * fields to a boolean, number or string field (see FieldPaths), e.g.
+  * issue_json_extract_creator_name reads the login of the issue's user. Extractors scan to the field's key, skip every other member
+  * without allocating, and stop as soon as the value has been read, so the rest of the
+  * message is never looked at.
+  */
+object MessageJSONExtractor {
+
+  private val jsonParam = "json"
+  private val lengthParam = "json_len"
+  private val valueParam = "value_out"
+  private val valueSizeParam = "value_size"
+  private val scanner = JSONScanner.paramName
+
+  /**
+    * Creates the extractors of all field paths of the message
+    * @param message Message to extract fields from
+    * @param messagesByName All messages of the protocol, by name
+    * @return Definitions of the message's extractors
+    */
+  def apply(message: Message, messagesByName: Map[String, Message]): Seq[FunctionDefinition] = {
+    FieldPaths(message, messagesByName).map(extractor(message, _))
+  }
+
+  /**
+    * The names of the fields on the path are joined with underscores, so different paths
+    * may get the same name. The analyzer rejects protocols where they do, see
+    * ProtocolDefinitionAnalyzer.
+    * @param messageName Name of the message to extract the field from
+    * @param path Fields leading from the message to the extracted field
+    * @return Name of the function to extract the field
+    */
+  def name(messageName: String, path: Seq[Field]): String = {
+    s"${messageName}_json_extract_${path.map(_.name).mkString("_")}"
+  }
+
+  /**
+    * @param message Message to extract the field from
+    * @param path Fields leading from the message to the extracted field
+    * @return Definition of the function to extract the field
+    */
+  private def extractor(message: Message, path: Seq[Field]): FunctionDefinition = {
+    val fieldType = path.last.fieldType.asInstanceOf[SimpleFieldType]
+    val jsonPath = path.map(_.jsonKey).mkString(".")
+
+    FunctionDefinition(
+      name = name(message.name, path),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Extract $jsonPath from a ${message.name}",
+        description =
+          s"Reads the value of $jsonPath from the first $lengthParam bytes of $jsonParam, a ${message.name} JSON object, without parsing the rest of the object or allocating memory. " +
+          s"${valueDescription(fieldType)} Only the members before the field are checked for valid JSON. Returns 1 if the field was found and its value is valid, 0 otherwise."
+      ),
+      prototype = FunctionPrototype(
+        isStatic = false,
+        returnType = Constants.defaultBooleanCType,
+        parameters = List(
+          FunctionParameter("char const*", jsonParam),
+          FunctionParameter("size_t", lengthParam)
+        ) ++ valueParameters(fieldType)
+      ),
+      body = body(path, fieldType)
+    )
+  }
+
+  /**
+    * @param fieldType Type of the extracted field
+    * @return Parameters receiving the extracted value
+    */
+  private def valueParameters(fieldType: SimpleFieldType): Seq[FunctionParameter] = {
+    fieldType match {
+      case DynamicStringType | InternedStringType | InlineStringType(_) | AliasedType(_, DynamicStringType | InternedStringType) =>
+        List(FunctionParameter("char*", valueParam), FunctionParameter("size_t", valueSizeParam))
+      case FixedStringType(_) | AliasedType(_, FixedStringType(_)) => List(FunctionParameter("char*", valueParam))
+      case AliasedType(alias, _) => List(FunctionParameter(s"$alias*", valueParam))
+      case EnumType(enumName, _) => List(FunctionParameter(s"$enumName*", valueParam))
+      case BooleanType => List(FunctionParameter(s"${Constants.defaultBooleanCType}*", valueParam))
+      case NumberType => List(FunctionParameter(s"${Constants.defaultNumberCType}*", valueParam))
+      case TimestampType => List(FunctionParameter(s"${Constants.defaultTimestampCType}*", valueParam))
+      case ObjectType(_) => throw new IllegalArgumentException("Objects cannot be extracted")
+    }
+  }
+
+  /**
+    * @param fieldType Type of the extracted field
+    * @return Sentence describing where the extracted value is stored
+    */
+  private def valueDescription(fieldType: SimpleFieldType): String = {
+    fieldType match {
+      case DynamicStringType | InternedStringType | InlineStringType(_) | AliasedType(_, DynamicStringType | InternedStringType) =>
+        s"The decoded string is copied to $valueParam, which holds $valueSizeParam bytes including the terminating NUL."
+      case FixedStringType(maxLength) =>
+        s"The decoded string is copied to $valueParam, which must hold ${maxLength + 1} bytes."
+      case AliasedType(_, FixedStringType(maxLength)) =>
+        s"The decoded string is copied to $valueParam, which must hold ${maxLength + 1} bytes."
+      case _ =>
+        s"The value is stored in $valueParam."
+    }
+  }
+
+  /**
+    * @param path Fields leading from the message to the extracted field
+    * @param fieldType Type of the extracted field
+    * @return Body of the function to extract the field
+    */
+  private def body(path: Seq[Field], fieldType: SimpleFieldType): String = {
+    // The value of each field on the path is an object one level deeper than its parent
+    val seeks = path.zipWithIndex.map({ case (field, index) =>
+      s"""${JSONScanner.seekMemberName}( &$scanner, "${field.jsonKey}", ${index + 1} )"""
+    })
+
+    val (locals, scanValue, storeValue) = valueScan(fieldType)
+    val conditions = (seeks :+ scanValue).mkString(" &&\n          ")
+
+    s"""${(s"${Constants.defaultBooleanCType} success;" +: s"${JSONScanner.typeName} $scanner;" +: locals).mkString("\n")}
+       |
+       |${JSONScanner.initialize(scanner, jsonParam, lengthParam)}
+       |
+       |success = $conditions;$storeValue
+       |
+       |return success;""".stripMargin
+  }
+
+  /**
+    * Gets the code that scans the extracted value. Values of aliased types are scanned into
+    * a local variable and converted to the alias, like the parse functions do, after checking
+    * that aliased numbers are within the alias' range.
+    * @param fieldType Type of the extracted field
+    * @return The local variables, the expression scanning the value, and the statements
+    *         storing the scanned value
+    */
+  private def valueScan(fieldType: SimpleFieldType): (Seq[String], String, String) = {
+    fieldType match {
+      case DynamicStringType | InternedStringType | InlineStringType(_) | AliasedType(_, DynamicStringType | InternedStringType) =>
+        (Nil, s"${JSONScanner.stringCopyName}( &$scanner, $valueParam, $valueSizeParam )", "")
+
+      case FixedStringType(maxLength) =>
+        (Nil, s"${JSONScanner.stringCopyName}( &$scanner, $valueParam, ${maxLength + 1} )", "")
+
+      case AliasedType(_, FixedStringType(maxLength)) =>
+        (Nil, s"${JSONScanner.stringCopyName}( &$scanner, $valueParam, ${maxLength + 1} )", "")
+
+      case BooleanType => (Nil, s"${JSONScanner.booleanName}( &$scanner, $valueParam )", "")
+
+      case NumberType => (Nil, s"${JSONScanner.numberName}( &$scanner, $valueParam )", "")
+
+      case TimestampType => (Nil, s"${TimestampJSONParser.scanName}( &$scanner, $valueParam )", "")
+
+      case enumType: EnumType => (Nil, s"${EnumJSONParser.scanName(enumType)}( &$scanner, $valueParam )", "")
+
+      case AliasedType(alias, underlyingType) =>
+        val (localType, scanName) = underlyingType match {
+          case BooleanType => (Constants.defaultBooleanCType, JSONScanner.booleanName)
+          case TimestampType => (Constants.defaultTimestampCType, TimestampJSONParser.scanName)
+          case _ => (Constants.defaultNumberCType, JSONScanner.numberName)
+        }
+
+        // Numbers are rejected when the alias cannot hold them, like the parse functions do
+        val rangeCheck = underlyingType match {
+          case NumberType => s"\n\n${AliasedNumberJSONParser.rangeCheck(alias, "value")}"
+          case _ => ""
+        }
+
+        val storeValue =
+          s"""$rangeCheck
+             |
+             |if( success )
+             |    {
+             |    *$valueParam = ( $alias )value;
+             |    }""".stripMargin
+
+        (List(s"$localType value;"), s"$scanName( &$scanner, &value )", storeValue)
+
+      case ObjectType(_) => throw new IllegalArgumentException("Objects cannot be extracted")
+    }
+  }
+}
@@ -0,0 +1,367 @@
+package codegen.json.parallel
+
+import codegen.Constants
+import codegen.allocator.Allocator
+import codegen.functions._
+import codegen.json.CJSONAllocatorHooks
+import codegen.json.scanning.JSONScanner
+
+/**
+  * The runtime of the parallel parse functions. A parallel parse first builds a structural
+  * index of the document with the JSON scanner: the position of each large array and of
+  * every one of its elements. The rest of the document is parsed serially, and the elements
+  * of each indexed array are then split into contiguous ranges that are parsed on separate
+  * threads, each writing directly into its part of the preallocated array. Everything is
+  * guarded by CDTO_PARALLEL so that only programs that use the parallel parse need pthreads.
+  */
+object JSONParallelRuntime {
+
+  /**
+    * Name of the macro that enables the parallel parse functions when defined
+    */
+  val guard: String = "CDTO_PARALLEL"
+
+  val rangeTypeName = "cdto_json_range"
+  val indexTypeName = "cdto_json_array_index"
+  val elementParserTypeName = "cdto_json_element_parser"
+
+  /**
+    * Maximum number of threads used by a parallel parse
+    */
+  val maxThreadsMacro = "CDTO_PARALLEL_MAX_THREADS"
+
+  val indexArrayName = "cdto_json_index_array"
+  val stripArraysName = "cdto_json_strip_arrays"
+  val parseElementsName = "cdto_json_parse_elements"
+
+  private val taskTypeName = "cdto_json_parallel_task"
+  private val workerName = "cdto_json_parallel_worker"
+  private val indexParam = "index"
+  private val taskParam = "arg"
+
+  /**
+    * Definitions of the index and task types along with the headers they need. They are
+    * only used inside the JSON C source files.
+    */
+  val definitions: String =
+    s"""#ifdef $guard
+       |
+       |#include <pthread.h>
+       |#include <unistd.h>
+       |
+       |#ifndef $maxThreadsMacro
+       |#define $maxThreadsMacro 64
+       |#endif
+       |
+       |// Position of a JSON value in the input, from its first character to just past its last
+       |typedef struct
+       |    {
+       |    size_t    start;
+       |    size_t    end;
+       |    } $rangeTypeName;
+       |
+       |// Position of a JSON array and of each of its elements. The range ends at 0 until the
+       |// array has been indexed.
+       |typedef struct
+       |    {
+       |    $rangeTypeName      range;
+       |    $rangeTypeName*     elements;
+       |    int                 element_cnt;
+       |    int                 element_cap;
+       |    } $indexTypeName;
+       |
+       |// Parses a cJSON item into an array element. Returns 1 on success, 0 otherwise.
+       |typedef int ( *$elementParserTypeName )( cJSON* json, void* element_out, ${Allocator.parameter.paramType} ${Allocator.paramName} );
+       |
+       |// Range of array elements parsed by one thread
+       |typedef struct
+       |    {
+       |    char const*                     json;
+       |    $indexTypeName const*    $indexParam;
+       |    int                             first;
+       |    int                             last;
+       |    char*                           array;
+       |    size_t                          element_size;
+       |    $elementParserTypeName        parse;
+       |    ${Allocator.parameter.paramType}           ${Allocator.paramName};
+       |    int                             success;
+       |    } $taskTypeName;
+       |
+       |#endif /* #ifdef $guard */""".stripMargin
+
+  /**
+    * All parallel parse runtime functions
+    */
+  def functions: Seq[FunctionDefinition] = List(
+    indexArrayFunction,
+    stripArraysFunction,
+    workerFunction,
+    parseElementsFunction
+  )
+
+  private val indexArrayFunction = FunctionDefinition(
+    name = indexArrayName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Index a JSON array",
+      description = s"Consumes the JSON array at the given nesting depth, recording its range and the range of each of its elements in $indexParam. The element ranges are allocated through the allocator and grow geometrically. Returns 1 if the array was consumed, 0 otherwise."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        JSONScanner.parameter,
+        FunctionParameter(s"$indexTypeName*", indexParam),
+        FunctionParameter(Constants.defaultIntCType, "depth"),
+        Allocator.parameter
+      )
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |${Constants.defaultBooleanCType} more;
+         |$rangeTypeName* elements;
+         |
+         |${JSONScanner.whitespaceName}( ${JSONScanner.paramName} );
+         |$indexParam->range.start = ${JSONScanner.paramName}->pos;
+         |success = ( depth <= ${JSONScanner.nestingLimitMacro} ) && ${JSONScanner.containerBeginName}( ${JSONScanner.paramName}, '[', ']', &more );
+         |
+         |while( success && more )
+         |    {
+         |    if( $indexParam->element_cnt == $indexParam->element_cap )
+         |        {
+         |        $indexParam->element_cap = ( 0 == $indexParam->element_cap ) ? 1024 : 2 * $indexParam->element_cap;
+         |        elements = ${Allocator.calloc(s"( size_t )$indexParam->element_cap", "sizeof( *elements )")};
+         |        success = ( NULL != elements );
+         |
+         |        if( success && ( $indexParam->element_cnt > 0 ) )
+         |            {
+         |            memcpy( elements, $indexParam->elements, ( size_t )$indexParam->element_cnt * sizeof( *elements ) );
+         |            }
+         |
+         |        ${Allocator.free(s"$indexParam->elements")};
+         |        $indexParam->elements = elements;
+         |        $indexParam->element_cnt = success ? $indexParam->element_cnt : 0;
+         |        }
+         |
+         |    if( success )
+         |        {
+         |        ${JSONScanner.whitespaceName}( ${JSONScanner.paramName} );
+         |        $indexParam->elements[$indexParam->element_cnt].start = ${JSONScanner.paramName}->pos;
+         |        success = ${JSONScanner.skipValueName}( ${JSONScanner.paramName}, depth + 1 );
+         |        $indexParam->elements[$indexParam->element_cnt].end = ${JSONScanner.paramName}->pos;
+         |        $indexParam->element_cnt++;
+         |        }
+         |
+         |    success = success && ${JSONScanner.containerNextName}( ${JSONScanner.paramName}, ']', &more );
+         |    }
+         |
+         |$indexParam->range.end = ${JSONScanner.paramName}->pos;
+         |
+         |return success;""".stripMargin,
+    preprocessorGuard = Some(guard)
+  )
+
+  private val stripArraysFunction = FunctionDefinition(
+    name = stripArraysName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Remove indexed arrays from JSON",
+      description = "Copies the first json_len bytes of json with the contents of every indexed array removed, leaving an empty array in its place, so that the rest of the document can be parsed without the arrays' elements. Returns the NUL-terminated copy, allocated through the allocator, or NULL if it could not be allocated."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = "char*",
+      parameters = List(
+        FunctionParameter("char const*", "json"),
+        FunctionParameter("size_t", "json_len"),
+        FunctionParameter(s"$indexTypeName const*", "indexes"),
+        FunctionParameter(Constants.defaultIntCType, "index_cnt"),
+        Allocator.parameter
+      )
+    ),
+    body =
+      s"""char* stripped;
+         |size_t pos;
+         |size_t length;
+         |size_t copy_end;
+         |int next;
+         |int i;
+         |
+         |stripped = ${Allocator.malloc("json_len + 1")};
+         |if( NULL == stripped )
+         |    {
+         |    return NULL;
+         |    }
+         |
+         |pos = 0;
+         |length = 0;
+         |
+         |do
+         |    {
+         |    // Find the first indexed array after the current position
+         |    next = -1;
+         |    for( i = 0; i < index_cnt; i++ )
+         |        {
+         |        if( ( 0 != indexes[i].range.end ) &&
+         |            ( indexes[i].range.start >= pos ) &&
+         |            ( ( next < 0 ) || ( indexes[i].range.start < indexes[next].range.start ) ) )
+         |            {
+         |            next = i;
+         |            }
+         |        }
+         |
+         |    copy_end = ( next < 0 ) ? json_len : indexes[next].range.start;
+         |    memcpy( stripped + length, json + pos, copy_end - pos );
+         |    length += copy_end - pos;
+         |
+         |    if( next >= 0 )
+         |        {
+         |        memcpy( stripped + length, "[]", 2 );
+         |        length += 2;
+         |        pos = indexes[next].range.end;
+         |        }
+         |    }
+         |while( next >= 0 );
+         |
+         |stripped[length] = '\\0';
+         |
+         |return stripped;""".stripMargin,
+    preprocessorGuard = Some(guard)
+  )
+
+  private val workerFunction = FunctionDefinition(
+    name = workerName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Parse a range of array elements",
+      description = s"Thread function that parses the elements of the task in $taskParam, a $taskTypeName, storing whether all of them were parsed in the task. cJSON needs each element as its own NUL-terminated string, so every element is copied into a buffer that is reused for the whole range. The task's allocator is the thread's cJSON allocator while it runs."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = "void*",
+      parameters = List(FunctionParameter("void*", taskParam))
+    ),
+    body =
+      s"""$taskTypeName* task;
+         |${Allocator.parameter.paramType} ${Allocator.paramName};
+         |${CJSONAllocatorHooks.previousAllocatorDeclaration}
+         |$rangeTypeName const* element_range;
+         |cJSON* json_item;
+         |char* element;
+         |size_t element_cap;
+         |size_t length;
+         |int i;
+         |
+         |task = ( $taskTypeName* )$taskParam;
+         |${Allocator.paramName} = task->${Allocator.paramName};
+         |${CJSONAllocatorHooks.push}
+         |
+         |element = NULL;
+         |element_cap = 0;
+         |task->success = 1;
+         |
+         |for( i = task->first; task->success && ( i < task->last ); i++ )
+         |    {
+         |    element_range = &task->$indexParam->elements[i];
+         |    length = element_range->end - element_range->start;
+         |
+         |    if( length >= element_cap )
+         |        {
+         |        ${Allocator.free("element")};
+         |        element_cap = 2 * length + 1;
+         |        element = ${Allocator.malloc("element_cap")};
+         |        task->success = ( NULL != element );
+         |        element_cap = task->success ? element_cap : 0;
+         |        }
+         |
+         |    if( task->success )
+         |        {
+         |        memcpy( element, task->json + element_range->start, length );
+         |        element[length] = '\\0';
+         |
+         |        json_item = cJSON_Parse( element );
+         |        task->success = ( NULL != json_item ) && task->parse( json_item, task->array + ( size_t )i * task->element_size, ${Allocator.paramName} );
+         |        cJSON_Delete( json_item );
+         |        }
+         |    }
+         |
+         |${Allocator.free("element")};
+         |${CJSONAllocatorHooks.pop}
+         |
+         |return NULL;""".stripMargin,
+    preprocessorGuard = Some(guard)
+  )
+
+  private val parseElementsFunction = FunctionDefinition(
+    name = parseElementsName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Parse array elements in parallel",
+      description =
+        s"Parses the elements indexed in $indexParam into array, which holds one zeroed element of element_size bytes for each of them, using up to thread_cnt threads. If thread_cnt is not positive, one thread per online processor is used. " +
+        "The elements are split into one contiguous range per thread, and the calling thread parses the first range itself. A range whose thread cannot be started is parsed on the calling thread. Returns 1 if all elements were parsed, 0 otherwise."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter("char const*", "json"),
+        FunctionParameter(s"$indexTypeName const*", indexParam),
+        FunctionParameter("void*", "array"),
+        FunctionParameter("size_t", "element_size"),
+        FunctionParameter(elementParserTypeName, "parse"),
+        FunctionParameter(Constants.defaultIntCType, "thread_cnt"),
+        Allocator.parameter
+      )
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |${Constants.defaultBooleanCType} started[$maxThreadsMacro];
+         |pthread_t threads[$maxThreadsMacro];
+         |$taskTypeName tasks[$maxThreadsMacro];
+         |int i;
+         |
+         |if( thread_cnt <= 0 )
+         |    {
+         |    thread_cnt = ( int )sysconf( _SC_NPROCESSORS_ONLN );
+         |    }
+         |
+         |thread_cnt = ( thread_cnt > $maxThreadsMacro ) ? $maxThreadsMacro : thread_cnt;
+         |thread_cnt = ( thread_cnt > $indexParam->element_cnt ) ? $indexParam->element_cnt : thread_cnt;
+         |thread_cnt = ( thread_cnt < 1 ) ? 1 : thread_cnt;
+         |
+         |for( i = 0; i < thread_cnt; i++ )
+         |    {
+         |    tasks[i].json = json;
+         |    tasks[i].$indexParam = $indexParam;
+         |    tasks[i].first = ( int )( ( long long )$indexParam->element_cnt * i / thread_cnt );
+         |    tasks[i].last = ( int )( ( long long )$indexParam->element_cnt * ( i + 1 ) / thread_cnt );
+         |    tasks[i].array = ( char* )array;
+         |    tasks[i].element_size = element_size;
+         |    tasks[i].parse = parse;
+         |    tasks[i].${Allocator.paramName} = ${Allocator.paramName};
+         |    tasks[i].success = 0;
+         |    }
+         |
+         |for( i = 1; i < thread_cnt; i++ )
+         |    {
+         |    started[i] = ( 0 == pthread_create( &threads[i], NULL, $workerName, &tasks[i] ) );
+         |    }
+         |
+         |$workerName( &tasks[0] );
+         |success = tasks[0].success;
+         |
+         |for( i = 1; i < thread_cnt; i++ )
+         |    {
+         |    if( started[i] )
+         |        {
+         |        pthread_join( threads[i], NULL );
+         |        }
+         |    else
+         |        {
+         |        $workerName( &tasks[i] );
+         |        }
+         |
+         |    success = success && tasks[i].success;
+         |    }
+         |
+         |return success;""".stripMargin,
+    preprocessorGuard = Some(guard)
+  )
+}
@@ -0,0 +1,251 @@
+package codegen.json.parallel
+
+import codegen.Constants
+import codegen.allocator.Allocator
+import codegen.functions._
+import codegen.json.parsing._
+import codegen.json.scanning.JSONScanner
+import codegen.messagetypes._
+import datamodel._
+
+/**
+  * Generates the parallel parse functions of messages with array-of-message fields. A
+  * parallel parse indexes the top-level object of the document, parses everything except
+  * the elements of its message arrays with <message>_json_parse_ex, and then parses the
+  * elements of each array on several threads (see JSONParallelRuntime). The result is the
+  * same as that of <message>_json_parse_ex.
+  */
+object MessageJSONParallelParser {
+
+  private val jsonStringParam = "json_str"
+  private val messageOutputParam = "obj_out"
+  private val threadCountParam = "thread_cnt"
+  private val indexesVar = "indexes"
+  private val scanner = JSONScanner.paramName
+
+  /**
+    * Gets the fields of a message that are parsed in parallel
+    * @param message Message
+    * @return The message's array-of-message fields, along with the name of their element message
+    */
+  def parallelFields(message: Message): Seq[(Field, String)] = {
+    message.fields.flatMap(field => field.fieldType match {
+      case ArrayType(ObjectType(objectName)) => List((field, objectName))
+      case _ => Nil
+    })
+  }
+
+  /**
+    * Creates the public function that parses a message in parallel
+    * @param message Message to parse
+    * @return Definition of the function to parse the message in parallel
+    */
+  def apply(message: Message): FunctionDefinition = {
+    FunctionDefinition(
+      name = name(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Parse a ${message.name} in parallel",
+        description =
+          s"Parses the provided JSON string into a ${message.name} like ${MessageJSONStringParser.name(message.name)}, parsing the elements of its message arrays on up to $threadCountParam threads. " +
+          s"If $threadCountParam is not positive, one thread per online processor is used. The caller must call ${MessageFreeFunction.name(message.name)} on $messageOutputParam."
+      ),
+      prototype = prototype(message),
+      body = s"return ${exName(message.name)}( $jsonStringParam, $messageOutputParam, $threadCountParam, ${Allocator.defaultAllocator} );",
+      preprocessorGuard = Some(JSONParallelRuntime.guard)
+    )
+  }
+
+  /**
+    * Creates the public function that parses a message in parallel with an allocator
+    * @param message Message to parse
+    * @return Definition of the function to parse the message in parallel with an allocator
+    */
+  def withAllocator(message: Message): FunctionDefinition = {
+    val basePrototype = prototype(message)
+
+    FunctionDefinition(
+      name = exName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Parse a ${message.name} in parallel with an allocator",
+        description =
+          s"Parses the provided JSON string into a ${message.name} like ${MessageJSONStringParser.exName(message.name)}, parsing the elements of its message arrays on up to $threadCountParam threads. " +
+          s"All allocations are made through ${Allocator.paramName}, which must be safe to use from several threads at once. The caller must call ${MessageFreeFunction.exName(message.name)} on $messageOutputParam with the same allocator."
+      ),
+      prototype = basePrototype.copy(parameters = basePrototype.parameters :+ Allocator.parameter),
+      body = exBody(message),
+      preprocessorGuard = Some(JSONParallelRuntime.guard)
+    )
+  }
+
+  /**
+    * Creates the static function through which the runtime parses the elements of arrays
+    * of the message. It has the runtime's generic element parser signature.
+    * @param message Message used as the element of array fields
+    * @return Definition of the message's element parse function
+    */
+  def elementParser(message: Message): FunctionDefinition = {
+    val structName = MessageStruct.structName(message)
+
+    FunctionDefinition(
+      name = elementParserName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Parse ${message.name} array element",
+        description = s"Parses the given JSON object into the ${message.name} at element_out."
+      ),
+      prototype = FunctionPrototype(
+        isStatic = true,
+        returnType = Constants.defaultBooleanCType,
+        parameters = List(
+          FunctionParameter("cJSON*", "json"),
+          FunctionParameter("void*", "element_out"),
+          Allocator.parameter
+        )
+      ),
+      body = s"return ${MessageJSONObjectParser.name(message.name)}( json, ( $structName* )element_out, ${Allocator.paramName} );",
+      preprocessorGuard = Some(JSONParallelRuntime.guard)
+    )
+  }
+
+  /**
+    * @param messageName Name of the message to parse
+    * @return Name of the function to parse the message in parallel
+    */
+  def name(messageName: String): String = {
+    s"${messageName}_json_parse_parallel"
+  }
+
+  /**
+    * @param messageName Name of the message to parse
+    * @return Name of the function to parse the message in parallel with an allocator
+    */
+  def exName(messageName: String): String = {
+    name(messageName) + Allocator.functionNameSuffix
+  }
+
+  /**
+    * @param messageName Name of the message used as array element
+    * @return Name of the message's element parse function
+    */
+  def elementParserName(messageName: String): String = {
+    s"${messageName}_json_element_parse"
+  }
+
+  /**
+    * @param message Message to parse
+    * @return Prototype of the function to parse the message in parallel
+    */
+  private def prototype(message: Message): FunctionPrototype = {
+    FunctionPrototype(
+      isStatic = false,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter("char const*", jsonStringParam),
+        FunctionParameter(s"${MessageStruct.structName(message)}*", messageOutputParam),
+        FunctionParameter(Constants.defaultIntCType, threadCountParam)
+      )
+    )
+  }
+
+  /**
+    * @param message Message to parse
+    * @return Body of the function to parse the message in parallel with an allocator
+    */
+  private def exBody(message: Message): String = {
+    val fields = parallelFields(message)
+    val serialParse = MessageJSONStringParser.exName(message.name)
+
+    // Only the first member matching each field's key is indexed, like cJSON_GetObjectItem
+    // only finds the first one
+    val indexBranches = fields.zipWithIndex.map({ case ((field, _), index) =>
+      s"""    else if( ( 0 == $indexesVar[$index].range.end ) && ${JSONScanner.stringMatchesName}( &key, "${field.jsonKey}" ) )
+         |        {
+         |        success = ${JSONParallelRuntime.indexArrayName}( &$scanner, &$indexesVar[$index], 2, ${Allocator.paramName} );
+         |        }""".stripMargin
+    })
+
+    val elementParses = fields.zipWithIndex.map({ case ((field, objectName), index) =>
+      val array = s"$messageOutputParam->${field.name}"
+      val count = s"$messageOutputParam->${MessageStruct.arrayCountFieldName(field.name)}"
+
+      s"""    if( success && ( $indexesVar[$index].element_cnt > 0 ) )
+         |        {
+         |        $array = ${Allocator.calloc(s"( size_t )$indexesVar[$index].element_cnt", s"sizeof( *$array )")};
+         |        success = ( NULL != $array );
+         |        $count = success ? $indexesVar[$index].element_cnt : 0;
+         |        success = success && ${JSONParallelRuntime.parseElementsName}( $jsonStringParam, &$indexesVar[$index], $array, sizeof( *$array ), ${elementParserName(objectName)}, $threadCountParam, ${Allocator.paramName} );
+         |        }""".stripMargin
+    })
+
+    // The serial parse only saw empty arrays, so the indexes are rebuilt over the elements
+    val indexSnippet = if(ArrayIndex.hasIndexes(message)) {
+      s"""
+         |
+         |    success = success && ${ArrayIndex.buildCall(message.name, messageOutputParam)};""".stripMargin
+    } else {
+      ""
+    }
+
+    s"""${Constants.defaultBooleanCType} success;
+       |${Constants.defaultBooleanCType} more;
+       |${JSONScanner.typeName} $scanner;
+       |${JSONScanner.typeName} key;
+       |${JSONParallelRuntime.indexTypeName} $indexesVar[${fields.length}];
+       |char* stripped;
+       |int i;
+       |
+       |${MessageInitFunction.name(message.name)}( $messageOutputParam );
+       |memset( $indexesVar, 0, sizeof( $indexesVar ) );
+       |${JSONScanner.initialize(scanner, jsonStringParam, s"strlen( $jsonStringParam )")}
+       |
+       |// Index the elements of the message arrays
+       |success = ${JSONScanner.containerBeginName}( &$scanner, '{', '}', &more );
+       |
+       |while( success && more )
+       |    {
+       |    ${JSONScanner.whitespaceName}( &$scanner );
+       |    key = $scanner;
+       |    success = ${JSONScanner.stringName}( &$scanner, NULL ) && ${JSONScanner.charName}( &$scanner, ':' );
+       |
+       |    if( !success )
+       |        {
+       |        // Invalid key
+       |        }
+       |${indexBranches.mkString("\n")}
+       |    else
+       |        {
+       |        success = ${JSONScanner.skipValueName}( &$scanner, 2 );
+       |        }
+       |
+       |    success = success && ${JSONScanner.containerNextName}( &$scanner, '}', &more );
+       |    }
+       |
+       |if( !success )
+       |    {
+       |    // cJSON is more lenient than the scanner, so documents that cannot be indexed are
+       |    // parsed serially, which also reports any error
+       |    success = $serialParse( $jsonStringParam, $messageOutputParam, ${Allocator.paramName} );
+       |    }
+       |else
+       |    {
+       |    // Parse everything but the elements of the indexed arrays
+       |    stripped = ${JSONParallelRuntime.stripArraysName}( $jsonStringParam, $scanner.len, $indexesVar, ${fields.length}, ${Allocator.paramName} );
+       |    success = ( NULL != stripped ) && $serialParse( stripped, $messageOutputParam, ${Allocator.paramName} );
+       |    ${Allocator.free("stripped")};
+       |
+       |${elementParses.mkString("\n\n")}$indexSnippet
+       |
+       |    // Reset the output on error
+       |    if( !success )
+       |        {
+       |        ${MessageFreeFunction.exName(message.name)}( $messageOutputParam, ${Allocator.paramName} );
+       |        }
+       |    }
+       |
+       |for( i = 0; i < ${fields.length}; i++ )
+       |    {
+       |    ${Allocator.free(s"$indexesVar[i].elements")};
+       |    }
+       |
+       |return success;""".stripMargin
+  }
+}
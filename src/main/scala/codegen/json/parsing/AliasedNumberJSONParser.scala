@@ -0,0 +1,97 @@
+package codegen.json.parsing
+
+import codegen.Constants
+import codegen.functions._
+
+/**
+  * Creates the functions to parse numeric JSON values into fields whose C type is aliased,
+  * e.g. Number cType=int32_t. Each aliased type gets its own function that stores the value
+  * with the width of the type and rejects values the type cannot represent. The checks only
+  * depend on the type, so the compiler reduces each function to the checks that apply to it.
+  */
+object AliasedNumberJSONParser {
+
+  private val jsonParamName = "json"
+  private val outputParamName = "value_out"
+
+  /**
+    * Gets the name of the function to parse numeric values of an aliased type
+    * @param alias C type of the values
+    * @return Name of the parse function
+    */
+  def name(alias: String): String = {
+    s"${alias}_json_parse"
+  }
+
+  /**
+    * Creates the static function to parse numeric values of an aliased type from JSON
+    * @param alias C type of the values
+    * @return Definition of the parse function
+    */
+  def parseFunction(alias: String): FunctionDefinition = FunctionDefinition(
+    name = name(alias),
+    documentation = FunctionDocumentation(
+      shortSummary = s"Parse JSON number as $alias",
+      description = s"Parses the given JSON object as a number and stores it as a $alias. Integer types only accept whole numbers within their range. Returns 1 if the parse was successful, 0 otherwise."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter(paramType = "cJSON*", paramName = jsonParamName),
+        FunctionParameter(paramType = s"$alias*", paramName = outputParamName)
+      )
+    ),
+    body = parseFunctionBody(alias)
+  )
+
+  /**
+    * Gets the statements that check whether a value parsed as a double can be stored in
+    * an aliased type, clearing the success variable if it cannot
+    * @param alias C type of the values
+    * @param value Name of the double variable holding the value
+    * @return Statements checking the value's range
+    */
+  def rangeCheck(alias: String, value: String): String = {
+    // 2^(bits - 1), the bound of signed types and half of the bound of unsigned types
+    val halfRange = s"( ${Constants.defaultNumberCType} )( 1ULL << ( sizeof( $alias ) * CHAR_BIT - 1 ) )"
+
+    s"""// Check the range before converting, since converting an out-of-range floating
+       |// value to an integer is undefined
+       |if( ( $alias )0.5 != 0 )
+       |    {
+       |    // Floating type
+       |    }
+       |else if( ( $alias )-1 < ( $alias )1 )
+       |    {
+       |    success = success && ( $value >= -$halfRange ) && ( $value < $halfRange );
+       |    success = success && ( ( ${Constants.defaultNumberCType} )( long long )$value == $value );
+       |    }
+       |else
+       |    {
+       |    success = success && ( $value >= 0.0 ) && ( $value < 2.0 * $halfRange );
+       |    success = success && ( ( ${Constants.defaultNumberCType} )( unsigned long long )$value == $value );
+       |    }""".stripMargin
+  }
+
+  /**
+    * @param alias C type of the values
+    * @return Body of the function to parse numeric values of the type
+    */
+  private def parseFunctionBody(alias: String): String = {
+    s"""${Constants.defaultBooleanCType} success;
+       |${Constants.defaultNumberCType} value;
+       |
+       |success = ( cJSON_Number == $jsonParamName->type );
+       |value = success ? $jsonParamName->valuedouble : 0.0;
+       |
+       |${rangeCheck(alias, "value")}
+       |
+       |if( success )
+       |    {
+       |    *$outputParamName = ( $alias )value;
+       |    }
+       |
+       |return success;""".stripMargin
+  }
+}
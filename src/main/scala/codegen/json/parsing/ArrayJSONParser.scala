@@ -3,7 +3,9 @@ package codegen.json.parsing
 import java.lang.annotation.ElementType
 
 import codegen.Constants
+import codegen.allocator.Allocator
 import codegen.functions._
+import codegen.json.stats.MessageJSONStats
 import codegen.messagetypes.MessageStruct
 import datamodel._
 
@@ -14,6 +16,8 @@ object ArrayJSONParser {
   private val jsonParam = "json_array"
   private val arrayOutputParam = "array_out"
   private val countOutputParam = "array_cnt_out"
+  private val inlineArrayParam = "inline_array"
+  private val inlineCapacityParam = "inline_cap"
 
   /**
     * Creates a function to parse an array from a cJSON object
@@ -29,6 +33,71 @@ object ArrayJSONParser {
     )
   }
 
+  /**
+    * Creates a function to parse an inline array from a cJSON object. Arrays with up to
+    * the inline capacity of elements are parsed into the inline buffer, larger ones are
+    * parsed onto the heap with the plain array parse function.
+    * @param elementType Type of element contained in the array
+    * @return Definition of function to parse a JSON array into an inline array field
+    */
+  def inlineFunction(elementType: SimpleFieldType): FunctionDefinition = {
+    val basePrototype = prototype(elementType)
+    val parseElement = elementParseCall(elementType, "array_item", s"&$inlineArrayParam[i]")
+
+    FunctionDefinition(
+      name = inlineName(elementType),
+      documentation = FunctionDocumentation(
+        shortSummary = "Parse JSON inline array",
+        description = s"Parses the given JSON object as an array. Up to $inlineCapacityParam elements are stored in $inlineArrayParam and $arrayOutputParam is set to NULL, more elements are stored in a heap array. Returns 1 if the parse was successful, 0 otherwise. The caller must free the parsed array"
+      ),
+      prototype = basePrototype.copy(parameters = List(
+        FunctionParameter(paramType = "cJSON*", paramName = jsonParam),
+        FunctionParameter(paramType = MessageStruct.arrayFieldType(elementType), paramName = inlineArrayParam),
+        FunctionParameter(paramType = Constants.defaultIntCType, paramName = inlineCapacityParam)
+      ) ++ basePrototype.parameters.tail),
+      body =
+        s"""${Constants.defaultBooleanCType} success;
+           |${Constants.defaultIntCType} array_cnt;
+           |${Constants.defaultIntCType} i;
+           |cJSON* array_item;
+           |
+           |success = ( cJSON_Array == $jsonParam->type );
+           |array_cnt = success ? cJSON_GetArraySize( $jsonParam ) : 0;
+           |
+           |if( array_cnt > $inlineCapacityParam )
+           |    {
+           |    // Too many elements to store inline
+           |    success = ${name(elementType)}( $jsonParam, $arrayOutputParam, $countOutputParam, ${Allocator.paramName} );
+           |    }
+           |else
+           |    {
+           |    // The inline elements were zeroed with the message, so it is safe to free
+           |    // them if an error occurs in the middle of parsing
+           |    *$arrayOutputParam = NULL;
+           |    *$countOutputParam = array_cnt;
+           |
+           |    array_item = success ? $jsonParam->child : NULL;
+           |    for( i = 0; success && ( i < array_cnt ); i++ )
+           |        {
+           |        success = $parseElement;
+           |        array_item = array_item->next;
+           |        }
+           |    }
+           |
+           |return success;""".stripMargin
+    )
+  }
+
+  /**
+    * Gets the name of the function to parse an inline array of the specified type from a
+    * cJSON object
+    * @param elementType Type of element contained in the array
+    * @return Name of the function to parse an inline array
+    */
+  def inlineName(elementType: SimpleFieldType): String = {
+    name(elementType) + "_inline"
+  }
+
   /**
     * Gets the name of the function to parse an array of the specified type from a cJSON
     * object
@@ -38,12 +107,17 @@ object ArrayJSONParser {
     */
   def name(elementType: SimpleFieldType): String = {
     elementType match {
+      case AliasedType(alias, NumberType) => alias + nameSuffix
+      case AliasedType(alias, TimestampType) => s"${alias}_timestamp$nameSuffix"
       case AliasedType(_, underlyingType) => name(underlyingType)
       case ObjectType(objectName) => objectName + nameSuffix
       case BooleanType => "boolean" + nameSuffix
       case DynamicStringType => "string" + nameSuffix
-      case FixedStringType(_) => "string" + nameSuffix
+      case InternedStringType => "interned_string" + nameSuffix
+      case FixedStringType(_) | InlineStringType(_) => "string" + nameSuffix
+      case EnumType(enumName, _) => enumName + nameSuffix
       case NumberType => "number" + nameSuffix
+      case TimestampType => "timestamp" + nameSuffix
     }
   }
 
@@ -70,7 +144,8 @@ object ArrayJSONParser {
 
         // Create output parameters as pointers to their respective types
         FunctionParameter(paramType = MessageStruct.arrayFieldType(elementType) + "*", paramName = arrayOutputParam),
-        FunctionParameter(paramType = Constants.defaultIntCType + "*", paramName = countOutputParam)
+        FunctionParameter(paramType = Constants.defaultIntCType + "*", paramName = countOutputParam),
+        Allocator.parameter
       )
     )
   }
@@ -83,7 +158,7 @@ object ArrayJSONParser {
     */
   private def body(elementType: SimpleFieldType): String = {
     val arrayTypeDeclaration = MessageStruct.arrayFieldType(elementType)
-    val parseElement = elementParseFunction(elementType)
+    val parseElement = elementParseCall(elementType, "array_item", "&array[i]")
 
     s"""${Constants.defaultBooleanCType} success;
        |$arrayTypeDeclaration array;
@@ -104,18 +179,22 @@ object ArrayJSONParser {
        |    array_cnt = cJSON_GetArraySize( $jsonParam );
        |    if( array_cnt > 0 )
        |        {
-       |        array = calloc( array_cnt, sizeof( *array ) );
+       |        array = ${Allocator.calloc("array_cnt", "sizeof( *array )")};
        |        success = ( NULL != array );
+       |        ${MessageJSONStats.allocation}
        |
        |        // Reset the array count if we failed to allocate the array
        |        array_cnt = success ? array_cnt : 0;
        |        }
        |    }
        |
+       |// Walk the linked list of items rather than looking up each item by
+       |// index, which would take time proportional to the index
+       |array_item = success ? $jsonParam->child : NULL;
        |for( i = 0; success && ( i < array_cnt ); i++ )
        |    {
-       |    array_item = cJSON_GetArrayItem( $jsonParam, i );
-       |    success = $parseElement( array_item, &array[i] );
+       |    success = $parseElement;
+       |    array_item = array_item->next;
        |    }
        |
        |*$arrayOutputParam = array;
@@ -125,20 +204,26 @@ object ArrayJSONParser {
   }
 
   /**
-    * Gets the name of the function to parse an element of an array from JSON.
-    * The returned element parse function will take as input a cJSON pointer
-    * parameter
+    * Gets the call to parse an element of an array from JSON. Elements that own
+    * dynamically-allocated memory are parsed with the array's allocator.
     * @param elementType Type of element contained in the array
-    * @return Name of the function to parse an element of an array from JSON
+    * @param jsonItem C expression for the cJSON item to parse
+    * @param elementOutput C expression for the address of the element to parse into
+    * @return Call to parse an element of an array from JSON
     */
-  private def elementParseFunction(elementType: SimpleFieldType): String = {
+  private def elementParseCall(elementType: SimpleFieldType, jsonItem: String, elementOutput: String): String = {
     elementType match {
-      case AliasedType(_, underlyingType) => elementParseFunction(underlyingType)
-      case ObjectType(objectName) => MessageJSONObjectParser.name(objectName)
-      case BooleanType => BooleanJSONParser.name
-      case DynamicStringType => DynamicStringJSONParser.name
-      case FixedStringType(_) => DynamicStringJSONParser.name // In arrays, fixed-length strings are dynamically-allocated
-      case NumberType => NumberJSONParser.name
+      case AliasedType(alias, NumberType) => s"${AliasedNumberJSONParser.name(alias)}( $jsonItem, $elementOutput )"
+      case AliasedType(_, TimestampType) => s"${TimestampJSONParser.name}( $jsonItem, ( ${Constants.defaultTimestampCType}* )$elementOutput )"
+      case AliasedType(_, underlyingType) => elementParseCall(underlyingType, jsonItem, elementOutput)
+      case ObjectType(objectName) => s"${MessageJSONObjectParser.name(objectName)}( $jsonItem, $elementOutput, ${Allocator.paramName} )"
+      case BooleanType => s"${BooleanJSONParser.name}( $jsonItem, $elementOutput )"
+      case DynamicStringType => s"${DynamicStringJSONParser.name}( $jsonItem, $elementOutput, ${Allocator.paramName} )"
+      case InternedStringType => s"${InternedStringJSONParser.name}( $jsonItem, $elementOutput, ${Allocator.paramName} )"
+      case FixedStringType(_) | InlineStringType(_) => s"${DynamicStringJSONParser.name}( $jsonItem, $elementOutput, ${Allocator.paramName} )" // In arrays, fixed-length and inline strings are dynamically-allocated
+      case NumberType => s"${NumberJSONParser.name}( $jsonItem, $elementOutput )"
+      case TimestampType => s"${TimestampJSONParser.name}( $jsonItem, $elementOutput )"
+      case enumType: EnumType => s"${EnumJSONParser.name(enumType)}( $jsonItem, $elementOutput )"
     }
   }
 }
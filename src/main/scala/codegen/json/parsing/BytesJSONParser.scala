@@ -0,0 +1,59 @@
+package codegen.json.parsing
+
+import codegen.Constants
+import codegen.allocator.Allocator
+import codegen.base64.Base64
+import codegen.functions._
+import codegen.json.stats.MessageJSONStats
+
+/**
+  * Defines a function to parse bytes from the base64 text of JSON strings
+  */
+object BytesJSONParser {
+
+  private val jsonParam = "json"
+  private val dataOutputParam = "data_out"
+  private val lengthOutputParam = "len_out"
+
+  /**
+    * Name of the function to parse bytes from JSON
+    */
+  val name: String = "bytes_json_parse"
+
+  /**
+    * Definition of the static function to parse bytes from JSON. The bytes are decoded
+    * straight from the string of the cJSON object into a single allocation.
+    */
+  val parseFunction: FunctionDefinition = FunctionDefinition(
+    name = name,
+    documentation = FunctionDocumentation(
+      shortSummary = "Parse JSON bytes",
+      description = s"Parses the given JSON object as a base64 string. Returns 1 if the parse was successful, 0 otherwise. The caller must free $dataOutputParam with the allocator."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter(paramType = "cJSON*", paramName = jsonParam),
+        FunctionParameter(paramType = "uint8_t**", paramName = dataOutputParam),
+        FunctionParameter(paramType = "size_t*", paramName = lengthOutputParam),
+        Allocator.parameter
+      )
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |
+         |*$dataOutputParam = NULL;
+         |*$lengthOutputParam = 0;
+         |
+         |success = ( cJSON_String == $jsonParam->type );
+         |
+         |if( success )
+         |    {
+         |    success = ${Base64.decodeName}( $jsonParam->valuestring, strlen( $jsonParam->valuestring ), $dataOutputParam, $lengthOutputParam, ${Allocator.paramName} );
+         |    ${MessageJSONStats.allocation}
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+}
@@ -1,7 +1,9 @@
 package codegen.json.parsing
 
 import codegen.Constants
+import codegen.allocator.Allocator
 import codegen.functions._
+import codegen.json.stats.MessageJSONStats
 
 /**
   * Defines a function to parse dynamically-allocated string values
@@ -21,8 +23,9 @@ object DynamicStringJSONParser {
        |
        |if( success )
        |    {
-       |    *$outputParam = strdup( $jsonParam->valuestring );
+       |    *$outputParam = ${Allocator.strdup(s"$jsonParam->valuestring")};
        |    success = ( NULL != *$outputParam );
+       |    ${MessageJSONStats.allocation}
        |    }
        |
        |return success;""".stripMargin
@@ -40,14 +43,15 @@ object DynamicStringJSONParser {
     name = name,
     documentation = FunctionDocumentation(
       description = "Parse dynamic JSON string",
-      shortSummary = s"Parses the given JSON object as a dynamic string. Returns 1 if the parse was successful, 0 otherwise. The caller must free $outputParam."
+      shortSummary = s"Parses the given JSON object as a dynamic string. Returns 1 if the parse was successful, 0 otherwise. The caller must free $outputParam with the allocator."
     ),
     FunctionPrototype(
       isStatic = true,
       returnType = Constants.defaultBooleanCType,
       parameters = List(
         FunctionParameter(paramType = "cJSON*", paramName = jsonParam),
-        FunctionParameter(paramType = {Constants.defaultCharacterCType} + "**", paramName = outputParam)
+        FunctionParameter(paramType = {Constants.defaultCharacterCType} + "**", paramName = outputParam),
+        Allocator.parameter
       )
     ),
     body = parseFunctionBody
@@ -0,0 +1,170 @@
+package codegen.json.parsing
+
+import codegen.Constants
+import codegen.functions._
+import codegen.json.scanning.JSONScanner
+import codegen.messagetypes.MessageEnum
+import datamodel._
+
+/**
+  * Defines the functions to parse enum values from JSON strings. A string is matched
+  * against the enum's values by switching on its length and comparing its bytes with the
+  * values of that length, so parsing neither allocates nor compares every value.
+  */
+object EnumJSONParser {
+
+  private val jsonParam = "json"
+  private val stringParam = "str"
+  private val lengthParam = "str_len"
+  private val outputParam = "value_out"
+  private val scanner = JSONScanner.paramName
+
+  /**
+    * @param enumType Enum type
+    * @return Name of the function to look up an enum value by its string
+    */
+  def fromStringName(enumType: EnumType): String = {
+    s"${enumType.name}_json_from_string"
+  }
+
+  /**
+    * @param enumType Enum type
+    * @return Name of the function to parse an enum value from a cJSON object
+    */
+  def name(enumType: EnumType): String = {
+    s"${enumType.name}_json_parse"
+  }
+
+  /**
+    * @param enumType Enum type
+    * @return Name of the function to scan an enum value with the JSON scanner
+    */
+  def scanName(enumType: EnumType): String = {
+    s"${enumType.name}_json_scan"
+  }
+
+  /**
+    * Creates the static function to look up an enum value by its string
+    * @param enumType Enum type
+    * @return Definition of the enum's lookup function
+    */
+  def fromStringFunction(enumType: EnumType): FunctionDefinition = {
+    val cases = enumType.values.groupBy(_.length).toSeq.sortBy(_._1).map({ case (length, values) =>
+      val comparisons = values.map(value =>
+        s"""if( 0 == memcmp( $stringParam, "$value", $length ) )
+           |            {
+           |            *$outputParam = ${MessageEnum.constantName(enumType, value)};
+           |            success = 1;
+           |            }""".stripMargin
+      )
+
+      s"""    case $length:
+         |        ${comparisons.mkString("\n        else ")}
+         |        break;""".stripMargin
+    })
+
+    FunctionDefinition(
+      name = fromStringName(enumType),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Look up ${enumType.name} value",
+        description = s"Finds the ${enumType.name} value whose string is the first $lengthParam bytes of $stringParam. Returns 1 if a value was found, 0 otherwise."
+      ),
+      prototype = FunctionPrototype(
+        isStatic = true,
+        returnType = Constants.defaultBooleanCType,
+        parameters = List(
+          FunctionParameter(s"${Constants.defaultCharacterCType} const*", stringParam),
+          FunctionParameter("size_t", lengthParam),
+          FunctionParameter(s"${enumType.name}*", outputParam)
+        )
+      ),
+      body =
+        s"""${Constants.defaultBooleanCType} success;
+           |
+           |success = 0;
+           |
+           |// Only values of the same length need to be compared
+           |switch( $lengthParam )
+           |    {
+           |${cases.mkString("\n\n")}
+           |
+           |    default:
+           |        break;
+           |    }
+           |
+           |return success;""".stripMargin
+    )
+  }
+
+  /**
+    * Creates the static function to parse an enum value from a cJSON object
+    * @param enumType Enum type
+    * @return Definition of the enum's parse function
+    */
+  def parseFunction(enumType: EnumType): FunctionDefinition = {
+    FunctionDefinition(
+      name = name(enumType),
+      documentation = FunctionDocumentation(
+        shortSummary = "Parse JSON enum",
+        description = s"Parses the given JSON object as a ${enumType.name} string. Returns 1 if the parse was successful, 0 otherwise."
+      ),
+      prototype = FunctionPrototype(
+        isStatic = true,
+        returnType = Constants.defaultBooleanCType,
+        parameters = List(
+          FunctionParameter("cJSON*", jsonParam),
+          FunctionParameter(s"${enumType.name}*", outputParam)
+        )
+      ),
+      body =
+        s"""${Constants.defaultBooleanCType} success;
+           |
+           |success = ( cJSON_String == $jsonParam->type );
+           |success = success && ${fromStringName(enumType)}( $jsonParam->valuestring, strlen( $jsonParam->valuestring ), $outputParam );
+           |
+           |return success;""".stripMargin
+    )
+  }
+
+  /**
+    * Creates the static function to scan an enum value with the JSON scanner, which the
+    * validate and extract functions use
+    * @param enumType Enum type
+    * @return Definition of the enum's scan function
+    */
+  def scanFunction(enumType: EnumType): FunctionDefinition = {
+    // Room for the longest value and its terminator. Longer strings do not fit, so they
+    // are rejected by the copy.
+    val bufferSize = enumType.values.map(_.length).max + 1
+
+    FunctionDefinition(
+      name = scanName(enumType),
+      documentation = FunctionDocumentation(
+        shortSummary = "Scan JSON enum",
+        description = s"Consumes a string and looks it up as a ${enumType.name} value, which is stored in $outputParam unless it is NULL. Returns 1 if a valid value was scanned, 0 otherwise."
+      ),
+      prototype = FunctionPrototype(
+        isStatic = true,
+        returnType = Constants.defaultBooleanCType,
+        parameters = List(
+          FunctionParameter(s"${JSONScanner.typeName}*", scanner),
+          FunctionParameter(s"${enumType.name}*", outputParam)
+        )
+      ),
+      body =
+        s"""${Constants.defaultBooleanCType} success;
+           |${Constants.defaultCharacterCType} buffer[$bufferSize];
+           |${enumType.name} value;
+           |
+           |success = ${JSONScanner.stringCopyName}( $scanner, buffer, sizeof( buffer ) ) &&
+           |          ${fromStringName(enumType)}( buffer, strlen( buffer ), &value );
+           |
+           |if( success && ( NULL != $outputParam ) )
+           |    {
+           |    *$outputParam = value;
+           |    }
+           |
+           |return success;""".stripMargin
+    )
+  }
+}
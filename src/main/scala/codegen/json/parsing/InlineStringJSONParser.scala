@@ -0,0 +1,76 @@
+package codegen.json.parsing
+
+import codegen.Constants
+import codegen.allocator.Allocator
+import codegen.functions._
+import codegen.json.stats.MessageJSONStats
+
+/**
+  * Defines a function to parse string values that are stored inline when they are short
+  * enough and on the heap otherwise
+  */
+object InlineStringJSONParser {
+
+  private val jsonParam = "json"
+  private val bufferParam = "buffer"
+  private val bufferSizeParam = "buffer_size"
+  private val heapOutputParam = "heap_out"
+
+  private def parseFunctionBody =
+    s"""${Constants.defaultBooleanCType} success;
+       |size_t length;
+       |
+       |*$heapOutputParam = NULL;
+       |$bufferParam[0] = '\\0';
+       |
+       |success = ( cJSON_String == $jsonParam->type );
+       |
+       |if( success )
+       |    {
+       |    length = strlen( $jsonParam->valuestring );
+       |    if( length < $bufferSizeParam )
+       |        {
+       |        memcpy( $bufferParam, $jsonParam->valuestring, length + 1 );
+       |        }
+       |    else
+       |        {
+       |        // Too long to store inline
+       |        *$heapOutputParam = ${Allocator.strdup(s"$jsonParam->valuestring")};
+       |        success = ( NULL != *$heapOutputParam );
+       |        ${MessageJSONStats.allocation}
+       |        }
+       |    }
+       |
+       |return success;""".stripMargin
+
+  /**
+    * Name of the function to parse inline string values from JSON
+    */
+  val name: String = "inline_string_json_parse"
+
+  /**
+    * Definition of the static function to parse inline string values from JSON. The
+    * function takes a cJSON pointer input parameter, the field's inline buffer and its
+    * size, and the field's heap pointer, which is only set if the value does not fit
+    * into the buffer.
+    */
+  val parseFunction: FunctionDefinition = FunctionDefinition(
+    name = name,
+    documentation = FunctionDocumentation(
+      shortSummary = "Parse inline JSON string",
+      description = s"Parses the given JSON object as a string. Strings shorter than $bufferSizeParam are copied into $bufferParam, longer strings are copied to the heap and stored in $heapOutputParam. Returns 1 if the parse was successful, 0 otherwise. The caller must free $heapOutputParam with the allocator."
+    ),
+    FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter(paramType = "cJSON*", paramName = jsonParam),
+        FunctionParameter(paramType = s"${Constants.defaultCharacterCType}*", paramName = bufferParam),
+        FunctionParameter(paramType = "size_t", paramName = bufferSizeParam),
+        FunctionParameter(paramType = s"${Constants.defaultCharacterCType}**", paramName = heapOutputParam),
+        Allocator.parameter
+      )
+    ),
+    body = parseFunctionBody
+  )
+}
@@ -0,0 +1,56 @@
+package codegen.json.parsing
+
+import codegen.Constants
+import codegen.allocator.Allocator
+import codegen.functions._
+
+/**
+  * Defines a function to parse interned string values from JSON
+  */
+object InternedStringJSONParser {
+
+  private val jsonParam = "json"
+  private val outputParam = "value_out"
+
+  private def parseFunctionBody =
+    s"""${Constants.defaultBooleanCType} success;
+       |
+       |*$outputParam = NULL;
+       |
+       |success = ( cJSON_String == $jsonParam->type );
+       |
+       |if( success )
+       |    {
+       |    *$outputParam = ${Allocator.intern(s"$jsonParam->valuestring")};
+       |    success = ( NULL != *$outputParam );
+       |    }
+       |
+       |return success;""".stripMargin
+
+  /**
+    * Name of the function to parse interned string values from JSON.
+    */
+  val name: String = "interned_string_json_parse"
+
+  /**
+    * Definition of the static function to parse interned string values from JSON.
+    * The function takes a cJSON pointer input parameter and a const char pointer output parameter.
+    */
+  val parseFunction: FunctionDefinition = FunctionDefinition(
+    name = name,
+    documentation = FunctionDocumentation(
+      shortSummary = "Parse interned JSON string",
+      description = s"Parses the given JSON object as a string shared through the allocator's intern table. Returns 1 if the parse was successful, 0 otherwise. The caller must release $outputParam with cdto_strintern_free()."
+    ),
+    FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter(paramType = "cJSON*", paramName = jsonParam),
+        FunctionParameter(paramType = s"${Constants.defaultCharacterCType} const**", paramName = outputParam),
+        Allocator.parameter
+      )
+    ),
+    body = parseFunctionBody
+  )
+}
@@ -0,0 +1,81 @@
+package codegen.json.parsing
+
+import codegen.allocator.Allocator
+import codegen.functions._
+
+/**
+  * Support for parsing JSON that is not NUL-terminated: length-delimited buffers and
+  * memory-mapped files. Memory mapping is only available on POSIX systems, where the
+  * generated header defines CDTO_MMAP unless CDTO_NO_MMAP is defined.
+  */
+object JSONInput {
+
+  /**
+    * Name of the macro that is defined when files can be memory-mapped
+    */
+  val mmapGuard: String = "CDTO_MMAP"
+
+  val parseLengthName = "cdto_cjson_parse_n"
+
+  /**
+    * Definition of the memory mapping macro to place in the protocol's JSON header, so that
+    * the file parse functions are declared exactly when they are defined
+    */
+  val headerDefinitions: String =
+    s"""#if !defined( $mmapGuard ) && !defined( CDTO_NO_MMAP ) && ( defined( __unix__ ) || defined( __APPLE__ ) )
+       |#define $mmapGuard
+       |#endif""".stripMargin
+
+  /**
+    * Headers needed by the file parse functions, to place in the JSON C source files
+    */
+  val sourceDefinitions: String =
+    s"""#ifdef $mmapGuard
+       |#include <fcntl.h>
+       |#include <sys/mman.h>
+       |#include <sys/stat.h>
+       |#include <unistd.h>
+       |#endif /* #ifdef $mmapGuard */""".stripMargin
+
+  /**
+    * Static function to parse a length-delimited JSON buffer with cJSON
+    */
+  val parseLengthFunction: FunctionDefinition = FunctionDefinition(
+    name = parseLengthName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Parse a JSON buffer",
+      description = "Parses the first json_len bytes of json with cJSON without reading past them. cJSON versions before 1.7.13 can only parse NUL-terminated strings, so with those the buffer is copied through the allocator first. Returns the parsed cJSON tree, or NULL on error."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = "cJSON*",
+      parameters = List(
+        FunctionParameter("char const*", "json"),
+        FunctionParameter("size_t", "json_len"),
+        Allocator.parameter
+      )
+    ),
+    body =
+      s"""#if defined( CJSON_VERSION_MAJOR ) && ( CJSON_VERSION_MAJOR * 10000 + CJSON_VERSION_MINOR * 100 + CJSON_VERSION_PATCH >= 10713 )
+         |( void )${Allocator.paramName};
+         |return cJSON_ParseWithLength( json, json_len );
+         |#else
+         |char* copy;
+         |cJSON* json_root;
+         |
+         |copy = ${Allocator.malloc("json_len + 1")};
+         |if( NULL == copy )
+         |    {
+         |    return NULL;
+         |    }
+         |
+         |memcpy( copy, json, json_len );
+         |copy[json_len] = '\\0';
+         |
+         |json_root = cJSON_Parse( copy );
+         |${Allocator.free("copy")};
+         |
+         |return json_root;
+         |#endif""".stripMargin
+  )
+}
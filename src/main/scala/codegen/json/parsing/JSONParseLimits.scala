@@ -0,0 +1,355 @@
+package codegen.json.parsing
+
+import codegen.Constants
+import codegen.allocator.Allocator
+import codegen.functions._
+import codegen.json.scanning.JSONScanner
+
+/**
+  * Support for parsing untrusted JSON within resource limits. Before cJSON builds its tree,
+  * the input is scanned once without allocating, which rejects inputs that are too long,
+  * too deeply nested, or have too many array elements or too long strings. The parse
+  * itself then allocates through an allocator that fails once the heap budget is spent,
+  * so the work done for any input is bounded by the limits.
+  */
+object JSONParseLimits {
+
+  val limitsTypeName = "cdto_json_limits"
+  val errorTypeName = "cdto_json_error"
+  val budgetTypeName = "cdto_json_heap_budget"
+
+  val okCode = "CDTO_JSON_OK"
+  val syntaxErrorCode = "CDTO_JSON_ERROR_SYNTAX"
+  val schemaErrorCode = "CDTO_JSON_ERROR_SCHEMA"
+  val memoryErrorCode = "CDTO_JSON_ERROR_MEMORY"
+  val inputLengthErrorCode = "CDTO_JSON_ERROR_INPUT_TOO_LONG"
+  val depthErrorCode = "CDTO_JSON_ERROR_TOO_DEEP"
+  val arrayLengthErrorCode = "CDTO_JSON_ERROR_ARRAY_TOO_LONG"
+  val stringLengthErrorCode = "CDTO_JSON_ERROR_STRING_TOO_LONG"
+  val heapErrorCode = "CDTO_JSON_ERROR_HEAP_LIMIT"
+
+  val checkName = "cdto_json_limits_check"
+  val budgetInitName = "cdto_json_budget_init"
+  val budgetErrorName = "cdto_json_budget_error"
+
+  private val limitsParam = "limits"
+  private val budgetParam = "budget"
+  private val scanValueName = "cdto_json_limits_scan_value"
+  private val scanStringName = "cdto_json_limits_scan_string"
+  private val budgetMallocName = "cdto_json_budget_malloc"
+  private val budgetFreeName = "cdto_json_budget_free"
+  private val budgetInternName = "cdto_json_budget_intern"
+
+  private val limitsParameter = FunctionParameter(s"$limitsTypeName const*", limitsParam)
+  private val budgetParameter = FunctionParameter(s"$budgetTypeName*", budgetParam)
+
+  /**
+    * Definitions of the limits and error types to place in the protocol's JSON header. They
+    * are shared by all protocols so they are protected against multiple definitions.
+    */
+  val headerDefinitions: String =
+    s"""#ifndef CDTO_JSON_LIMITS_DEFINED
+       |#define CDTO_JSON_LIMITS_DEFINED
+       |
+       |// Limits on the resources spent parsing a JSON document. Zero means no limit.
+       |typedef struct
+       |    {
+       |    size_t    max_input_len;    // bytes of JSON text
+       |    int       max_depth;        // nesting depth of objects and arrays, the outermost being 1
+       |    size_t    max_array_cnt;    // elements of any array
+       |    size_t    max_string_len;   // decoded bytes of any string, including keys
+       |    size_t    max_heap_bytes;   // bytes allocated while parsing, including cJSON's tree
+       |    } $limitsTypeName;
+       |
+       |typedef enum
+       |    {
+       |    $okCode = 0,
+       |    $syntaxErrorCode,
+       |    $schemaErrorCode,
+       |    $memoryErrorCode,
+       |    $inputLengthErrorCode,
+       |    $depthErrorCode,
+       |    $arrayLengthErrorCode,
+       |    $stringLengthErrorCode,
+       |    $heapErrorCode
+       |    } $errorTypeName;
+       |
+       |#endif /* #ifndef CDTO_JSON_LIMITS_DEFINED */""".stripMargin
+
+  /**
+    * Definition of the heap budget type to place in the JSON C source files
+    */
+  val sourceDefinitions: String =
+    s"""typedef struct
+       |    {
+       |    ${Allocator.typeName} const*    ${Allocator.paramName};
+       |    size_t                   remaining;
+       |    int                      exceeded;
+       |    int                      failed;
+       |    } $budgetTypeName;""".stripMargin
+
+  /**
+    * All functions needed by the limited parse functions
+    */
+  def functions: Seq[FunctionDefinition] = List(
+    checkFunction,
+    scanValueFunction,
+    scanStringFunction,
+    budgetInitFunction,
+    budgetErrorFunction,
+    budgetMallocFunction,
+    budgetFreeFunction,
+    budgetInternFunction
+  )
+
+  private val checkFunction = FunctionDefinition(
+    name = checkName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Check JSON against limits",
+      description = s"Scans the first json_len bytes of json without allocating and checks the input length, nesting depth, array lengths and string lengths against the limits, which may be NULL. Nesting is also limited to ${JSONScanner.nestingLimitMacro}. Returns $okCode if the document is within the limits, the error code of the first limit exceeded, or $syntaxErrorCode if the document is not valid JSON."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = errorTypeName,
+      parameters = List(
+        FunctionParameter("char const*", "json"),
+        FunctionParameter("size_t", "json_len"),
+        limitsParameter
+      )
+    ),
+    body =
+      s"""$limitsTypeName no_limits;
+         |${JSONScanner.typeName} ${JSONScanner.paramName};
+         |
+         |if( NULL == $limitsParam )
+         |    {
+         |    memset( &no_limits, 0, sizeof( no_limits ) );
+         |    $limitsParam = &no_limits;
+         |    }
+         |
+         |if( ( 0 != $limitsParam->max_input_len ) && ( json_len > $limitsParam->max_input_len ) )
+         |    {
+         |    return $inputLengthErrorCode;
+         |    }
+         |
+         |${JSONScanner.initialize(JSONScanner.paramName, "json", "json_len")}
+         |
+         |return $scanValueName( &${JSONScanner.paramName}, $limitsParam, 1 );""".stripMargin
+  )
+
+  private val scanValueFunction = FunctionDefinition(
+    name = scanValueName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Scan a JSON value within limits",
+      description = "Consumes any JSON value at the given nesting depth, checking its syntax and the limits. Returns the error code of the first limit exceeded, if any."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = errorTypeName,
+      parameters = List(JSONScanner.parameter, limitsParameter, FunctionParameter(Constants.defaultIntCType, "depth"))
+    ),
+    body =
+      s"""$errorTypeName error;
+         |${Constants.defaultBooleanCType} more;
+         |size_t element_cnt;
+         |char c;
+         |
+         |${JSONScanner.whitespaceName}( ${JSONScanner.paramName} );
+         |c = ( ${JSONScanner.paramName}->pos < ${JSONScanner.paramName}->len ) ? ${JSONScanner.paramName}->json[${JSONScanner.paramName}->pos] : '\\0';
+         |error = $okCode;
+         |
+         |if( ( ( '{' == c ) || ( '[' == c ) ) &&
+         |    ( ( depth > ${JSONScanner.nestingLimitMacro} ) || ( ( 0 != $limitsParam->max_depth ) && ( depth > $limitsParam->max_depth ) ) ) )
+         |    {
+         |    error = $depthErrorCode;
+         |    }
+         |else if( '{' == c )
+         |    {
+         |    error = ${JSONScanner.containerBeginName}( ${JSONScanner.paramName}, '{', '}', &more ) ? $okCode : $syntaxErrorCode;
+         |    while( ( $okCode == error ) && more )
+         |        {
+         |        error = $scanStringName( ${JSONScanner.paramName}, $limitsParam );
+         |        if( $okCode == error )
+         |            {
+         |            error = ${JSONScanner.charName}( ${JSONScanner.paramName}, ':' ) ? $scanValueName( ${JSONScanner.paramName}, $limitsParam, depth + 1 ) : $syntaxErrorCode;
+         |            }
+         |
+         |        if( ( $okCode == error ) && !${JSONScanner.containerNextName}( ${JSONScanner.paramName}, '}', &more ) )
+         |            {
+         |            error = $syntaxErrorCode;
+         |            }
+         |        }
+         |    }
+         |else if( '[' == c )
+         |    {
+         |    element_cnt = 0;
+         |    error = ${JSONScanner.containerBeginName}( ${JSONScanner.paramName}, '[', ']', &more ) ? $okCode : $syntaxErrorCode;
+         |    while( ( $okCode == error ) && more )
+         |        {
+         |        // Stop at the first element over the limit rather than counting them all
+         |        element_cnt++;
+         |        if( ( 0 != $limitsParam->max_array_cnt ) && ( element_cnt > $limitsParam->max_array_cnt ) )
+         |            {
+         |            error = $arrayLengthErrorCode;
+         |            }
+         |        else
+         |            {
+         |            error = $scanValueName( ${JSONScanner.paramName}, $limitsParam, depth + 1 );
+         |            }
+         |
+         |        if( ( $okCode == error ) && !${JSONScanner.containerNextName}( ${JSONScanner.paramName}, ']', &more ) )
+         |            {
+         |            error = $syntaxErrorCode;
+         |            }
+         |        }
+         |    }
+         |else if( '"' == c )
+         |    {
+         |    error = $scanStringName( ${JSONScanner.paramName}, $limitsParam );
+         |    }
+         |else
+         |    {
+         |    // Scalars do not nest, so their depth does not matter
+         |    error = ${JSONScanner.skipValueName}( ${JSONScanner.paramName}, 1 ) ? $okCode : $syntaxErrorCode;
+         |    }
+         |
+         |return error;""".stripMargin
+  )
+
+  private val scanStringFunction = FunctionDefinition(
+    name = scanStringName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Scan a JSON string within limits",
+      description = s"Consumes a string and checks the length of its decoded value. Returns $okCode, $stringLengthErrorCode or $syntaxErrorCode."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = errorTypeName,
+      parameters = List(JSONScanner.parameter, limitsParameter)
+    ),
+    body =
+      s"""size_t decoded_len;
+         |
+         |if( !${JSONScanner.stringName}( ${JSONScanner.paramName}, &decoded_len ) )
+         |    {
+         |    return $syntaxErrorCode;
+         |    }
+         |
+         |return ( ( 0 != $limitsParam->max_string_len ) && ( decoded_len > $limitsParam->max_string_len ) ) ? $stringLengthErrorCode : $okCode;""".stripMargin
+  )
+
+  private val budgetInitFunction = FunctionDefinition(
+    name = budgetInitName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Initialize a heap budget",
+      description = "Sets up budget_allocator to allocate through the allocator until the heap limit of the limits, which may be NULL, is reached. Interned strings are not counted."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.voidCType,
+      parameters = List(
+        budgetParameter,
+        FunctionParameter(s"${Allocator.typeName}*", "budget_allocator"),
+        limitsParameter,
+        Allocator.parameter
+      )
+    ),
+    body =
+      s"""$budgetParam->${Allocator.paramName} = ${Allocator.paramName};
+         |$budgetParam->remaining = ( ( NULL != $limitsParam ) && ( 0 != $limitsParam->max_heap_bytes ) ) ? $limitsParam->max_heap_bytes : ( size_t )-1;
+         |$budgetParam->exceeded = 0;
+         |$budgetParam->failed = 0;
+         |
+         |budget_allocator->malloc_fn = $budgetMallocName;
+         |budget_allocator->free_fn = $budgetFreeName;
+         |budget_allocator->ctx = $budgetParam;
+         |budget_allocator->intern_fn = ( ( NULL != ${Allocator.paramName} ) && ( NULL != ${Allocator.paramName}->intern_fn ) ) ? $budgetInternName : NULL;""".stripMargin
+  )
+
+  private val budgetErrorFunction = FunctionDefinition(
+    name = budgetErrorName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Get the error of a failed parse",
+      description = s"Gets the error code of a parse that failed after its input passed the limits check: $heapErrorCode if the heap budget was spent, $memoryErrorCode if an allocation failed, and $schemaErrorCode otherwise."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = errorTypeName,
+      parameters = List(FunctionParameter(s"$budgetTypeName const*", budgetParam))
+    ),
+    body =
+      s"""if( $budgetParam->exceeded )
+         |    {
+         |    return $heapErrorCode;
+         |    }
+         |
+         |return $budgetParam->failed ? $memoryErrorCode : $schemaErrorCode;""".stripMargin
+  )
+
+  private val budgetMallocFunction = FunctionDefinition(
+    name = budgetMallocName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Allocate from a heap budget",
+      description = "Allocates size bytes through the budget's allocator, or returns NULL if that would exceed the budget."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = "void*",
+      parameters = List(FunctionParameter("void*", "ctx"), FunctionParameter("size_t", "size"))
+    ),
+    body =
+      s"""$budgetTypeName* $budgetParam;
+         |void* memory;
+         |
+         |$budgetParam = ( $budgetTypeName* )ctx;
+         |if( size > $budgetParam->remaining )
+         |    {
+         |    $budgetParam->exceeded = 1;
+         |    return NULL;
+         |    }
+         |
+         |memory = ${Allocator.mallocFunction.name}( $budgetParam->${Allocator.paramName}, size );
+         |if( NULL == memory )
+         |    {
+         |    $budgetParam->failed = 1;
+         |    return NULL;
+         |    }
+         |
+         |$budgetParam->remaining -= size;
+         |
+         |return memory;""".stripMargin
+  )
+
+  private val budgetFreeFunction = FunctionDefinition(
+    name = budgetFreeName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Free memory of a heap budget",
+      description = "Frees memory through the budget's allocator. The budget counts the bytes allocated, so it is not refunded."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.voidCType,
+      parameters = List(FunctionParameter("void*", "ctx"), FunctionParameter("void*", "ptr"))
+    ),
+    body = s"${Allocator.freeFunction.name}( ( ( $budgetTypeName* )ctx )->${Allocator.paramName}, ptr );"
+  )
+
+  private val budgetInternFunction = FunctionDefinition(
+    name = budgetInternName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Intern a string of a heap budget",
+      description = "Interns the string through the budget's allocator, which owns the interned copy."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = "char const*",
+      parameters = List(FunctionParameter("void*", "ctx"), FunctionParameter("char const*", "str"))
+    ),
+    body =
+      s"""${Allocator.parameter.paramType} ${Allocator.paramName};
+         |
+         |${Allocator.paramName} = ( ( $budgetTypeName* )ctx )->${Allocator.paramName};
+         |
+         |return ${Allocator.paramName}->intern_fn( ${Allocator.paramName}->ctx, str );""".stripMargin
+  )
+}
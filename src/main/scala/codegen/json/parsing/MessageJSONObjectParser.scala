@@ -1,7 +1,9 @@
 package codegen.json.parsing
 
 import codegen.Constants
+import codegen.allocator.Allocator
 import codegen.functions._
+import codegen.json.tables._
 import codegen.messagetypes._
 import datamodel._
 
@@ -29,6 +31,22 @@ object MessageJSONObjectParser {
     )
   }
 
+  /**
+    * Creates the static function to parse a message object from a cJSON object for
+    * table-driven code generation. Rather than parsing each field itself, the function
+    * passes the message's descriptor to the generic runtime.
+    * @param message Message to parse
+    * @return Definition of function to parse messages from cJSON objects with the runtime
+    */
+  def tableDriven(message: Message): FunctionDefinition = {
+    FunctionDefinition(
+      name = name(message.name),
+      documentation = documentation(message),
+      prototype = prototype(message),
+      body = tableDrivenBody(message)
+    )
+  }
+
   /**
     * Gets the name of the internal static function to parse a message object from a
     * cJSON object
@@ -60,7 +78,8 @@ object MessageJSONObjectParser {
       returnType = Constants.defaultBooleanCType,
       parameters = List(
         FunctionParameter(paramType = "cJSON*", paramName = jsonObjectParam),
-        FunctionParameter(paramType = message.name + "*", messageOutputParam)
+        FunctionParameter(paramType = message.name + "*", messageOutputParam),
+        Allocator.parameter
       )
     )
   }
@@ -71,8 +90,16 @@ object MessageJSONObjectParser {
     */
   private def body(message: Message): String = {
     val initializeOutput = s"${MessageInitFunction.name(message.name)}( $messageOutputParam );"
-    val freeOutput = s"${MessageFreeFunction.name(message.name)}( $messageOutputParam );"
+    val freeOutput = s"${MessageFreeFunction.exName(message.name)}( $messageOutputParam, ${Allocator.paramName} );"
     val parseFieldSnippets = message.fields.map(parseFieldSnippet).mkString("\n\n")
+    val indexSnippet = if(ArrayIndex.hasIndexes(message)) {
+      s"""
+         |
+         |// Index the arrays once all of their elements are parsed
+         |$successVar = $successVar && ${ArrayIndex.buildCall(message.name, messageOutputParam)};""".stripMargin
+    } else {
+      ""
+    }
 
     s"""${Constants.defaultBooleanCType} $successVar;
        |cJSON* $jsonObjectItemVar;
@@ -80,7 +107,7 @@ object MessageJSONObjectParser {
        |$successVar = 1;
        |$initializeOutput
        |
-       |$parseFieldSnippets
+       |$parseFieldSnippets$indexSnippet
        |
        |// Reset the output on error
        |if( !$successVar )
@@ -92,19 +119,63 @@ object MessageJSONObjectParser {
      """.stripMargin
   }
 
+  /**
+    * @param message Message to parse
+    * @return Body of the function to parse messages from cJSON objects with the runtime
+    */
+  private def tableDrivenBody(message: Message): String = {
+    val descriptor = MessageJSONDescriptor.name(message.name)
+    val freeOutput = s"${MessageFreeFunction.exName(message.name)}( $messageOutputParam, ${Allocator.paramName} );"
+
+    s"""${Constants.defaultBooleanCType} $successVar;
+       |
+       |$successVar = ${JSONTableRuntime.objectParseName}( $jsonObjectParam, $messageOutputParam, &$descriptor, ${Allocator.paramName} );
+       |
+       |// Reset the output on error
+       |if( !$successVar )
+       |    {
+       |    $freeOutput
+       |    }
+       |
+       |return $successVar;""".stripMargin
+  }
+
   /**
     * Gets the snippet of code necessary to parse the provided field of the specified
-    * message.
+    * message. Optional fields may be missing, in which case they keep their default.
     * @param field Field to parse
     * @return Code snippet to parse the message field
     */
   private def parseFieldSnippet(field: Field): String = {
     val parseFunctionCall = fieldParseCall(field.name, field.fieldType)
-    s"""if( $successVar )
-       |    {
-       |    $jsonObjectItemVar = cJSON_GetObjectItem( $jsonObjectParam, "${field.jsonKey}" );
-       |    $successVar = ( NULL != json_item ) && ( $parseFunctionCall );
-       |    }""".stripMargin
+
+    (OptionalField.isOptional(field), OptionalField.defaultAssignment(messageOutputParam, field)) match {
+      case (true, Some(defaultAssignment)) =>
+        s"""if( $successVar )
+           |    {
+           |    $jsonObjectItemVar = cJSON_GetObjectItem( $jsonObjectParam, "${field.jsonKey}" );
+           |    if( NULL == $jsonObjectItemVar )
+           |        {
+           |        $defaultAssignment
+           |        }
+           |    else
+           |        {
+           |        $successVar = $parseFunctionCall;
+           |        }
+           |    }""".stripMargin
+      case (true, None) =>
+        s"""if( $successVar )
+           |    {
+           |    $jsonObjectItemVar = cJSON_GetObjectItem( $jsonObjectParam, "${field.jsonKey}" );
+           |    $successVar = ( NULL == json_item ) || ( $parseFunctionCall );
+           |    }""".stripMargin
+      case _ =>
+        s"""if( $successVar )
+           |    {
+           |    $jsonObjectItemVar = cJSON_GetObjectItem( $jsonObjectParam, "${field.jsonKey}" );
+           |    $successVar = ( NULL != json_item ) && ( $parseFunctionCall );
+           |    }""".stripMargin
+    }
   }
 
   /**
@@ -116,12 +187,18 @@ object MessageJSONObjectParser {
   private def fieldParseCall(fieldName: String, fieldType: FieldType): String = {
     fieldType match {
       case ArrayType(elementType) =>  arrayFieldParseCall(fieldName, elementType)
-      case AliasedType(_, underlyingType) => aliasedFieldParseCall(fieldName, underlyingType)
-      case ObjectType(objectName) => defaultFieldParseCall(fieldName, MessageJSONObjectParser.name(objectName))
+      case InlineArrayType(elementType, capacity) => inlineArrayFieldParseCall(fieldName, elementType, capacity)
+      case BytesType => bytesFieldParseCall(fieldName)
+      case AliasedType(alias, underlyingType) => aliasedFieldParseCall(fieldName, alias, underlyingType)
+      case ObjectType(objectName) => allocatingFieldParseCall(fieldName, MessageJSONObjectParser.name(objectName))
       case BooleanType => defaultFieldParseCall(fieldName, BooleanJSONParser.name)
-      case DynamicStringType => defaultFieldParseCall(fieldName, DynamicStringJSONParser.name)
+      case DynamicStringType => allocatingFieldParseCall(fieldName, DynamicStringJSONParser.name)
+      case InternedStringType => allocatingFieldParseCall(fieldName, InternedStringJSONParser.name)
       case FixedStringType(_) => fixedStringFieldParseCall(fieldName)
+      case InlineStringType(_) => inlineStringFieldParseCall(fieldName)
       case NumberType => defaultFieldParseCall(fieldName, NumberJSONParser.name)
+      case TimestampType => defaultFieldParseCall(fieldName, TimestampJSONParser.name)
+      case enumType: EnumType => defaultFieldParseCall(fieldName, EnumJSONParser.name(enumType))
     }
   }
 
@@ -135,21 +212,52 @@ object MessageJSONObjectParser {
     val parseFunction = ArrayJSONParser.name(elementType)
     val countFieldName = MessageStruct.arrayCountFieldName(arrayFieldName)
 
-    s"$parseFunction( $jsonObjectItemVar, &$messageOutputParam->$arrayFieldName, &$messageOutputParam->$countFieldName )"
+    s"$parseFunction( $jsonObjectItemVar, &$messageOutputParam->$arrayFieldName, &$messageOutputParam->$countFieldName, ${Allocator.paramName} )"
+  }
+
+  /**
+    * Gets the function call to parse an inline array field of a message
+    * @param arrayFieldName Name of the array field within the message
+    * @param elementType Type of elements contained in the array
+    * @param capacity Number of elements stored inline
+    * @return Function call to parse the inline array field from JSON
+    */
+  private def inlineArrayFieldParseCall(arrayFieldName: String, elementType: SimpleFieldType, capacity: Int): String = {
+    val parseFunction = ArrayJSONParser.inlineName(elementType)
+    val countFieldName = MessageStruct.arrayCountFieldName(arrayFieldName)
+    val inlineFieldName = InlineArray.bufferName(arrayFieldName)
+
+    s"$parseFunction( $jsonObjectItemVar, $messageOutputParam->$inlineFieldName, $capacity, &$messageOutputParam->$arrayFieldName, &$messageOutputParam->$countFieldName, ${Allocator.paramName} )"
+  }
+
+  /**
+    * Gets the function call to parse a bytes field of a message
+    * @param fieldName Name of the bytes field within the message
+    * @return Function call to parse the bytes field from JSON
+    */
+  private def bytesFieldParseCall(fieldName: String): String = {
+    val member = s"$messageOutputParam->$fieldName"
+
+    s"${BytesJSONParser.name}( $jsonObjectItemVar, &${Bytes.data(member)}, &${Bytes.length(member)}, ${Allocator.paramName} )"
   }
 
   /**
     * Gets the function call to parse an aliased message field
     * @param fieldName Name of aliased-type field
+    * @param alias C type of the field
     * @param underlyingType Underlying field type
     * @return Function call to parse the aliased field
     */
-  private def aliasedFieldParseCall(fieldName: String, underlyingType: BaseFieldType): String = {
+  private def aliasedFieldParseCall(fieldName: String, alias: String, underlyingType: BaseFieldType): String = {
     underlyingType match {
       case BooleanType => defaultAliasedFieldParseCall(fieldName, BooleanJSONParser.name, Constants.defaultBooleanCType)
-      case DynamicStringType => defaultAliasedFieldParseCall(fieldName, DynamicStringJSONParser.name, Constants.defaultCharacterCType)
+      case DynamicStringType => allocatingAliasedFieldParseCall(fieldName, DynamicStringJSONParser.name, Constants.defaultCharacterCType)
+      case InternedStringType => allocatingAliasedFieldParseCall(fieldName, InternedStringJSONParser.name, s"${Constants.defaultCharacterCType} const")
       case FixedStringType(_) => aliasedFixedStringParseCall(fieldName)
-      case NumberType => defaultAliasedFieldParseCall(fieldName, NumberJSONParser.name, Constants.defaultNumberCType)
+      case InlineStringType(_) => inlineStringFieldParseCall(fieldName)
+      case NumberType => defaultFieldParseCall(fieldName, AliasedNumberJSONParser.name(alias)) // Parsed with the width of the alias
+      case TimestampType => defaultAliasedFieldParseCall(fieldName, TimestampJSONParser.name, Constants.defaultTimestampCType)
+      case enumType: EnumType => defaultAliasedFieldParseCall(fieldName, EnumJSONParser.name(enumType), enumType.name)
     }
   }
 
@@ -167,6 +275,18 @@ object MessageJSONObjectParser {
     s"$parseFunctionName( $jsonObjectItemVar, ($underlyingType*)&$messageOutputParam->$fieldName )"
   }
 
+  /**
+    * Gets the function call to parse an aliased-type field whose underlying type owns
+    * dynamically-allocated memory
+    * @param fieldName Name of field
+    * @param parseFunctionName Name of function to parse the field's underlying type
+    * @param underlyingType Field's underlying C-type
+    * @return Function call to parse the aliased field with the allocator
+    */
+  private def allocatingAliasedFieldParseCall(fieldName: String, parseFunctionName: String, underlyingType: String): String = {
+    s"$parseFunctionName( $jsonObjectItemVar, ($underlyingType**)&$messageOutputParam->$fieldName, ${Allocator.paramName} )"
+  }
+
   /**
     * Gets the function call to parse an aliased fixed-string field
     * @param fieldName Name of aliased field
@@ -189,6 +309,17 @@ object MessageJSONObjectParser {
     s"$parseFunctionName( $jsonObjectItemVar, &$messageOutputParam->$fieldName )"
   }
 
+  /**
+    * Gets the function call to parse a message field whose type owns dynamically-allocated
+    * memory. The allocator is passed along to the field's parse function.
+    * @param fieldName Name of the field to parse
+    * @param parseFunctionName Name of the function to parse field's type
+    * @return Function call to parse the field with the allocator
+    */
+  private def allocatingFieldParseCall(fieldName: String, parseFunctionName: String): String = {
+    s"$parseFunctionName( $jsonObjectItemVar, &$messageOutputParam->$fieldName, ${Allocator.paramName} )"
+  }
+
   /**
     * Gets the function call to parse a fixed-length string field
     * @param fieldName Name of the field to parse
@@ -198,4 +329,16 @@ object MessageJSONObjectParser {
     val parseFunction = FixedStringJSONParser.name
     s"$parseFunction( $jsonObjectItemVar, $messageOutputParam->$fieldName, sizeof( $messageOutputParam->$fieldName ) )"
   }
+
+  /**
+    * Gets the function call to parse an inline string field into its inline buffer or,
+    * if the value is too long, onto the heap
+    * @param fieldName Name of the field to parse
+    * @return Function call to parse the inline string field
+    */
+  private def inlineStringFieldParseCall(fieldName: String): String = {
+    val parseFunction = InlineStringJSONParser.name
+    val buffer = s"$messageOutputParam->${InlineString.bufferName(fieldName)}"
+    s"$parseFunction( $jsonObjectItemVar, $buffer, sizeof( $buffer ), &$messageOutputParam->$fieldName, ${Allocator.paramName} )"
+  }
 }
@@ -1,7 +1,10 @@
 package codegen.json.parsing
 
 import codegen.Constants
+import codegen.allocator.Allocator
 import codegen.functions._
+import codegen.json.CJSONAllocatorHooks
+import codegen.json.stats.MessageJSONStats
 import codegen.messagetypes._
 import datamodel._
 
@@ -9,7 +12,11 @@ import datamodel._
 object MessageJSONStringParser {
 
   private val jsonStringParam = "json_str"
+  private val jsonBufferParam = "json"
+  private val lengthParam = "json_len"
+  private val pathParam = "path"
   private val messageOutputParam = "obj_out"
+  private val limitsParam = "limits"
 
   /**
     * Returns the definition for the function that parses an input string into
@@ -27,6 +34,147 @@ object MessageJSONStringParser {
     )
   }
 
+  /**
+    * Returns the definition for the function that parses an input string into
+    * objects of the given message type using a caller-provided allocator for all
+    * memory, including the memory used internally by cJSON.
+    * @param message Message to parse
+    * @return Function to parse the message from JSON strings with an allocator
+    */
+  def withAllocator(message: Message): FunctionDefinition = {
+    FunctionDefinition(
+      name = exName(message.name),
+      documentation = exDocumentation(message),
+      prototype = exPrototype(message),
+      body = exBody(message)
+    )
+  }
+
+  /**
+    * Returns the definition for the function that parses a length-delimited JSON
+    * buffer, which need not be NUL-terminated, into objects of the given message type
+    * @param message Message to parse
+    * @return Function to parse the message from JSON buffers
+    */
+  def withLength(message: Message): FunctionDefinition = {
+    FunctionDefinition(
+      name = lengthName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Parse a ${message.name} from a buffer",
+        description =
+          s"Parses the first $lengthParam bytes of $jsonBufferParam into a ${message.name}. The buffer need not be NUL-terminated and is never read past $lengthParam bytes. The caller must call ${MessageFreeFunction.name(message.name)} on $messageOutputParam."
+      ),
+      prototype = lengthPrototype(message),
+      body = s"return ${lengthExName(message.name)}( $jsonBufferParam, $lengthParam, $messageOutputParam, ${Allocator.defaultAllocator} );"
+    )
+  }
+
+  /**
+    * Returns the definition for the function that parses a length-delimited JSON
+    * buffer into objects of the given message type using a caller-provided allocator
+    * @param message Message to parse
+    * @return Function to parse the message from JSON buffers with an allocator
+    */
+  def withLengthAndAllocator(message: Message): FunctionDefinition = {
+    val basePrototype = lengthPrototype(message)
+
+    FunctionDefinition(
+      name = lengthExName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Parse a ${message.name} from a buffer with an allocator",
+        description =
+          s"Parses the first $lengthParam bytes of $jsonBufferParam into a ${message.name}, making all allocations through ${Allocator.paramName}. The buffer need not be NUL-terminated and is never read past $lengthParam bytes. The caller must call ${MessageFreeFunction.exName(message.name)} on $messageOutputParam with the same allocator."
+      ),
+      prototype = basePrototype.copy(parameters = basePrototype.parameters :+ Allocator.parameter),
+      body = parseBody(message, lengthParam, s"${JSONInput.parseLengthName}( $jsonBufferParam, $lengthParam, ${Allocator.paramName} )")
+    )
+  }
+
+  /**
+    * Returns the definition for the function that parses a length-delimited JSON buffer
+    * into objects of the given message type within resource limits
+    * @param message Message to parse
+    * @return Function to parse the message from JSON buffers within limits
+    */
+  def withLimits(message: Message): FunctionDefinition = {
+    FunctionDefinition(
+      name = limitedName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Parse a ${message.name} within limits",
+        description =
+          s"Parses the first $lengthParam bytes of $jsonBufferParam into a ${message.name} like ${lengthName(message.name)}, failing as soon as the input exceeds one of the $limitsParam, which may be NULL. " +
+          s"Returns ${JSONParseLimits.okCode} on success or the code of the error. The caller must call ${MessageFreeFunction.name(message.name)} on $messageOutputParam."
+      ),
+      prototype = limitedPrototype(message),
+      body = s"return ${limitedExName(message.name)}( $jsonBufferParam, $lengthParam, $messageOutputParam, $limitsParam, ${Allocator.defaultAllocator} );"
+    )
+  }
+
+  /**
+    * Returns the definition for the function that parses a length-delimited JSON buffer
+    * into objects of the given message type within resource limits using a caller-provided
+    * allocator
+    * @param message Message to parse
+    * @return Function to parse the message from JSON buffers within limits with an allocator
+    */
+  def withLimitsAndAllocator(message: Message): FunctionDefinition = {
+    val basePrototype = limitedPrototype(message)
+
+    FunctionDefinition(
+      name = limitedExName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Parse a ${message.name} within limits with an allocator",
+        description =
+          s"Parses the first $lengthParam bytes of $jsonBufferParam into a ${message.name} like ${lengthExName(message.name)}, failing as soon as the input exceeds one of the $limitsParam, which may be NULL. " +
+          s"Returns ${JSONParseLimits.okCode} on success or the code of the error. The caller must call ${MessageFreeFunction.exName(message.name)} on $messageOutputParam with the same allocator."
+      ),
+      prototype = basePrototype.copy(parameters = basePrototype.parameters :+ Allocator.parameter),
+      body = limitedBody(message)
+    )
+  }
+
+  /**
+    * Returns the definition for the function that parses a JSON file into objects of
+    * the given message type. The file is memory-mapped rather than read into memory.
+    * @param message Message to parse
+    * @return Function to parse the message from JSON files
+    */
+  def fromFile(message: Message): FunctionDefinition = {
+    FunctionDefinition(
+      name = fileName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Parse a ${message.name} from a file",
+        description =
+          s"Parses the JSON file at $pathParam into a ${message.name}. The file is memory-mapped and parsed in place. The caller must call ${MessageFreeFunction.name(message.name)} on $messageOutputParam."
+      ),
+      prototype = filePrototype(message),
+      body = s"return ${fileExName(message.name)}( $pathParam, $messageOutputParam, ${Allocator.defaultAllocator} );",
+      preprocessorGuard = Some(JSONInput.mmapGuard)
+    )
+  }
+
+  /**
+    * Returns the definition for the function that parses a JSON file into objects of
+    * the given message type using a caller-provided allocator
+    * @param message Message to parse
+    * @return Function to parse the message from JSON files with an allocator
+    */
+  def fromFileWithAllocator(message: Message): FunctionDefinition = {
+    val basePrototype = filePrototype(message)
+
+    FunctionDefinition(
+      name = fileExName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Parse a ${message.name} from a file with an allocator",
+        description =
+          s"Parses the JSON file at $pathParam into a ${message.name}, making all allocations through ${Allocator.paramName}. The file is memory-mapped and parsed in place. The caller must call ${MessageFreeFunction.exName(message.name)} on $messageOutputParam with the same allocator."
+      ),
+      prototype = basePrototype.copy(parameters = basePrototype.parameters :+ Allocator.parameter),
+      body = fileBody(message),
+      preprocessorGuard = Some(JSONInput.mmapGuard)
+    )
+  }
+
   /**
     * Gets the name of the public API function to parse a message object from a
     * JSON input string.
@@ -37,6 +185,64 @@ object MessageJSONStringParser {
     s"${messageName}_json_parse"
   }
 
+  /**
+    * Gets the name of the public API function to parse a message object from a
+    * JSON input string with an allocator.
+    * @param messageName Name of the message to parse
+    * @return Function to parse a message object from a JSON string with an allocator
+    */
+  def exName(messageName: String): String = {
+    name(messageName) + Allocator.functionNameSuffix
+  }
+
+  /**
+    * @param messageName Name of the message to parse
+    * @return Name of the function to parse a message object from a JSON buffer
+    */
+  def lengthName(messageName: String): String = {
+    name(messageName) + "_n"
+  }
+
+  /**
+    * @param messageName Name of the message to parse
+    * @return Name of the function to parse a message object from a JSON buffer with an allocator
+    */
+  def lengthExName(messageName: String): String = {
+    lengthName(messageName) + Allocator.functionNameSuffix
+  }
+
+  /**
+    * @param messageName Name of the message to parse
+    * @return Name of the function to parse a message object from a JSON buffer within limits
+    */
+  def limitedName(messageName: String): String = {
+    name(messageName) + "_limited"
+  }
+
+  /**
+    * @param messageName Name of the message to parse
+    * @return Name of the function to parse a message object from a JSON buffer within limits with an allocator
+    */
+  def limitedExName(messageName: String): String = {
+    limitedName(messageName) + Allocator.functionNameSuffix
+  }
+
+  /**
+    * @param messageName Name of the message to parse
+    * @return Name of the function to parse a message object from a JSON file
+    */
+  def fileName(messageName: String): String = {
+    name(messageName) + "_file"
+  }
+
+  /**
+    * @param messageName Name of the message to parse
+    * @return Name of the function to parse a message object from a JSON file with an allocator
+    */
+  def fileExName(messageName: String): String = {
+    fileName(messageName) + Allocator.functionNameSuffix
+  }
+
   /**
     * @param message Message to parse
     * @return Documentation of the function to parse a message from a JSON string
@@ -49,6 +255,18 @@ object MessageJSONStringParser {
     )
   }
 
+  /**
+    * @param message Message to parse
+    * @return Documentation of the function to parse a message from a JSON string with an allocator
+    */
+  private def exDocumentation(message: Message): FunctionDocumentation = {
+    FunctionDocumentation(
+      shortSummary = s"Parse a ${message.name} with an allocator",
+      description =
+        s"Parses the provided JSON string into a ${message.name}, making all allocations through ${Allocator.paramName}. The caller must call ${MessageFreeFunction.exName(message.name)} on $messageOutputParam with the same allocator."
+    )
+  }
+
   /**
     * @param message Message to parse
     * @return Prototype of the function to parse a message from a JSON string
@@ -64,29 +282,108 @@ object MessageJSONStringParser {
     )
   }
 
+  /**
+    * @param message Message to parse
+    * @return Prototype of the function to parse a message from a JSON string with an allocator
+    */
+  private def exPrototype(message: Message): FunctionPrototype = {
+    val basePrototype = prototype(message)
+
+    basePrototype.copy(parameters = basePrototype.parameters :+ Allocator.parameter)
+  }
+
+  /**
+    * @param message Message to parse
+    * @return Prototype of the function to parse a message from a JSON buffer
+    */
+  private def lengthPrototype(message: Message): FunctionPrototype = {
+    FunctionPrototype(
+      isStatic = false,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter(paramType = "char const*", paramName = jsonBufferParam),
+        FunctionParameter(paramType = "size_t", paramName = lengthParam),
+        FunctionParameter(paramType = message.name + "*", paramName = messageOutputParam)
+      )
+    )
+  }
+
+  /**
+    * @param message Message to parse
+    * @return Prototype of the function to parse a message from a JSON buffer within limits
+    */
+  private def limitedPrototype(message: Message): FunctionPrototype = {
+    FunctionPrototype(
+      isStatic = false,
+      returnType = JSONParseLimits.errorTypeName,
+      parameters = lengthPrototype(message).parameters :+ FunctionParameter(paramType = s"${JSONParseLimits.limitsTypeName} const*", paramName = limitsParam)
+    )
+  }
+
+  /**
+    * @param message Message to parse
+    * @return Prototype of the function to parse a message from a JSON file
+    */
+  private def filePrototype(message: Message): FunctionPrototype = {
+    FunctionPrototype(
+      isStatic = false,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter(paramType = "char const*", paramName = pathParam),
+        FunctionParameter(paramType = message.name + "*", paramName = messageOutputParam)
+      )
+    )
+  }
+
   /**
     * @param message Message to parse
     * @return Body of the function to parse a message from a JSON string
     */
   private def body(message: Message): String = {
+    s"return ${exName(message.name)}( $jsonStringParam, $messageOutputParam, ${Allocator.defaultAllocator} );"
+  }
+
+  /**
+    * @param message Message to parse
+    * @return Body of the function to parse a message from a JSON string with an allocator
+    */
+  private def exBody(message: Message): String = {
+    parseBody(message, s"strlen( $jsonStringParam )", s"cJSON_Parse( $jsonStringParam )")
+  }
+
+  /**
+    * Gets the body of a function that parses JSON text into a message with an allocator
+    * @param message Message to parse
+    * @param inputLength C expression for the length of the JSON text
+    * @param parseCall C expression that parses the JSON text into a cJSON tree
+    * @return Body of the parse function
+    */
+  private def parseBody(message: Message, inputLength: String, parseCall: String): String = {
     val jsonRootVar = "json_root"
     val initializeOutput = s"${MessageInitFunction.name(message.name)}( $messageOutputParam );"
-    val freeOutput = s"${MessageFreeFunction.name(message.name)}( $messageOutputParam );"
+    val freeOutput = s"${MessageFreeFunction.exName(message.name)}( $messageOutputParam, ${Allocator.paramName} );"
 
     // Delegate to the object parser to perform the actual parsing work
-    val parseJSONObject = s"${MessageJSONObjectParser.name(message.name)}( $jsonRootVar, $messageOutputParam );"
+    val parseJSONObject = s"${MessageJSONObjectParser.name(message.name)}( $jsonRootVar, $messageOutputParam, ${Allocator.paramName} );"
 
     s"""${Constants.defaultBooleanCType} success;
        |cJSON* $jsonRootVar;
+       |${CJSONAllocatorHooks.previousAllocatorDeclaration}
+       |${MessageJSONStats.locals}
        |
+       |${MessageJSONStats.begin(message.name, MessageJSONStats.parseOperation)}
+       |${MessageJSONStats.add(MessageJSONStats.bytesInCounter, inputLength)}
+       |${CJSONAllocatorHooks.push}
        |$initializeOutput
        |
-       |$jsonRootVar = cJSON_Parse( $jsonStringParam );
+       |$jsonRootVar = $parseCall;
        |success = ( NULL != $jsonRootVar );
+       |${MessageJSONStats.addIf("!success", MessageJSONStats.syntaxFailuresCounter, "1")}
        |
        |if( success )
        |    {
        |    success = $parseJSONObject
+       |    ${MessageJSONStats.addIf("!success", MessageJSONStats.schemaFailuresCounter, "1")}
        |    }
        |
        |// Reset the output on error
@@ -96,6 +393,84 @@ object MessageJSONStringParser {
        |    }
        |
        |cJSON_Delete( $jsonRootVar );
+       |${CJSONAllocatorHooks.pop}
+       |${MessageJSONStats.end}
+       |
+       |return success;""".stripMargin
+  }
+
+  /**
+    * Gets the body of the function to parse a message within limits. The input is checked
+    * against the limits before cJSON allocates anything, and the parse then allocates
+    * through a heap budget that also records why an allocation failed.
+    * @param message Message to parse
+    * @return Body of the function to parse a message from a JSON buffer within limits
+    */
+  private def limitedBody(message: Message): String = {
+    s"""${JSONParseLimits.errorTypeName} error;
+       |${JSONParseLimits.budgetTypeName} budget;
+       |${Allocator.typeName} budget_allocator;
+       |
+       |${MessageInitFunction.name(message.name)}( $messageOutputParam );
+       |
+       |error = ${JSONParseLimits.checkName}( $jsonBufferParam, $lengthParam, $limitsParam );
+       |
+       |if( ${JSONParseLimits.okCode} == error )
+       |    {
+       |    ${JSONParseLimits.budgetInitName}( &budget, &budget_allocator, $limitsParam, ${Allocator.paramName} );
+       |    if( !${lengthExName(message.name)}( $jsonBufferParam, $lengthParam, $messageOutputParam, &budget_allocator ) )
+       |        {
+       |        error = ${JSONParseLimits.budgetErrorName}( &budget );
+       |        }
+       |    }
+       |
+       |return error;""".stripMargin
+  }
+
+  /**
+    * @param message Message to parse
+    * @return Body of the function to parse a message from a JSON file with an allocator
+    */
+  private def fileBody(message: Message): String = {
+    s"""${Constants.defaultBooleanCType} success;
+       |${Constants.defaultIntCType} fd;
+       |struct stat file_stat;
+       |size_t file_size;
+       |void* mapping;
+       |
+       |mapping = MAP_FAILED;
+       |file_size = 0;
+       |
+       |fd = open( $pathParam, O_RDONLY );
+       |if( ( fd >= 0 ) && ( 0 == fstat( fd, &file_stat ) ) && ( file_stat.st_size > 0 ) )
+       |    {
+       |    file_size = ( size_t )file_stat.st_size;
+       |    mapping = mmap( NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+       |    }
+       |
+       |success = ( MAP_FAILED != mapping );
+       |
+       |if( success )
+       |    {
+       |    // The parser reads the file once from front to back
+       |#if defined( MADV_SEQUENTIAL )
+       |    madvise( mapping, file_size, MADV_SEQUENTIAL );
+       |#elif defined( POSIX_MADV_SEQUENTIAL )
+       |    posix_madvise( mapping, file_size, POSIX_MADV_SEQUENTIAL );
+       |#endif
+       |
+       |    success = ${lengthExName(message.name)}( ( char const* )mapping, file_size, $messageOutputParam, ${Allocator.paramName} );
+       |    munmap( mapping, file_size );
+       |    }
+       |else
+       |    {
+       |    ${MessageInitFunction.name(message.name)}( $messageOutputParam );
+       |    }
+       |
+       |if( fd >= 0 )
+       |    {
+       |    close( fd );
+       |    }
        |
        |return success;""".stripMargin
   }
@@ -0,0 +1,83 @@
+package codegen.json.parsing
+
+import codegen.Constants
+import codegen.functions._
+import codegen.json.scanning.JSONScanner
+import codegen.timestamp.Timestamp
+
+/**
+  * Defines the functions to parse timestamps from the RFC 3339 text of JSON strings
+  */
+object TimestampJSONParser {
+
+  private val jsonParam = "json"
+  private val scannerParam = "scanner"
+  private val outputParam = "value_out"
+
+  /**
+    * Name of the function to parse timestamps from cJSON objects
+    */
+  val name: String = "timestamp_json_parse"
+
+  /**
+    * Name of the function to scan timestamps with the JSON scanner
+    */
+  val scanName: String = "timestamp_json_scan"
+
+  /**
+    * Definition of the static function to parse timestamps from JSON. The string of the
+    * cJSON object is parsed in place.
+    */
+  val parseFunction: FunctionDefinition = FunctionDefinition(
+    name = name,
+    documentation = FunctionDocumentation(
+      shortSummary = "Parse JSON timestamp",
+      description = "Parses the given JSON object as an RFC 3339 date-time string. Returns 1 if the parse was successful, 0 otherwise."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter(paramType = "cJSON*", paramName = jsonParam),
+        FunctionParameter(paramType = s"${Constants.defaultTimestampCType}*", paramName = outputParam)
+      )
+    ),
+    body =
+      s"""return ( cJSON_String == $jsonParam->type ) && ${Timestamp.parseName}( $jsonParam->valuestring, strlen( $jsonParam->valuestring ), $outputParam );"""
+  )
+
+  /**
+    * Definition of the static function to scan timestamps, which the validate and extract
+    * functions use
+    */
+  val scanFunction: FunctionDefinition = FunctionDefinition(
+    name = scanName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Scan JSON timestamp",
+      description = s"Consumes a string and parses it as an RFC 3339 date-time, which is stored in $outputParam unless it is NULL. Returns 1 if a valid timestamp was scanned, 0 otherwise."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter(s"${JSONScanner.typeName}*", scannerParam),
+        FunctionParameter(s"${Constants.defaultTimestampCType}*", outputParam)
+      )
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |${Constants.defaultCharacterCType} buffer[${Timestamp.parseBufferSize}];
+         |${Constants.defaultTimestampCType} value;
+         |
+         |// Strings that do not fit the buffer are rejected by the copy
+         |success = ${JSONScanner.stringCopyName}( $scannerParam, buffer, sizeof( buffer ) ) &&
+         |          ${Timestamp.parseName}( buffer, strlen( buffer ), &value );
+         |
+         |if( success && ( NULL != $outputParam ) )
+         |    {
+         |    *$outputParam = value;
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+}
@@ -0,0 +1,740 @@
+package codegen.json.scanning
+
+import codegen.Constants
+import codegen.functions._
+
+/**
+  * A streaming JSON scanner that reads values directly from the input text without building
+  * a cJSON tree or allocating any memory. Each scan function skips leading whitespace, consumes
+  * one syntactic element and returns 1, or returns 0 leaving the scanner's position at (or
+  * inside) the offending element so it can be reported as the error offset. The scanner accepts
+  * exactly the JSON grammar of RFC 8259.
+  */
+object JSONScanner {
+
+  val typeName = "cdto_json_scanner"
+  val paramName = "scanner"
+
+  /**
+    * Maximum nesting depth of JSON containers, matching cJSON's default nesting limit
+    */
+  val nestingLimitMacro = "CDTO_JSON_NESTING_LIMIT"
+
+  val whitespaceName = "cdto_json_scan_whitespace"
+  val charName = "cdto_json_scan_char"
+  val booleanName = "cdto_json_scan_boolean"
+  val literalName = "cdto_json_scan_literal"
+  val numberName = "cdto_json_scan_number"
+  val stringName = "cdto_json_scan_string"
+  val fixedStringName = "cdto_json_scan_fixed_string"
+  val stringCopyName = "cdto_json_scan_string_copy"
+  val base64Name = "cdto_json_scan_base64"
+  val stringMatchesName = "cdto_json_string_matches"
+  val containerBeginName = "cdto_json_scan_container_begin"
+  val containerNextName = "cdto_json_scan_container_next"
+  val skipValueName = "cdto_json_skip_value"
+  val seekMemberName = "cdto_json_seek_member"
+
+  private val anyName = "cdto_json_scan_any"
+  private val digitsName = "cdto_json_scan_digits"
+  private val hex4Name = "cdto_json_scan_hex4"
+  private val unicodeEscapeName = "cdto_json_scan_unicode_escape"
+  private val stringCharName = "cdto_json_scan_string_char"
+
+  val parameter: FunctionParameter = FunctionParameter(s"$typeName*", paramName)
+
+  /**
+    * Definition of the scanner type. It is shared by all protocols, so it is protected
+    * against multiple definitions.
+    */
+  val typeDefinition: String =
+    s"""#ifndef CDTO_JSON_SCANNER_DEFINED
+       |#define CDTO_JSON_SCANNER_DEFINED
+       |
+       |#ifndef $nestingLimitMacro
+       |#define $nestingLimitMacro 1000
+       |#endif
+       |
+       |typedef struct
+       |    {
+       |    char const*    json;
+       |    size_t         len;
+       |    size_t         pos;
+       |    } $typeName;
+       |
+       |#endif /* #ifndef CDTO_JSON_SCANNER_DEFINED */""".stripMargin
+
+  /**
+    * Gets the statements that initialize a scanner local variable over a JSON string
+    * @param scannerVar Name of the scanner variable
+    * @param json Expression of the JSON text
+    * @param length Expression of the length of the JSON text
+    * @return Statements to initialize the scanner
+    */
+  def initialize(scannerVar: String, json: String, length: String): String = {
+    s"""$scannerVar.json = $json;
+       |$scannerVar.len = $length;
+       |$scannerVar.pos = 0;""".stripMargin
+  }
+
+  /**
+    * All scanner functions
+    */
+  def functions: Seq[FunctionDefinition] = List(
+    whitespaceFunction,
+    charFunction,
+    anyFunction,
+    literalFunction,
+    booleanFunction,
+    digitsFunction,
+    numberFunction,
+    hex4Function,
+    unicodeEscapeFunction,
+    stringCharFunction,
+    stringFunction,
+    fixedStringFunction,
+    stringCopyFunction,
+    base64Function,
+    stringMatchesFunction,
+    containerBeginFunction,
+    containerNextFunction,
+    skipValueFunction,
+    seekMemberFunction
+  )
+
+  private def scannerFunction(name: String,
+                              shortSummary: String,
+                              description: String,
+                              returnType: String,
+                              parameters: Seq[FunctionParameter],
+                              body: String): FunctionDefinition = {
+    FunctionDefinition(
+      name = name,
+      documentation = FunctionDocumentation(shortSummary, description),
+      prototype = FunctionPrototype(isStatic = true, returnType = returnType, parameters = parameter +: parameters),
+      body = body
+    )
+  }
+
+  private val whitespaceFunction = scannerFunction(
+    name = whitespaceName,
+    shortSummary = "Skip JSON whitespace",
+    description = "Advances the scanner past any whitespace.",
+    returnType = Constants.voidCType,
+    parameters = Nil,
+    body =
+      s"""while( ( $paramName->pos < $paramName->len ) &&
+         |       ( ( ' ' == $paramName->json[$paramName->pos] ) ||
+         |         ( '\\t' == $paramName->json[$paramName->pos] ) ||
+         |         ( '\\n' == $paramName->json[$paramName->pos] ) ||
+         |         ( '\\r' == $paramName->json[$paramName->pos] ) ) )
+         |    {
+         |    $paramName->pos++;
+         |    }""".stripMargin
+  )
+
+  private val charFunction = scannerFunction(
+    name = charName,
+    shortSummary = "Scan a JSON structural character",
+    description = "Consumes the expected character if it is the next character after any whitespace. Returns 1 if the character was consumed, 0 otherwise.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = List(FunctionParameter(Constants.defaultCharacterCType, "expected")),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |
+         |$whitespaceName( $paramName );
+         |success = ( $paramName->pos < $paramName->len ) && ( expected == $paramName->json[$paramName->pos] );
+         |$paramName->pos += success ? 1 : 0;
+         |
+         |return success;""".stripMargin
+  )
+
+  private val anyFunction = scannerFunction(
+    name = anyName,
+    shortSummary = "Scan one of several characters",
+    description = "Consumes the next character, without skipping whitespace, if it is one of the given characters. Returns 1 if a character was consumed, 0 otherwise.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = List(FunctionParameter("char const*", "chars")),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |
+         |success = ( $paramName->pos < $paramName->len ) &&
+         |          ( '\\0' != $paramName->json[$paramName->pos] ) &&
+         |          ( NULL != strchr( chars, $paramName->json[$paramName->pos] ) );
+         |$paramName->pos += success ? 1 : 0;
+         |
+         |return success;""".stripMargin
+  )
+
+  private val literalFunction = scannerFunction(
+    name = literalName,
+    shortSummary = "Scan a JSON literal",
+    description = "Consumes the given literal, e.g. null, if it follows any whitespace. Returns 1 if the literal was consumed, 0 otherwise.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = List(FunctionParameter("char const*", "literal")),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |size_t length;
+         |
+         |$whitespaceName( $paramName );
+         |length = strlen( literal );
+         |success = ( $paramName->len - $paramName->pos >= length ) && ( 0 == memcmp( $paramName->json + $paramName->pos, literal, length ) );
+         |$paramName->pos += success ? length : 0;
+         |
+         |return success;""".stripMargin
+  )
+
+  private val booleanFunction = scannerFunction(
+    name = booleanName,
+    shortSummary = "Scan a JSON boolean",
+    description = "Consumes a true or false literal and stores its value in value_out, if not NULL. Returns 1 if a boolean was consumed, 0 otherwise.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = List(FunctionParameter(s"${Constants.defaultBooleanCType}*", "value_out")),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |${Constants.defaultBooleanCType} value;
+         |
+         |value = $literalName( $paramName, "true" );
+         |success = value || $literalName( $paramName, "false" );
+         |
+         |if( success && ( NULL != value_out ) )
+         |    {
+         |    *value_out = value;
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+
+  private val digitsFunction = scannerFunction(
+    name = digitsName,
+    shortSummary = "Scan decimal digits",
+    description = "Consumes a run of decimal digits and returns the number of digits consumed.",
+    returnType = "size_t",
+    parameters = Nil,
+    body =
+      s"""size_t start;
+         |
+         |start = $paramName->pos;
+         |while( ( $paramName->pos < $paramName->len ) && isdigit( ( unsigned char )$paramName->json[$paramName->pos] ) )
+         |    {
+         |    $paramName->pos++;
+         |    }
+         |
+         |return $paramName->pos - start;""".stripMargin
+  )
+
+  private val numberFunction = scannerFunction(
+    name = numberName,
+    shortSummary = "Scan a JSON number",
+    description = "Consumes a number and stores its value in value_out, if not NULL. Like cJSON, numbers of 64 or more characters are rejected. Returns 1 if a number was consumed, 0 otherwise.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = List(FunctionParameter(s"${Constants.defaultNumberCType}*", "value_out")),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |size_t start;
+         |size_t length;
+         |char number[64];
+         |
+         |$whitespaceName( $paramName );
+         |start = $paramName->pos;
+         |
+         |// -?(0|[1-9][0-9]*)(\\.[0-9]+)?([eE][+-]?[0-9]+)?
+         |$anyName( $paramName, "-" );
+         |success = $anyName( $paramName, "0" ) || ( $digitsName( $paramName ) > 0 );
+         |
+         |if( success && $anyName( $paramName, "." ) )
+         |    {
+         |    success = ( $digitsName( $paramName ) > 0 );
+         |    }
+         |
+         |if( success && $anyName( $paramName, "eE" ) )
+         |    {
+         |    $anyName( $paramName, "+-" );
+         |    success = ( $digitsName( $paramName ) > 0 );
+         |    }
+         |
+         |length = $paramName->pos - start;
+         |success = success && ( length < sizeof( number ) );
+         |
+         |if( success && ( NULL != value_out ) )
+         |    {
+         |    memcpy( number, $paramName->json + start, length );
+         |    number[length] = '\\0';
+         |    *value_out = strtod( number, NULL );
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+
+  private val hex4Function = scannerFunction(
+    name = hex4Name,
+    shortSummary = "Scan four hexadecimal digits",
+    description = "Consumes the four hexadecimal digits of a unicode escape sequence. Returns 1 if the digits were consumed, 0 otherwise.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = List(FunctionParameter("unsigned long*", "value_out")),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |${Constants.defaultIntCType} i;
+         |unsigned char digit;
+         |
+         |*value_out = 0;
+         |success = ( $paramName->len - $paramName->pos >= 4 );
+         |
+         |for( i = 0; success && ( i < 4 ); i++ )
+         |    {
+         |    digit = ( unsigned char )$paramName->json[$paramName->pos + i];
+         |    success = ( 0 != isxdigit( digit ) );
+         |    *value_out = ( *value_out << 4 ) | ( unsigned long )( isdigit( digit ) ? digit - '0' : tolower( digit ) - 'a' + 10 );
+         |    }
+         |
+         |$paramName->pos += success ? 4 : 0;
+         |
+         |return success;""".stripMargin
+  )
+
+  private val unicodeEscapeFunction = scannerFunction(
+    name = unicodeEscapeName,
+    shortSummary = "Scan a unicode escape sequence",
+    description = "Consumes the digits of a \\u escape sequence, and of the escaped low surrogate that must follow a high surrogate, and stores the character's UTF-8 encoding in bytes_out. Returns the number of bytes stored, or -1 if the escape sequence is invalid.",
+    returnType = Constants.defaultIntCType,
+    parameters = List(FunctionParameter("unsigned char*", "bytes_out")),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |${Constants.defaultIntCType} byte_cnt;
+         |unsigned long codepoint;
+         |unsigned long low_surrogate;
+         |
+         |low_surrogate = 0;
+         |success = $hex4Name( $paramName, &codepoint );
+         |
+         |// Low surrogates may only follow high surrogates
+         |success = success && !( ( codepoint >= 0xDC00 ) && ( codepoint <= 0xDFFF ) );
+         |
+         |if( success && ( codepoint >= 0xD800 ) && ( codepoint <= 0xDBFF ) )
+         |    {
+         |    success = ( $paramName->len - $paramName->pos >= 2 ) &&
+         |              ( '\\\\' == $paramName->json[$paramName->pos] ) &&
+         |              ( 'u' == $paramName->json[$paramName->pos + 1] );
+         |    $paramName->pos += success ? 2 : 0;
+         |
+         |    success = success && $hex4Name( $paramName, &low_surrogate ) && ( low_surrogate >= 0xDC00 ) && ( low_surrogate <= 0xDFFF );
+         |    codepoint = 0x10000 + ( ( ( codepoint & 0x3FF ) << 10 ) | ( low_surrogate & 0x3FF ) );
+         |    }
+         |
+         |if( !success )
+         |    {
+         |    byte_cnt = -1;
+         |    }
+         |else if( codepoint < 0x80 )
+         |    {
+         |    bytes_out[0] = ( unsigned char )codepoint;
+         |    byte_cnt = 1;
+         |    }
+         |else if( codepoint < 0x800 )
+         |    {
+         |    bytes_out[0] = ( unsigned char )( 0xC0 | ( codepoint >> 6 ) );
+         |    bytes_out[1] = ( unsigned char )( 0x80 | ( codepoint & 0x3F ) );
+         |    byte_cnt = 2;
+         |    }
+         |else if( codepoint < 0x10000 )
+         |    {
+         |    bytes_out[0] = ( unsigned char )( 0xE0 | ( codepoint >> 12 ) );
+         |    bytes_out[1] = ( unsigned char )( 0x80 | ( ( codepoint >> 6 ) & 0x3F ) );
+         |    bytes_out[2] = ( unsigned char )( 0x80 | ( codepoint & 0x3F ) );
+         |    byte_cnt = 3;
+         |    }
+         |else
+         |    {
+         |    bytes_out[0] = ( unsigned char )( 0xF0 | ( codepoint >> 18 ) );
+         |    bytes_out[1] = ( unsigned char )( 0x80 | ( ( codepoint >> 12 ) & 0x3F ) );
+         |    bytes_out[2] = ( unsigned char )( 0x80 | ( ( codepoint >> 6 ) & 0x3F ) );
+         |    bytes_out[3] = ( unsigned char )( 0x80 | ( codepoint & 0x3F ) );
+         |    byte_cnt = 4;
+         |    }
+         |
+         |return byte_cnt;""".stripMargin
+  )
+
+  private val stringCharFunction = scannerFunction(
+    name = stringCharName,
+    shortSummary = "Scan a character of a JSON string",
+    description = "Consumes the next character of a string, or its closing quote, and stores the character's decoded bytes in bytes_out, which must have room for 4 bytes. Returns the number of bytes stored, 0 if the closing quote was consumed, or -1 if the string is invalid.",
+    returnType = Constants.defaultIntCType,
+    parameters = List(FunctionParameter("unsigned char*", "bytes_out")),
+    body =
+      s"""${Constants.defaultIntCType} byte_cnt;
+         |unsigned char c;
+         |
+         |c = ( $paramName->pos < $paramName->len ) ? ( unsigned char )$paramName->json[$paramName->pos] : '\\0';
+         |byte_cnt = 1;
+         |
+         |if( c < 0x20 )
+         |    {
+         |    // Unterminated string or unescaped control character
+         |    byte_cnt = -1;
+         |    }
+         |else if( '"' == c )
+         |    {
+         |    byte_cnt = 0;
+         |    $paramName->pos++;
+         |    }
+         |else if( '\\\\' != c )
+         |    {
+         |    bytes_out[0] = c;
+         |    $paramName->pos++;
+         |    }
+         |else
+         |    {
+         |    c = ( $paramName->len - $paramName->pos >= 2 ) ? ( unsigned char )$paramName->json[$paramName->pos + 1] : '\\0';
+         |    $paramName->pos += 2;
+         |
+         |    switch( c )
+         |        {
+         |        case '"':
+         |        case '\\\\':
+         |        case '/':
+         |            bytes_out[0] = c;
+         |            break;
+         |
+         |        case 'b':
+         |            bytes_out[0] = '\\b';
+         |            break;
+         |
+         |        case 'f':
+         |            bytes_out[0] = '\\f';
+         |            break;
+         |
+         |        case 'n':
+         |            bytes_out[0] = '\\n';
+         |            break;
+         |
+         |        case 'r':
+         |            bytes_out[0] = '\\r';
+         |            break;
+         |
+         |        case 't':
+         |            bytes_out[0] = '\\t';
+         |            break;
+         |
+         |        case 'u':
+         |            byte_cnt = $unicodeEscapeName( $paramName, bytes_out );
+         |            break;
+         |
+         |        default:
+         |            $paramName->pos -= 2;
+         |            byte_cnt = -1;
+         |            break;
+         |        }
+         |    }
+         |
+         |return byte_cnt;""".stripMargin
+  )
+
+  private val stringFunction = scannerFunction(
+    name = stringName,
+    shortSummary = "Scan a JSON string",
+    description = "Consumes a string and stores the length of its decoded UTF-8 value in decoded_len_out, if not NULL. Returns 1 if a string was consumed, 0 otherwise.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = List(FunctionParameter("size_t*", "decoded_len_out")),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |${Constants.defaultIntCType} byte_cnt;
+         |size_t decoded_len;
+         |unsigned char bytes[4];
+         |
+         |decoded_len = 0;
+         |success = $charName( $paramName, '"' );
+         |byte_cnt = 1;
+         |
+         |while( success && ( byte_cnt > 0 ) )
+         |    {
+         |    byte_cnt = $stringCharName( $paramName, bytes );
+         |    success = ( byte_cnt >= 0 );
+         |    decoded_len += success ? ( size_t )byte_cnt : 0;
+         |    }
+         |
+         |if( NULL != decoded_len_out )
+         |    {
+         |    *decoded_len_out = decoded_len;
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+
+  private val fixedStringFunction = scannerFunction(
+    name = fixedStringName,
+    shortSummary = "Scan a fixed-length JSON string",
+    description = "Consumes a string whose decoded value is at most max_len bytes long. Returns 1 if the string was consumed, 0 otherwise. A string that is too long leaves the scanner at its opening quote.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = List(FunctionParameter("size_t", "max_len")),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |size_t start;
+         |size_t decoded_len;
+         |
+         |$whitespaceName( $paramName );
+         |start = $paramName->pos;
+         |
+         |success = $stringName( $paramName, &decoded_len );
+         |
+         |if( success && ( decoded_len > max_len ) )
+         |    {
+         |    $paramName->pos = start;
+         |    success = 0;
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+
+  private val stringCopyFunction = scannerFunction(
+    name = stringCopyName,
+    shortSummary = "Scan a JSON string into a buffer",
+    description = "Consumes a string and stores its decoded, NUL-terminated value in buffer, which holds buffer_size bytes. Returns 1 if the string was consumed and fit into the buffer, 0 otherwise.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = List(FunctionParameter("char*", "buffer"), FunctionParameter("size_t", "buffer_size")),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |${Constants.defaultIntCType} byte_cnt;
+         |size_t length;
+         |unsigned char bytes[4];
+         |
+         |length = 0;
+         |success = $charName( $paramName, '"' );
+         |byte_cnt = 1;
+         |
+         |while( success && ( byte_cnt > 0 ) )
+         |    {
+         |    byte_cnt = $stringCharName( $paramName, bytes );
+         |
+         |    // Leave room for the terminating NUL
+         |    success = ( byte_cnt >= 0 ) && ( length + ( size_t )byte_cnt < buffer_size );
+         |
+         |    if( success )
+         |        {
+         |        memcpy( buffer + length, bytes, ( size_t )byte_cnt );
+         |        length += ( size_t )byte_cnt;
+         |        }
+         |    }
+         |
+         |if( success )
+         |    {
+         |    buffer[length] = '\\0';
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+
+  private val base64Function = scannerFunction(
+    name = base64Name,
+    shortSummary = "Scan a base64 JSON string",
+    description = "Consumes a string whose decoded value is padded base64 text of the standard alphabet: a multiple of 4 characters, of which at most the last two are padding. Returns 1 if the string was consumed, 0 otherwise.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = Nil,
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |${Constants.defaultIntCType} byte_cnt;
+         |size_t text_len;
+         |size_t padding;
+         |unsigned char bytes[4];
+         |unsigned char c;
+         |
+         |text_len = 0;
+         |padding = 0;
+         |success = $charName( $paramName, '"' );
+         |byte_cnt = 1;
+         |
+         |while( success && ( byte_cnt > 0 ) )
+         |    {
+         |    byte_cnt = $stringCharName( $paramName, bytes );
+         |    success = ( byte_cnt >= 0 );
+         |    c = ( 1 == byte_cnt ) ? bytes[0] : '\\0';
+         |
+         |    if( byte_cnt > 1 )
+         |        {
+         |        // Characters outside of ASCII are not in the alphabet
+         |        success = 0;
+         |        }
+         |    else if( '=' == c )
+         |        {
+         |        padding++;
+         |        success = ( padding <= 2 );
+         |        }
+         |    else if( 1 == byte_cnt )
+         |        {
+         |        // Padding is only allowed at the end of the text
+         |        success = ( 0 == padding ) &&
+         |                  ( ( ( c >= 'A' ) && ( c <= 'Z' ) ) ||
+         |                    ( ( c >= 'a' ) && ( c <= 'z' ) ) ||
+         |                    ( ( c >= '0' ) && ( c <= '9' ) ) ||
+         |                    ( '+' == c ) ||
+         |                    ( '/' == c ) );
+         |        }
+         |
+         |    text_len += success ? ( size_t )byte_cnt : 0;
+         |    }
+         |
+         |return success && ( 0 == text_len % 4 );""".stripMargin
+  )
+
+  private val stringMatchesFunction = FunctionDefinition(
+    name = stringMatchesName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Compare a JSON string to a key",
+      description = "Decodes the valid JSON string starting at string_start and compares it to key, ignoring case like cJSON_GetObjectItem. Returns 1 if they are equal, 0 otherwise."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter(s"$typeName const*", "string_start"),
+        FunctionParameter("char const*", "key")
+      )
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} matches;
+         |${Constants.defaultIntCType} byte_cnt;
+         |${Constants.defaultIntCType} i;
+         |unsigned char bytes[4];
+         |$typeName $paramName;
+         |
+         |$paramName = *string_start;
+         |matches = $charName( &$paramName, '"' );
+         |byte_cnt = 1;
+         |
+         |while( matches && ( byte_cnt > 0 ) )
+         |    {
+         |    byte_cnt = $stringCharName( &$paramName, bytes );
+         |
+         |    for( i = 0; matches && ( i < byte_cnt ); i++ )
+         |        {
+         |        matches = ( '\\0' != *key ) && ( tolower( bytes[i] ) == tolower( ( unsigned char )*key ) );
+         |        key++;
+         |        }
+         |    }
+         |
+         |return matches && ( 0 == byte_cnt ) && ( '\\0' == *key );""".stripMargin
+  )
+
+  private val containerBeginFunction = scannerFunction(
+    name = containerBeginName,
+    shortSummary = "Scan the start of a JSON object or array",
+    description = "Consumes the opening character of a container and, if the container is empty, its closing character. Sets more_out to 1 if the container has members. Returns 1 if the container was opened, 0 otherwise.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = List(
+      FunctionParameter(Constants.defaultCharacterCType, "open"),
+      FunctionParameter(Constants.defaultCharacterCType, "close"),
+      FunctionParameter(s"${Constants.defaultBooleanCType}*", "more_out")
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |
+         |success = $charName( $paramName, open );
+         |*more_out = success && !$charName( $paramName, close );
+         |
+         |return success;""".stripMargin
+  )
+
+  private val containerNextFunction = scannerFunction(
+    name = containerNextName,
+    shortSummary = "Scan the separator after a member of a JSON object or array",
+    description = "Consumes either the comma before the next member of a container, setting more_out to 1, or its closing character, setting more_out to 0. Returns 1 if either was consumed, 0 otherwise.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = List(
+      FunctionParameter(Constants.defaultCharacterCType, "close"),
+      FunctionParameter(s"${Constants.defaultBooleanCType}*", "more_out")
+    ),
+    body =
+      s"""*more_out = $charName( $paramName, ',' );
+         |
+         |return *more_out || $charName( $paramName, close );""".stripMargin
+  )
+
+  private val skipValueFunction = scannerFunction(
+    name = skipValueName,
+    shortSummary = "Skip a JSON value",
+    description = s"Consumes any JSON value, checking only its syntax. Containers may be nested at most $nestingLimitMacro deep, where depth is the nesting depth of the value. Returns 1 if a value was consumed, 0 otherwise.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = List(FunctionParameter(Constants.defaultIntCType, "depth")),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |${Constants.defaultBooleanCType} more;
+         |char c;
+         |
+         |$whitespaceName( $paramName );
+         |success = ( depth <= $nestingLimitMacro ) && ( $paramName->pos < $paramName->len );
+         |c = success ? $paramName->json[$paramName->pos] : '\\0';
+         |
+         |if( !success )
+         |    {
+         |    // Too deeply nested or missing value
+         |    }
+         |else if( '{' == c )
+         |    {
+         |    success = $containerBeginName( $paramName, '{', '}', &more );
+         |    while( success && more )
+         |        {
+         |        success = $stringName( $paramName, NULL ) &&
+         |                  $charName( $paramName, ':' ) &&
+         |                  $skipValueName( $paramName, depth + 1 ) &&
+         |                  $containerNextName( $paramName, '}', &more );
+         |        }
+         |    }
+         |else if( '[' == c )
+         |    {
+         |    success = $containerBeginName( $paramName, '[', ']', &more );
+         |    while( success && more )
+         |        {
+         |        success = $skipValueName( $paramName, depth + 1 ) && $containerNextName( $paramName, ']', &more );
+         |        }
+         |    }
+         |else if( '"' == c )
+         |    {
+         |    success = $stringName( $paramName, NULL );
+         |    }
+         |else if( ( 't' == c ) || ( 'f' == c ) )
+         |    {
+         |    success = $booleanName( $paramName, NULL );
+         |    }
+         |else if( 'n' == c )
+         |    {
+         |    success = $literalName( $paramName, "null" );
+         |    }
+         |else
+         |    {
+         |    success = $numberName( $paramName, NULL );
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+
+  private val seekMemberFunction = scannerFunction(
+    name = seekMemberName,
+    shortSummary = "Find a member of a JSON object",
+    description = "Scans a JSON object at the given nesting depth, skipping members until the first one whose key matches key, ignoring case like cJSON_GetObjectItem. The rest of the object is not scanned. Returns 1 and leaves the scanner before the member's value if the member was found, 0 otherwise.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = List(FunctionParameter("char const*", "key"), FunctionParameter(Constants.defaultIntCType, "depth")),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |${Constants.defaultBooleanCType} found;
+         |${Constants.defaultBooleanCType} more;
+         |$typeName member_key;
+         |
+         |found = 0;
+         |success = ( depth <= $nestingLimitMacro ) && $containerBeginName( $paramName, '{', '}', &more );
+         |
+         |while( success && more && !found )
+         |    {
+         |    $whitespaceName( $paramName );
+         |    member_key = *$paramName;
+         |    success = $stringName( $paramName, NULL ) && $charName( $paramName, ':' );
+         |    found = success && $stringMatchesName( &member_key, key );
+         |
+         |    if( success && !found )
+         |        {
+         |        success = $skipValueName( $paramName, depth + 1 ) && $containerNextName( $paramName, '}', &more );
+         |        }
+         |    }
+         |
+         |return found;""".stripMargin
+  )
+}
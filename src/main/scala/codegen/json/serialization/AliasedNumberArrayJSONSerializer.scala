@@ -0,0 +1,76 @@
+package codegen.json.serialization
+
+import codegen.Constants
+import codegen.functions._
+import codegen.json.CJSONAllocatorHooks
+
+/**
+  * Creates the functions to serialize arrays of numbers whose C type is aliased, e.g.
+  * Array[Number] cType=int32_t. cJSON_CreateDoubleArray() only reads doubles, so the
+  * elements are first widened into a buffer of doubles. The widening loop has no calls or
+  * branches, so the compiler can vectorize it.
+  */
+object AliasedNumberArrayJSONSerializer {
+
+  private val arrayParam = "array"
+  private val countParam = "array_cnt"
+  private val jsonOutputParam = "json_out"
+
+  /**
+    * Gets the name of the function to serialize arrays of an aliased numeric type
+    * @param alias C type of the array's elements
+    * @return Name of the serialize function
+    */
+  def name(alias: String): String = {
+    s"${alias}_array_json_serialize"
+  }
+
+  /**
+    * Creates the static function to serialize arrays of an aliased numeric type
+    * @param alias C type of the array's elements
+    * @return Definition of the serialize function
+    */
+  def definition(alias: String): FunctionDefinition = FunctionDefinition(
+    name = name(alias),
+    documentation = FunctionDocumentation(
+      shortSummary = s"Serialize array of $alias values",
+      description = s"Serializes an array of $alias values as JSON numbers. The caller must clean up $jsonOutputParam"
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter(paramType = s"$alias const*", paramName = arrayParam),
+        FunctionParameter(paramType = Constants.defaultIntCType, paramName = countParam),
+        FunctionParameter(paramType = "cJSON**", paramName = jsonOutputParam)
+      )
+    ),
+    body =
+      s"""${Constants.defaultNumberCType}* numbers;
+         |${Constants.defaultIntCType} i;
+         |
+         |*$jsonOutputParam = NULL;
+         |
+         |if( $countParam <= 0 )
+         |    {
+         |    // cJSON_CreateDoubleArray() does not accept empty arrays
+         |    *$jsonOutputParam = cJSON_CreateArray();
+         |    }
+         |else
+         |    {
+         |    numbers = ${CJSONAllocatorHooks.malloc(s"( size_t )$countParam * sizeof( *numbers )")};
+         |    if( NULL != numbers )
+         |        {
+         |        for( i = 0; i < $countParam; i++ )
+         |            {
+         |            numbers[i] = ( ${Constants.defaultNumberCType} )$arrayParam[i];
+         |            }
+         |
+         |        *$jsonOutputParam = cJSON_CreateDoubleArray( numbers, $countParam );
+         |        ${CJSONAllocatorHooks.free("numbers")};
+         |        }
+         |    }
+         |
+         |return ( NULL != *$jsonOutputParam );""".stripMargin
+  )
+}
@@ -0,0 +1,66 @@
+package codegen.json.serialization
+
+import codegen.Constants
+import codegen.base64.Base64
+import codegen.functions._
+import codegen.json.CJSONAllocatorHooks
+
+/**
+  * Contains the definition of the function to serialize bytes to cJSON string objects
+  * holding their base64 text
+  */
+object BytesJSONSerializer {
+
+  private val dataParam = "data"
+  private val lengthParam = "len"
+  private val jsonOutputParam = "json_out"
+
+  val name: String = "bytes_json_serialize"
+
+  val definition: FunctionDefinition = FunctionDefinition(
+    name = name,
+    documentation = FunctionDocumentation(
+      shortSummary = "Serialize bytes",
+      description = s"Serializes $lengthParam bytes of $dataParam as a base64 string. Returns 0 if $dataParam is NULL while $lengthParam is not 0, 1 otherwise. The caller must clean up $jsonOutputParam."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter(paramType = "uint8_t const*", paramName = dataParam),
+        FunctionParameter(paramType = "size_t", paramName = lengthParam),
+        FunctionParameter(paramType = "cJSON**", paramName = jsonOutputParam)
+      )
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |char* text;
+         |size_t text_len;
+         |
+         |*$jsonOutputParam = NULL;
+         |text = NULL;
+         |text_len = ${Base64.encodedLength(lengthParam)};
+         |
+         |success = ( ( NULL != $dataParam ) || ( 0 == $lengthParam ) ) && ${Base64.lengthCheck(lengthParam)};
+         |
+         |if( success )
+         |    {
+         |    text = ${CJSONAllocatorHooks.malloc("text_len + 1")};
+         |    success = ( NULL != text );
+         |    }
+         |
+         |// cJSON copies the text into the string object
+         |if( success )
+         |    {
+         |    ${Base64.encodeName}( $dataParam, $lengthParam, text );
+         |    text[text_len] = '\\0';
+         |
+         |    *$jsonOutputParam = cJSON_CreateString( text );
+         |    success = ( NULL != *$jsonOutputParam );
+         |    }
+         |
+         |${CJSONAllocatorHooks.free("text")};
+         |
+         |return success;""".stripMargin
+  )
+}
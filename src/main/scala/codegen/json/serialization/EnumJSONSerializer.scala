@@ -0,0 +1,132 @@
+package codegen.json.serialization
+
+import codegen.Constants
+import codegen.functions._
+import codegen.messagetypes.MessageEnum
+import datamodel._
+
+/**
+  * Defines the functions to serialize enum values as JSON strings. Each value maps to a
+  * string literal, so serializing an enum value never allocates the string.
+  */
+object EnumJSONSerializer {
+
+  private val valueParam = "value"
+  private val arrayParam = "array"
+  private val countParam = "array_cnt"
+  private val jsonOutputParam = "json_out"
+
+  /**
+    * @param enumType Enum type
+    * @return Name of the function to get the string of an enum value
+    */
+  def toStringName(enumType: EnumType): String = {
+    s"${enumType.name}_json_to_string"
+  }
+
+  /**
+    * @param enumType Enum type
+    * @return Name of the function to serialize an array of enum values
+    */
+  def arrayName(enumType: EnumType): String = {
+    s"${enumType.name}_array_json_serialize"
+  }
+
+  /**
+    * Creates the static function to get the string of an enum value
+    * @param enumType Enum type
+    * @return Definition of the enum's string function
+    */
+  def toStringFunction(enumType: EnumType): FunctionDefinition = {
+    val cases = enumType.values.map(value =>
+      s"""    case ${MessageEnum.constantName(enumType, value)}:
+         |        string = "$value";
+         |        break;""".stripMargin
+    )
+
+    FunctionDefinition(
+      name = toStringName(enumType),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Get ${enumType.name} string",
+        description = s"Gets the JSON string of the ${enumType.name} value. Returns NULL if $valueParam is not a ${enumType.name} value."
+      ),
+      prototype = FunctionPrototype(
+        isStatic = true,
+        returnType = s"${Constants.defaultCharacterCType} const*",
+        parameters = List(FunctionParameter(enumType.name, valueParam))
+      ),
+      body =
+        s"""${Constants.defaultCharacterCType} const* string;
+           |
+           |switch( $valueParam )
+           |    {
+           |${cases.mkString("\n\n")}
+           |
+           |    default:
+           |        string = NULL;
+           |        break;
+           |    }
+           |
+           |return string;""".stripMargin
+    )
+  }
+
+  /**
+    * Creates the static function to serialize an array of enum values to a cJSON array
+    * @param enumType Enum type
+    * @return Definition of the enum's array serialize function
+    */
+  def arrayFunction(enumType: EnumType): FunctionDefinition = {
+    FunctionDefinition(
+      name = arrayName(enumType),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Serialize array of ${enumType.name} values",
+        description = s"Serializes an array of ${enumType.name} values as strings. The caller must clean up $jsonOutputParam"
+      ),
+      prototype = FunctionPrototype(
+        isStatic = true,
+        returnType = Constants.defaultBooleanCType,
+        parameters = List(
+          FunctionParameter(s"${enumType.name} const*", arrayParam),
+          FunctionParameter(Constants.defaultIntCType, countParam),
+          FunctionParameter("cJSON**", jsonOutputParam)
+        )
+      ),
+      body =
+        s"""${Constants.defaultBooleanCType} success;
+           |cJSON* json_array;
+           |cJSON* array_item;
+           |${Constants.defaultCharacterCType} const* string;
+           |int i;
+           |
+           |*$jsonOutputParam = NULL;
+           |
+           |json_array = cJSON_CreateArray();
+           |success = ( NULL != json_array );
+           |
+           |for( i = 0; success && ( i < $countParam ); i++ )
+           |    {
+           |    string = ${toStringName(enumType)}( $arrayParam[i] );
+           |    array_item = ( NULL == string ) ? NULL : cJSON_CreateString( string );
+           |    success = ( NULL != array_item );
+           |
+           |    if( success )
+           |        {
+           |        cJSON_AddItemToArray( json_array, array_item );
+           |        }
+           |    }
+           |
+           |// Set the output or clean up on error
+           |if( success )
+           |    {
+           |    *$jsonOutputParam = json_array;
+           |    }
+           |else
+           |    {
+           |    cJSON_Delete( json_array );
+           |    }
+           |
+           |return success;""".stripMargin
+    )
+  }
+}
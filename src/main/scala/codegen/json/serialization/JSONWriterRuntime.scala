@@ -0,0 +1,468 @@
+package codegen.json.serialization
+
+import codegen.Constants
+import codegen.base64.Base64
+import codegen.functions._
+import codegen.timestamp.Timestamp
+
+/**
+  * The runtime of the resumable JSON writers. A writer serializes a message in small steps
+  * into caller-provided buffers of any size, so that a message can be written to a
+  * non-blocking socket without ever holding the whole JSON document in memory. Each message
+  * has a step function (see MessageJSONWriter) that produces the next piece of output and
+  * records its position in a frame on the writer's stack. The stack holds one frame per level
+  * of message nesting, which is bounded by the protocol, so a writer never allocates.
+  */
+object JSONWriterRuntime {
+
+  val typeName = "cdto_json_writer"
+  val frameTypeName = "cdto_json_writer_frame"
+  val stepTypeName = "cdto_json_writer_step"
+  val paramName = "writer"
+
+  /**
+    * Maximum nesting depth of the messages a writer can serialize
+    */
+  val maxDepthMacro = "CDTO_JSON_WRITER_MAX_DEPTH"
+
+  val startName = "cdto_json_writer_start"
+  val fillName = "cdto_json_writer_fill"
+  val pushName = "cdto_json_writer_push"
+  val putName = "cdto_json_writer_put"
+  val numberName = "cdto_json_writer_number"
+  val booleanName = "cdto_json_writer_boolean"
+  val stringName = "cdto_json_writer_string"
+  val bytesName = "cdto_json_writer_bytes"
+  val timestampName = "cdto_json_writer_timestamp"
+
+  private val drainName = "cdto_json_writer_drain"
+  private val escapeName = "cdto_json_writer_escape"
+  private val encodeName = "cdto_json_writer_encode"
+
+  val parameter: FunctionParameter = FunctionParameter(s"$typeName*", paramName)
+
+  /**
+    * Definition of the writer type. Callers allocate writers, so it is defined in the public
+    * header. It is shared by all protocols, so it is protected against multiple definitions.
+    */
+  val typeDefinition: String =
+    s"""#ifndef CDTO_JSON_WRITER_DEFINED
+       |#define CDTO_JSON_WRITER_DEFINED
+       |
+       |#ifndef $maxDepthMacro
+       |#define $maxDepthMacro 32
+       |#endif
+       |
+       |struct $typeName;
+       |
+       |// Produces the next piece of a message's JSON. Returns 1 on success, 0 otherwise.
+       |typedef int ( *$stepTypeName )( struct $typeName* $paramName );
+       |
+       |// Position of a writer within one message
+       |typedef struct
+       |    {
+       |    $stepTypeName    step;
+       |    void const*             obj;
+       |    int                     state;
+       |    int                     index;
+       |    } $frameTypeName;
+       |
+       |// State of a resumable JSON serialization. All members are private.
+       |typedef struct $typeName
+       |    {
+       |    $frameTypeName    frames[$maxDepthMacro];
+       |    int                       depth;
+       |    char const*               prefix;
+       |    size_t                    prefix_len;
+       |    char const*               text;
+       |    size_t                    text_len;
+       |    char const*               string;
+       |    uint8_t const*            bytes;
+       |    size_t                    bytes_len;
+       |    char                      scratch[40];
+       |    } $typeName;
+       |
+       |#endif /* #ifndef CDTO_JSON_WRITER_DEFINED */""".stripMargin
+
+  /**
+    * Gets the check that the writer's stack is deep enough for the messages of a protocol
+    * @param depth Maximum nesting depth of the protocol's messages
+    * @return Preprocessor check failing the build if the stack is too small
+    */
+  def depthCheck(depth: Int): String = {
+    s"""#if $maxDepthMacro < $depth
+       |#error "$maxDepthMacro must be at least $depth to write the messages of this protocol"
+       |#endif""".stripMargin
+  }
+
+  /**
+    * All runtime functions
+    */
+  def functions: Seq[FunctionDefinition] = List(
+    startFunction,
+    drainFunction,
+    escapeFunction,
+    encodeFunction,
+    Base64.encodeFunction,
+    fillFunction,
+    pushFunction,
+    putFunction,
+    numberFunction,
+    booleanFunction,
+    stringFunction,
+    bytesFunction,
+    timestampFunction
+  ) ++ Timestamp.functions
+
+  private def writerFunction(name: String,
+                             shortSummary: String,
+                             description: String,
+                             returnType: String,
+                             parameters: Seq[FunctionParameter],
+                             body: String): FunctionDefinition = {
+    FunctionDefinition(
+      name = name,
+      documentation = FunctionDocumentation(shortSummary, description),
+      prototype = FunctionPrototype(isStatic = true, returnType = returnType, parameters = parameter +: parameters),
+      body = body
+    )
+  }
+
+  private val startFunction = writerFunction(
+    name = startName,
+    shortSummary = "Start writing a message",
+    description = "Resets the writer to write the given message from the beginning.",
+    returnType = Constants.voidCType,
+    parameters = List(FunctionParameter(stepTypeName, "step"), FunctionParameter("void const*", "obj")),
+    body =
+      s"""$paramName->depth = 0;
+         |$paramName->text = "";
+         |$paramName->text_len = 0;
+         |$paramName->string = NULL;
+         |$paramName->bytes_len = 0;
+         |
+         |$pushName( $paramName, "", step, obj );""".stripMargin
+  )
+
+  private val drainFunction = FunctionDefinition(
+    name = drainName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Copy pending text",
+      description = "Copies as much of the pending text as fits into the rest of the buffer and advances the text past the copied characters."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.voidCType,
+      parameters = List(
+        FunctionParameter("char const**", "text"),
+        FunctionParameter("size_t*", "text_len"),
+        FunctionParameter("char*", "buffer"),
+        FunctionParameter("size_t", "buffer_size"),
+        FunctionParameter("size_t*", "written")
+      )
+    ),
+    body =
+      s"""size_t length;
+         |
+         |length = buffer_size - *written;
+         |length = ( *text_len < length ) ? *text_len : length;
+         |
+         |memcpy( buffer + *written, *text, length );
+         |*text += length;
+         |*text_len -= length;
+         |*written += length;""".stripMargin
+  )
+
+  private val escapeFunction = writerFunction(
+    name = escapeName,
+    shortSummary = "Write the string being written",
+    description = "Copies characters of the string being written into the rest of the buffer up to the next character that must be escaped, like cJSON does. The escape sequence, or the closing quote at the end of the string, becomes the pending text.",
+    returnType = Constants.voidCType,
+    parameters = List(
+      FunctionParameter("char*", "buffer"),
+      FunctionParameter("size_t", "buffer_size"),
+      FunctionParameter("size_t*", "written")
+    ),
+    body =
+      s"""unsigned char c;
+         |
+         |c = ( unsigned char )*$paramName->string;
+         |while( ( *written < buffer_size ) && ( c >= 0x20 ) && ( '"' != c ) && ( '\\\\' != c ) )
+         |    {
+         |    buffer[( *written )++] = ( char )c;
+         |    $paramName->string++;
+         |    c = ( unsigned char )*$paramName->string;
+         |    }
+         |
+         |if( *written == buffer_size )
+         |    {
+         |    // Out of space
+         |    }
+         |else if( '\\0' == c )
+         |    {
+         |    $paramName->string = NULL;
+         |    $paramName->text = "\\"";
+         |    $paramName->text_len = 1;
+         |    }
+         |else
+         |    {
+         |    switch( c )
+         |        {
+         |        case '"':
+         |            $paramName->text = "\\\\\\"";
+         |            break;
+         |
+         |        case '\\\\':
+         |            $paramName->text = "\\\\\\\\";
+         |            break;
+         |
+         |        case '\\b':
+         |            $paramName->text = "\\\\b";
+         |            break;
+         |
+         |        case '\\f':
+         |            $paramName->text = "\\\\f";
+         |            break;
+         |
+         |        case '\\n':
+         |            $paramName->text = "\\\\n";
+         |            break;
+         |
+         |        case '\\r':
+         |            $paramName->text = "\\\\r";
+         |            break;
+         |
+         |        case '\\t':
+         |            $paramName->text = "\\\\t";
+         |            break;
+         |
+         |        default:
+         |            sprintf( $paramName->scratch, "\\\\u%04x", ( unsigned int )c );
+         |            $paramName->text = $paramName->scratch;
+         |            break;
+         |        }
+         |
+         |    $paramName->text_len = strlen( $paramName->text );
+         |    $paramName->string++;
+         |    }""".stripMargin
+  )
+
+  private val encodeFunction = writerFunction(
+    name = encodeName,
+    shortSummary = "Write the bytes being written",
+    description = "Encodes whole groups of three bytes being written as base64 straight into the rest of the buffer. The next group, padded if it is the last one, becomes the pending text, followed by the closing quote at the end of the bytes.",
+    returnType = Constants.voidCType,
+    parameters = List(
+      FunctionParameter("char*", "buffer"),
+      FunctionParameter("size_t", "buffer_size"),
+      FunctionParameter("size_t*", "written")
+    ),
+    body =
+      s"""size_t length;
+         |
+         |length = ( buffer_size - *written ) / 4 * 3;
+         |length = ( $paramName->bytes_len / 3 * 3 < length ) ? $paramName->bytes_len / 3 * 3 : length;
+         |
+         |${Base64.encodeName}( $paramName->bytes, length, buffer + *written );
+         |$paramName->bytes += length;
+         |$paramName->bytes_len -= length;
+         |*written += ${Base64.encodedLength("length")};
+         |
+         |// Either the buffer has no room for another group or less than a group is left
+         |if( 0 == $paramName->bytes_len )
+         |    {
+         |    $paramName->text = "\\"";
+         |    $paramName->text_len = 1;
+         |    }
+         |else
+         |    {
+         |    length = ( $paramName->bytes_len < 3 ) ? $paramName->bytes_len : 3;
+         |    ${Base64.encodeName}( $paramName->bytes, length, $paramName->scratch );
+         |    $paramName->bytes += length;
+         |    $paramName->bytes_len -= length;
+         |
+         |    $paramName->scratch[4] = '"';
+         |    $paramName->text = $paramName->scratch;
+         |    $paramName->text_len = ( 0 == $paramName->bytes_len ) ? 5 : 4;
+         |    }""".stripMargin
+  )
+
+  private val fillFunction = writerFunction(
+    name = fillName,
+    shortSummary = "Write the next part of a message",
+    description = "Writes as much of the message as fits into buffer, which holds buffer_size bytes, and stores the number of bytes written in written_out. Returns 1 if the whole message has been written, 0 if more output remains, or -1 if the message cannot be serialized.",
+    returnType = Constants.defaultIntCType,
+    parameters = List(
+      FunctionParameter("char*", "buffer"),
+      FunctionParameter("size_t", "buffer_size"),
+      FunctionParameter("size_t*", "written_out")
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |size_t written;
+         |
+         |success = 1;
+         |written = 0;
+         |
+         |// Pending text is written before the rest of the string, and both before the next step
+         |while( success && ( written < buffer_size ) )
+         |    {
+         |    if( $paramName->prefix_len > 0 )
+         |        {
+         |        $drainName( &$paramName->prefix, &$paramName->prefix_len, buffer, buffer_size, &written );
+         |        }
+         |    else if( $paramName->text_len > 0 )
+         |        {
+         |        $drainName( &$paramName->text, &$paramName->text_len, buffer, buffer_size, &written );
+         |        }
+         |    else if( NULL != $paramName->string )
+         |        {
+         |        $escapeName( $paramName, buffer, buffer_size, &written );
+         |        }
+         |    else if( $paramName->bytes_len > 0 )
+         |        {
+         |        $encodeName( $paramName, buffer, buffer_size, &written );
+         |        }
+         |    else if( $paramName->depth > 0 )
+         |        {
+         |        success = $paramName->frames[$paramName->depth - 1].step( $paramName );
+         |        }
+         |    else
+         |        {
+         |        break;
+         |        }
+         |    }
+         |
+         |*written_out = written;
+         |
+         |if( !success )
+         |    {
+         |    return -1;
+         |    }
+         |
+         |return ( 0 == $paramName->depth ) && ( 0 == $paramName->prefix_len ) && ( 0 == $paramName->text_len ) && ( NULL == $paramName->string ) && ( 0 == $paramName->bytes_len );""".stripMargin
+  )
+
+  private val pushFunction = writerFunction(
+    name = pushName,
+    shortSummary = "Start writing a nested message",
+    description = "Writes the prefix, then the nested message. The writer continues with the current message once the nested message has been written.",
+    returnType = Constants.voidCType,
+    parameters = List(
+      FunctionParameter("char const*", "prefix"),
+      FunctionParameter(stepTypeName, "step"),
+      FunctionParameter("void const*", "obj")
+    ),
+    body =
+      s"""$paramName->prefix = prefix;
+         |$paramName->prefix_len = strlen( prefix );
+         |
+         |$paramName->frames[$paramName->depth].step = step;
+         |$paramName->frames[$paramName->depth].obj = obj;
+         |$paramName->frames[$paramName->depth].state = 0;
+         |$paramName->frames[$paramName->depth].index = 0;
+         |$paramName->depth++;""".stripMargin
+  )
+
+  private val putFunction = writerFunction(
+    name = putName,
+    shortSummary = "Write text",
+    description = "Writes the prefix followed by the text. Both must remain valid until they have been written.",
+    returnType = Constants.voidCType,
+    parameters = List(FunctionParameter("char const*", "prefix"), FunctionParameter("char const*", "text")),
+    body =
+      s"""$paramName->prefix = prefix;
+         |$paramName->prefix_len = strlen( prefix );
+         |$paramName->text = text;
+         |$paramName->text_len = strlen( text );""".stripMargin
+  )
+
+  private val numberFunction = writerFunction(
+    name = numberName,
+    shortSummary = "Write a number",
+    description = "Writes the prefix followed by the number, formatted like cJSON formats numbers. Infinite and NaN values are written as null.",
+    returnType = Constants.voidCType,
+    parameters = List(FunctionParameter("char const*", "prefix"), FunctionParameter(Constants.defaultNumberCType, "value")),
+    body =
+      s"""// Use the shortest format that reads back as the same value
+         |if( ( value - value ) != 0 )
+         |    {
+         |    strcpy( $paramName->scratch, "null" );
+         |    }
+         |else
+         |    {
+         |    sprintf( $paramName->scratch, "%1.15g", value );
+         |
+         |    if( strtod( $paramName->scratch, NULL ) != value )
+         |        {
+         |        sprintf( $paramName->scratch, "%1.17g", value );
+         |        }
+         |    }
+         |
+         |$putName( $paramName, prefix, $paramName->scratch );""".stripMargin
+  )
+
+  private val booleanFunction = writerFunction(
+    name = booleanName,
+    shortSummary = "Write a boolean",
+    description = "Writes the prefix followed by true if the value is non-zero, false otherwise.",
+    returnType = Constants.voidCType,
+    parameters = List(FunctionParameter("char const*", "prefix"), FunctionParameter(Constants.defaultBooleanCType, "value")),
+    body = s"""$putName( $paramName, prefix, value ? "true" : "false" );"""
+  )
+
+  private val stringFunction = writerFunction(
+    name = stringName,
+    shortSummary = "Write a string",
+    description = "Writes the prefix followed by the string as a quoted and escaped JSON string. The string must remain valid until it has been written. Returns 0 if the string is NULL, since it cannot be serialized, 1 otherwise.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = List(FunctionParameter("char const*", "prefix"), FunctionParameter("char const*", "string")),
+    body =
+      s"""$putName( $paramName, prefix, "\\"" );
+         |$paramName->string = string;
+         |
+         |return ( NULL != string );""".stripMargin
+  )
+
+  private val bytesFunction = writerFunction(
+    name = bytesName,
+    shortSummary = "Write bytes",
+    description = "Writes the prefix followed by len bytes of data as a base64 string. The data must remain valid until it has been written. Returns 0 if the data is NULL while len is not 0, since it cannot be serialized, 1 otherwise.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = List(
+      FunctionParameter("char const*", "prefix"),
+      FunctionParameter("uint8_t const*", "data"),
+      FunctionParameter("size_t", "len")
+    ),
+    body =
+      s"""if( 0 == len )
+         |    {
+         |    $putName( $paramName, prefix, "\\"\\"" );
+         |    }
+         |else
+         |    {
+         |    $putName( $paramName, prefix, "\\"" );
+         |    $paramName->bytes = data;
+         |    $paramName->bytes_len = ( NULL != data ) ? len : 0;
+         |    }
+         |
+         |return ( NULL != data ) || ( 0 == len );""".stripMargin
+  )
+
+  private val timestampFunction = writerFunction(
+    name = timestampName,
+    shortSummary = "Write a timestamp",
+    description = "Writes the prefix followed by the timestamp as a quoted RFC 3339 date-time in UTC.",
+    returnType = Constants.voidCType,
+    parameters = List(FunctionParameter("char const*", "prefix"), FunctionParameter(Constants.defaultTimestampCType, "value")),
+    body =
+      s"""size_t length;
+         |
+         |$paramName->scratch[0] = '"';
+         |length = ${Timestamp.formatName}( value, $paramName->scratch + 1 );
+         |$paramName->scratch[length + 1] = '"';
+         |$paramName->scratch[length + 2] = '\\0';
+         |
+         |$putName( $paramName, prefix, $paramName->scratch );""".stripMargin
+  )
+}
@@ -20,7 +20,22 @@ object MessageArrayJSONSerializer {
       name = name(messageName),
       documentation = documentation(messageName),
       prototype = prototype(messageName),
-      body = body(messageName)
+      body = body(messageName, MessageJSONObjectSerializer.name(messageName))
+    )
+  }
+
+  /**
+    * Generates the definition of the function to serialize an array of cached messages to
+    * a cJSON array object, reusing the cached JSON of unchanged messages
+    * @param messageName Name of the cached message
+    * @return Definition of function to serialize an array of cached messages
+    */
+  def cached(messageName: String): FunctionDefinition = {
+    FunctionDefinition(
+      name = cachedName(messageName),
+      documentation = documentation(messageName),
+      prototype = prototype(messageName),
+      body = body(messageName, MessageJSONObjectSerializer.cachedName(messageName))
     )
   }
 
@@ -33,6 +48,14 @@ object MessageArrayJSONSerializer {
     s"${messageName}_array_json_serialize"
   }
 
+  /**
+    * @param messageName Name of a cached message
+    * @return Name of the function to serialize arrays of the message with their caches
+    */
+  def cachedName(messageName: String): String = {
+    name(messageName) + "_cached"
+  }
+
   /**
     * @param messageName Name of message
     * @return Documentation for function to serialize arrays of messages
@@ -62,11 +85,10 @@ object MessageArrayJSONSerializer {
 
   /**
     * @param messageName Name of message
+    * @param objectSerializer Name of the function to serialize each message
     * @return Body of function to serialize arrays of message objects
     */
-  private def body(messageName: String): String = {
-    val objectSerializer = MessageJSONObjectSerializer.name(messageName)
-
+  private def body(messageName: String, objectSerializer: String): String = {
     s"""${Constants.defaultBooleanCType} success;
        |cJSON* json_array;
        |cJSON* array_item;
@@ -0,0 +1,239 @@
+package codegen.json.serialization
+
+import codegen.Constants
+import codegen.allocator.Allocator
+import codegen.functions._
+import codegen.json.CJSONAllocatorHooks
+import codegen.messagetypes._
+import datamodel._
+
+/**
+  * Functions to reuse the JSON kept by messages declared with cache=true. The cached
+  * serializers add the JSON of unchanged messages and array fields to the cJSON tree as raw
+  * items, so only the changed parts are built and printed again. The caches are updated
+  * through the const message pointers of the serializers, so cached messages must not be
+  * defined const. Each cache keeps the allocator of the serialization that printed its
+  * JSON, which frees it when it is replaced and when the message is freed.
+  *
+  * Only one thread at a time reads and updates caches: a serialization of a cached message
+  * first takes a lock shared by every generated source file, and serializations started
+  * while another thread holds it build the JSON of every field without using the caches.
+  */
+object MessageJSONCache {
+
+  private val messageParam = "obj"
+  private val arrayParam = "obj_array"
+  private val countParam = "obj_array_cnt"
+  private val validVar = "valid"
+
+  /**
+    * Name of the lock held while reading and updating caches
+    */
+  val lockName: String = "cdto_json_cache_lock"
+
+  /**
+    * Definition of the cache lock, to place after the atomic and shared macros of
+    * CJSONAllocatorHooks.definitions. It is 1 while a thread uses the caches, 0 otherwise.
+    */
+  val definitions: String = s"CDTO_SHARED CDTO_ATOMIC_INT $lockName;"
+
+  /**
+    * Gets the statement that takes the cache lock if no other thread holds it
+    * @param locked Name of the boolean variable set to whether the lock was taken
+    * @param unlocked Name of an int variable that is overwritten
+    * @return Statement taking the lock
+    */
+  def tryLock(locked: String, unlocked: String): String = {
+    s"""$unlocked = 0;
+       |$locked = CDTO_ATOMIC_EXCHANGE_IF( &$lockName, &$unlocked, 1 );""".stripMargin
+  }
+
+  /**
+    * Statement that releases the cache lock
+    */
+  val unlock: String = s"CDTO_ATOMIC_STORE( &$lockName, 0 );"
+
+  /**
+    * Static function to print a cJSON tree into a cache
+    */
+  val storeFunction: FunctionDefinition = FunctionDefinition(
+    name = "cdto_json_cache_store",
+    documentation = FunctionDocumentation(
+      shortSummary = "Store JSON in a cache",
+      description = "Prints the cJSON tree into the cache, replacing its previous JSON. The JSON is allocated through the calling thread's cJSON allocator, which the cache keeps to free it. If printing fails, the cache is left invalid so the JSON is built again by the next serialization. The caller must hold the cache lock."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.voidCType,
+      parameters = List(
+        FunctionParameter(paramType = s"${MessageCache.typeName}*", paramName = "cache"),
+        FunctionParameter(paramType = "cJSON*", paramName = "json")
+      )
+    ),
+    body =
+      s"""char* printed;
+         |
+         |printed = cJSON_PrintUnformatted( json );
+         |if( NULL == printed )
+         |    {
+         |    return;
+         |    }
+         |
+         |${Allocator.freeFunction.name}( cache->allocator, cache->json );
+         |cache->json = printed;
+         |cache->json_len = strlen( printed );
+         |cache->allocator = ${CJSONAllocatorHooks.activeAllocator};
+         |cache->valid = 1;""".stripMargin
+  )
+
+  /**
+    * @param messageName Name of a cached message
+    * @return Name of the function to check whether a message's JSON can be reused
+    */
+  def validName(messageName: String): String = {
+    s"${messageName}_json_cache_valid"
+  }
+
+  /**
+    * @param messageName Name of a cached message
+    * @return Name of the function to check whether the JSON of all messages of an array can be reused
+    */
+  def arrayValidName(messageName: String): String = {
+    s"${messageName}_array_json_cache_valid"
+  }
+
+  /**
+    * Gets the statement that prints a cJSON tree into one of a message's caches
+    * @param message Cached message
+    * @param obj Expression of the const message pointer
+    * @param cache Name of the cache member
+    * @param json Expression of the cJSON tree
+    * @return Statement updating the cache
+    */
+  def store(message: Message, obj: String, cache: String, json: String): String = {
+    s"${storeFunction.name}( &( ( ${MessageStruct.structName(message)}* )$obj )->$cache, $json );"
+  }
+
+  /**
+    * Creates the function that checks whether the JSON of a message can be reused. The
+    * message's own cache is only valid if the cached messages it contains did not change
+    * either, since their fields are changed without going through the message.
+    * @param message Cached message
+    * @param cachedMessages Names of all cached messages of the protocol
+    * @return Definition of the message's cache check function
+    */
+  def validFunction(message: Message, cachedMessages: Set[String]): FunctionDefinition = {
+    val nestedChecks = message.fields.flatMap(field => nestedValid(field, cachedMessages))
+    val checks = s"$validVar = $messageParam->${MessageCache.memberName}.valid;" +: nestedChecks.map(check => s"$validVar = $validVar && $check;")
+
+    FunctionDefinition(
+      name = validName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Check ${message.name} JSON cache",
+        description = s"Checks whether the cached JSON of the provided ${message.name} is still up to date."
+      ),
+      prototype = FunctionPrototype(
+        isStatic = true,
+        returnType = Constants.defaultBooleanCType,
+        parameters = List(FunctionParameter(paramType = s"${MessageStruct.structName(message)} const*", paramName = messageParam))
+      ),
+      body =
+        s"""${Constants.defaultBooleanCType} $validVar;
+           |
+           |${checks.mkString("\n")}
+           |
+           |return $validVar;""".stripMargin
+    )
+  }
+
+  /**
+    * Creates the function that checks whether the cached JSON of every message of an array
+    * is up to date
+    * @param message Cached message
+    * @return Definition of the array cache check function
+    */
+  def arrayValidFunction(message: Message): FunctionDefinition = {
+    FunctionDefinition(
+      name = arrayValidName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Check ${message.name} array JSON caches",
+        description = s"Checks whether the cached JSON of every ${message.name} of the array is still up to date."
+      ),
+      prototype = FunctionPrototype(
+        isStatic = true,
+        returnType = Constants.defaultBooleanCType,
+        parameters = List(
+          FunctionParameter(paramType = s"${MessageStruct.structName(message)} const*", paramName = arrayParam),
+          FunctionParameter(paramType = Constants.defaultIntCType, paramName = countParam)
+        )
+      ),
+      body =
+        s"""${Constants.defaultBooleanCType} $validVar;
+           |${Constants.defaultIntCType} i;
+           |
+           |$validVar = 1;
+           |for( i = 0; $validVar && ( i < $countParam ); i++ )
+           |    {
+           |    $validVar = ${validName(message.name)}( &$arrayParam[i] );
+           |    }
+           |
+           |return $validVar;""".stripMargin
+    )
+  }
+
+  /**
+    * Gets the expression that checks whether the JSON of an array field can be reused
+    * @param message Cached message containing the field
+    * @param fieldName Name of the array field
+    * @param elementType Type of the array's elements
+    * @param elements Expression of the array's elements
+    * @param cachedMessages Names of all cached messages of the protocol
+    * @return Expression checking the field's cache
+    */
+  def fragmentValid(message: Message, fieldName: String, elementType: SimpleFieldType, elements: String, cachedMessages: Set[String]): String = {
+    val fragmentCheck = s"$messageParam->${MessageCache.fragmentName(fieldName)}.valid"
+
+    elementsValid(elementType, elements, countExpression(fieldName), cachedMessages) match {
+      case Some(check) => s"$fragmentCheck && $check"
+      case None => fragmentCheck
+    }
+  }
+
+  /**
+    * @param field Field of a cached message
+    * @param cachedMessages Names of all cached messages of the protocol
+    * @return Expression checking the caches of the cached messages the field contains, if any
+    */
+  private def nestedValid(field: Field, cachedMessages: Set[String]): Option[String] = {
+    val member = s"$messageParam->${field.name}"
+
+    field.fieldType match {
+      case ObjectType(objectName) if cachedMessages.contains(objectName) => Some(s"${validName(objectName)}( &$member )")
+      case ArrayType(elementType) => elementsValid(elementType, member, countExpression(field.name), cachedMessages)
+      case InlineArrayType(elementType, _) => elementsValid(elementType, InlineArray.elements(member), countExpression(field.name), cachedMessages)
+      case _ => None
+    }
+  }
+
+  /**
+    * @param elementType Type of an array's elements
+    * @param elements Expression of the array's elements
+    * @param count Expression of the number of elements
+    * @param cachedMessages Names of all cached messages of the protocol
+    * @return Expression checking the caches of the elements if they are cached messages
+    */
+  private def elementsValid(elementType: SimpleFieldType, elements: String, count: String, cachedMessages: Set[String]): Option[String] = {
+    elementType match {
+      case ObjectType(objectName) if cachedMessages.contains(objectName) => Some(s"${arrayValidName(objectName)}( $elements, $count )")
+      case _ => None
+    }
+  }
+
+  /**
+    * @param fieldName Name of an array field
+    * @return Expression of the number of elements in the array field
+    */
+  private def countExpression(fieldName: String): String = {
+    s"$messageParam->${MessageStruct.arrayCountFieldName(fieldName)}"
+  }
+}
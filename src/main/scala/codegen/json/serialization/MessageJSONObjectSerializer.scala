@@ -2,6 +2,7 @@ package codegen.json.serialization
 
 import codegen.Constants
 import codegen.functions._
+import codegen.json.tables._
 import codegen.messagetypes._
 import datamodel._
 
@@ -31,6 +32,42 @@ object MessageJSONObjectSerializer {
     )
   }
 
+  /**
+    * Generates the function to serialize a message to a cJSON object for table-driven
+    * code generation. The function passes the message's descriptor to the generic runtime.
+    * @param message Message to serialize
+    * @return Definition of the function to serialize a message to a cJSON object with the runtime
+    */
+  def tableDriven(message: Message): FunctionDefinition = {
+    FunctionDefinition(
+      name = name(message.name),
+      documentation = documentation(message),
+      prototype = prototype(message),
+      body = s"return ${JSONTableRuntime.objectSerializeName}( $messageParam, &${MessageJSONDescriptor.name(message.name)}, $jsonOutputParam );"
+    )
+  }
+
+  /**
+    * Generates the function to serialize a message declared with cache=true to a cJSON
+    * object. The JSON of the message and of its array fields is reused while unchanged and
+    * kept for later serializations otherwise. Contained cached messages are serialized with
+    * their own cached serializers.
+    * @param message Cached message to serialize
+    * @param cachedMessages Names of all cached messages of the protocol
+    * @return Definition of the function to serialize a cached message to a cJSON object
+    */
+  def cached(message: Message, cachedMessages: Set[String]): FunctionDefinition = {
+    FunctionDefinition(
+      name = cachedName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Serialize a ${message.name} to JSON with its cache",
+        description = s"Serializes the provided ${message.name} to a cJSON object, reusing its cached JSON where it did not change. The caller must clean up $jsonOutputParam."
+      ),
+      prototype = prototype(message),
+      body = cachedBody(message, cachedMessages)
+    )
+  }
+
   /**
     * Gets the name of the function that serializes a message to
     * a cJSON object
@@ -41,6 +78,14 @@ object MessageJSONObjectSerializer {
     s"${messageName}_json_obj_serialize"
   }
 
+  /**
+    * @param messageName Name of a cached message
+    * @return Name of function to serialize the message to a cJSON object with its cache
+    */
+  def cachedName(messageName: String): String = {
+    name(messageName) + "_cached"
+  }
+
   /**
     * @param message Message to serialize
     * @return Documentation for the function to serialize a message
@@ -73,7 +118,7 @@ object MessageJSONObjectSerializer {
     * @return Body of the function to serialize message to a cJSON object
     */
   private def body(message: Message): String = {
-    val fieldSnippets = message.fields.map(field => fieldSerializeSnippet(field.fieldType, field.name, field.jsonKey))
+    val fieldSnippets = message.fields.map(field => fieldSerializeSnippet(message, field, Set.empty))
     val allFieldSnippets = fieldSnippets.mkString("\n\n")
 
     s"""${Constants.defaultBooleanCType} $successVar;
@@ -101,154 +146,328 @@ object MessageJSONObjectSerializer {
   }
 
   /**
-    * Generates the code snippet to serialize the specified object field to a
-    * cJSON object and add it to the message's root JSON object
+    * @param message Cached message to serialize
+    * @param cachedMessages Names of all cached messages of the protocol
+    * @return Body of the function to serialize a cached message to a cJSON object
+    */
+  private def cachedBody(message: Message, cachedMessages: Set[String]): String = {
+    val fieldSnippets = message.fields.map(field => fieldSerializeSnippet(message, field, cachedMessages))
+    val allFieldSnippets = fieldSnippets.mkString("\n\n")
+    val cache = s"$messageParam->${MessageCache.memberName}"
+
+    s"""${Constants.defaultBooleanCType} $successVar;
+       |cJSON* $jsonRootVar;
+       |cJSON* $jsonItemVar;
+       |
+       |*$jsonOutputParam = NULL;
+       |
+       |// Reuse the JSON of the message if none of its fields changed
+       |if( ${MessageJSONCache.validName(message.name)}( $messageParam ) )
+       |    {
+       |    *$jsonOutputParam = cJSON_CreateRaw( $cache.json );
+       |    return ( NULL != *$jsonOutputParam );
+       |    }
+       |
+       |$jsonRootVar = cJSON_CreateObject();
+       |$successVar = ( NULL != $jsonRootVar );
+       |
+       |$allFieldSnippets
+       |
+       |// Set the output and keep its JSON, or clean up on error
+       |if( $successVar )
+       |    {
+       |    ${MessageJSONCache.store(message, messageParam, MessageCache.memberName, jsonRootVar)}
+       |    *$jsonOutputParam = $jsonRootVar;
+       |    }
+       |else
+       |    {
+       |    cJSON_Delete( $jsonRootVar );
+       |    }
+       |
+       |return $successVar;""".stripMargin
+  }
+
+  /**
+    * Generates the code snippet to serialize the specified field to a cJSON object and
+    * add it to the message's root JSON object. When serializing a cached message, the JSON
+    * of array fields is reused while they are unchanged. Optional fields are left out while
+    * they hold their default or are empty.
+    * @param message Message containing the field
+    * @param field Field to serialize
+    * @param cachedMessages Names of the cached messages whose cached serializers to use, empty
+    *                       when serializing without caches
+    * @return Code snippet to serialize the specified field
+    */
+  private def fieldSerializeSnippet(message: Message, field: Field, cachedMessages: Set[String]): String = {
+    val valueSnippet = field.fieldType match {
+      case ArrayType(elementType) =>
+        arrayFieldSerializeSnippet(message, field.name, elementType, s"$messageParam->${field.name}", cachedMessages)
+      case InlineArrayType(elementType, _) =>
+        arrayFieldSerializeSnippet(message, field.name, elementType, InlineArray.elements(s"$messageParam->${field.name}"), cachedMessages)
+      case BytesType => bytesSerializeSnippet(s"$messageParam->${field.name}")
+      case simpleType: SimpleFieldType => simpleFieldSerializeSnippet(simpleType, field.name, cachedMessages)
+    }
+
+    val snippet =
+      s"""$valueSnippet
+         |
+         |${addToJSONRootSnippet(field.jsonKey)}""".stripMargin
+
+    OptionalField.guard(OptionalField.omitCondition(messageParam, field), snippet)
+  }
+
+  /**
+    * Generates the code snippet to serialize the specified simple-type field to a cJSON object
     * @param fieldType Type of field
     * @param fieldName Name of field
-    * @param jsonKey Field's JSON key
+    * @param cachedMessages Names of the cached messages whose cached serializers to use
     * @return Code snippet to serialize the specified field
     */
-  private def fieldSerializeSnippet(fieldType: FieldType, fieldName: String, jsonKey: String): String = {
+  private def simpleFieldSerializeSnippet(fieldType: SimpleFieldType, fieldName: String, cachedMessages: Set[String]): String = {
     fieldType match {
-      case ArrayType(elementType) => arraySerializeSnippet(elementType, fieldName, jsonKey)
-      case AliasedType(_, underlyingType) =>fieldSerializeSnippet(underlyingType, fieldName, jsonKey)
-      case ObjectType(objectName) => objectSerializeSnippet(objectName, fieldName, jsonKey)
-      case baseFieldType:BaseFieldType => baseTypeFieldSerializeSnippet(baseFieldType, fieldName, jsonKey)
+      case AliasedType(_, underlyingType) => simpleFieldSerializeSnippet(underlyingType, fieldName, cachedMessages)
+      case ObjectType(objectName) => objectSerializeSnippet(objectName, fieldName, cachedMessages)
+      case baseFieldType:BaseFieldType => baseTypeFieldSerializeSnippet(baseFieldType, fieldName)
+    }
+  }
+
+  /**
+    * Generates the code snippet to serialize an array field. The array of a cached message is
+    * taken from the field's cache if neither the field nor its cached elements changed, and
+    * kept in the cache otherwise.
+    * @param message Message containing the field
+    * @param fieldName Name of the array field
+    * @param elementType Type of elements contained in the array
+    * @param elements Expression of the array's elements
+    * @param cachedMessages Names of the cached messages whose cached serializers to use
+    * @return Code snippet to serialize the specified array field
+    */
+  private def arrayFieldSerializeSnippet(message: Message, fieldName: String, elementType: SimpleFieldType, elements: String, cachedMessages: Set[String]): String = {
+    val serializeSnippet = arraySerializeSnippet(elementType, elements, countExpression(fieldName), cachedMessages)
+
+    if(cachedMessages.contains(message.name)) {
+      val fragment = MessageCache.fragmentName(fieldName)
+      val indentedSnippet = serializeSnippet.split("\n").map(line => if(line.isEmpty) line else "    " + line).mkString("\n")
+
+      s"""if( $successVar && ${MessageJSONCache.fragmentValid(message, fieldName, elementType, elements, cachedMessages)} )
+         |    {
+         |    $jsonItemVar = cJSON_CreateRaw( $messageParam->$fragment.json );
+         |    $successVar = ( NULL != $jsonItemVar );
+         |    }
+         |else
+         |    {
+         |$indentedSnippet
+         |
+         |    if( $successVar )
+         |        {
+         |        ${MessageJSONCache.store(message, messageParam, fragment, jsonItemVar)}
+         |        }
+         |    }""".stripMargin
+    } else {
+      serializeSnippet
     }
   }
 
+  /**
+    * @param fieldName Name of an array field
+    * @return Expression of the number of elements in the array field
+    */
+  private def countExpression(fieldName: String): String = {
+    s"$messageParam->${MessageStruct.arrayCountFieldName(fieldName)}"
+  }
+
   /**
     * Gets the code snippet to serialize an array of the specified element type as
     * a field of a message.
     * @param elementType Type of elements contained in the array
-    * @param fieldName Name of the array field
-    * @param jsonKey JSON key of the array field
+    * @param array Expression of the array
+    * @param count Expression of the number of elements in the array
+    * @param cachedMessages Names of the cached messages whose cached serializers to use
     * @return Code snippet to serialize the specified array field
     */
-  private def arraySerializeSnippet(elementType: SimpleFieldType, fieldName: String, jsonKey: String): String = {
+  private def arraySerializeSnippet(elementType: SimpleFieldType, array: String, count: String, cachedMessages: Set[String]): String = {
     elementType match {
-      case AliasedType(_, underlyingType) => arraySerializeSnippet(underlyingType, fieldName, jsonKey)
-      case ObjectType(objectName) => objectArraySerializeSnippet(objectName, fieldName, jsonKey)
-      case BooleanType => booleanArraySerializeSnippet(fieldName, jsonKey)
-      case DynamicStringType => stringArraySerializeSnippet(fieldName, jsonKey)
-      case FixedStringType(_) => stringArraySerializeSnippet(fieldName, jsonKey)
-      case NumberType => numberArraySerializeSnippet(fieldName, jsonKey)
+      case AliasedType(alias, NumberType) => aliasedNumberArraySerializeSnippet(alias, array, count)
+      case AliasedType(_, underlyingType) => arraySerializeSnippet(underlyingType, array, count, cachedMessages)
+      case ObjectType(objectName) => objectArraySerializeSnippet(objectName, array, count, cachedMessages)
+      case BooleanType => booleanArraySerializeSnippet(array, count)
+      case DynamicStringType => stringArraySerializeSnippet(array, count)
+      case InternedStringType => stringArraySerializeSnippet(array, count)
+      case FixedStringType(_) | InlineStringType(_) => stringArraySerializeSnippet(array, count)
+      case NumberType => numberArraySerializeSnippet(array, count)
+      case TimestampType => timestampArraySerializeSnippet(array, count)
+      case enumType: EnumType => enumArraySerializeSnippet(enumType, array, count)
     }
   }
 
   /**
     * Gets the code snippet to serialize an array of objects
     * @param objectName Name of object type contained in the array
-    * @param fieldName Name of the object array field
-    * @param jsonKey JSON key of the object array field
+    * @param array Expression of the object array
+    * @param count Expression of the number of elements in the array
+    * @param cachedMessages Names of the cached messages whose cached serializers to use
     * @return Code snippet to serialize the specified object array field
     */
-  private def objectArraySerializeSnippet(objectName: String, fieldName: String, jsonKey: String): String = {
-    val serializeFunction = MessageArrayJSONSerializer.name(objectName)
-    val countField = MessageStruct.arrayCountFieldName(fieldName)
+  private def objectArraySerializeSnippet(objectName: String, array: String, count: String, cachedMessages: Set[String]): String = {
+    val serializeFunction =
+      if(cachedMessages.contains(objectName)) MessageArrayJSONSerializer.cachedName(objectName)
+      else MessageArrayJSONSerializer.name(objectName)
 
     s"""if( $successVar )
        |    {
-       |    $successVar = $serializeFunction( $messageParam->$fieldName, $messageParam->$countField, &$jsonItemVar );
-       |    }
-       |
-       |${addToJSONRootSnippet(jsonKey)}""".stripMargin
+       |    $successVar = $serializeFunction( $array, $count, &$jsonItemVar );
+       |    }""".stripMargin
   }
 
   /**
     * Gets the code snippet to serialize an array of boolean values
-    * @param fieldName Name of the boolean array field
-    * @param jsonKey JSON key of the boolean array field
+    * @param array Expression of the boolean array
+    * @param count Expression of the number of elements in the array
     * @return Code snippet to serialize the specified boolean array field
     */
-  private def booleanArraySerializeSnippet(fieldName: String, jsonKey: String): String = {
+  private def booleanArraySerializeSnippet(array: String, count: String): String = {
     val serializeFunction = BooleanArrayJSONSerializer.name
-    val countField = MessageStruct.arrayCountFieldName(fieldName)
 
     s"""if( $successVar )
        |    {
-       |    $successVar = $serializeFunction( $messageParam->$fieldName, $messageParam->$countField, &$jsonItemVar );
-       |    }
-       |
-       |${addToJSONRootSnippet(jsonKey)}""".stripMargin
+       |    $successVar = $serializeFunction( $array, $count, &$jsonItemVar );
+       |    }""".stripMargin
   }
 
   /**
     * Gets the code snippet to serialize an array of strings
-    * @param fieldName Name of the string array field
-    * @param jsonKey JSON key of the string array field
+    * @param array Expression of the string array
+    * @param count Expression of the number of elements in the array
     * @return Code snippet to serialize the specified string array field
     */
-  private def stringArraySerializeSnippet(fieldName: String, jsonKey: String): String = {
-    val countField = MessageStruct.arrayCountFieldName(fieldName)
-
+  private def stringArraySerializeSnippet(array: String, count: String): String = {
     s"""if( $successVar )
        |    {
-       |    $jsonItemVar = cJSON_CreateStringArray( $messageParam->$fieldName, $messageParam->$countField );
+       |    $jsonItemVar = cJSON_CreateStringArray( $array, $count );
        |    $successVar = ( NULL != $jsonItemVar );
-       |    }
-       |
-       |${addToJSONRootSnippet(jsonKey)}""".stripMargin
+       |    }""".stripMargin
+  }
+
+  /**
+    * Gets the code snippet to serialize an array of enum values
+    * @param enumType Enum type of the array's elements
+    * @param array Expression of the enum array
+    * @param count Expression of the number of elements in the array
+    * @return Code snippet to serialize the specified enum array field
+    */
+  private def enumArraySerializeSnippet(enumType: EnumType, array: String, count: String): String = {
+    val serializeFunction = EnumJSONSerializer.arrayName(enumType)
+
+    s"""if( $successVar )
+       |    {
+       |    $successVar = $serializeFunction( $array, $count, &$jsonItemVar );
+       |    }""".stripMargin
+  }
+
+  /**
+    * Gets the code snippet to serialize an array of numbers with an aliased C type
+    * @param alias C type of the array's elements
+    * @param array Expression of the number array
+    * @param count Expression of the number of elements in the array
+    * @return Code snippet to serialize the specified number array field
+    */
+  private def aliasedNumberArraySerializeSnippet(alias: String, array: String, count: String): String = {
+    val serializeFunction = AliasedNumberArrayJSONSerializer.name(alias)
+
+    s"""if( $successVar )
+       |    {
+       |    $successVar = $serializeFunction( $array, $count, &$jsonItemVar );
+       |    }""".stripMargin
   }
 
   /**
     * Gets the code snippet to serialize an array of numbers
-    * @param fieldName Name of string array field
-    * @param jsonKey JSON key of string array field
+    * @param array Expression of the number array
+    * @param count Expression of the number of elements in the array
     * @return Code snippet to serialize an array of strings into the specified field
     */
-  private def numberArraySerializeSnippet(fieldName: String, jsonKey: String): String = {
-    val countField = MessageStruct.arrayCountFieldName(fieldName)
-
+  private def numberArraySerializeSnippet(array: String, count: String): String = {
     s"""if( $successVar )
        |    {
-       |    $jsonItemVar = cJSON_CreateDoubleArray( $messageParam->$fieldName, $messageParam->$countField );
+       |    $jsonItemVar = cJSON_CreateDoubleArray( $array, $count );
        |    $successVar = ( NULL != $jsonItemVar );
-       |    }
-       |
-       |${addToJSONRootSnippet(jsonKey)}""".stripMargin
+       |    }""".stripMargin
+  }
+
+  /**
+    * Gets the code snippet to serialize an array of timestamps
+    * @param array Expression of the timestamp array
+    * @param count Expression of the number of elements in the array
+    * @return Code snippet to serialize the specified timestamp array field
+    */
+  private def timestampArraySerializeSnippet(array: String, count: String): String = {
+    s"""if( $successVar )
+       |    {
+       |    $successVar = ${TimestampJSONSerializer.arrayName}( $array, $count, &$jsonItemVar );
+       |    }""".stripMargin
+  }
+
+  /**
+    * Gets the code snippet to serialize a bytes field
+    * @param member Expression of the bytes field
+    * @return Code snippet to serialize the specified bytes field
+    */
+  private def bytesSerializeSnippet(member: String): String = {
+    s"""if( $successVar )
+       |    {
+       |    $successVar = ${BytesJSONSerializer.name}( ${Bytes.data(member)}, ${Bytes.length(member)}, &$jsonItemVar );
+       |    }""".stripMargin
   }
 
   /**
     * Gets the code snippet to serialize an object field
     * @param objectName Name of the object type
     * @param fieldName Name of the object field
-    * @param jsonKey JSON key of the object field
+    * @param cachedMessages Names of the cached messages whose cached serializers to use
     * @return Code snippet to serialize the sepcified object field
     */
-  private def objectSerializeSnippet(objectName: String, fieldName: String, jsonKey: String): String = {
-    val serializeFunction = MessageJSONObjectSerializer.name(objectName)
+  private def objectSerializeSnippet(objectName: String, fieldName: String, cachedMessages: Set[String]): String = {
+    val serializeFunction =
+      if(cachedMessages.contains(objectName)) cachedName(objectName)
+      else name(objectName)
 
     s"""if( $successVar )
        |    {
        |    $successVar = $serializeFunction( &$messageParam->$fieldName, &$jsonItemVar );
-       |    }
-       |
-       |${addToJSONRootSnippet(jsonKey)}""".stripMargin
+       |    }""".stripMargin
   }
 
   /**
     * Gets the code snippet to serialize a base-type field
     * @param baseFieldType Type of field
     * @param fieldName Name of field
-    * @param jsonKey Field's JSON key
     * @return Code snippet to serialize the specified field
     */
-  private def baseTypeFieldSerializeSnippet(baseFieldType: BaseFieldType, fieldName: String, jsonKey: String): String = {
+  private def baseTypeFieldSerializeSnippet(baseFieldType: BaseFieldType, fieldName: String): String = {
     val serializeFunction = baseFieldType match {
       case BooleanType => "cJSON_CreateBool"
       case DynamicStringType => "cJSON_CreateString"
+      case InternedStringType => "cJSON_CreateString"
       case FixedStringType(_) => "cJSON_CreateString"
+      case InlineStringType(_) => "cJSON_CreateString"
       case NumberType => "cJSON_CreateNumber"
+      case TimestampType => TimestampJSONSerializer.name
+      case EnumType(_, _) => "cJSON_CreateString"
+    }
+
+    // Enum values are serialized as their strings. cJSON_CreateString() fails if the
+    // value has no string, since the string is NULL.
+    val value = baseFieldType match {
+      case enumType: EnumType => s"${EnumJSONSerializer.toStringName(enumType)}( $messageParam->$fieldName )"
+      case InlineStringType(_) => InlineString.value(s"$messageParam->$fieldName")
+      case _ => s"$messageParam->$fieldName"
     }
 
     s"""if( $successVar )
        |    {
-       |    $jsonItemVar = $serializeFunction( $messageParam->$fieldName );
+       |    $jsonItemVar = $serializeFunction( $value );
        |    $successVar = ( NULL != $jsonItemVar );
-       |    }
-       |
-       |${addToJSONRootSnippet(jsonKey)}""".stripMargin
+       |    }""".stripMargin
   }
 
   /**
@@ -1,7 +1,10 @@
 package codegen.json.serialization
 
 import codegen.Constants
+import codegen.allocator.Allocator
 import codegen.functions._
+import codegen.json.CJSONAllocatorHooks
+import codegen.json.stats.MessageJSONStats
 import datamodel._
 
 object MessageJSONPrettyStringSerializer {
@@ -13,8 +16,7 @@ object MessageJSONPrettyStringSerializer {
     * Creates a function to serialize a message object to a formatted
     * JSON string. This function is non-static and exported.
     * @param message Message to serialize
-    * @return Definition of function to serialize a message to a formatted
-    *         JSON string
+    * @return Definition of function to serialize a message to a formatted JSON string
     */
   def apply(message: Message): FunctionDefinition = {
     FunctionDefinition(
@@ -25,6 +27,22 @@ object MessageJSONPrettyStringSerializer {
     )
   }
 
+  /**
+    * Generates a function to serialize messages to a formatted JSON string using a
+    * caller-provided allocator for all memory, including the memory used
+    * internally by cJSON and the output string.
+    * @param message Message to serialize
+    * @return Definition of function to serialize a message to a formatted JSON string with an allocator
+    */
+  def withAllocator(message: Message): FunctionDefinition = {
+    FunctionDefinition(
+      name = exName(message.name),
+      exDocumentation(message),
+      exPrototype(message),
+      exBody(message)
+    )
+  }
+
   /**
     * Gets the name of the function to serialize messages to a formatted
     * JSON string
@@ -35,6 +53,16 @@ object MessageJSONPrettyStringSerializer {
     s"${messageName}_json_serialize_pretty"
   }
 
+  /**
+    * Gets the name of the function to serialize messages to a formatted JSON string
+    * with an allocator
+    * @param messageName Name of message to serialize
+    * @return Name of function to serialize a message to a formatted JSON string with an allocator
+    */
+  def exName(messageName: String): String = {
+    name(messageName) + Allocator.functionNameSuffix
+  }
+
   /**
     * @param message Message to serialize
     * @return Documentation of function to serialize messages to a formatted JSON string
@@ -46,6 +74,17 @@ object MessageJSONPrettyStringSerializer {
     )
   }
 
+  /**
+    * @param message Message to serialize
+    * @return Documentation of function to serialize messages to a formatted JSON string with an allocator
+    */
+  private def exDocumentation(message: Message): FunctionDocumentation = {
+    FunctionDocumentation(
+      shortSummary = s"Pretty print a ${message.name} to JSON with an allocator",
+      description = s"Serializes a ${message.name} to a formatted JSON string, making all allocations through ${Allocator.paramName}. The caller must free $jsonOutputParam with the same allocator."
+    )
+  }
+
   /**
     * @param message Message to serialize
     * @return Prototype of function to serialize messages to a formatted JSON string
@@ -61,16 +100,38 @@ object MessageJSONPrettyStringSerializer {
     )
   }
 
+  /**
+    * @param message Message to serialize
+    * @return Prototype of function to serialize messages to a formatted JSON string with an allocator
+    */
+  private def exPrototype(message: Message): FunctionPrototype = {
+    val basePrototype = prototype(message)
+
+    basePrototype.copy(parameters = basePrototype.parameters :+ Allocator.parameter)
+  }
+
   /**
     * @param message Message to serialize
     * @return Body of function to serialize messages to a formatted JSON string
     */
   private def body(message: Message): String = {
+    s"return ${exName(message.name)}( $messageParam, $jsonOutputParam, ${Allocator.defaultAllocator} );"
+  }
+
+  /**
+    * @param message Message to serialize
+    * @return Body of function to serialize messages to a formatted JSON string with an allocator
+    */
+  private def exBody(message: Message): String = {
     val objectSerializer = MessageJSONObjectSerializer.name(message.name)
 
     s"""${Constants.defaultBooleanCType} success;
        |cJSON* json_root;
+       |${CJSONAllocatorHooks.previousAllocatorDeclaration}
+       |${MessageJSONStats.locals}
        |
+       |${MessageJSONStats.begin(message.name, MessageJSONStats.serializeOperation)}
+       |${CJSONAllocatorHooks.push}
        |json_root = NULL;
        |*$jsonOutputParam = NULL;
        |
@@ -80,10 +141,13 @@ object MessageJSONPrettyStringSerializer {
        |    {
        |    *$jsonOutputParam = cJSON_Print( json_root );
        |    success = ( NULL != *$jsonOutputParam );
+       |    ${MessageJSONStats.addIf("success", MessageJSONStats.bytesOutCounter, s"strlen( *$jsonOutputParam )")}
        |    }
        |
        |cJSON_Delete( json_root );
+       |${CJSONAllocatorHooks.pop}
+       |${MessageJSONStats.end}
        |
        |return success;""".stripMargin
   }
-}
\ No newline at end of file
+}
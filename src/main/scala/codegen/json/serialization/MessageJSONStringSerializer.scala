@@ -1,7 +1,11 @@
 package codegen.json.serialization
 
 import codegen.Constants
+import codegen.allocator.Allocator
 import codegen.functions._
+import codegen.json.CJSONAllocatorHooks
+import codegen.json.stats.MessageJSONStats
+import codegen.messagetypes.MessageCache
 import datamodel._
 
 object MessageJSONStringSerializer {
@@ -25,6 +29,24 @@ object MessageJSONStringSerializer {
     )
   }
 
+  /**
+    * Generates a function to serialize messages to an unformatted JSON string using a
+    * caller-provided allocator for all memory, including the memory used
+    * internally by cJSON and the output string. The JSON of a cached message is copied
+    * from its cache while unchanged.
+    * @param message Message to serialize
+    * @param cached Whether to use the message's cache
+    * @return Definition of function to serialize a message to an unformatted JSON string with an allocator
+    */
+  def withAllocator(message: Message, cached: Boolean = false): FunctionDefinition = {
+    FunctionDefinition(
+      name = exName(message.name),
+      exDocumentation(message),
+      exPrototype(message),
+      if(cached) cachedExBody(message) else exBody(message)
+    )
+  }
+
   /**
     * Gets the name of the function to serialize messages to unformatted
     * JSON strings.
@@ -35,9 +57,19 @@ object MessageJSONStringSerializer {
     s"${messageName}_json_serialize"
   }
 
+  /**
+    * Gets the name of the function to serialize messages to an unformatted JSON string
+    * with an allocator
+    * @param messageName Name of message to serialize
+    * @return Name of function to serialize a message to an unformatted JSON string with an allocator
+    */
+  def exName(messageName: String): String = {
+    name(messageName) + Allocator.functionNameSuffix
+  }
+
   /**
     * @param message Message to serialize
-    * @return Documentation of function to serialize a message to an unformatted JSON string
+    * @return Documentation of function to serialize messages to an unformatted JSON string
     */
   private def documentation(message: Message): FunctionDocumentation = {
     FunctionDocumentation(
@@ -48,7 +80,18 @@ object MessageJSONStringSerializer {
 
   /**
     * @param message Message to serialize
-    * @return Prototype of function to serialize a message to an unformatted JSON string
+    * @return Documentation of function to serialize messages to an unformatted JSON string with an allocator
+    */
+  private def exDocumentation(message: Message): FunctionDocumentation = {
+    FunctionDocumentation(
+      shortSummary = s"Serialize a ${message.name} to JSON with an allocator",
+      description = s"Serializes a ${message.name} to an unformatted JSON string, making all allocations through ${Allocator.paramName}. The caller must free $jsonOutputParam with the same allocator."
+    )
+  }
+
+  /**
+    * @param message Message to serialize
+    * @return Prototype of function to serialize messages to an unformatted JSON string
     */
   private def prototype(message: Message): FunctionPrototype = {
     FunctionPrototype(
@@ -63,14 +106,36 @@ object MessageJSONStringSerializer {
 
   /**
     * @param message Message to serialize
-    * @return body of function to serialize a message to an unformatted JSON string
+    * @return Prototype of function to serialize messages to an unformatted JSON string with an allocator
+    */
+  private def exPrototype(message: Message): FunctionPrototype = {
+    val basePrototype = prototype(message)
+
+    basePrototype.copy(parameters = basePrototype.parameters :+ Allocator.parameter)
+  }
+
+  /**
+    * @param message Message to serialize
+    * @return Body of function to serialize messages to an unformatted JSON string
     */
   private def body(message: Message): String = {
+    s"return ${exName(message.name)}( $messageParam, $jsonOutputParam, ${Allocator.defaultAllocator} );"
+  }
+
+  /**
+    * @param message Message to serialize
+    * @return Body of function to serialize messages to an unformatted JSON string with an allocator
+    */
+  private def exBody(message: Message): String = {
     val objectSerializer = MessageJSONObjectSerializer.name(message.name)
 
     s"""${Constants.defaultBooleanCType} success;
        |cJSON* json_root;
+       |${CJSONAllocatorHooks.previousAllocatorDeclaration}
+       |${MessageJSONStats.locals}
        |
+       |${MessageJSONStats.begin(message.name, MessageJSONStats.serializeOperation)}
+       |${CJSONAllocatorHooks.push}
        |json_root = NULL;
        |*$jsonOutputParam = NULL;
        |
@@ -80,9 +145,82 @@ object MessageJSONStringSerializer {
        |    {
        |    *$jsonOutputParam = cJSON_PrintUnformatted( json_root );
        |    success = ( NULL != *$jsonOutputParam );
+       |    ${MessageJSONStats.addIf("success", MessageJSONStats.bytesOutCounter, s"strlen( *$jsonOutputParam )")}
+       |    }
+       |
+       |cJSON_Delete( json_root );
+       |${CJSONAllocatorHooks.pop}
+       |${MessageJSONStats.end}
+       |
+       |return success;""".stripMargin
+  }
+
+  /**
+    * Gets the body of the function to serialize a cached message. The caches are only used
+    * while holding the cache lock; if another thread holds it, every field is serialized.
+    * @param message Cached message to serialize
+    * @return Body of function to serialize cached messages to an unformatted JSON string
+    *         with an allocator
+    */
+  private def cachedExBody(message: Message): String = {
+    val objectSerializer = MessageJSONObjectSerializer.name(message.name)
+    val cachedObjectSerializer = MessageJSONObjectSerializer.cachedName(message.name)
+    val cacheValid = s"${MessageJSONCache.validName(message.name)}( $messageParam )"
+    val cache = s"$messageParam->${MessageCache.memberName}"
+
+    s"""${Constants.defaultBooleanCType} success;
+       |${Constants.defaultBooleanCType} locked;
+       |${Constants.defaultIntCType} unlocked;
+       |cJSON* json_root;
+       |${CJSONAllocatorHooks.previousAllocatorDeclaration}
+       |${MessageJSONStats.locals}
+       |
+       |${MessageJSONStats.begin(message.name, MessageJSONStats.serializeOperation)}
+       |${CJSONAllocatorHooks.push}
+       |json_root = NULL;
+       |*$jsonOutputParam = NULL;
+       |
+       |// Another thread may be replacing the JSON of the caches, so leave them alone while it does
+       |${MessageJSONCache.tryLock("locked", "unlocked")}
+       |
+       |// Only build the JSON of the changed fields, which also updates the cache
+       |success = 1;
+       |if( !locked )
+       |    {
+       |    success = $objectSerializer( $messageParam, &json_root );
+       |    }
+       |else if( !$cacheValid )
+       |    {
+       |    success = $cachedObjectSerializer( $messageParam, &json_root );
+       |    }
+       |
+       |if( success && locked && $cacheValid )
+       |    {
+       |    *$jsonOutputParam = ${Allocator.malloc(s"$cache.json_len + 1")};
+       |    success = ( NULL != *$jsonOutputParam );
+       |    ${MessageJSONStats.allocated(s"*$jsonOutputParam")}
+       |    if( success )
+       |        {
+       |        memcpy( *$jsonOutputParam, $cache.json, $cache.json_len + 1 );
+       |        }
+       |    }
+       |else if( success )
+       |    {
+       |    // The cache could not be updated
+       |    *$jsonOutputParam = cJSON_PrintUnformatted( json_root );
+       |    success = ( NULL != *$jsonOutputParam );
+       |    }
+       |
+       |${MessageJSONStats.addIf("success", MessageJSONStats.bytesOutCounter, s"strlen( *$jsonOutputParam )")}
+       |
+       |if( locked )
+       |    {
+       |    ${MessageJSONCache.unlock}
        |    }
        |
        |cJSON_Delete( json_root );
+       |${CJSONAllocatorHooks.pop}
+       |${MessageJSONStats.end}
        |
        |return success;""".stripMargin
   }
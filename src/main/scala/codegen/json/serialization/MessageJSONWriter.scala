@@ -0,0 +1,322 @@
+package codegen.json.serialization
+
+import codegen.Constants
+import codegen.functions._
+import codegen.messagetypes._
+import datamodel._
+
+/**
+  * Generates the resumable JSON writer of each message. A writer is started with
+  * <message>_json_writer_init and produces the message's JSON through repeated calls to
+  * <message>_json_writer_fill, each filling as much of a caller-provided buffer as it can.
+  * The JSON is the same as that of <message>_json_serialize.
+  */
+object MessageJSONWriter {
+
+  private val messageParam = "obj"
+  private val writer = JSONWriterRuntime.paramName
+  private val frameVar = "frame"
+
+  /**
+    * Creates the public function that starts writing a message
+    * @param message Message to write
+    * @return Definition of the function to start writing the message
+    */
+  def init(message: Message): FunctionDefinition = {
+    FunctionDefinition(
+      name = initName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Start writing a ${message.name}",
+        description = s"Prepares the writer to write the ${message.name} as JSON with ${fillName(message.name)}. The ${message.name} is not copied, so it must not be modified or freed until the writer is done."
+      ),
+      prototype = FunctionPrototype(
+        isStatic = false,
+        returnType = Constants.voidCType,
+        parameters = List(JSONWriterRuntime.parameter, FunctionParameter(s"${MessageStruct.structName(message)} const*", messageParam))
+      ),
+      body = s"${JSONWriterRuntime.startName}( $writer, ${stepName(message.name)}, $messageParam );"
+    )
+  }
+
+  /**
+    * Creates the public function that writes the next part of a message
+    * @param message Message to write
+    * @return Definition of the function to write the next part of the message
+    */
+  def fill(message: Message): FunctionDefinition = {
+    FunctionDefinition(
+      name = fillName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Write the next part of a ${message.name}",
+        description =
+          s"Writes as much of the ${message.name} started with ${initName(message.name)} as fits into buffer, which holds buffer_size bytes, and stores the number of bytes written in written_out. " +
+          "The output is not NUL-terminated. Returns 1 if the whole message has been written, 0 if more output remains, or -1 if the message cannot be serialized."
+      ),
+      prototype = FunctionPrototype(
+        isStatic = false,
+        returnType = Constants.defaultIntCType,
+        parameters = List(
+          JSONWriterRuntime.parameter,
+          FunctionParameter("char*", "buffer"),
+          FunctionParameter("size_t", "buffer_size"),
+          FunctionParameter("size_t*", "written_out")
+        )
+      ),
+      body = s"return ${JSONWriterRuntime.fillName}( $writer, buffer, buffer_size, written_out );"
+    )
+  }
+
+  /**
+    * Creates the static function that produces the next piece of a message's JSON. Each
+    * field is one state of the frame; array fields stay in their state until every element
+    * has been written.
+    * @param message Message to write
+    * @return Definition of the message's step function
+    */
+  def step(message: Message): FunctionDefinition = {
+    FunctionDefinition(
+      name = stepName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Write the next piece of a ${message.name}",
+        description = s"Writes the next field of the ${message.name} in the writer's top frame, or the end of the ${message.name} after its last field. Returns 1 on success, 0 otherwise."
+      ),
+      prototype = FunctionPrototype(
+        isStatic = true,
+        returnType = Constants.defaultBooleanCType,
+        parameters = List(JSONWriterRuntime.parameter)
+      ),
+      body = stepBody(message)
+    )
+  }
+
+  /**
+    * @param messageName Name of the message to write
+    * @return Name of the function to start writing the message
+    */
+  def initName(messageName: String): String = {
+    s"${messageName}_json_writer_init"
+  }
+
+  /**
+    * @param messageName Name of the message to write
+    * @return Name of the function to write the next part of the message
+    */
+  def fillName(messageName: String): String = {
+    s"${messageName}_json_writer_fill"
+  }
+
+  /**
+    * @param messageName Name of the message to write
+    * @return Name of the message's step function
+    */
+  def stepName(messageName: String): String = {
+    s"${messageName}_json_write_step"
+  }
+
+  /**
+    * Gets the deepest nesting of messages in the protocol, which is the number of frames a
+    * writer needs. Messages cannot contain themselves, directly or through arrays, so the
+    * depth is finite.
+    * @param protocol Message protocol
+    * @return Maximum nesting depth of the protocol's messages, counting the outermost message
+    */
+  def maxDepth(protocol: Protocol): Int = {
+    val messagesByName = protocol.messages.map(message => message.name -> message).toMap
+    val depths = protocol.messages.foldLeft(Map.empty[String, Int])((known, message) => messageDepths(message, messagesByName, known))
+
+    depths.values.foldLeft(0)(math.max)
+  }
+
+  /**
+    * Computes the nesting depth of a message and of all messages it contains
+    * @param message Message
+    * @param messagesByName All messages of the protocol, by name
+    * @param known Depths computed so far, by message name
+    * @return The known depths with those of the message and the messages it contains added
+    */
+  private def messageDepths(message: Message, messagesByName: Map[String, Message], known: Map[String, Int]): Map[String, Int] = {
+    if(known.contains(message.name)) {
+      known
+    } else {
+      val children = message.fields.map(_.fieldType).collect({
+        case ObjectType(objectName) => objectName
+        case ArrayType(ObjectType(objectName)) => objectName
+        case InlineArrayType(ObjectType(objectName), _) => objectName
+      })
+
+      val withChildren = children.foldLeft(known)((depths, child) => messageDepths(messagesByName(child), messagesByName, depths))
+
+      withChildren + (message.name -> (1 + children.map(withChildren).foldLeft(0)(math.max)))
+    }
+  }
+
+  /**
+    * @param message Message to write
+    * @return Body of the message's step function
+    */
+  private def stepBody(message: Message): String = {
+    val objectLocals =
+      if(message.fields.isEmpty) Nil
+      else List(s"${MessageStruct.structName(message)} const* $messageParam;")
+
+    val objectInitialization =
+      if(message.fields.isEmpty) Nil
+      else List(s"$messageParam = ( ${MessageStruct.structName(message)} const* )$frameVar->obj;")
+
+    // The first field that is written opens the object and every later one is preceded by a
+    // comma
+    val fieldCases = message.fields.zipWithIndex.map({ case (field, index) =>
+      val key = "\"" + field.jsonKey + "\":"
+      fieldCase(field, index, suffix => writtenText(message.fields.take(index), "," + key + suffix, "{" + key + suffix))
+    })
+
+    val end = writtenText(message.fields, "}", "{}")
+
+    s"""${(s"${Constants.defaultBooleanCType} success;" +: s"${JSONWriterRuntime.frameTypeName}* $frameVar;" +: objectLocals).mkString("\n")}
+       |
+       |${(s"$frameVar = &$writer->frames[$writer->depth - 1];" +: objectInitialization).mkString("\n")}
+       |success = 1;
+       |
+       |switch( $frameVar->state )
+       |    {
+       |${(fieldCases :+ endCase(end)).mkString("\n\n")}
+       |    }
+       |
+       |return success;""".stripMargin
+  }
+
+  /**
+    * Gets text that depends on whether any of the given fields was written. It is only
+    * decided at runtime while all of them are optional.
+    * @param fields Fields of the message
+    * @param written Text used if any of the fields was written
+    * @param noneWritten Text used if none of the fields was written
+    * @return C expression of the text
+    */
+  private def writtenText(fields: Seq[Field], written: String, noneWritten: String): String = {
+    val omitConditions = fields.map(OptionalField.omitCondition(messageParam, _))
+
+    if(fields.isEmpty) {
+      cString(noneWritten)
+    } else if(omitConditions.exists(_.isEmpty)) {
+      cString(written)
+    } else {
+      val anyWritten = omitConditions.flatten.map(omit => s"!( $omit )").mkString(" || ")
+      s"( ( $anyWritten ) ? ${cString(written)} : ${cString(noneWritten)} )"
+    }
+  }
+
+  /**
+    * @param end C expression of the text that ends the message
+    * @return Case of the step function's switch that ends the message
+    */
+  private def endCase(end: String): String = {
+    s"""    default:
+       |        ${JSONWriterRuntime.putName}( $writer, "", $end );
+       |        $writer->depth--;
+       |        break;""".stripMargin
+  }
+
+  /**
+    * @param field Field to write
+    * @param state State of the frame in which the field is written
+    * @param keyPrefix Function from the text following the field's key to the C expression of
+    *                  the text preceding the field's value
+    * @return Case of the step function's switch that writes the field. Optional fields that
+    *         are left out only advance the state.
+    */
+  private def fieldCase(field: Field, state: Int, keyPrefix: String => String): String = {
+    val member = s"$messageParam->${field.name}"
+
+    field.fieldType match {
+      case ArrayType(elementType) => arrayCase(field, elementType, member, state, keyPrefix)
+      case InlineArrayType(elementType, _) => arrayCase(field, elementType, InlineArray.elements(member), state, keyPrefix)
+      case BytesType => valueCase(field, state, s"success = ${JSONWriterRuntime.bytesName}( $writer, ${keyPrefix("")}, ${Bytes.data(member)}, ${Bytes.length(member)} );")
+      case simpleType: SimpleFieldType => valueCase(field, state, valueStatement(simpleType, keyPrefix(""), member))
+    }
+  }
+
+  /**
+    * @param field Field to write
+    * @param state State of the frame in which the field is written
+    * @param statement Statement writing the field
+    * @return Case of the step function's switch that runs the statement unless the field is
+    *         left out
+    */
+  private def valueCase(field: Field, state: Int, statement: String): String = {
+    val guardedStatement = OptionalField.guard(OptionalField.omitCondition(messageParam, field), statement)
+
+    s"""    case $state:
+       |        ${guardedStatement.replace("\n", "\n        ")}
+       |        $frameVar->state++;
+       |        break;""".stripMargin
+  }
+
+  /**
+    * @param field Array field to write
+    * @param elementType Type of elements contained in the array
+    * @param array Expression of the array's elements
+    * @param state State of the frame in which the field is written
+    * @param keyPrefix Function from the text following the field's key to the C expression of
+    *                  the text preceding the field's value
+    * @return Case of the step function's switch that writes the array field, one element per step
+    */
+  private def arrayCase(field: Field, elementType: SimpleFieldType, array: String, state: Int, keyPrefix: String => String): String = {
+    val countField = MessageStruct.arrayCountFieldName(field.name)
+    val element = s"$array[$frameVar->index]"
+    val open = keyPrefix("[")
+
+    // Optional arrays are only left out while they have no elements
+    val omitBranch = OptionalField.omitCondition(messageParam, field) match {
+      case Some(omit) =>
+        s"""if( $omit )
+           |            {
+           |            $frameVar->state++;
+           |            }
+           |        else """.stripMargin
+      case None => ""
+    }
+
+    s"""    case $state:
+       |        ${omitBranch}if( $frameVar->index < $messageParam->$countField )
+       |            {
+       |            ${valueStatement(elementType, s"""( 0 == $frameVar->index ) ? $open : ","""", element)}
+       |            $frameVar->index++;
+       |            }
+       |        else
+       |            {
+       |            ${JSONWriterRuntime.putName}( $writer, ( 0 == $frameVar->index ) ? $open : "", "]" );
+       |            $frameVar->index = 0;
+       |            $frameVar->state++;
+       |            }
+       |        break;""".stripMargin
+  }
+
+  /**
+    * @param valueType Type of the value to write
+    * @param prefix C expression of the text preceding the value
+    * @param value C expression of the value
+    * @return Statement writing the prefix followed by the value
+    */
+  private def valueStatement(valueType: SimpleFieldType, prefix: String, value: String): String = {
+    valueType match {
+      case ObjectType(objectName) => s"${JSONWriterRuntime.pushName}( $writer, $prefix, ${stepName(objectName)}, &$value );"
+      case AliasedType(_, NumberType) => s"${JSONWriterRuntime.numberName}( $writer, $prefix, ( ${Constants.defaultNumberCType} )$value );"
+      case AliasedType(_, underlyingType) => valueStatement(underlyingType, prefix, value)
+      case BooleanType => s"${JSONWriterRuntime.booleanName}( $writer, $prefix, $value );"
+      case DynamicStringType | InternedStringType | FixedStringType(_) => s"success = ${JSONWriterRuntime.stringName}( $writer, $prefix, $value );"
+      case InlineStringType(_) => s"success = ${JSONWriterRuntime.stringName}( $writer, $prefix, ${InlineString.value(value)} );"
+      case NumberType => s"${JSONWriterRuntime.numberName}( $writer, $prefix, $value );"
+      case TimestampType => s"${JSONWriterRuntime.timestampName}( $writer, $prefix, $value );"
+      case enumType: EnumType => s"success = ${JSONWriterRuntime.stringName}( $writer, $prefix, ${EnumJSONSerializer.toStringName(enumType)}( $value ) );"
+    }
+  }
+
+  /**
+    * @param text Text
+    * @return C string literal of the text
+    */
+  private def cString(text: String): String = {
+    "\"" + text.replace("\\", "\\\\").replace("\"", "\\\"") + "\""
+  }
+}
@@ -0,0 +1,96 @@
+package codegen.json.serialization
+
+import codegen.Constants
+import codegen.functions._
+import codegen.timestamp.Timestamp
+
+/**
+  * Contains the definitions of the functions to serialize timestamps and arrays of
+  * timestamps to cJSON string objects holding their RFC 3339 text
+  */
+object TimestampJSONSerializer {
+
+  private val valueParam = "value"
+  private val arrayParam = "array"
+  private val countParam = "array_cnt"
+  private val jsonOutputParam = "json_out"
+
+  val name: String = "timestamp_json_serialize"
+  val arrayName: String = "timestamp_array_json_serialize"
+
+  /**
+    * Definition of the function to serialize a single timestamp. Like cJSON_CreateNumber(),
+    * it returns the new cJSON object, or NULL if it could not be created.
+    */
+  val definition: FunctionDefinition = FunctionDefinition(
+    name = name,
+    documentation = FunctionDocumentation(
+      shortSummary = "Serialize timestamp",
+      description = "Creates a cJSON string holding the timestamp as an RFC 3339 date-time in UTC. Returns NULL if the string could not be created. The caller must clean up the returned object."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = "cJSON*",
+      parameters = List(FunctionParameter(paramType = Constants.defaultTimestampCType, paramName = valueParam))
+    ),
+    body =
+      s"""char text[${Timestamp.textSize}];
+         |
+         |${Timestamp.formatName}( $valueParam, text );
+         |
+         |return cJSON_CreateString( text );""".stripMargin
+  )
+
+  /**
+    * Definition of the function to serialize an array of timestamps
+    */
+  val arrayDefinition: FunctionDefinition = FunctionDefinition(
+    name = arrayName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Serialize array of timestamps",
+      description = s"Serializes an array of timestamps as an array of RFC 3339 strings. The caller must clean up $jsonOutputParam"
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter(paramType = s"${Constants.defaultTimestampCType} const*", paramName = arrayParam),
+        FunctionParameter(paramType = "int", paramName = countParam),
+        FunctionParameter(paramType = "cJSON**", paramName = jsonOutputParam)
+      )
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |cJSON* json_array;
+         |cJSON* array_item;
+         |int i;
+         |
+         |*$jsonOutputParam = NULL;
+         |
+         |json_array = cJSON_CreateArray();
+         |success = ( NULL != json_array );
+         |
+         |for( i = 0; success && ( i < $countParam ); i++ )
+         |    {
+         |    array_item = $name( $arrayParam[i] );
+         |    success = ( NULL != array_item );
+         |
+         |    if( success )
+         |        {
+         |        cJSON_AddItemToArray( json_array, array_item );
+         |        }
+         |    }
+         |
+         |// Set the output or clean up on error
+         |if( success )
+         |    {
+         |    *$jsonOutputParam = json_array;
+         |    }
+         |else
+         |    {
+         |    cJSON_Delete( json_array );
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+}
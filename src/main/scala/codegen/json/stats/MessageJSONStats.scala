@@ -0,0 +1,313 @@
+package codegen.json.stats
+
+import codegen.Constants
+import codegen.functions._
+import codegen.types._
+import datamodel._
+
+/**
+  * Generates the optional instrumentation for the JSON parse and serialize functions.
+  * All instrumentation is expressed through macros that expand to nothing unless the
+  * generated code is compiled with CDTO_STATS defined, so uninstrumented builds compile
+  * to exactly the same code as before.
+  */
+object MessageJSONStats {
+
+  /**
+    * Name of the macro that enables the instrumentation when defined
+    */
+  val guard: String = "CDTO_STATS"
+
+  private val countersTypeName = "cdto_json_stats_counters"
+  private val statsTypeName = "cdto_json_stats"
+  private val counterCType = "unsigned long long"
+  private val statsOutputParam = "stats_out"
+
+  /*
+  * Names of the counters kept for every parse and serialize operation
+  */
+  val callsCounter = "calls"
+  val bytesInCounter = "bytes_in"
+  val bytesOutCounter = "bytes_out"
+  val syntaxFailuresCounter = "failures_syntax"
+  val schemaFailuresCounter = "failures_schema"
+  val memoryFailuresCounter = "failures_memory"
+  val allocationsCounter = "allocations"
+  val freesCounter = "frees"
+  val cyclesCounter = "cycles"
+
+  /*
+  * Operations for which counters are kept
+  */
+  val parseOperation = "parse"
+  val serializeOperation = "serialize"
+
+  /**
+    * Statement macro that declares the local variables used by the other statement
+    * macros. Must be placed with the function's local variable declarations.
+    */
+  val locals: String = "CDTO_STATS_LOCALS"
+
+  /**
+    * Statement macro that ends the measurement started by begin()
+    */
+  val end: String = "CDTO_STATS_END()"
+
+  /**
+    * Statement macro that counts an allocation against the operation currently being
+    * measured on the calling thread, if any
+    */
+  val allocation: String = "CDTO_STATS_ALLOCATION()"
+
+  /**
+    * Gets the statement macro that counts the result of an allocation against the operation
+    * currently being measured on the calling thread, if any. A successful allocation is
+    * counted as an allocation and a failed one as a memory failure.
+    * @param memory C expression of the allocated memory, NULL if the allocation failed
+    * @return Statement macro to count the allocation
+    */
+  def allocated(memory: String): String = {
+    s"CDTO_STATS_ALLOCATED( $memory )"
+  }
+
+  /**
+    * Gets the statement macro that counts freeing memory against the operation currently
+    * being measured on the calling thread, if any
+    * @param memory C expression of the freed memory, which is not counted if NULL
+    * @return Statement macro to count the free
+    */
+  def freed(memory: String): String = {
+    s"CDTO_STATS_FREED( $memory )"
+  }
+
+  /**
+    * Gets the statement macro that starts measuring an operation on a message
+    * @param messageName Name of the message
+    * @param operation Operation being measured, e.g. parse or serialize
+    * @return Statement macro to start the measurement
+    */
+  def begin(messageName: String, operation: String): String = {
+    s"CDTO_STATS_BEGIN( ${threadLocalName(messageName)}.$operation )"
+  }
+
+  /**
+    * Gets the statement macro that adds an amount to a counter of the operation
+    * currently being measured
+    * @param counter Name of the counter
+    * @param amount C expression for the amount to add
+    * @return Statement macro to increment the counter
+    */
+  def add(counter: String, amount: String): String = {
+    s"CDTO_STATS_ADD( $counter, $amount )"
+  }
+
+  /**
+    * Gets the statement macro that adds an amount to a counter of the operation
+    * currently being measured if the given condition holds
+    * @param condition C expression that must be true for the counter to be incremented
+    * @param counter Name of the counter
+    * @param amount C expression for the amount to add
+    * @return Statement macro to conditionally increment the counter
+    */
+  def addIf(condition: String, counter: String, amount: String): String = {
+    s"CDTO_STATS_ADD_IF( $condition, $counter, $amount )"
+  }
+
+  /**
+    * Gets the type definitions to place in the protocol's JSON header. The definitions are
+    * shared between protocols so they are protected against multiple definitions.
+    * @return Header definitions for the instrumentation counters
+    */
+  def headerDefinitions: String = {
+    val counters = List(
+      callsCounter,
+      bytesInCounter,
+      bytesOutCounter,
+      syntaxFailuresCounter,
+      schemaFailuresCounter,
+      memoryFailuresCounter,
+      allocationsCounter,
+      freesCounter,
+      cyclesCounter
+    )
+
+    val countersType = StructDefinition(countersTypeName, counters.map(SimpleStructField(_, counterCType)))
+    val statsType = StructDefinition(statsTypeName, List(
+      SimpleStructField(parseOperation, countersTypeName),
+      SimpleStructField(serializeOperation, countersTypeName)
+    ))
+
+    s"""#ifdef $guard
+       |#ifndef CDTO_JSON_STATS_DEFINED
+       |#define CDTO_JSON_STATS_DEFINED
+       |
+       |${StructGenerator(countersType)}
+       |
+       |${StructGenerator(statsType)}
+       |
+       |#endif /* #ifndef CDTO_JSON_STATS_DEFINED */
+       |#endif /* #ifdef $guard */""".stripMargin
+  }
+
+  /**
+    * Gets the macro and thread-local variable definitions to place in the protocol's
+    * JSON C source file. These rely on the CDTO_THREAD_LOCAL and CDTO_SHARED macros being
+    * defined first. The active counters are shared so that allocations made in one translation
+    * unit are counted against a call that started in another.
+    * @param messages Messages whose functions are defined in the C source file
+    * @return Source definitions for the instrumentation
+    */
+  def sourceDefinitions(messages: Seq[Message]): String = {
+    val threadLocals = messages
+      .map(message => s"static CDTO_THREAD_LOCAL $statsTypeName ${threadLocalName(message.name)};")
+      .mkString("\n")
+
+    s"""#ifdef $guard
+       |
+       |#if defined( __x86_64__ ) || defined( __i386__ )
+       |#include <x86intrin.h>
+       |#else
+       |#include <time.h>
+       |#endif
+       |
+       |#define CDTO_STATS_LOCALS                              $countersTypeName* stats; $counterCType stats_start;
+       |#define CDTO_STATS_BEGIN( _counters )                  stats = &( _counters ); stats->$callsCounter++; stats_start = cdto_stats_now(); cdto_stats_active = stats;
+       |#define CDTO_STATS_ADD( _counter, _amount )            stats->_counter += ( _amount );
+       |#define CDTO_STATS_ADD_IF( _cond, _counter, _amount )  if( _cond ) { stats->_counter += ( _amount ); }
+       |#define CDTO_STATS_ALLOCATION()                        if( NULL != cdto_stats_active ) { cdto_stats_active->$allocationsCounter++; }
+       |#define CDTO_STATS_ALLOCATED( _memory )                if( NULL != cdto_stats_active ) { if( NULL != ( _memory ) ) { cdto_stats_active->$allocationsCounter++; } else { cdto_stats_active->$memoryFailuresCounter++; } }
+       |#define CDTO_STATS_FREED( _memory )                    if( ( NULL != cdto_stats_active ) && ( NULL != ( _memory ) ) ) { cdto_stats_active->$freesCounter++; }
+       |#define CDTO_STATS_END()                               stats->$cyclesCounter += cdto_stats_now() - stats_start; cdto_stats_active = NULL;
+       |
+       |CDTO_SHARED CDTO_THREAD_LOCAL $countersTypeName* cdto_stats_active;
+       |$threadLocals
+       |
+       |#else
+       |
+       |#define CDTO_STATS_LOCALS
+       |#define CDTO_STATS_BEGIN( _counters )
+       |#define CDTO_STATS_ADD( _counter, _amount )
+       |#define CDTO_STATS_ADD_IF( _cond, _counter, _amount )
+       |#define CDTO_STATS_ALLOCATION()
+       |#define CDTO_STATS_ALLOCATED( _memory )
+       |#define CDTO_STATS_FREED( _memory )
+       |#define CDTO_STATS_END()
+       |
+       |#endif /* #ifdef $guard */""".stripMargin
+  }
+
+  /**
+    * Gets all functions needed to instrument the protocol's JSON functions and to
+    * read the counters
+    * @param messages Messages whose functions are defined in the C source file
+    * @return List of instrumentation functions
+    */
+  def functions(messages: Seq[Message]): Seq[FunctionDefinition] = {
+    val messageFunctions = messages.flatMap(message => List(
+      snapshotFunction(message),
+      resetFunction(message)
+    ))
+
+    clockFunction +: messageFunctions
+  }
+
+  /**
+    * Gets the name of the function to snapshot the counters of a message
+    * @param messageName Name of the message
+    * @return Name of the function to snapshot the message's counters
+    */
+  def snapshotFunctionName(messageName: String): String = {
+    s"${messageName}_json_stats_get"
+  }
+
+  /**
+    * Gets the name of the function to reset the counters of a message
+    * @param messageName Name of the message
+    * @return Name of the function to reset the message's counters
+    */
+  def resetFunctionName(messageName: String): String = {
+    s"${messageName}_json_stats_reset"
+  }
+
+  /**
+    * Gets the name of the thread-local variable holding a message's counters
+    * @param messageName Name of the message
+    * @return Name of the message's thread-local counters
+    */
+  private def threadLocalName(messageName: String): String = {
+    s"${messageName}_json_stats_tls"
+  }
+
+  /**
+    * Static function to read the cycle counter. This uses the time-stamp counter on x86
+    * and falls back to a monotonic clock in nanoseconds on all other architectures.
+    */
+  private val clockFunction = FunctionDefinition(
+    name = "cdto_stats_now",
+    documentation = FunctionDocumentation(
+      shortSummary = "Read cycle counter",
+      description = "Returns the time-stamp counter on x86 and a monotonic clock in nanoseconds otherwise."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = counterCType,
+      parameters = Nil
+    ),
+    body =
+      s"""#if defined( __x86_64__ ) || defined( __i386__ )
+         |return ($counterCType)__rdtsc();
+         |#else
+         |struct timespec now;
+         |
+         |clock_gettime( CLOCK_MONOTONIC, &now );
+         |return ($counterCType)now.tv_sec * 1000000000ULL + ($counterCType)now.tv_nsec;
+         |#endif""".stripMargin,
+    preprocessorGuard = Some(guard)
+  )
+
+  /**
+    * @param message Message whose counters are read
+    * @return Definition of the function to snapshot a message's counters
+    */
+  private def snapshotFunction(message: Message): FunctionDefinition = {
+    FunctionDefinition(
+      name = snapshotFunctionName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Get ${message.name} JSON statistics",
+        description = s"Copies the calling thread's ${message.name} parse and serialize counters to $statsOutputParam."
+      ),
+      prototype = FunctionPrototype(
+        isStatic = false,
+        returnType = Constants.voidCType,
+        parameters = List(
+          FunctionParameter(paramType = statsTypeName + "*", paramName = statsOutputParam)
+        )
+      ),
+      body = s"*$statsOutputParam = ${threadLocalName(message.name)};",
+      preprocessorGuard = Some(guard)
+    )
+  }
+
+  /**
+    * @param message Message whose counters are reset
+    * @return Definition of the function to reset a message's counters
+    */
+  private def resetFunction(message: Message): FunctionDefinition = {
+    val threadLocal = threadLocalName(message.name)
+
+    FunctionDefinition(
+      name = resetFunctionName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Reset ${message.name} JSON statistics",
+        description = s"Zeros out the calling thread's ${message.name} parse and serialize counters."
+      ),
+      prototype = FunctionPrototype(
+        isStatic = false,
+        returnType = Constants.voidCType,
+        parameters = Nil
+      ),
+      body = s"memset( &$threadLocal, 0, sizeof( $threadLocal ) );",
+      preprocessorGuard = Some(guard)
+    )
+  }
+}
@@ -0,0 +1,762 @@
+package codegen.json.tables
+
+import codegen.Constants
+import codegen.allocator.Allocator
+import codegen.base64.Base64
+import codegen.functions._
+import codegen.json.serialization.{BytesJSONSerializer, TimestampJSONSerializer}
+import codegen.json.stats.MessageJSONStats
+import codegen.messagetypes.Bytes
+import codegen.timestamp.Timestamp
+
+/**
+  * The generic runtime used by table-driven code generation. Instead of specialized parse and
+  * serialize code for every field of every message, each message gets a constant descriptor
+  * table (see MessageJSONDescriptor) and these functions interpret the tables. The runtime is
+  * emitted once into each JSON C source file that uses it.
+  */
+object JSONTableRuntime {
+
+  private val jsonParam = "json"
+  private val fieldParam = "field"
+  private val descriptorParam = "descriptor"
+
+  /**
+    * Name of the function to parse a message object from a cJSON object using its descriptor
+    */
+  val objectParseName = "cdto_json_table_object_parse"
+
+  /**
+    * Name of the function to serialize a message object to a cJSON object using its descriptor
+    */
+  val objectSerializeName = "cdto_json_table_object_serialize"
+
+  private val numberSetName = "cdto_json_table_number_set"
+  private val numberGetName = "cdto_json_table_number_get"
+  private val valueParseName = "cdto_json_table_value_parse"
+  private val arrayParseName = "cdto_json_table_array_parse"
+  private val valueSerializeName = "cdto_json_table_value_serialize"
+  private val arraySerializeName = "cdto_json_table_array_serialize"
+  private val isOmittedName = "cdto_json_table_is_omitted"
+
+  /**
+    * All runtime functions
+    */
+  def functions: Seq[FunctionDefinition] = List(
+    numberSetFunction,
+    numberGetFunction,
+    valueParseFunction,
+    arrayParseFunction,
+    objectParseFunction,
+    valueSerializeFunction,
+    arraySerializeFunction,
+    isOmittedFunction,
+    objectSerializeFunction
+  )
+
+  private val fieldParameter = FunctionParameter(s"${MessageJSONDescriptor.fieldTypeName} const*", fieldParam)
+
+  private val numberSetFunction = FunctionDefinition(
+    name = numberSetName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Store a JSON number",
+      description = "Converts the value to the number format of a field and stores it. Returns 0 if an integer field cannot represent the value exactly."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter("void*", "value_out"),
+        fieldParameter,
+        FunctionParameter(Constants.defaultNumberCType, "value")
+      )
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |long long integer;
+         |unsigned long long unsigned_integer;
+         |
+         |success = 1;
+         |
+         |if( $fieldParam->format & ${MessageJSONDescriptor.floatingFormat} )
+         |    {
+         |    if( sizeof( float ) == $fieldParam->size )
+         |        {
+         |        *( float* )value_out = ( float )value;
+         |        }
+         |    else if( sizeof( double ) == $fieldParam->size )
+         |        {
+         |        *( double* )value_out = value;
+         |        }
+         |    else
+         |        {
+         |        *( long double* )value_out = value;
+         |        }
+         |    }
+         |else if( $fieldParam->format & ${MessageJSONDescriptor.signedFormat} )
+         |    {
+         |    // Check the range before converting, since converting an out-of-range
+         |    // floating value to an integer is undefined
+         |    success = ( value >= -9223372036854775808.0 ) && ( value < 9223372036854775808.0 );
+         |    integer = success ? ( long long )value : 0;
+         |    success = success && ( ( double )integer == value );
+         |
+         |    if( success && ( $fieldParam->size < sizeof( long long ) ) )
+         |        {
+         |        success = ( integer >= -( 1LL << ( $fieldParam->size * CHAR_BIT - 1 ) ) ) && ( integer < ( 1LL << ( $fieldParam->size * CHAR_BIT - 1 ) ) );
+         |        }
+         |
+         |    if( !success )
+         |        {
+         |        // Leave the field unchanged
+         |        }
+         |    else if( sizeof( signed char ) == $fieldParam->size )
+         |        {
+         |        *( signed char* )value_out = ( signed char )integer;
+         |        }
+         |    else if( sizeof( short ) == $fieldParam->size )
+         |        {
+         |        *( short* )value_out = ( short )integer;
+         |        }
+         |    else if( sizeof( int ) == $fieldParam->size )
+         |        {
+         |        *( int* )value_out = ( int )integer;
+         |        }
+         |    else
+         |        {
+         |        *( long long* )value_out = integer;
+         |        }
+         |    }
+         |else
+         |    {
+         |    success = ( value >= 0.0 ) && ( value < 18446744073709551616.0 );
+         |    unsigned_integer = success ? ( unsigned long long )value : 0;
+         |    success = success && ( ( double )unsigned_integer == value );
+         |
+         |    if( success && ( $fieldParam->size < sizeof( unsigned long long ) ) )
+         |        {
+         |        success = ( unsigned_integer < ( 1ULL << ( $fieldParam->size * CHAR_BIT ) ) );
+         |        }
+         |
+         |    if( !success )
+         |        {
+         |        // Leave the field unchanged
+         |        }
+         |    else if( sizeof( unsigned char ) == $fieldParam->size )
+         |        {
+         |        *( unsigned char* )value_out = ( unsigned char )unsigned_integer;
+         |        }
+         |    else if( sizeof( unsigned short ) == $fieldParam->size )
+         |        {
+         |        *( unsigned short* )value_out = ( unsigned short )unsigned_integer;
+         |        }
+         |    else if( sizeof( unsigned int ) == $fieldParam->size )
+         |        {
+         |        *( unsigned int* )value_out = ( unsigned int )unsigned_integer;
+         |        }
+         |    else
+         |        {
+         |        *( unsigned long long* )value_out = unsigned_integer;
+         |        }
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+
+  private val numberGetFunction = FunctionDefinition(
+    name = numberGetName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Load a JSON number",
+      description = "Reads a field stored in the field's number format as a double."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultNumberCType,
+      parameters = List(
+        FunctionParameter("void const*", "value"),
+        fieldParameter
+      )
+    ),
+    body =
+      s"""${Constants.defaultNumberCType} number;
+         |
+         |if( $fieldParam->format & ${MessageJSONDescriptor.floatingFormat} )
+         |    {
+         |    if( sizeof( float ) == $fieldParam->size )
+         |        {
+         |        number = *( float const* )value;
+         |        }
+         |    else if( sizeof( double ) == $fieldParam->size )
+         |        {
+         |        number = *( double const* )value;
+         |        }
+         |    else
+         |        {
+         |        number = ( double )*( long double const* )value;
+         |        }
+         |    }
+         |else if( $fieldParam->format & ${MessageJSONDescriptor.signedFormat} )
+         |    {
+         |    if( sizeof( signed char ) == $fieldParam->size )
+         |        {
+         |        number = *( signed char const* )value;
+         |        }
+         |    else if( sizeof( short ) == $fieldParam->size )
+         |        {
+         |        number = *( short const* )value;
+         |        }
+         |    else if( sizeof( int ) == $fieldParam->size )
+         |        {
+         |        number = *( int const* )value;
+         |        }
+         |    else
+         |        {
+         |        number = ( double )*( long long const* )value;
+         |        }
+         |    }
+         |else
+         |    {
+         |    if( sizeof( unsigned char ) == $fieldParam->size )
+         |        {
+         |        number = *( unsigned char const* )value;
+         |        }
+         |    else if( sizeof( unsigned short ) == $fieldParam->size )
+         |        {
+         |        number = *( unsigned short const* )value;
+         |        }
+         |    else if( sizeof( unsigned int ) == $fieldParam->size )
+         |        {
+         |        number = *( unsigned int const* )value;
+         |        }
+         |    else
+         |        {
+         |        number = ( double )*( unsigned long long const* )value;
+         |        }
+         |    }
+         |
+         |return number;""".stripMargin
+  )
+
+  private val valueParseFunction = FunctionDefinition(
+    name = valueParseName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Parse a JSON value",
+      description = "Parses the given JSON object as a single value of the field's type. Returns 1 if the parse was successful, 0 otherwise."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter("cJSON*", jsonParam),
+        FunctionParameter("void*", "value_out"),
+        fieldParameter,
+        Allocator.parameter
+      )
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |int chars_printed;
+         |size_t i;
+         |size_t length;
+         |
+         |switch( $fieldParam->type )
+         |    {
+         |    case ${MessageJSONDescriptor.booleanTag}:
+         |        success = ( cJSON_True == $jsonParam->type ) || ( cJSON_False == $jsonParam->type );
+         |        success = success && $numberSetName( value_out, $fieldParam, ( cJSON_True == $jsonParam->type ) ? 1.0 : 0.0 );
+         |        break;
+         |
+         |    case ${MessageJSONDescriptor.dynamicStringTag}:
+         |        success = ( cJSON_String == $jsonParam->type );
+         |        if( success )
+         |            {
+         |            *( char** )value_out = ${Allocator.strdup(s"$jsonParam->valuestring")};
+         |            success = ( NULL != *( char** )value_out );
+         |            ${MessageJSONStats.allocation}
+         |            }
+         |        break;
+         |
+         |    case ${MessageJSONDescriptor.internedStringTag}:
+         |        success = ( cJSON_String == $jsonParam->type );
+         |        if( success )
+         |            {
+         |            *( char const** )value_out = ${Allocator.intern(s"$jsonParam->valuestring")};
+         |            success = ( NULL != *( char const** )value_out );
+         |            }
+         |        break;
+         |
+         |    case ${MessageJSONDescriptor.fixedStringTag}:
+         |        success = ( cJSON_String == $jsonParam->type );
+         |        if( success )
+         |            {
+         |            chars_printed = snprintf( ( char* )value_out, $fieldParam->size, "%s", $jsonParam->valuestring );
+         |            success = ( chars_printed >= 0 ) && ( ( size_t )chars_printed < $fieldParam->size );
+         |            }
+         |        break;
+         |
+         |    case ${MessageJSONDescriptor.inlineStringTag}:
+         |        // value_out is the heap pointer, the inline buffer is at inline_offset in the
+         |        // same message
+         |        success = ( cJSON_String == $jsonParam->type );
+         |        length = success ? strlen( $jsonParam->valuestring ) : 0;
+         |        if( success && ( length < $fieldParam->size ) )
+         |            {
+         |            memcpy( ( unsigned char* )value_out - $fieldParam->offset + $fieldParam->inline_offset, $jsonParam->valuestring, length + 1 );
+         |            }
+         |        else if( success )
+         |            {
+         |            *( char** )value_out = ${Allocator.strdup(s"$jsonParam->valuestring")};
+         |            success = ( NULL != *( char** )value_out );
+         |            ${MessageJSONStats.allocation}
+         |            }
+         |        break;
+         |
+         |    case ${MessageJSONDescriptor.numberTag}:
+         |        success = ( cJSON_Number == $jsonParam->type ) && $numberSetName( value_out, $fieldParam, $jsonParam->valuedouble );
+         |        break;
+         |
+         |    case ${MessageJSONDescriptor.enumTag}:
+         |        success = ( cJSON_String == $jsonParam->type );
+         |        for( i = 0; success && ( i < $fieldParam->value_cnt ); i++ )
+         |            {
+         |            if( 0 == strcmp( $jsonParam->valuestring, $fieldParam->values[i] ) )
+         |                {
+         |                break;
+         |                }
+         |            }
+         |
+         |        success = success && ( i < $fieldParam->value_cnt ) && $numberSetName( value_out, $fieldParam, ( double )i );
+         |        break;
+         |
+         |    case ${MessageJSONDescriptor.objectTag}:
+         |        success = $objectParseName( $jsonParam, value_out, $fieldParam->object, ${Allocator.paramName} );
+         |        break;
+         |
+         |    case ${MessageJSONDescriptor.bytesTag}:
+         |        success = ( cJSON_String == $jsonParam->type );
+         |        if( success )
+         |            {
+         |            success = ${Base64.decodeName}( $jsonParam->valuestring, strlen( $jsonParam->valuestring ), &( ( ${Bytes.typeName}* )value_out )->data, &( ( ${Bytes.typeName}* )value_out )->len, ${Allocator.paramName} );
+         |            ${MessageJSONStats.allocation}
+         |            }
+         |        break;
+         |
+         |    case ${MessageJSONDescriptor.timestampTag}:
+         |        success = ( cJSON_String == $jsonParam->type ) && ${Timestamp.parseName}( $jsonParam->valuestring, strlen( $jsonParam->valuestring ), ( int64_t* )value_out );
+         |        break;
+         |
+         |    default:
+         |        success = 0;
+         |        break;
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+
+  private val arrayParseFunction = FunctionDefinition(
+    name = arrayParseName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Parse JSON array",
+      description = "Parses the given JSON object as an array of the field's element type. Arrays with up to the field's inline count of elements are parsed into its inline buffer and array_out is set to NULL. Returns 1 if the parse was successful, 0 otherwise. The caller must free the parsed array"
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter("cJSON*", jsonParam),
+        FunctionParameter("void*", "array_out"),
+        FunctionParameter(Constants.defaultIntCType + "*", "array_cnt_out"),
+        fieldParameter,
+        Allocator.parameter
+      )
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |unsigned char* array;
+         |unsigned char* elements;
+         |${Constants.defaultIntCType} array_cnt;
+         |${Constants.defaultIntCType} i;
+         |cJSON* array_item;
+         |
+         |array = NULL;
+         |elements = NULL;
+         |array_cnt = 0;
+         |
+         |success = ( cJSON_Array == $jsonParam->type );
+         |
+         |// Allocate room to hold all items. Initialize the array's memory to
+         |// all zeros so it is safe to free the array if an error occurs in the
+         |// middle of parsing.
+         |if( success )
+         |    {
+         |    array_cnt = cJSON_GetArraySize( $jsonParam );
+         |    if( ( array_cnt > 0 ) && ( ( size_t )array_cnt <= $fieldParam->inline_cnt ) )
+         |        {
+         |        // The inline buffer is at inline_offset in the same message and was
+         |        // zeroed with it
+         |        elements = ( unsigned char* )array_out - $fieldParam->offset + $fieldParam->inline_offset;
+         |        }
+         |    else if( array_cnt > 0 )
+         |        {
+         |        array = ${Allocator.calloc("array_cnt", s"$fieldParam->size")};
+         |        elements = array;
+         |        success = ( NULL != array );
+         |        ${MessageJSONStats.allocation}
+         |
+         |        // Reset the array count if we failed to allocate the array
+         |        array_cnt = success ? array_cnt : 0;
+         |        }
+         |    }
+         |
+         |// Walk the linked list of items rather than looking up each item by
+         |// index, which would take time proportional to the index
+         |array_item = success ? $jsonParam->child : NULL;
+         |for( i = 0; success && ( i < array_cnt ); i++ )
+         |    {
+         |    success = $valueParseName( array_item, elements + ( size_t )i * $fieldParam->size, $fieldParam, ${Allocator.paramName} );
+         |    array_item = array_item->next;
+         |    }
+         |
+         |memcpy( array_out, &array, sizeof( array ) );
+         |*array_cnt_out = array_cnt;
+         |
+         |return success;""".stripMargin
+  )
+
+  private val objectParseFunction = FunctionDefinition(
+    name = objectParseName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Parse a message from JSON",
+      description = "Parses the given JSON object into the message described by the descriptor. Returns 1 if the parse was successful, 0 otherwise. On failure the message may be partially parsed and must be freed."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter("cJSON*", jsonParam),
+        FunctionParameter("void*", "obj_out"),
+        FunctionParameter(s"${MessageJSONDescriptor.messageTypeName} const*", descriptorParam),
+        Allocator.parameter
+      )
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |size_t i;
+         |cJSON* json_item;
+         |${MessageJSONDescriptor.fieldTypeName} const* $fieldParam;
+         |unsigned char* obj;
+         |
+         |obj = ( unsigned char* )obj_out;
+         |memset( obj, 0, $descriptorParam->size );
+         |
+         |success = ( cJSON_Object == $jsonParam->type );
+         |
+         |for( i = 0; success && ( i < $descriptorParam->field_cnt ); i++ )
+         |    {
+         |    $fieldParam = &$descriptorParam->fields[i];
+         |    json_item = cJSON_GetObjectItem( $jsonParam, $fieldParam->json_key );
+         |    success = ( NULL != json_item ) || $fieldParam->omit_empty || ( NULL != $fieldParam->default_value );
+         |
+         |    if( NULL == json_item )
+         |        {
+         |        // Missing optional fields are left empty or set to their default
+         |        if( NULL != $fieldParam->default_value )
+         |            {
+         |            memcpy( obj + $fieldParam->offset, $fieldParam->default_value, $fieldParam->size );
+         |            }
+         |        }
+         |    else if( $fieldParam->is_array )
+         |        {
+         |        success = $arrayParseName( json_item, obj + $fieldParam->offset, ( ${Constants.defaultIntCType}* )( obj + $fieldParam->count_offset ), $fieldParam, ${Allocator.paramName} );
+         |        }
+         |    else
+         |        {
+         |        success = $valueParseName( json_item, obj + $fieldParam->offset, $fieldParam, ${Allocator.paramName} );
+         |        }
+         |    }
+         |
+         |// Index the arrays once all of their elements are parsed
+         |if( success && ( NULL != $descriptorParam->index ) )
+         |    {
+         |    success = $descriptorParam->index( obj, ${Allocator.paramName} );
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+
+  private val valueSerializeFunction = FunctionDefinition(
+    name = valueSerializeName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Serialize a JSON value",
+      description = "Serializes a single value of the field's type to a cJSON object. The caller must clean up json_out."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter("void const*", "value"),
+        fieldParameter,
+        FunctionParameter("cJSON**", "json_out")
+      )
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |${Constants.defaultNumberCType} number;
+         |char const* string;
+         |
+         |*json_out = NULL;
+         |
+         |switch( $fieldParam->type )
+         |    {
+         |    case ${MessageJSONDescriptor.booleanTag}:
+         |        *json_out = cJSON_CreateBool( 0.0 != $numberGetName( value, $fieldParam ) );
+         |        break;
+         |
+         |    case ${MessageJSONDescriptor.dynamicStringTag}:
+         |        *json_out = cJSON_CreateString( *( char* const* )value );
+         |        break;
+         |
+         |    case ${MessageJSONDescriptor.internedStringTag}:
+         |        *json_out = cJSON_CreateString( *( char const* const* )value );
+         |        break;
+         |
+         |    case ${MessageJSONDescriptor.fixedStringTag}:
+         |        *json_out = cJSON_CreateString( ( char const* )value );
+         |        break;
+         |
+         |    case ${MessageJSONDescriptor.inlineStringTag}:
+         |        string = *( char* const* )value;
+         |        if( NULL == string )
+         |            {
+         |            string = ( char const* )value - $fieldParam->offset + $fieldParam->inline_offset;
+         |            }
+         |        *json_out = cJSON_CreateString( string );
+         |        break;
+         |
+         |    case ${MessageJSONDescriptor.numberTag}:
+         |        *json_out = cJSON_CreateNumber( $numberGetName( value, $fieldParam ) );
+         |        break;
+         |
+         |    case ${MessageJSONDescriptor.enumTag}:
+         |        number = $numberGetName( value, $fieldParam );
+         |        if( ( number >= 0.0 ) && ( number < ( ${Constants.defaultNumberCType} )$fieldParam->value_cnt ) )
+         |            {
+         |            *json_out = cJSON_CreateString( $fieldParam->values[( size_t )number] );
+         |            }
+         |        break;
+         |
+         |    case ${MessageJSONDescriptor.objectTag}:
+         |        $objectSerializeName( value, $fieldParam->object, json_out );
+         |        break;
+         |
+         |    case ${MessageJSONDescriptor.bytesTag}:
+         |        ${BytesJSONSerializer.name}( ( ( ${Bytes.typeName} const* )value )->data, ( ( ${Bytes.typeName} const* )value )->len, json_out );
+         |        break;
+         |
+         |    case ${MessageJSONDescriptor.timestampTag}:
+         |        *json_out = ${TimestampJSONSerializer.name}( *( int64_t const* )value );
+         |        break;
+         |
+         |    default:
+         |        break;
+         |    }
+         |
+         |success = ( NULL != *json_out );
+         |
+         |return success;""".stripMargin
+  )
+
+  private val arraySerializeFunction = FunctionDefinition(
+    name = arraySerializeName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Serialize JSON array",
+      description = "Serializes an array of the field's element type to a cJSON array object. A NULL array of a field with inline storage is read from its inline buffer. The caller must clean up json_out."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter("void const*", "array_field"),
+        FunctionParameter(Constants.defaultIntCType, "array_cnt"),
+        fieldParameter,
+        FunctionParameter("cJSON**", "json_out")
+      )
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |unsigned char const* array;
+         |cJSON* json_array;
+         |cJSON* array_item;
+         |${Constants.defaultIntCType} i;
+         |
+         |*json_out = NULL;
+         |memcpy( &array, array_field, sizeof( array ) );
+         |if( ( NULL == array ) && ( $fieldParam->inline_cnt > 0 ) )
+         |    {
+         |    array = ( unsigned char const* )array_field - $fieldParam->offset + $fieldParam->inline_offset;
+         |    }
+         |
+         |json_array = cJSON_CreateArray();
+         |success = ( NULL != json_array );
+         |
+         |for( i = 0; success && ( i < array_cnt ); i++ )
+         |    {
+         |    success = $valueSerializeName( array + ( size_t )i * $fieldParam->size, $fieldParam, &array_item );
+         |
+         |    if( success )
+         |        {
+         |        cJSON_AddItemToArray( json_array, array_item );
+         |        }
+         |    }
+         |
+         |// Set the output or clean up on error
+         |if( success )
+         |    {
+         |    *json_out = json_array;
+         |    }
+         |else
+         |    {
+         |    cJSON_Delete( json_array );
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+
+  private val isOmittedFunction = FunctionDefinition(
+    name = isOmittedName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Check if a field is left out",
+      description = "Returns 1 if the field of the message holds its default value, or is empty and left out while empty, 0 otherwise."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter("unsigned char const*", "obj"),
+        fieldParameter
+      )
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} omitted;
+         |unsigned char const* value;
+         |size_t i;
+         |
+         |value = obj + $fieldParam->offset;
+         |
+         |if( NULL != $fieldParam->default_value )
+         |    {
+         |    omitted = ( 0 == memcmp( value, $fieldParam->default_value, $fieldParam->size ) );
+         |    }
+         |else if( !$fieldParam->omit_empty )
+         |    {
+         |    omitted = 0;
+         |    }
+         |else if( $fieldParam->is_array )
+         |    {
+         |    omitted = ( 0 == *( ${Constants.defaultIntCType} const* )( obj + $fieldParam->count_offset ) );
+         |    }
+         |else
+         |    {
+         |    switch( $fieldParam->type )
+         |        {
+         |        case ${MessageJSONDescriptor.dynamicStringTag}:
+         |        case ${MessageJSONDescriptor.internedStringTag}:
+         |            omitted = ( NULL == *( char const* const* )value );
+         |            break;
+         |
+         |        case ${MessageJSONDescriptor.fixedStringTag}:
+         |            omitted = ( '\\0' == *( char const* )value );
+         |            break;
+         |
+         |        case ${MessageJSONDescriptor.inlineStringTag}:
+         |            omitted = ( NULL == *( char const* const* )value ) && ( '\\0' == *( char const* )( obj + $fieldParam->inline_offset ) );
+         |            break;
+         |
+         |        case ${MessageJSONDescriptor.bytesTag}:
+         |            omitted = ( 0 == ( ( ${Bytes.typeName} const* )value )->len );
+         |            break;
+         |
+         |        case ${MessageJSONDescriptor.objectTag}:
+         |            omitted = 0;
+         |            break;
+         |
+         |        default:
+         |            // Numbers, booleans, enums and timestamps are empty while zero
+         |            omitted = 1;
+         |            for( i = 0; omitted && ( i < $fieldParam->size ); i++ )
+         |                {
+         |                omitted = ( 0 == value[i] );
+         |                }
+         |            break;
+         |        }
+         |    }
+         |
+         |return omitted;""".stripMargin
+  )
+
+  private val objectSerializeFunction = FunctionDefinition(
+    name = objectSerializeName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Serialize a message to JSON",
+      description = "Serializes the message described by the descriptor to a cJSON object. The caller must clean up json_out."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter("void const*", "obj_in"),
+        FunctionParameter(s"${MessageJSONDescriptor.messageTypeName} const*", descriptorParam),
+        FunctionParameter("cJSON**", "json_out")
+      )
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |size_t i;
+         |cJSON* json_root;
+         |cJSON* json_item;
+         |${MessageJSONDescriptor.fieldTypeName} const* $fieldParam;
+         |unsigned char const* obj;
+         |
+         |*json_out = NULL;
+         |obj = ( unsigned char const* )obj_in;
+         |
+         |json_root = cJSON_CreateObject();
+         |success = ( NULL != json_root );
+         |
+         |for( i = 0; success && ( i < $descriptorParam->field_cnt ); i++ )
+         |    {
+         |    $fieldParam = &$descriptorParam->fields[i];
+         |    json_item = NULL;
+         |
+         |    if( $isOmittedName( obj, $fieldParam ) )
+         |        {
+         |        // Leave the optional field out
+         |        }
+         |    else if( $fieldParam->is_array )
+         |        {
+         |        success = $arraySerializeName( obj + $fieldParam->offset, *( ${Constants.defaultIntCType} const* )( obj + $fieldParam->count_offset ), $fieldParam, &json_item );
+         |        }
+         |    else
+         |        {
+         |        success = $valueSerializeName( obj + $fieldParam->offset, $fieldParam, &json_item );
+         |        }
+         |
+         |    if( success && ( NULL != json_item ) )
+         |        {
+         |        cJSON_AddItemToObject( json_root, $fieldParam->json_key, json_item );
+         |        }
+         |    }
+         |
+         |// Set the output or clean up on error
+         |if( success )
+         |    {
+         |    *json_out = json_root;
+         |    }
+         |else
+         |    {
+         |    cJSON_Delete( json_root );
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+}
@@ -0,0 +1,341 @@
+package codegen.json.tables
+
+import codegen.allocator.Allocator
+import codegen.functions._
+import codegen.messagetypes.{ArrayIndex, InlineArray, InlineString, MessageEnum, MessageStruct, OptionalField}
+import codegen.Constants
+import codegen.types._
+import datamodel._
+
+/**
+  * Generates the constant descriptor tables that describe the JSON layout of each message for
+  * table-driven code generation. A message descriptor lists, for every field, its JSON key,
+  * its offset in the message struct, a type tag, the size of the value (or of one array
+  * element), the number format, the descriptor of a nested message, the offset of the
+  * element count of array fields, the strings of enum values, and the offset and capacity
+  * of the inline storage of inline arrays and strings, whether the field is left out while
+  * empty, and its default value. The descriptor of a message with
+  * indexed array fields points to the function that builds the indexes once it is parsed.
+  */
+object MessageJSONDescriptor {
+
+  val fieldTypeName = "cdto_json_field_descriptor"
+  val messageTypeName = "cdto_json_message_descriptor"
+
+  val booleanTag = "CDTO_JSON_BOOLEAN"
+  val dynamicStringTag = "CDTO_JSON_DYNAMIC_STRING"
+  val internedStringTag = "CDTO_JSON_INTERNED_STRING"
+  val fixedStringTag = "CDTO_JSON_FIXED_STRING"
+  val inlineStringTag = "CDTO_JSON_INLINE_STRING"
+  val numberTag = "CDTO_JSON_NUMBER"
+  val enumTag = "CDTO_JSON_ENUM"
+  val objectTag = "CDTO_JSON_OBJECT"
+  val bytesTag = "CDTO_JSON_BYTES"
+  val timestampTag = "CDTO_JSON_TIMESTAMP"
+
+  val floatingFormat = "CDTO_JSON_FLOATING"
+  val signedFormat = "CDTO_JSON_SIGNED"
+
+  private val numberFormatMacro = "CDTO_JSON_NUMBER_FORMAT"
+
+  private val fieldStruct = StructDefinition(
+    name = fieldTypeName,
+    fields = List(
+      SimpleStructField("json_key", "char const*"),
+      SimpleStructField("offset", "size_t"),
+      SimpleStructField("is_array", Constants.defaultBooleanCType),
+      SimpleStructField("count_offset", "size_t"),
+      SimpleStructField("type", "cdto_json_value_type"),
+      SimpleStructField("size", "size_t"),
+      SimpleStructField("format", "unsigned char"),
+      SimpleStructField("object", s"$messageTypeName const*"),
+      SimpleStructField("values", "char const* const*"),
+      SimpleStructField("value_cnt", "size_t"),
+      SimpleStructField("inline_offset", "size_t"),
+      SimpleStructField("inline_cnt", "size_t"),
+      SimpleStructField("omit_empty", Constants.defaultBooleanCType),
+      SimpleStructField("default_value", "void const*")
+    )
+  )
+
+  /**
+    * Definitions of the descriptor types. These are shared by all protocols, so they are
+    * protected against multiple definitions.
+    */
+  val typeDefinitions: String =
+    s"""#ifndef CDTO_JSON_TABLE_DEFINED
+       |#define CDTO_JSON_TABLE_DEFINED
+       |
+       |#define $floatingFormat 0x01
+       |#define $signedFormat 0x02
+       |
+       |// Gets the number format of a C type. Only floating types keep the fraction
+       |// of 0.5 and only signed types keep the sign of -1.
+       |#define $numberFormatMacro( _type ) ( ( ( ( _type )0.5 != 0 ) ? $floatingFormat : 0 ) | ( ( ( _type )-1 < ( _type )1 ) ? $signedFormat : 0 ) )
+       |
+       |typedef enum
+       |    {
+       |    $booleanTag,
+       |    $dynamicStringTag,
+       |    $internedStringTag,
+       |    $fixedStringTag,
+       |    $inlineStringTag,
+       |    $numberTag,
+       |    $enumTag,
+       |    $objectTag,
+       |    $bytesTag,
+       |    $timestampTag
+       |    } cdto_json_value_type;
+       |
+       |typedef struct $messageTypeName $messageTypeName;
+       |
+       |${StructGenerator(fieldStruct)}
+       |
+       |struct $messageTypeName
+       |    {
+       |    size_t                               size;
+       |    $fieldTypeName const*    fields;
+       |    size_t                               field_cnt;
+       |    int                                  ( *index )( void*, ${Allocator.typeName} const* );
+       |    };
+       |
+       |#endif /* #ifndef CDTO_JSON_TABLE_DEFINED */""".stripMargin
+
+  /**
+    * Gets the name of a message's descriptor
+    * @param messageName Name of the message
+    * @return Name of the message's descriptor variable
+    */
+  def name(messageName: String): String = {
+    s"${messageName}_json_descriptor"
+  }
+
+  /**
+    * Gets the declarations of the descriptors of the given messages so that descriptors can
+    * refer to each other regardless of the order they are defined in
+    * @param messages Messages to declare descriptors for
+    * @param isStatic True if the descriptors are local to a single C source file, false if
+    *                 they are shared between C source files
+    * @return Declarations of the message descriptors
+    */
+  def declarations(messages: Seq[Message], isStatic: Boolean): String = {
+    val storageClass = if(isStatic) "static" else "extern"
+
+    messages.map(message => s"$storageClass const $messageTypeName ${name(message.name)};").mkString("\n")
+  }
+
+  /**
+    * Gets the definitions of the field tables and descriptors of the given messages
+    * @param messages Messages to define descriptors for
+    * @param isStatic True if the descriptors are local to a single C source file, false if
+    *                 they are shared between C source files
+    * @return Definitions of the message descriptors
+    */
+  def definitions(messages: Seq[Message], isStatic: Boolean): String = {
+    messages.map(definition(_, isStatic)).mkString("\n\n")
+  }
+
+  /**
+    * @param message Message to define a descriptor for
+    * @param isStatic True if the descriptor is local to a single C source file
+    * @return Definition of the message's field table and descriptor
+    */
+  private def definition(message: Message, isStatic: Boolean): String = {
+    val fieldsName = s"${message.name}_json_fields"
+    val storageClass = if(isStatic) "static " else ""
+    val fieldDescriptors = message.fields.map(field => s"    ${fieldDescriptor(message, field)}").mkString(",\n")
+    val enumValues = MessageEnum.enumTypes(List(message)).map(enumValuesDefinition).map(_ + "\n\n").mkString
+    val defaultValues = message.fields.flatMap(defaultValueDefinition(message, _)).map(_ + "\n").mkString
+    val defaultSeparator = if(defaultValues.isEmpty) "" else "\n"
+
+    // The index function is defined here since the descriptor refers to it
+    val (indexFunction, indexName) = if(ArrayIndex.hasIndexes(message)) {
+      (FunctionGenerator.implementation(indexFunctionDefinition(message)) + "\n\n", indexFunctionName(message.name))
+    } else {
+      ("", "NULL")
+    }
+
+    s"""$enumValues$defaultValues$defaultSeparator$indexFunction// JSON key, offset, is array, count offset, type, size, number format, nested message, enum values, inline offset, inline count, omit empty, default
+       |static const $fieldTypeName $fieldsName[] =
+       |    {
+       |$fieldDescriptors
+       |    };
+       |
+       |${storageClass}const $messageTypeName ${name(message.name)} =
+       |    {
+       |    sizeof( ${MessageStruct.structName(message)} ),
+       |    $fieldsName,
+       |    sizeof( $fieldsName ) / sizeof( $fieldsName[0] ),
+       |    $indexName
+       |    };""".stripMargin
+  }
+
+  /**
+    * @param messageName Name of message
+    * @return Name of the static function the runtime calls to build the message's indexes
+    */
+  private def indexFunctionName(messageName: String): String = {
+    s"${messageName}_json_index"
+  }
+
+  /**
+    * Creates the function the runtime calls to build the indexes of a parsed message
+    * @param message Message with indexed array fields
+    * @return Definition of the message's descriptor index function
+    */
+  private def indexFunctionDefinition(message: Message): FunctionDefinition = {
+    FunctionDefinition(
+      name = indexFunctionName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Index ${message.name}",
+        description = s"Builds the indexes of a parsed ${message.name}. Returns 1 if the indexes were built, 0 otherwise."
+      ),
+      prototype = FunctionPrototype(
+        isStatic = true,
+        returnType = Constants.defaultBooleanCType,
+        parameters = List(FunctionParameter("void*", "obj"), Allocator.parameter)
+      ),
+      body = s"return ${ArrayIndex.buildCall(message.name, s"( ${MessageStruct.structName(message)}* )obj")};"
+    )
+  }
+
+  /**
+    * @param message Message containing the field
+    * @param field Field to describe
+    * @return Initializer of the field's descriptor
+    */
+  private def fieldDescriptor(message: Message, field: Field): String = {
+    val structName = MessageStruct.structName(message)
+    val offset = s"offsetof( $structName, ${field.name} )"
+    val nullMember = s"( ( $structName* )0 )->${field.name}"
+
+    val countOffset = s"offsetof( $structName, ${MessageStruct.arrayCountFieldName(field.name)} )"
+
+    // Bytes have no value type of their own
+    val (isArray, arrayCountOffset, inlineOffset, inlineCount, valueType, size) = field.fieldType match {
+      case ArrayType(elementType) =>
+        (1, countOffset, "0", "0", Some(arrayElementType(elementType)), s"sizeof( *$nullMember )")
+      case InlineArrayType(elementType, capacity) =>
+        // Up to capacity elements are parsed into the inline buffer instead of the heap
+        (1, countOffset, s"offsetof( $structName, ${InlineArray.bufferName(field.name)} )", capacity.toString, Some(arrayElementType(elementType)), s"sizeof( *$nullMember )")
+      case BytesType =>
+        (0, "0", "0", "0", None, s"sizeof( $nullMember )")
+      case inlineType @ InlineStringType(_) =>
+        // The value is parsed into the heap pointer or the buffer, which is described by its
+        // offset and size
+        val bufferName = InlineString.bufferName(field.name)
+        (0, "0", s"offsetof( $structName, $bufferName )", "0", Some(inlineType), s"sizeof( ( ( $structName* )0 )->$bufferName )")
+      case simpleType: SimpleFieldType =>
+        (0, "0", "0", "0", Some(simpleType), s"sizeof( $nullMember )")
+    }
+
+    val nestedDescriptor = valueType match {
+      case Some(ObjectType(objectName)) => s"&${name(objectName)}"
+      case _ => "NULL"
+    }
+
+    val (values, valueCount) = valueType match {
+      case Some(enumType: EnumType) => (enumValuesName(enumType), enumType.values.length)
+      case _ => ("NULL", 0)
+    }
+
+    val tag = valueType.map(typeTag).getOrElse(bytesTag)
+    val format = valueType.map(numberFormat).getOrElse("0")
+    val omitEmpty = if(field.omitEmpty) 1 else 0
+    val defaultValue = if(field.default.isDefined) s"&${defaultValueName(message, field)}" else "NULL"
+
+    s"""{ "${field.jsonKey}", $offset, $isArray, $arrayCountOffset, $tag, $size, $format, $nestedDescriptor, $values, $valueCount, $inlineOffset, $inlineCount, $omitEmpty, $defaultValue }"""
+  }
+
+  /**
+    * @param message Message containing the field
+    * @param field Field with a default value
+    * @return Name of the constant holding the field's default value
+    */
+  private def defaultValueName(message: Message, field: Field): String = {
+    s"${message.name}_${field.name}_json_default"
+  }
+
+  /**
+    * Gets the definition of the constant the runtime copies into a missing field and compares
+    * the field with before serializing it. It has the type of the field's struct member.
+    * @param message Message containing the field
+    * @param field Field of the message
+    * @return Definition of the field's default value, None if it has no default
+    */
+  private def defaultValueDefinition(message: Message, field: Field): Option[String] = {
+    OptionalField.defaultValue(field).map(value =>
+      s"static const ${OptionalField.defaultCType(field)} ${defaultValueName(message, field)} = $value;"
+    )
+  }
+
+  /**
+    * @param enumType Enum type
+    * @return Name of the array of the enum's value strings
+    */
+  private def enumValuesName(enumType: EnumType): String = {
+    s"${enumType.name}_json_values"
+  }
+
+  /**
+    * Gets the definition of the strings of an enum's values, indexed by the values'
+    * constants
+    * @param enumType Enum type
+    * @return Definition of the array of the enum's value strings
+    */
+  private def enumValuesDefinition(enumType: EnumType): String = {
+    val values = enumType.values.map(value => s"""    "$value"""").mkString(",\n")
+
+    s"""static char const* const ${enumValuesName(enumType)}[] =
+       |    {
+       |$values
+       |    };""".stripMargin
+  }
+
+  /**
+    * In arrays, fixed-length and inline strings are dynamically-allocated
+    * @param elementType Type of elements contained in an array
+    * @return Type to describe the elements with
+    */
+  private def arrayElementType(elementType: SimpleFieldType): SimpleFieldType = {
+    elementType match {
+      case FixedStringType(_) | InlineStringType(_) => DynamicStringType
+      case AliasedType(alias, FixedStringType(_)) => AliasedType(alias, DynamicStringType)
+      case _ => elementType
+    }
+  }
+
+  /**
+    * @param fieldType Type of a value
+    * @return Type tag of the value
+    */
+  private def typeTag(fieldType: SimpleFieldType): String = {
+    fieldType match {
+      case AliasedType(_, underlyingType) => typeTag(underlyingType)
+      case ObjectType(_) => objectTag
+      case BooleanType => booleanTag
+      case DynamicStringType => dynamicStringTag
+      case InternedStringType => internedStringTag
+      case FixedStringType(_) => fixedStringTag
+      case InlineStringType(_) => inlineStringTag
+      case NumberType => numberTag
+      case TimestampType => timestampTag
+      case EnumType(_, _) => enumTag
+    }
+  }
+
+  /**
+    * Gets the number format of a value, which is how booleans and numbers are stored
+    * @param fieldType Type of a value
+    * @return Number format of the value
+    */
+  private def numberFormat(fieldType: SimpleFieldType): String = {
+    fieldType match {
+      case AliasedType(alias, BooleanType | NumberType) => s"$numberFormatMacro( $alias )"
+      case BooleanType => s"$numberFormatMacro( ${Constants.defaultBooleanCType} )"
+      case NumberType => s"$numberFormatMacro( ${Constants.defaultNumberCType} )"
+      case EnumType(enumName, _) => s"$numberFormatMacro( $enumName )"
+      case _ => "0"
+    }
+  }
+}
@@ -0,0 +1,308 @@
+package codegen.json.validation
+
+import codegen.Constants
+import codegen.functions._
+import codegen.json.parsing.{AliasedNumberJSONParser, EnumJSONParser, TimestampJSONParser}
+import codegen.json.scanning.JSONScanner
+import codegen.messagetypes.OptionalField
+import datamodel._
+
+object MessageJSONValidator {
+
+  private val jsonParam = "json"
+  private val lengthParam = "json_len"
+  private val errorOffsetParam = "error_offset_out"
+  private val depthParam = "depth"
+  private val scanner = JSONScanner.paramName
+  private val numberVar = "value"
+
+  /**
+    * Creates the public function that checks whether a JSON string is a valid message
+    * without parsing it into a message struct or allocating any memory
+    * @param message Message to validate
+    * @return Definition of the function to validate JSON strings
+    */
+  def apply(message: Message): FunctionDefinition = {
+    FunctionDefinition(
+      name = name(message.name),
+      documentation = documentation(message),
+      prototype = prototype,
+      body = body(message)
+    )
+  }
+
+  /**
+    * Creates the static function that validates a JSON object as a message by scanning
+    * the members of the object
+    * @param message Message to validate
+    * @return Definition of the function to validate JSON objects
+    */
+  def objectValidator(message: Message): FunctionDefinition = {
+    FunctionDefinition(
+      name = objectValidatorName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Validate ${message.name} JSON object",
+        description = s"Scans a JSON object and checks that it is a valid ${message.name}. The object is at the given nesting depth. Returns 1 if the object is valid, 0 otherwise."
+      ),
+      prototype = FunctionPrototype(
+        isStatic = true,
+        returnType = Constants.defaultBooleanCType,
+        parameters = List(JSONScanner.parameter, FunctionParameter(Constants.defaultIntCType, depthParam))
+      ),
+      body = objectValidatorBody(message)
+    )
+  }
+
+  /**
+    * @param messageName Name of the message to validate
+    * @return Name of the public function to validate JSON strings
+    */
+  def name(messageName: String): String = {
+    s"${messageName}_json_validate"
+  }
+
+  /**
+    * @param messageName Name of the message to validate
+    * @return Name of the static function to validate JSON objects
+    */
+  def objectValidatorName(messageName: String): String = {
+    s"${messageName}_json_obj_validate"
+  }
+
+  /**
+    * Gets the expression that scans a single value of the given type. Aliased numbers also
+    * need their range checked, see aliasedNumberValidation.
+    * @param fieldType Type of the value
+    * @param depth Expression of the nesting depth of the value
+    * @return Expression that is 1 if a valid value was scanned, 0 otherwise
+    */
+  private def valueValidation(fieldType: SimpleFieldType, depth: String): String = {
+    fieldType match {
+      case AliasedType(_, underlyingType) => valueValidation(underlyingType, depth)
+      case ObjectType(objectName) => s"${objectValidatorName(objectName)}( $scanner, $depth )"
+      case BooleanType => s"${JSONScanner.booleanName}( $scanner, NULL )"
+      case DynamicStringType | InternedStringType | InlineStringType(_) => s"${JSONScanner.stringName}( $scanner, NULL )"
+      case FixedStringType(maxLength) => s"${JSONScanner.fixedStringName}( $scanner, $maxLength )"
+      case NumberType => s"${JSONScanner.numberName}( $scanner, NULL )"
+      case TimestampType => s"${TimestampJSONParser.scanName}( $scanner, NULL )"
+      case enumType: EnumType => s"${EnumJSONParser.scanName(enumType)}( $scanner, NULL )"
+    }
+  }
+
+  /**
+    * @param message Message to validate
+    * @return Documentation of the function to validate JSON strings
+    */
+  private def documentation(message: Message): FunctionDocumentation = {
+    FunctionDocumentation(
+      shortSummary = s"Validate a ${message.name}",
+      description =
+        s"Checks that the first $lengthParam bytes of $jsonParam are a valid ${message.name}, enforcing the same rules as ${message.name}_json_parse in a single pass without allocating memory. " +
+        s"Only whitespace may follow the message. If the JSON is invalid and $errorOffsetParam is not NULL, it receives the byte offset of the first violation. Returns 1 if the JSON is valid, 0 otherwise."
+    )
+  }
+
+  private val prototype = FunctionPrototype(
+    isStatic = false,
+    returnType = Constants.defaultBooleanCType,
+    parameters = List(
+      FunctionParameter("char const*", jsonParam),
+      FunctionParameter("size_t", lengthParam),
+      FunctionParameter("size_t*", errorOffsetParam)
+    )
+  )
+
+  /**
+    * @param message Message to validate
+    * @return Body of the function to validate JSON strings
+    */
+  private def body(message: Message): String = {
+    s"""${Constants.defaultBooleanCType} success;
+       |${JSONScanner.typeName} $scanner;
+       |
+       |${JSONScanner.initialize(scanner, jsonParam, lengthParam)}
+       |
+       |success = ${objectValidatorName(message.name)}( &$scanner, 1 );
+       |
+       |if( success )
+       |    {
+       |    ${JSONScanner.whitespaceName}( &$scanner );
+       |    success = ( $scanner.pos == $scanner.len );
+       |    }
+       |
+       |if( !success && ( NULL != $errorOffsetParam ) )
+       |    {
+       |    *$errorOffsetParam = $scanner.pos;
+       |    }
+       |
+       |return success;""".stripMargin
+  }
+
+  /**
+    * Gets the body of the function to validate a JSON object. Like cJSON_GetObjectItem,
+    * a member's key matches a field's JSON key regardless of case and only the first
+    * member matching a field is validated as the field. All other members only need to
+    * be valid JSON.
+    * @param message Message to validate
+    * @return Body of the function to validate JSON objects
+    */
+  private def objectValidatorBody(message: Message): String = {
+    val hasArrays = message.fields.exists(field => field.fieldType match {
+      case ArrayType(_) | InlineArrayType(_, _) => true
+      case _ => false
+    })
+    val hasAliasedNumbers = message.fields.exists(field => field.fieldType match {
+      case AliasedType(_, NumberType) | ArrayType(AliasedType(_, NumberType)) | InlineArrayType(AliasedType(_, NumberType), _) => true
+      case _ => false
+    })
+    val keyLocals = if(message.fields.nonEmpty) List(s"${JSONScanner.typeName} key;") else Nil
+    val arrayLocals = if(hasArrays) List(s"${Constants.defaultBooleanCType} more_items;") else Nil
+    val numberLocals = if(hasAliasedNumbers) List(s"${Constants.defaultNumberCType} $numberVar;") else Nil
+
+    // Messages without fields never compare keys, so they do not need to save them
+    val saveKey = if(message.fields.nonEmpty) s"\n    key = *$scanner;" else ""
+
+    val locals = List(
+      s"${Constants.defaultBooleanCType} success;",
+      s"${Constants.defaultBooleanCType} more;"
+    ) ++ keyLocals ++ arrayLocals ++ numberLocals ++ message.fields.map(field => s"${Constants.defaultBooleanCType} ${seenVar(field)};")
+
+    val initializations = message.fields.map(field => s"${seenVar(field)} = 0;")
+
+    val memberBranches = List(
+      """    if( !success )
+        |        {
+        |        // Invalid key
+        |        }""".stripMargin
+    ) ++ message.fields.map(fieldBranch) :+
+      s"""    else
+         |        {
+         |        success = ${JSONScanner.skipValueName}( $scanner, $depthParam + 1 );
+         |        }""".stripMargin
+
+    val requiredFields = message.fields.filterNot(OptionalField.isOptional)
+    val allSeen = if(requiredFields.isEmpty) "1" else requiredFields.map(seenVar).mkString(" && ")
+
+    s"""${locals.mkString("\n")}
+       |
+       |${(initializations :+ s"success = ( $depthParam <= ${JSONScanner.nestingLimitMacro} ) && ${JSONScanner.containerBeginName}( $scanner, '{', '}', &more );").mkString("\n")}
+       |
+       |while( success && more )
+       |    {
+       |    ${JSONScanner.whitespaceName}( $scanner );$saveKey
+       |    success = ${JSONScanner.stringName}( $scanner, NULL ) && ${JSONScanner.charName}( $scanner, ':' );
+       |    ${JSONScanner.whitespaceName}( $scanner );
+       |
+       |${memberBranches.mkString("\n")}
+       |
+       |    success = success && ${JSONScanner.containerNextName}( $scanner, '}', &more );
+       |    }
+       |
+       |// All fields without a default or omitEmpty are required. Report a missing field at the
+       |// closing brace.
+       |if( success && !( $allSeen ) )
+       |    {
+       |    $scanner->pos--;
+       |    success = 0;
+       |    }
+       |
+       |return success;""".stripMargin
+  }
+
+  /**
+    * @param field Field of the message
+    * @return Name of the local variable recording whether the field's key has been seen
+    */
+  private def seenVar(field: Field): String = {
+    s"${field.name}_seen"
+  }
+
+  /**
+    * Gets the branch of the member loop that validates the value of a field
+    * @param field Field to validate
+    * @return Else-if branch validating the field's value
+    */
+  private def fieldBranch(field: Field): String = {
+    s"""    else if( !${seenVar(field)} && ${JSONScanner.stringMatchesName}( &key, "${field.jsonKey}" ) )
+       |        {
+       |        ${seenVar(field)} = 1;
+       |${fieldValidation(field.fieldType)}
+       |        }""".stripMargin
+  }
+
+  /**
+    * @param fieldType Type of the field
+    * @return Statements validating the value of the field
+    */
+  private def fieldValidation(fieldType: FieldType): String = {
+    fieldType match {
+      case ArrayType(elementType) => arrayValidation(elementType)
+      case InlineArrayType(elementType, _) => arrayValidation(elementType)
+
+      case BytesType =>
+        s"        success = ${JSONScanner.base64Name}( $scanner );"
+
+      case AliasedType(alias, NumberType) => indent(aliasedNumberValidation(alias), "        ")
+
+      case simpleType: SimpleFieldType =>
+        s"        success = ${valueValidation(simpleType, s"$depthParam + 1")};"
+    }
+  }
+
+  /**
+    * @param elementType Type of elements contained in the array
+    * @return Statements validating the elements of an array field
+    */
+  private def arrayValidation(elementType: SimpleFieldType): String = {
+    val elementValidation = elementType match {
+      case AliasedType(alias, NumberType) =>
+        s"""${indent(aliasedNumberValidation(alias), "            ")}
+           |            success = success && ${JSONScanner.containerNextName}( $scanner, ']', &more_items );""".stripMargin
+
+      case _ =>
+        s"            success = ${valueValidation(elementValidationType(elementType), s"$depthParam + 2")} && ${JSONScanner.containerNextName}( $scanner, ']', &more_items );"
+    }
+
+    s"""        success = ${JSONScanner.containerBeginName}( $scanner, '[', ']', &more_items );
+       |        while( success && more_items )
+       |            {
+       |$elementValidation
+       |            }""".stripMargin
+  }
+
+  /**
+    * Gets the statements that validate a number of an aliased type. The number is scanned
+    * into a local variable and rejected if the alias cannot hold it, like the parse
+    * functions do.
+    * @param alias C type of the number
+    * @return Statements validating the number
+    */
+  private def aliasedNumberValidation(alias: String): String = {
+    s"""success = ${JSONScanner.numberName}( $scanner, &$numberVar );
+       |
+       |${AliasedNumberJSONParser.rangeCheck(alias, numberVar)}""".stripMargin
+  }
+
+  /**
+    * Indents every non-empty line of a snippet
+    * @param snippet Snippet of code
+    * @param indentation Whitespace to insert before each line
+    * @return Indented snippet
+    */
+  private def indent(snippet: String, indentation: String): String = {
+    snippet.split("\n").map(line => if(line.isEmpty) line else indentation + line).mkString("\n")
+  }
+
+  /**
+    * Arrays of fixed-length strings are parsed as arrays of dynamically-allocated strings,
+    * so their elements have no maximum length
+    * @param elementType Type of elements contained in an array
+    * @return Type to validate the elements as
+    */
+  private def elementValidationType(elementType: SimpleFieldType): SimpleFieldType = {
+    elementType match {
+      case FixedStringType(_) | AliasedType(_, FixedStringType(_)) => DynamicStringType
+      case _ => elementType
+    }
+  }
+}
@@ -1,6 +1,7 @@
 package codegen.messagetypes
 
 import codegen.Constants
+import codegen.allocator.Allocator
 import codegen.functions._
 import datamodel._
 
@@ -10,6 +11,7 @@ object ArrayFieldFreeFunction {
   private val nameSuffix = "_array_free"
   private val arrayParamName = "array"
   private val countParamName = "array_cnt"
+  private val inlineArrayParamName = "inline_array"
   private val indexVariableName = "i"
 
   /**
@@ -27,6 +29,53 @@ object ArrayFieldFreeFunction {
     )
   }
 
+  /**
+    * Gets the definition for the static function to free inline arrays containing the
+    * specified types of elements. It frees the heap array if the elements did not fit
+    * inline, and the elements in the inline buffer otherwise. Inline arrays of elements
+    * that do not own memory are freed with the plain array free function instead.
+    * @param elementType Type of elements contained in the array
+    * @return Function definition of the inline array's free function
+    */
+  def inlineFunction(elementType: SimpleFieldType): FunctionDefinition = {
+    val basePrototype = prototype(elementType)
+    val inlineElementFree = elementFreeFunctionCall(elementType, inlineArrayParamName).getOrElse("")
+
+    FunctionDefinition(
+      name = inlineName(elementType),
+      documentation = FunctionDocumentation(
+        shortSummary = "Free inline array",
+        description = s"Cleans up all resources owned by the array and its elements using the allocator. The elements are in $inlineArrayParamName if $arrayParamName is NULL."
+      ),
+      prototype = basePrototype.copy(parameters = basePrototype.parameters.init ++ List(
+        FunctionParameter(paramType = MessageStruct.arrayFieldType(elementType), paramName = inlineArrayParamName),
+        Allocator.parameter
+      )),
+      body =
+        s"""${Constants.defaultIntCType} $indexVariableName;
+           |
+           |if( NULL != $arrayParamName )
+           |    {
+           |    ${name(elementType)}( $arrayParamName, $countParamName, ${Allocator.paramName} );
+           |    }
+           |else
+           |    {
+           |    for( $indexVariableName = 0; $indexVariableName < $countParamName; $indexVariableName++ )
+           |        {
+           |        $inlineElementFree
+           |        }
+           |    }""".stripMargin
+    )
+  }
+
+  /**
+    * @param elementType Type of elements contained in the array
+    * @return True if the elements of the array own memory that must be freed
+    */
+  def freesElements(elementType: SimpleFieldType): Boolean = {
+    elementFreeFunctionCall(elementType, arrayParamName).isDefined
+  }
+
   /**
     * Gets the name of the function to free arrays containing the specified type of
     * elements
@@ -39,11 +88,24 @@ object ArrayFieldFreeFunction {
       case ObjectType(objectName) => objectName + nameSuffix
       case BooleanType => "boolean" + nameSuffix
       case DynamicStringType => "string" + nameSuffix
-      case FixedStringType(_) => "string" + nameSuffix
+      case InternedStringType => "interned_string" + nameSuffix
+      case FixedStringType(_) | InlineStringType(_) => "string" + nameSuffix
+      case EnumType(enumName, _) => enumName + nameSuffix
       case NumberType => "number" + nameSuffix
+      case TimestampType => "timestamp" + nameSuffix
     }
   }
 
+  /**
+    * Gets the name of the function to free inline arrays containing the specified type
+    * of elements
+    * @param elementType Type of elements contained in the array
+    * @return Name of the inline array's free function
+    */
+  def inlineName(elementType: SimpleFieldType): String = {
+    name(elementType) + "_inline"
+  }
+
   /**
     * Gets the documentation for an array free function
     * @return Array free function documentation
@@ -51,7 +113,7 @@ object ArrayFieldFreeFunction {
   private def documentation: FunctionDocumentation = {
     FunctionDocumentation(
       shortSummary = "Free array",
-      description = "Cleans up all resources owned by the array and its elements."
+      description = "Cleans up all resources owned by the array and its elements using the allocator."
     )
   }
 
@@ -67,7 +129,8 @@ object ArrayFieldFreeFunction {
       returnType = Constants.voidCType,
       parameters = List(
         FunctionParameter(paramType = MessageStruct.arrayFieldType(elementType), paramName = arrayParamName),
-        FunctionParameter(paramType = Constants.defaultIntCType, paramName = countParamName)
+        FunctionParameter(paramType = Constants.defaultIntCType, paramName = countParamName),
+        Allocator.parameter
       )
     )
   }
@@ -78,7 +141,7 @@ object ArrayFieldFreeFunction {
     * @return String containing the body of the array free function
     */
   private def body(elementType: SimpleFieldType): String = {
-    elementFreeFunctionCall(elementType) match {
+    elementFreeFunctionCall(elementType, arrayParamName) match {
       case None => nonDynamicElementsFreeBody
       case Some(freeFunction) => dynamicElementsFreeBody(freeFunction)
     }
@@ -90,39 +153,54 @@ object ArrayFieldFreeFunction {
     * elements. If the array's elements are non-dynamic and do not
     * need to be freed, then this will return None
     * @param elementType Type of elements contained within the array
+    * @param array Name of the array variable
     * @return None if the array's elements are nt dynamically allocated,
     *         a string to free the element otherwise
     */
-  private def elementFreeFunctionCall(elementType: SimpleFieldType): Option[String] = {
+  private def elementFreeFunctionCall(elementType: SimpleFieldType, array: String): Option[String] = {
     elementType match {
-      case AliasedType(_, underlyingType) => elementFreeFunctionCall(underlyingType)
-      case ObjectType(objectName) => Some(objectElementFreeCall(objectName))
+      case AliasedType(_, underlyingType) => elementFreeFunctionCall(underlyingType, array)
+      case ObjectType(objectName) => Some(objectElementFreeCall(objectName, array))
       case BooleanType => None
-      case DynamicStringType => Some(stringElementFreeCall)
-      case FixedStringType(_) => Some(stringElementFreeCall)
+      case DynamicStringType => Some(stringElementFreeCall(array))
+      case InternedStringType => Some(internedStringElementFreeCall(array))
+      case FixedStringType(_) | InlineStringType(_) => Some(stringElementFreeCall(array))
       case NumberType => None
+      case TimestampType => None
+      case EnumType(_, _) => None
     }
   }
 
   /**
     * Gets the function call to free an element of a string array
+    * @param array Name of the array variable
     * @return String to free a string element of an array
     */
-  private def stringElementFreeCall: String = {
-    s"${Constants.defaultFreeFunction}( $arrayParamName[$indexVariableName] );"
+  private def stringElementFreeCall(array: String): String = {
+    s"${Allocator.free(s"$array[$indexVariableName]")};"
+  }
+
+  /**
+    * Gets the function call to release an element of an interned string array
+    * @param array Name of the array variable
+    * @return String to release an interned string element of an array
+    */
+  private def internedStringElementFreeCall(array: String): String = {
+    s"${Allocator.internFree(s"$array[$indexVariableName]")};"
   }
 
   /**
     * Gets the function call to free an element of an array of message
     * objects
     * @param objectName Name of the cDTO message object
+    * @param array Name of the array variable
     * @return String to free a message object that is an element of an array
     */
-  private def objectElementFreeCall(objectName: String): String = {
-    val functionName = MessageFreeFunction.name(objectName)
+  private def objectElementFreeCall(objectName: String, array: String): String = {
+    val functionName = MessageFreeFunction.exName(objectName)
 
     // Always pass object elements as pointers to their free functions
-    s"$functionName( &$arrayParamName[$indexVariableName] );"
+    s"$functionName( &$array[$indexVariableName], ${Allocator.paramName} );"
   }
 
   /**
@@ -132,7 +210,7 @@ object ArrayFieldFreeFunction {
     * @return Body of array free function with non-dynamic elements
     */
   private def nonDynamicElementsFreeBody: String = {
-    s"${Constants.defaultFreeFunction}( $arrayParamName );"
+    s"${Allocator.free(arrayParamName)};"
   }
 
   /**
@@ -150,6 +228,6 @@ object ArrayFieldFreeFunction {
       |    $elementFreeCall
       |    }
       |
-      |${Constants.defaultFreeFunction}( $arrayParamName );""".stripMargin
+      |${Allocator.free(arrayParamName)};""".stripMargin
   }
 }
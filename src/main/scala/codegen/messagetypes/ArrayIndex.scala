@@ -0,0 +1,440 @@
+package codegen.messagetypes
+
+import codegen.Constants
+import codegen.allocator.Allocator
+import codegen.functions._
+import codegen.types._
+import datamodel._
+
+/**
+  * Describes the lookup indexes of array fields declared with index=<key>. Such a field has a
+  * <field>_index member holding an open-addressing hash table over the key strings of its
+  * elements. The parsers build the indexes of a message once its fields are parsed, and
+  * <message>_<field>_find looks elements up by key with a single probe sequence instead of
+  * comparing the key against every element.
+  */
+object ArrayIndex {
+
+  /**
+    * Name of the type of the index members
+    */
+  val typeName: String = "cdto_index"
+
+  private val paramName = "obj"
+  private val keyParamName = "key"
+  private val hashName = "cdto_index_hash"
+
+  /**
+    * Type definition of the index to place in the protocol's type header. Each slot holds the
+    * position of an element plus one, or 0 if the slot is empty. The definition is shared by
+    * all protocols so it is protected against multiple definitions.
+    */
+  val typeDefinition: String =
+    s"""#ifndef CDTO_INDEX_DEFINED
+       |#define CDTO_INDEX_DEFINED
+       |
+       |typedef struct
+       |    {
+       |    unsigned int*    slots;
+       |    size_t           cap;
+       |    } $typeName;
+       |
+       |#endif /* #ifndef CDTO_INDEX_DEFINED */""".stripMargin
+
+  /**
+    * @param fieldName Name of an indexed array field
+    * @return Name of the struct member holding the field's index
+    */
+  def memberName(fieldName: String): String = {
+    s"${fieldName}_index"
+  }
+
+  /**
+    * @param message cDTO message
+    * @return The message's indexed array fields
+    */
+  def indexedFields(message: Message): Seq[Field] = {
+    message.fields.filter(_.index.isDefined)
+  }
+
+  /**
+    * @param message cDTO message
+    * @return True if the message has indexed array fields
+    */
+  def hasIndexes(message: Message): Boolean = {
+    indexedFields(message).nonEmpty
+  }
+
+  /**
+    * @param protocol Message protocol
+    * @return True if any message of the protocol has indexed array fields
+    */
+  def isUsed(protocol: Protocol): Boolean = {
+    protocol.messages.exists(hasIndexes)
+  }
+
+  /**
+    * Gets the struct members holding the indexes of a message
+    * @param message cDTO message
+    * @return The index members, empty if the message has no indexed fields
+    */
+  def structFields(message: Message): Seq[StructField] = {
+    indexedFields(message).map(field => SimpleStructField(memberName(field.name), typeName))
+  }
+
+  /**
+    * Gets the calls to free the index tables of a message
+    * @param message cDTO message
+    * @param obj Name of the message pointer
+    * @return Calls to free the index tables, empty if the message has no indexed fields
+    */
+  def freeCalls(message: Message, obj: String): Seq[String] = {
+    indexedFields(message).map(field => s"${Allocator.free(s"$obj->${memberName(field.name)}.slots")};")
+  }
+
+  /**
+    * @param messageName Name of message
+    * @return Name of the function to build the indexes of a message
+    */
+  def name(messageName: String): String = {
+    s"${messageName}_index"
+  }
+
+  /**
+    * @param messageName Name of message
+    * @return Name of the function to build the indexes of a message with an allocator
+    */
+  def exName(messageName: String): String = {
+    name(messageName) + Allocator.functionNameSuffix
+  }
+
+  /**
+    * @param messageName Name of message
+    * @param fieldName Name of an indexed array field
+    * @return Name of the function to look up an element of the field by key
+    */
+  def findName(messageName: String, fieldName: String): String = {
+    s"${messageName}_${fieldName}_find"
+  }
+
+  /**
+    * Gets the call that builds the indexes of a parsed message, to place in parsers
+    * @param messageName Name of message
+    * @param obj C expression of the message pointer
+    * @return Call that is 1 if the indexes were built, 0 otherwise
+    */
+  def buildCall(messageName: String, obj: String): String = {
+    s"${exName(messageName)}( $obj, ${Allocator.paramName} )"
+  }
+
+  /**
+    * Gets the functions to build and search the indexes of a message
+    * @param message cDTO message
+    * @param messagesByName All messages of the protocol, by name
+    * @return The index and find functions, empty if the message has no indexed fields
+    */
+  def functions(message: Message, messagesByName: Map[String, Message]): Seq[FunctionDefinition] = {
+    if(hasIndexes(message)) {
+      val fieldFunctions = indexedFields(message).flatMap(field => {
+        val key = IndexKey(message, field, messagesByName)
+        List(buildFunction(message, key), findFunction(message, key))
+      })
+
+      List(indexFunction(message), indexFunctionWithAllocator(message)) ++ fieldFunctions
+    } else {
+      Nil
+    }
+  }
+
+  /**
+    * Static function hashing the keys with 32-bit FNV-1a
+    */
+  val hashFunction: FunctionDefinition = FunctionDefinition(
+    name = hashName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Hash index key",
+      description = "Gets the FNV-1a hash of the NUL-terminated key."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = "size_t",
+      parameters = List(FunctionParameter("char const*", keyParamName))
+    ),
+    body =
+      s"""unsigned long hash;
+         |
+         |hash = 2166136261UL;
+         |for( ; '\\0' != *$keyParamName; $keyParamName++ )
+         |    {
+         |    hash = ( ( hash ^ ( unsigned char )*$keyParamName ) * 16777619UL ) & 0xFFFFFFFFUL;
+         |    }
+         |
+         |return ( size_t )hash;""".stripMargin
+  )
+
+  /**
+    * The key of an indexed array field
+    * @param field The indexed field
+    * @param elements C expression of the field's elements
+    * @param count C expression of the number of elements
+    * @param elementName Name of the element message
+    * @param keyField The key field of the element message
+    */
+  private case class IndexKey(field: Field, elements: String, count: String, elementName: String, keyField: Field) {
+
+    /**
+      * @param element C expression of an element
+      * @return C expression of the element's key string
+      */
+    def value(element: String): String = {
+      val member = s"$element.${keyField.name}"
+
+      keyField.fieldType match {
+        case InlineStringType(_) => InlineString.value(member)
+        case AliasedType(_, _) => s"( char const* )$member"
+        case _ => member
+      }
+    }
+
+    /**
+      * @return True if the key of an element may be NULL
+      */
+    def isNullable: Boolean = {
+      keyField.fieldType match {
+        case DynamicStringType | InternedStringType | AliasedType(_, DynamicStringType | InternedStringType) => true
+        case _ => false
+      }
+    }
+  }
+
+  private object IndexKey {
+    def apply(message: Message, field: Field, messagesByName: Map[String, Message]): IndexKey = {
+      val member = s"$paramName->${field.name}"
+      val count = s"$paramName->${MessageStruct.arrayCountFieldName(field.name)}"
+
+      val (elements, elementName) = field.fieldType match {
+        case ArrayType(ObjectType(objectName)) => (member, objectName)
+        case InlineArrayType(ObjectType(objectName), _) => (InlineArray.elements(member), objectName)
+        case _ => throw new IllegalArgumentException(s"${message.name}.${field.name} cannot be indexed")
+      }
+
+      val keyField = messagesByName(elementName).fields.find(_.name == field.index.get).get
+
+      IndexKey(field, elements, count, elementName, keyField)
+    }
+  }
+
+  /**
+    * @param messageName Name of message
+    * @param fieldName Name of an indexed array field
+    * @return Name of the static function to build the index of the field
+    */
+  private def buildName(messageName: String, fieldName: String): String = {
+    s"${messageName}_${fieldName}_index_build"
+  }
+
+  /**
+    * Creates the function to build the indexes of a message
+    * @param message cDTO message
+    * @return Definition of the message's index function
+    */
+  private def indexFunction(message: Message): FunctionDefinition = {
+    FunctionDefinition(
+      name = name(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Index ${message.name}",
+        description = s"Rebuilds the lookup indexes of the provided ${message.name}. The parsers build them, so this is only needed after changing an indexed field. Returns 1 if the indexes were built, 0 if out of memory."
+      ),
+      prototype = indexPrototype(message),
+      body = s"return ${exName(message.name)}( $paramName, ${Allocator.defaultAllocator} );"
+    )
+  }
+
+  /**
+    * Creates the function to build the indexes of a message with an allocator
+    * @param message cDTO message
+    * @return Definition of the message's index function with an allocator
+    */
+  private def indexFunctionWithAllocator(message: Message): FunctionDefinition = {
+    val builds = indexedFields(message).map(field => s"${buildName(message.name, field.name)}( $paramName, ${Allocator.paramName} )")
+
+    FunctionDefinition(
+      name = exName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Index ${message.name} with an allocator",
+        description = s"Rebuilds the lookup indexes of the provided ${message.name} using the allocator it was created with. Returns 1 if the indexes were built, 0 if out of memory."
+      ),
+      prototype = {
+        val basePrototype = indexPrototype(message)
+        basePrototype.copy(parameters = basePrototype.parameters :+ Allocator.parameter)
+      },
+      body = s"return ${builds.mkString(" &&\n       ")};"
+    )
+  }
+
+  /**
+    * @param message cDTO message
+    * @return Prototype shared by the index functions
+    */
+  private def indexPrototype(message: Message): FunctionPrototype = {
+    FunctionPrototype(
+      isStatic = false,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(FunctionParameter(paramType = s"${MessageStruct.structName(message)}*", paramName = paramName))
+    )
+  }
+
+  /**
+    * Creates the static function that rebuilds the index of a single field
+    * @param message cDTO message
+    * @param key Key of the indexed field
+    * @return Definition of the field's index build function
+    */
+  private def buildFunction(message: Message, key: IndexKey): FunctionDefinition = {
+    val member = s"$paramName->${memberName(key.field.name)}"
+
+    // Elements with equal keys keep the first one, which a linear search would find
+    val insert =
+      s"""slot = $hashName( $keyParamName ) & ( index.cap - 1 );
+         |while( ( 0 != index.slots[slot] ) && ( 0 != strcmp( ${key.value(s"${key.elements}[index.slots[slot] - 1]")}, $keyParamName ) ) )
+         |    {
+         |    slot = ( slot + 1 ) & ( index.cap - 1 );
+         |    }
+         |
+         |if( 0 == index.slots[slot] )
+         |    {
+         |    index.slots[slot] = ( unsigned int )i + 1;
+         |    }""".stripMargin
+
+    // Elements without a key cannot be found, so they are left out of the index
+    val keyInsert = if(key.isNullable) {
+      s"""if( NULL != $keyParamName )
+         |    {
+         |    ${indent(insert)}
+         |    }""".stripMargin
+    } else {
+      insert
+    }
+
+    FunctionDefinition(
+      name = buildName(message.name, key.field.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Index ${message.name} ${key.field.name}",
+        description = s"Replaces the index of the ${key.field.name} field by the ${key.keyField.name} of its current elements. Returns 1 if the index was built, 0 if out of memory."
+      ),
+      prototype = FunctionPrototype(
+        isStatic = true,
+        returnType = Constants.defaultBooleanCType,
+        parameters = List(
+          FunctionParameter(paramType = s"${MessageStruct.structName(message)}*", paramName = paramName),
+          Allocator.parameter
+        )
+      ),
+      body =
+        s"""${Constants.defaultBooleanCType} success;
+           |$typeName index;
+           |size_t slot;
+           |char const* $keyParamName;
+           |${Constants.defaultIntCType} i;
+           |
+           |${Allocator.free(s"$member.slots")};
+           |$member.slots = NULL;
+           |$member.cap = 0;
+           |
+           |if( ${key.count} <= 0 )
+           |    {
+           |    return 1;
+           |    }
+           |
+           |// Keep the table at most half full so that lookups only probe a few slots
+           |index.cap = 8;
+           |while( index.cap < 2 * ( size_t )${key.count} )
+           |    {
+           |    index.cap *= 2;
+           |    }
+           |
+           |index.slots = ${Allocator.calloc("index.cap", "sizeof( *index.slots )")};
+           |success = ( NULL != index.slots );
+           |
+           |for( i = 0; success && ( i < ${key.count} ); i++ )
+           |    {
+           |    $keyParamName = ${key.value(s"${key.elements}[i]")};
+           |
+           |    ${indent(keyInsert)}
+           |    }
+           |
+           |if( success )
+           |    {
+           |    $member = index;
+           |    }
+           |
+           |return success;""".stripMargin
+    )
+  }
+
+  /**
+    * Creates the function to look up an element of an indexed field by key
+    * @param message cDTO message
+    * @param key Key of the indexed field
+    * @return Definition of the field's find function
+    */
+  private def findFunction(message: Message, key: IndexKey): FunctionDefinition = {
+    val member = s"$paramName->${memberName(key.field.name)}"
+    val keyValue = key.value(s"${key.elements}[i]")
+    val linearMatch = if(key.isNullable) s"( NULL != $keyValue ) && ( 0 == strcmp( $keyValue, $keyParamName ) )" else s"0 == strcmp( $keyValue, $keyParamName )"
+
+    FunctionDefinition(
+      name = findName(message.name, key.field.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Find ${message.name} ${key.field.name} by ${key.keyField.name}",
+        description =
+          s"Gets the first element of the ${key.field.name} field of the provided ${message.name} whose ${key.keyField.name} is $keyParamName, or NULL if there is none. " +
+          s"Parsed messages are searched through their index. Other messages are searched linearly until ${name(message.name)} is called."
+      ),
+      prototype = FunctionPrototype(
+        isStatic = false,
+        returnType = s"${key.elementName} const*",
+        parameters = List(
+          FunctionParameter(paramType = s"${MessageStruct.structName(message)} const*", paramName = paramName),
+          FunctionParameter(paramType = "char const*", paramName = keyParamName)
+        )
+      ),
+      body =
+        s"""size_t slot;
+           |${Constants.defaultIntCType} i;
+           |
+           |if( NULL != $member.slots )
+           |    {
+           |    for( slot = $hashName( $keyParamName ) & ( $member.cap - 1 ); 0 != $member.slots[slot]; slot = ( slot + 1 ) & ( $member.cap - 1 ) )
+           |        {
+           |        i = ( ${Constants.defaultIntCType} )$member.slots[slot] - 1;
+           |        if( 0 == strcmp( $keyValue, $keyParamName ) )
+           |            {
+           |            return &${key.elements}[i];
+           |            }
+           |        }
+           |
+           |    return NULL;
+           |    }
+           |
+           |for( i = 0; i < ${key.count}; i++ )
+           |    {
+           |    if( $linearMatch )
+           |        {
+           |        return &${key.elements}[i];
+           |        }
+           |    }
+           |
+           |return NULL;""".stripMargin
+    )
+  }
+
+  /**
+    * Indents all but the first line of a snippet by one level
+    * @param snippet Snippet of code
+    * @return Indented snippet
+    */
+  private def indent(snippet: String): String = {
+    snippet.replace("\n", "\n    ")
+  }
+}
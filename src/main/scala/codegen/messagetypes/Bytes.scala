@@ -0,0 +1,72 @@
+package codegen.messagetypes
+
+import codegen.Constants
+import codegen.types._
+import datamodel._
+
+/**
+  * Describes how Bytes fields are stored. Such a field is a struct holding a pointer to
+  * the binary data on the heap, which is NULL if the data is empty, and the length of
+  * the data.
+  */
+object Bytes {
+
+  /**
+    * Name of the type of Bytes fields
+    */
+  val typeName: String = "cdto_bytes"
+
+  /**
+    * Header that defines the type of the data
+    */
+  val header: String = Constants.stdintHeader
+
+  /**
+    * Definition of the type to place in the protocol's type header. The type is shared by
+    * all protocols so it is protected against multiple definitions.
+    */
+  val typeDefinition: String =
+    s"""#ifndef CDTO_BYTES_DEFINED
+       |#define CDTO_BYTES_DEFINED
+       |
+       |typedef struct
+       |    {
+       |    uint8_t*    data;
+       |    size_t      len;
+       |    } $typeName;
+       |
+       |#endif /* #ifndef CDTO_BYTES_DEFINED */""".stripMargin
+
+  /**
+    * @param member C expression of the field's struct member, e.g. obj->avatar
+    * @return C expression of the field's data
+    */
+  def data(member: String): String = {
+    s"$member.data"
+  }
+
+  /**
+    * @param member C expression of the field's struct member, e.g. obj->avatar
+    * @return C expression of the length of the field's data
+    */
+  def length(member: String): String = {
+    s"$member.len"
+  }
+
+  /**
+    * Gets the struct member of a Bytes field
+    * @param fieldName Name of the field
+    * @return The field's struct member
+    */
+  def structField(fieldName: String): StructField = {
+    SimpleStructField(fieldName, typeName)
+  }
+
+  /**
+    * @param messages Messages
+    * @return True if any field of the messages holds bytes
+    */
+  def isUsed(messages: Seq[Message]): Boolean = {
+    messages.exists(_.fields.exists(_.fieldType == BytesType))
+  }
+}
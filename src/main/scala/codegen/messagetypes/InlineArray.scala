@@ -0,0 +1,75 @@
+package codegen.messagetypes
+
+import codegen.Constants
+import codegen.types._
+import datamodel._
+
+/**
+  * Describes how array fields declared with inline=N are stored. Besides the usual array
+  * pointer and count, such a field has a buffer named <field>_inline that holds up to N
+  * elements. The pointer is NULL while the elements fit into the buffer and points to a
+  * heap array otherwise, so it never points into the struct and messages can still be
+  * copied and moved bitwise.
+  */
+object InlineArray {
+
+  /**
+    * Name of the macro that gets the elements of an inline array field
+    */
+  val elementsMacro: String = "CDTO_INLINE_ARRAY"
+
+  /**
+    * Definition of the elements macro to place in the protocol's type header. The macro
+    * is shared by all protocols so it is protected against multiple definitions.
+    */
+  val macroDefinition: String =
+    s"""#ifndef $elementsMacro
+       |// Gets the elements of an inline array field, e.g. $elementsMacro( issue.labels ). The
+       |// elements are stored in the field's buffer unless there were too many to fit.
+       |#define $elementsMacro( _member ) ( ( NULL != ( _member ) ) ? ( _member ) : ( _member##_inline ) )
+       |#endif""".stripMargin
+
+  /**
+    * @param fieldName Name of the inline array field
+    * @return Name of the struct member holding the field's inline elements
+    */
+  def bufferName(fieldName: String): String = {
+    s"${fieldName}_inline"
+  }
+
+  /**
+    * @param member C expression of the field's array pointer, e.g. obj->labels
+    * @return C expression of the field's elements
+    */
+  def elements(member: String): String = {
+    s"$elementsMacro( $member )"
+  }
+
+  /**
+    * Gets the struct members of an inline array field
+    * @param fieldName Name of the field
+    * @param elementType Type of the array's elements
+    * @param capacity Number of elements stored inline
+    * @return The field's array pointer, count and inline buffer
+    */
+  def structFields(fieldName: String, elementType: SimpleFieldType, capacity: Int): Seq[StructField] = {
+    val pointerType = MessageStruct.arrayFieldType(elementType)
+
+    List(
+      SimpleStructField(fieldName, pointerType),
+      SimpleStructField(MessageStruct.arrayCountFieldName(fieldName), Constants.defaultIntCType),
+      FixedArrayStructField(bufferName(fieldName), pointerType.stripSuffix("*"), capacity)
+    )
+  }
+
+  /**
+    * @param protocol Message protocol
+    * @return True if any field of the protocol is an inline array
+    */
+  def isUsed(protocol: Protocol): Boolean = {
+    protocol.messages.exists(_.fields.exists(_.fieldType match {
+      case InlineArrayType(_, _) => true
+      case _ => false
+    }))
+  }
+}
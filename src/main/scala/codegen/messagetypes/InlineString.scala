@@ -0,0 +1,71 @@
+package codegen.messagetypes
+
+import codegen.Constants
+import codegen.types._
+import datamodel._
+
+/**
+  * Describes how fields declared with inline=N are stored. Such a field is a pair of
+  * struct members: a buffer named <field>_inline that holds values of up to N characters,
+  * and a pointer named after the field that holds a heap copy of longer values and is
+  * NULL otherwise. The pointer never points into the struct, so messages can still be
+  * copied and moved bitwise.
+  */
+object InlineString {
+
+  /**
+    * Name of the macro that gets the value of an inline string field
+    */
+  val valueMacro: String = "CDTO_INLINE_STRING"
+
+  /**
+    * Definition of the value macro to place in the protocol's type header. The macro is
+    * shared by all protocols so it is protected against multiple definitions.
+    */
+  val macroDefinition: String =
+    s"""#ifndef $valueMacro
+       |// Gets the value of an inline string field, e.g. $valueMacro( issue.title ). The value
+       |// is stored in the field's buffer unless it was too long to fit.
+       |#define $valueMacro( _member ) ( ( NULL != ( _member ) ) ? ( _member ) : ( _member##_inline ) )
+       |#endif""".stripMargin
+
+  /**
+    * @param fieldName Name of the inline string field
+    * @return Name of the struct member holding the field's inline buffer
+    */
+  def bufferName(fieldName: String): String = {
+    s"${fieldName}_inline"
+  }
+
+  /**
+    * @param member C expression of the field's struct member, e.g. obj->title
+    * @return C expression of the field's value
+    */
+  def value(member: String): String = {
+    s"$valueMacro( $member )"
+  }
+
+  /**
+    * Gets the struct members of an inline string field
+    * @param fieldName Name of the field
+    * @param capacity Length of the longest value stored inline
+    * @return The field's heap pointer and inline buffer
+    */
+  def structFields(fieldName: String, capacity: Int): Seq[StructField] = {
+    List(
+      SimpleStructField(fieldName, Constants.defaultCharacterCType + "*"),
+      FixedArrayStructField(bufferName(fieldName), Constants.defaultCharacterCType, capacity + 1) // include room for null-terminator
+    )
+  }
+
+  /**
+    * @param protocol Message protocol
+    * @return True if any field of the protocol stores its strings inline
+    */
+  def isUsed(protocol: Protocol): Boolean = {
+    protocol.messages.exists(_.fields.exists(_.fieldType match {
+      case InlineStringType(_) => true
+      case _ => false
+    }))
+  }
+}
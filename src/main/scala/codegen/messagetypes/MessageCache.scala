@@ -0,0 +1,253 @@
+package codegen.messagetypes
+
+import codegen.Constants
+import codegen.allocator.Allocator
+import codegen.functions._
+import codegen.types._
+import datamodel._
+
+/**
+  * Describes how messages declared with cache=true keep their serialized JSON. Such a
+  * message has a json_cache member holding its last compact JSON and a <field>_json_cache
+  * member per array field holding the JSON of the array alone. The caches are filled by
+  * the JSON serializers and invalidated by the mark dirty functions and the field setters,
+  * so changing a field only re-serializes that field's JSON.
+  */
+object MessageCache {
+
+  /**
+    * Name of the type holding a cached JSON string
+    */
+  val typeName: String = "cdto_json_cache"
+
+  /**
+    * Name of the struct member holding the JSON of the whole message
+    */
+  val memberName: String = "json_cache"
+
+  private val paramName = "obj"
+  private val valueParamName = "value"
+
+  /**
+    * Type definition of the cache to place in the protocol's type header. The definition is
+    * shared by all protocols so it is protected against multiple definitions.
+    */
+  val typeDefinition: String =
+    s"""#ifndef CDTO_JSON_CACHE_DEFINED
+       |#define CDTO_JSON_CACHE_DEFINED
+       |
+       |typedef struct
+       |    {
+       |    char*                     json;
+       |    size_t                    json_len;
+       |    ${Allocator.typeName} const*     allocator;
+       |    int                       valid;
+       |    } $typeName;
+       |
+       |#endif /* #ifndef CDTO_JSON_CACHE_DEFINED */""".stripMargin
+
+  /**
+    * @param fieldName Name of an array field
+    * @return Name of the struct member holding the JSON of the array field
+    */
+  def fragmentName(fieldName: String): String = {
+    s"${fieldName}_$memberName"
+  }
+
+  /**
+    * @param fieldType Type of a field of a cached message
+    * @return True if the JSON of the field is cached on its own
+    */
+  def hasFragment(fieldType: FieldType): Boolean = {
+    fieldType match {
+      case ArrayType(_) | InlineArrayType(_, _) => true
+      case _ => false
+    }
+  }
+
+  /**
+    * @param message cDTO message
+    * @return Names of the struct members holding the message's array field JSON
+    */
+  def fragmentNames(message: Message): Seq[String] = {
+    message.fields.filter(field => hasFragment(field.fieldType)).map(field => fragmentName(field.name))
+  }
+
+  /**
+    * Gets the struct members holding the caches of a message
+    * @param message cDTO message
+    * @return The cache members, empty if the message is not cached
+    */
+  def structFields(message: Message): Seq[StructField] = {
+    if(message.cached) {
+      (fragmentNames(message) :+ memberName).map(SimpleStructField(_, typeName))
+    } else {
+      Nil
+    }
+  }
+
+  /**
+    * @param protocol Message protocol
+    * @return True if any message of the protocol is cached
+    */
+  def isUsed(protocol: Protocol): Boolean = {
+    protocol.messages.exists(_.cached)
+  }
+
+  /**
+    * Gets the calls to free the cache buffers of a message, each through the allocator
+    * it was allocated with
+    * @param message cDTO message
+    * @param obj Name of the message pointer
+    * @return Calls to free the cache buffers, empty if the message is not cached
+    */
+  def freeCalls(message: Message, obj: String): Seq[String] = {
+    if(message.cached) {
+      (fragmentNames(message) :+ memberName).map(cache => s"${Allocator.freeFunction.name}( $obj->$cache.allocator, $obj->$cache.json );")
+    } else {
+      Nil
+    }
+  }
+
+  /**
+    * Gets the functions to invalidate the caches of a message
+    * @param message cDTO message
+    * @return The mark dirty and setter functions, empty if the message is not cached
+    */
+  def functions(message: Message): Seq[FunctionDefinition] = {
+    if(message.cached) {
+      val fieldFunctions = message.fields.flatMap(field =>
+        fieldMarkDirtyFunction(message, field) +: setterFunction(message, field).toList
+      )
+
+      markDirtyFunction(message) +: fieldFunctions
+    } else {
+      Nil
+    }
+  }
+
+  /**
+    * @param messageName Name of message
+    * @return Name of the function to invalidate all caches of the message
+    */
+  def markDirtyName(messageName: String): String = {
+    s"${messageName}_mark_dirty"
+  }
+
+  /**
+    * @param messageName Name of message
+    * @param fieldName Name of field
+    * @return Name of the function to invalidate the caches of a field
+    */
+  def fieldMarkDirtyName(messageName: String, fieldName: String): String = {
+    s"${messageName}_${fieldName}_mark_dirty"
+  }
+
+  /**
+    * @param messageName Name of message
+    * @param fieldName Name of field
+    * @return Name of the function to set a scalar field
+    */
+  def setterName(messageName: String, fieldName: String): String = {
+    s"${messageName}_${fieldName}_set"
+  }
+
+  /**
+    * Creates the function to invalidate all caches of a message
+    * @param message cDTO message
+    * @return Definition of the message's mark dirty function
+    */
+  def markDirtyFunction(message: Message): FunctionDefinition = {
+    val caches = fragmentNames(message) :+ memberName
+
+    FunctionDefinition(
+      name = markDirtyName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Invalidate ${message.name} JSON",
+        description = s"Discards the cached JSON of the provided ${message.name}, so that all of its fields are serialized again. Nested messages keep their own caches."
+      ),
+      prototype = prototype(message),
+      body = caches.map(cache => s"$paramName->$cache.valid = 0;").mkString("\n")
+    )
+  }
+
+  /**
+    * Creates the function to invalidate the caches holding the JSON of a field
+    * @param message cDTO message
+    * @param field Field of the message
+    * @return Definition of the field's mark dirty function
+    */
+  def fieldMarkDirtyFunction(message: Message, field: Field): FunctionDefinition = {
+    val fragment = if(hasFragment(field.fieldType)) List(fragmentName(field.name)) else Nil
+    val caches = fragment :+ memberName
+
+    FunctionDefinition(
+      name = fieldMarkDirtyName(message.name, field.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Invalidate ${message.name} ${field.name} JSON",
+        description = s"Discards the cached JSON of the provided ${message.name} after its ${field.name} field was changed directly."
+      ),
+      prototype = prototype(message),
+      body = caches.map(cache => s"$paramName->$cache.valid = 0;").mkString("\n")
+    )
+  }
+
+  /**
+    * Creates the function to set a scalar field and invalidate the message's JSON. Fields
+    * that own memory are changed directly and marked dirty instead.
+    * @param message cDTO message
+    * @param field Field of the message
+    * @return Definition of the field's setter, None if the field is not a scalar
+    */
+  def setterFunction(message: Message, field: Field): Option[FunctionDefinition] = {
+    scalarType(field.fieldType).map(valueType =>
+      FunctionDefinition(
+        name = setterName(message.name, field.name),
+        documentation = FunctionDocumentation(
+          shortSummary = s"Set ${message.name} ${field.name}",
+          description = s"Sets the ${field.name} field of the provided ${message.name} and discards its cached JSON."
+        ),
+        prototype = FunctionPrototype(
+          isStatic = false,
+          returnType = Constants.voidCType,
+          parameters = List(
+            FunctionParameter(paramType = s"${MessageStruct.structName(message)}*", paramName = paramName),
+            FunctionParameter(paramType = valueType, paramName = valueParamName)
+          )
+        ),
+        body =
+          s"""$paramName->${field.name} = $valueParamName;
+             |$paramName->$memberName.valid = 0;""".stripMargin
+      )
+    )
+  }
+
+  /**
+    * @param message cDTO message
+    * @return Prototype shared by the mark dirty functions
+    */
+  private def prototype(message: Message): FunctionPrototype = {
+    FunctionPrototype(
+      isStatic = false,
+      returnType = Constants.voidCType,
+      parameters = List(
+        FunctionParameter(paramType = s"${MessageStruct.structName(message)}*", paramName = paramName)
+      )
+    )
+  }
+
+  /**
+    * @param fieldType Type of field
+    * @return C type of the field if it is a scalar that can be set by value
+    */
+  private def scalarType(fieldType: FieldType): Option[String] = {
+    fieldType match {
+      case AliasedType(alias, BooleanType | NumberType | TimestampType) => Some(alias)
+      case BooleanType => Some(Constants.defaultBooleanCType)
+      case NumberType => Some(Constants.defaultNumberCType)
+      case TimestampType => Some(Constants.defaultTimestampCType)
+      case EnumType(enumName, _) => Some(enumName)
+      case _ => None
+    }
+  }
+}
@@ -0,0 +1,46 @@
+package codegen.messagetypes
+
+import codegen.types.EnumDefinition
+import datamodel._
+
+object MessageEnum {
+
+  /**
+    * Generates a C enum definition based on the provided enum field type
+    * @param enumType Enum type of a message field
+    * @return Definition of the C enum corresponding to the enum type
+    */
+  def apply(enumType: EnumType): EnumDefinition = {
+    EnumDefinition(
+      name = enumType.name,
+      constants = enumType.values.map(constantName(enumType, _))
+    )
+  }
+
+  /**
+    * Gets the name of the C constant of an enum value, e.g. ISSUE_STATE_OPEN for the
+    * value open of the issue_state enum
+    * @param enumType Enum type
+    * @param value Value of the enum
+    * @return Name of the value's C constant
+    */
+  def constantName(enumType: EnumType, value: String): String = {
+    s"${enumType.name}_$value".toUpperCase
+  }
+
+  /**
+    * Gets all enum types used by the fields of the given messages, including enums
+    * used as array elements
+    * @param messages Messages
+    * @return Enum types used by the messages, without duplicates
+    */
+  def enumTypes(messages: Seq[Message]): Seq[EnumType] = {
+    val enumTypes = messages.flatMap(_.fields).map(_.fieldType).collect({
+      case enumType: EnumType => enumType
+      case ArrayType(enumType: EnumType) => enumType
+      case InlineArrayType(enumType: EnumType, _) => enumType
+    })
+
+    enumTypes.distinct
+  }
+}
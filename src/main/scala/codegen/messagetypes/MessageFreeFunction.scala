@@ -1,6 +1,7 @@
 package codegen.messagetypes
 
 import codegen.Constants
+import codegen.allocator.Allocator
 import codegen.functions._
 import datamodel._
 
@@ -23,6 +24,22 @@ object MessageFreeFunction {
     )
   }
 
+  /**
+    * Creates the definition of the function to free all memory owned
+    * by a cDTO message struct through the allocator that was used to
+    * create it
+    * @param message cDTO message
+    * @return Definition of the message free function with an allocator
+    */
+  def withAllocator(message: Message): FunctionDefinition = {
+    FunctionDefinition(
+      name = exName(message.name),
+      documentation = exDocumentation(message),
+      prototype = exPrototype(message),
+      body = exBody(message)
+    )
+  }
+
   /**
     * Gets the name of the function to free a message struct. All message
     * free functions take pointer parameters
@@ -33,6 +50,15 @@ object MessageFreeFunction {
     s"${messageName}_free"
   }
 
+  /**
+    * Gets the name of the function to free a message struct with an allocator
+    * @param messageName Name of message
+    * @return Name of the message struct's free function with an allocator
+    */
+  def exName(messageName: String): String = {
+    name(messageName) + Allocator.functionNameSuffix
+  }
+
   /**
     * Gets the documentation for a message free function
     * @param message cDTO message
@@ -45,6 +71,18 @@ object MessageFreeFunction {
     )
   }
 
+  /**
+    * Gets the documentation for a message free function with an allocator
+    * @param message cDTO message
+    * @return Message free function documentation
+    */
+  private def exDocumentation(message: Message): FunctionDocumentation = {
+    FunctionDocumentation(
+      shortSummary = s"Free ${message.name} with an allocator",
+      description = s"Cleans up all resources owned by the provided ${message.name} using the allocator it was created with."
+    )
+  }
+
   /**
     * Gets the prototype for the message free function
     * @param message cDTO message
@@ -61,17 +99,41 @@ object MessageFreeFunction {
   }
 
   /**
-    * Gets the body of a message free function
+    * Gets the prototype for the message free function with an allocator
+    * @param message cDTO message
+    * @return Message free function prototype
+    */
+  private def exPrototype(message: Message): FunctionPrototype = {
+    val basePrototype = prototype(message)
+
+    basePrototype.copy(parameters = basePrototype.parameters :+ Allocator.parameter)
+  }
+
+  /**
+    * Gets the body of a message free function. This frees the message with the
+    * C standard library allocator.
     * @param message cDTO message
     * @return String containing the body of a message free function
     */
   private def body(message: Message): String = {
+    s"${exName(message.name)}( $paramName, ${Allocator.defaultAllocator} );"
+  }
+
+  /**
+    * Gets the body of a message free function with an allocator
+    * @param message cDTO message
+    * @return String containing the body of a message free function
+    */
+  private def exBody(message: Message): String = {
     val fieldFreeCalls = for {
       field <- message.fields
       freeCall <- fieldFreeFunctionCall(message.name, field.name, field.fieldType)
     } yield freeCall
 
-    val allFieldFreeCalls = fieldFreeCalls.mkString("\n")
+    val cacheFreeCalls = MessageCache.freeCalls(message, paramName)
+    val indexFreeCalls = ArrayIndex.freeCalls(message, paramName)
+    val allFreeCalls = fieldFreeCalls ++ cacheFreeCalls ++ indexFreeCalls
+    val allFieldFreeCalls = allFreeCalls.mkString("\n")
 
     // After freeing all of the message's fields, we want to call the message's
     // init function so its memory is zeroed out. This will make it safe to
@@ -81,7 +143,7 @@ object MessageFreeFunction {
 
     // Add a line blank between the field free calls and the message initialization
     // call for better readability
-    val spacing = if(fieldFreeCalls.isEmpty) "" else "\n\n"
+    val spacing = if(allFreeCalls.isEmpty) "" else "\n\n"
 
     s"$allFieldFreeCalls$spacing$initCall"
   }
@@ -98,12 +160,18 @@ object MessageFreeFunction {
   private def fieldFreeFunctionCall(messageName: String, fieldName: String, fieldType: FieldType): Option[String] = {
     fieldType match {
       case ArrayType(elementType) => Some(arrayFreeFunctionCall(fieldName, elementType))
+      case InlineArrayType(elementType, _) => Some(inlineArrayFreeFunctionCall(fieldName, elementType))
+      case BytesType => Some(dynamicStringFreeFunctionCall(Bytes.data(fieldName))) // the data is freed like a string
       case AliasedType(_, underlyingType) => fieldFreeFunctionCall(messageName, fieldName, underlyingType)
       case ObjectType(objectName) => Some(objectFreeFunctionName(objectName, fieldName))
       case BooleanType => None
       case DynamicStringType => Some(dynamicStringFreeFunctionCall(fieldName))
+      case InlineStringType(_) => Some(dynamicStringFreeFunctionCall(fieldName)) // only long values are on the heap
+      case InternedStringType => Some(internedStringFreeFunctionCall(fieldName))
       case FixedStringType(_) => None
       case NumberType => None
+      case TimestampType => None
+      case EnumType(_, _) => None
     }
   }
 
@@ -117,7 +185,26 @@ object MessageFreeFunction {
     val functionName = ArrayFieldFreeFunction.name(elementType)
     val countField = MessageStruct.arrayCountFieldName(arrayFieldName)
 
-    s"$functionName( $paramName->$arrayFieldName, $paramName->$countField );"
+    s"$functionName( $paramName->$arrayFieldName, $paramName->$countField, ${Allocator.paramName} );"
+  }
+
+  /**
+    * Gets the string to free an inline array field. Without elements to free, only the
+    * heap array needs to be freed, which the plain array free function does.
+    * @param arrayFieldName Name of the array field
+    * @param elementType Type of elements contained in the array
+    * @return String to free the inline array field
+    */
+  private def inlineArrayFreeFunctionCall(arrayFieldName: String, elementType: SimpleFieldType): String = {
+    if(ArrayFieldFreeFunction.freesElements(elementType)) {
+      val functionName = ArrayFieldFreeFunction.inlineName(elementType)
+      val countField = MessageStruct.arrayCountFieldName(arrayFieldName)
+      val inlineField = InlineArray.bufferName(arrayFieldName)
+
+      s"$functionName( $paramName->$arrayFieldName, $paramName->$countField, $paramName->$inlineField, ${Allocator.paramName} );"
+    } else {
+      arrayFreeFunctionCall(arrayFieldName, elementType)
+    }
   }
 
   /**
@@ -128,10 +215,10 @@ object MessageFreeFunction {
     * @return String to free the object field
     */
   private def objectFreeFunctionName(objectTypeName: String, objectFieldName: String): String = {
-    val functionName = MessageFreeFunction.name(objectTypeName)
+    val functionName = MessageFreeFunction.exName(objectTypeName)
 
     // Always pass object fields as pointers to their free functions
-    s"$functionName( &$paramName->$objectFieldName );"
+    s"$functionName( &$paramName->$objectFieldName, ${Allocator.paramName} );"
   }
 
   /**
@@ -140,6 +227,16 @@ object MessageFreeFunction {
     * @return String to free the string field
     */
   private def dynamicStringFreeFunctionCall(stringFieldName: String): String = {
-    s"${Constants.defaultFreeFunction}( $paramName->$stringFieldName );"
+    s"${Allocator.free(s"$paramName->$stringFieldName")};"
+  }
+
+  /**
+    * Gets the string to release a field containing an interned string. The string is
+    * only freed if it was not shared through the allocator's intern table.
+    * @param stringFieldName Name of the field containing the string
+    * @return String to release the string field
+    */
+  private def internedStringFreeFunctionCall(stringFieldName: String): String = {
+    s"${Allocator.internFree(s"$paramName->$stringFieldName")};"
   }
 }
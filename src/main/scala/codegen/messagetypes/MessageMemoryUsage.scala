@@ -0,0 +1,467 @@
+package codegen.messagetypes
+
+import codegen.Constants
+import codegen.allocator.Allocator
+import codegen.functions._
+import datamodel._
+
+/**
+  * Generates the functions that measure the heap memory owned by messages. They walk the
+  * same strings, arrays and nested messages that MessageFreeFunction releases and report
+  * the number of bytes and allocations. Interned strings are only counted when the
+  * allocator has no intern function, as they are owned by the intern table otherwise.
+  * Defining CDTO_MALLOC_USABLE_SIZE when compiling the generated code counts the
+  * allocator overhead of memory from the C standard library with malloc_usable_size().
+  */
+object MessageMemoryUsage {
+
+  /**
+    * Name of the macro that enables malloc_usable_size()
+    */
+  val usableSizeGuard: String = "CDTO_MALLOC_USABLE_SIZE"
+
+  /**
+    * Header needed by malloc_usable_size(), to place in the types C source file
+    */
+  val sourceDefinitions: String =
+    s"""#ifdef $usableSizeGuard
+       |#include <malloc.h>
+       |#endif /* #ifdef $usableSizeGuard */""".stripMargin
+
+  private val paramName = "obj"
+  private val arrayParamName = "array"
+  private val arrayCountParamName = "array_cnt"
+  private val bytesParamName = "heap_bytes"
+  private val countParamName = "alloc_cnt"
+  private val indexVariableName = "i"
+
+  private val outputParameters = List(
+    FunctionParameter(paramType = "size_t*", paramName = bytesParamName),
+    FunctionParameter(paramType = "size_t*", paramName = countParamName)
+  )
+
+  /**
+    * Creates the function to measure the heap memory owned by a message
+    * @param message cDTO message
+    * @return Definition of the message memory usage function
+    */
+  def apply(message: Message): FunctionDefinition = {
+    FunctionDefinition(
+      name = name(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Get ${message.name} memory usage",
+        description = s"Gets the number of heap bytes and allocations owned by the provided ${message.name}, not counting the ${message.name} itself."
+      ),
+      prototype = prototype(message),
+      body = s"${exName(message.name)}( $paramName, $bytesParamName, $countParamName, ${Allocator.defaultAllocator} );"
+    )
+  }
+
+  /**
+    * Creates the function to measure the heap memory owned by a message that was created
+    * with an allocator
+    * @param message cDTO message
+    * @return Definition of the message memory usage function with an allocator
+    */
+  def withAllocator(message: Message): FunctionDefinition = {
+    val basePrototype = prototype(message)
+
+    FunctionDefinition(
+      name = exName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Get ${message.name} memory usage with an allocator",
+        description = s"Gets the number of heap bytes and allocations owned by the provided ${message.name}, which was created with the allocator, not counting the ${message.name} itself."
+      ),
+      prototype = basePrototype.copy(parameters = basePrototype.parameters :+ Allocator.parameter),
+      body =
+        s"""*$bytesParamName = 0;
+           |*$countParamName = 0;
+           |${addName(message.name)}( $paramName, $bytesParamName, $countParamName, ${Allocator.paramName} );""".stripMargin
+    )
+  }
+
+  /**
+    * Creates the function to measure the heap memory owned by the elements of an array of
+    * messages, e.g. a cache of parsed messages
+    * @param message cDTO message
+    * @return Definition of the message array memory usage function
+    */
+  def arrayFunction(message: Message): FunctionDefinition = {
+    FunctionDefinition(
+      name = arrayName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Get ${message.name} array memory usage",
+        description = s"Gets the number of heap bytes and allocations owned by the elements of the provided array, not counting the array itself."
+      ),
+      prototype = arrayPrototype(message),
+      body = s"${arrayExName(message.name)}( $arrayParamName, $arrayCountParamName, $bytesParamName, $countParamName, ${Allocator.defaultAllocator} );"
+    )
+  }
+
+  /**
+    * Creates the function to measure the heap memory owned by the elements of an array of
+    * messages that were created with an allocator
+    * @param message cDTO message
+    * @return Definition of the message array memory usage function with an allocator
+    */
+  def arrayFunctionWithAllocator(message: Message): FunctionDefinition = {
+    val basePrototype = arrayPrototype(message)
+
+    FunctionDefinition(
+      name = arrayExName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Get ${message.name} array memory usage with an allocator",
+        description = s"Gets the number of heap bytes and allocations owned by the elements of the provided array, which were created with the allocator, not counting the array itself."
+      ),
+      prototype = basePrototype.copy(parameters = basePrototype.parameters :+ Allocator.parameter),
+      body =
+        s"""${Constants.defaultIntCType} $indexVariableName;
+           |
+           |*$bytesParamName = 0;
+           |*$countParamName = 0;
+           |for( $indexVariableName = 0; $indexVariableName < $arrayCountParamName; $indexVariableName++ )
+           |    {
+           |    ${addName(message.name)}( &$arrayParamName[$indexVariableName], $bytesParamName, $countParamName, ${Allocator.paramName} );
+           |    }""".stripMargin
+    )
+  }
+
+  /**
+    * Creates the static function that adds the heap memory owned by a message to the
+    * running totals. Nested messages are measured by calling their own add function.
+    * @param message cDTO message
+    * @return Definition of the message's memory usage add function
+    */
+  def addFunction(message: Message): FunctionDefinition = {
+    val fieldUsages = message.fields.flatMap(field => fieldUsage(field.name, field.fieldType)) ++ cacheUsages(message) ++ indexUsages(message)
+    val needsIndex = message.fields.exists(field => field.fieldType match {
+      case ArrayType(elementType) => elementUsage(elementType, "").isDefined
+      case InlineArrayType(elementType, _) => elementUsage(elementType, "").isDefined
+      case _ => false
+    })
+
+    val declarations = if(needsIndex) s"${Constants.defaultIntCType} $indexVariableName;\n\n" else ""
+    val body = if(fieldUsages.isEmpty) {
+      s"""( void )$paramName;
+         |( void )$bytesParamName;
+         |( void )$countParamName;
+         |( void )${Allocator.paramName};""".stripMargin
+    } else {
+      declarations + fieldUsages.mkString("\n")
+    }
+
+    FunctionDefinition(
+      name = addName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Add ${message.name} memory usage",
+        description = s"Adds the heap bytes and allocations owned by the provided ${message.name} to the totals."
+      ),
+      prototype = FunctionPrototype(
+        isStatic = true,
+        returnType = Constants.voidCType,
+        parameters = (FunctionParameter(paramType = s"${MessageStruct.structName(message)} const*", paramName = paramName) +: outputParameters) :+ Allocator.parameter
+      ),
+      body = body
+    )
+  }
+
+  /**
+    * Gets the static helper functions needed to measure the messages of a protocol
+    * @param protocol Message protocol
+    * @return List of helper functions used by the protocol's memory usage functions
+    */
+  def helperFunctions(protocol: Protocol): Seq[FunctionDefinition] = {
+    val fieldTypes = protocol.messages.flatMap(_.fields.map(_.fieldType))
+    val (arrayTypes, simpleTypes) = fieldTypes.partition(!_.isInstanceOf[SimpleFieldType])
+    val elementTypes = arrayTypes.collect({
+      case ArrayType(elementType) => elementType
+      case InlineArrayType(elementType, _) => elementType
+    })
+
+    // Strings of fixed length are only on the heap as array elements
+    val usesInterning = fieldTypes.exists(Allocator.isInterned)
+    val usesStrings = usesInterning || MessageCache.isUsed(protocol) ||
+      simpleTypes.collect({ case simpleType: SimpleFieldType => baseType(simpleType) }).exists(isString) ||
+      elementTypes.map(baseType).exists(elementType => isString(elementType) || elementType.isInstanceOf[FixedStringType])
+    // Arrays and bytes are heap blocks
+    val usesBlocks = usesStrings || arrayTypes.nonEmpty
+
+    List(
+      if(usesBlocks) Some(blockFunction) else None,
+      if(usesStrings) Some(stringFunction) else None,
+      if(usesInterning) Some(internedStringFunction) else None
+    ).flatten
+  }
+
+  /**
+    * @param messageName Name of message
+    * @return Name of the message's memory usage function
+    */
+  def name(messageName: String): String = {
+    s"${messageName}_memory_usage"
+  }
+
+  /**
+    * @param messageName Name of message
+    * @return Name of the message's memory usage function with an allocator
+    */
+  def exName(messageName: String): String = {
+    name(messageName) + Allocator.functionNameSuffix
+  }
+
+  /**
+    * @param messageName Name of message
+    * @return Name of the message's array memory usage function
+    */
+  def arrayName(messageName: String): String = {
+    s"${messageName}_array_memory_usage"
+  }
+
+  /**
+    * @param messageName Name of message
+    * @return Name of the message's array memory usage function with an allocator
+    */
+  def arrayExName(messageName: String): String = {
+    arrayName(messageName) + Allocator.functionNameSuffix
+  }
+
+  /**
+    * @param messageName Name of message
+    * @return Name of the message's static memory usage add function
+    */
+  def addName(messageName: String): String = {
+    s"${messageName}_memory_usage_add"
+  }
+
+  /**
+    * Static function to count a heap block
+    */
+  val blockFunction: FunctionDefinition = FunctionDefinition(
+    name = "cdto_memory_usage_add",
+    documentation = FunctionDocumentation(
+      shortSummary = "Add heap block",
+      description = s"Adds a heap block of size bytes to the totals. NULL pointers are ignored. If $usableSizeGuard is defined, the usable size of blocks from the C standard library is counted instead."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.voidCType,
+      parameters = List(
+        Allocator.parameter,
+        FunctionParameter(paramType = "void const*", paramName = "ptr"),
+        FunctionParameter(paramType = "size_t", paramName = "size")
+      ) ++ outputParameters
+    ),
+    body =
+      s"""if( NULL == ptr )
+         |    {
+         |    return;
+         |    }
+         |
+         |#ifdef $usableSizeGuard
+         |if( NULL == ${Allocator.paramName} )
+         |    {
+         |    size = malloc_usable_size( ( void* )ptr );
+         |    }
+         |#else
+         |( void )${Allocator.paramName};
+         |#endif
+         |
+         |*$bytesParamName += size;
+         |*$countParamName += 1;""".stripMargin
+  )
+
+  /**
+    * Static function to count a heap string
+    */
+  val stringFunction: FunctionDefinition = FunctionDefinition(
+    name = "cdto_memory_usage_add_string",
+    documentation = FunctionDocumentation(
+      shortSummary = "Add heap string",
+      description = "Adds a NUL-terminated heap string to the totals. NULL strings are ignored."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.voidCType,
+      parameters = List(
+        Allocator.parameter,
+        FunctionParameter(paramType = s"${Constants.defaultCharacterCType} const*", paramName = "str")
+      ) ++ outputParameters
+    ),
+    body =
+      s"""if( NULL != str )
+         |    {
+         |    ${blockFunction.name}( ${Allocator.paramName}, str, strlen( str ) + 1, $bytesParamName, $countParamName );
+         |    }""".stripMargin
+  )
+
+  /**
+    * Static function to count an interned string
+    */
+  val internedStringFunction: FunctionDefinition = FunctionDefinition(
+    name = "cdto_memory_usage_add_interned",
+    documentation = FunctionDocumentation(
+      shortSummary = "Add interned string",
+      description = "Adds an interned string to the totals if it was duplicated because the allocator has no intern function. Strings owned by the intern table are not counted."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.voidCType,
+      parameters = List(
+        Allocator.parameter,
+        FunctionParameter(paramType = s"${Constants.defaultCharacterCType} const*", paramName = "str")
+      ) ++ outputParameters
+    ),
+    body =
+      s"""if( ( NULL == ${Allocator.paramName} ) || ( NULL == ${Allocator.paramName}->intern_fn ) )
+         |    {
+         |    ${stringFunction.name}( ${Allocator.paramName}, str, $bytesParamName, $countParamName );
+         |    }""".stripMargin
+  )
+
+  /**
+    * @param message cDTO message
+    * @return Prototype of the message memory usage function
+    */
+  private def prototype(message: Message): FunctionPrototype = {
+    FunctionPrototype(
+      isStatic = false,
+      returnType = Constants.voidCType,
+      parameters = FunctionParameter(paramType = s"${MessageStruct.structName(message)} const*", paramName = paramName) +: outputParameters
+    )
+  }
+
+  /**
+    * @param message cDTO message
+    * @return Prototype of the message array memory usage function
+    */
+  private def arrayPrototype(message: Message): FunctionPrototype = {
+    FunctionPrototype(
+      isStatic = false,
+      returnType = Constants.voidCType,
+      parameters = List(
+        FunctionParameter(paramType = s"${MessageStruct.structName(message)} const*", paramName = arrayParamName),
+        FunctionParameter(paramType = Constants.defaultIntCType, paramName = arrayCountParamName)
+      ) ++ outputParameters
+    )
+  }
+
+  /**
+    * Gets the statements that add the heap memory owned by a field, like
+    * MessageFreeFunction frees it
+    * @param fieldName Name of the field
+    * @param fieldType Type of the field
+    * @return Statements to measure the field if it owns heap memory, None otherwise
+    */
+  private def fieldUsage(fieldName: String, fieldType: FieldType): Option[String] = {
+    val member = s"$paramName->$fieldName"
+
+    fieldType match {
+      case ArrayType(elementType) => Some(arrayUsage(member, member, fieldName, elementType))
+      case InlineArrayType(elementType, _) => Some(arrayUsage(member, InlineArray.elements(member), fieldName, elementType))
+      case BytesType => Some(s"${blockFunction.name}( ${Allocator.paramName}, ${Bytes.data(member)}, ${Bytes.length(member)}, $bytesParamName, $countParamName );")
+      case AliasedType(_, underlyingType) => fieldUsage(fieldName, underlyingType)
+      case ObjectType(objectName) => Some(s"${addName(objectName)}( &$member, $bytesParamName, $countParamName, ${Allocator.paramName} );")
+      case DynamicStringType | InlineStringType(_) => Some(stringUsage(stringFunction.name, member)) // inline strings are only on the heap when long
+      case InternedStringType => Some(stringUsage(internedStringFunction.name, member))
+      case BooleanType | FixedStringType(_) | NumberType | TimestampType | EnumType(_, _) => None
+    }
+  }
+
+  /**
+    * Gets the statements that add the cached JSON of a message. Discarded JSON is counted
+    * as well since its buffer is kept until the message is serialized again.
+    * @param message cDTO message
+    * @return Statements to measure the message's caches, empty if the message is not cached
+    */
+  private def cacheUsages(message: Message): Seq[String] = {
+    if(message.cached) {
+      (MessageCache.fragmentNames(message) :+ MessageCache.memberName).map(cache => stringUsage(stringFunction.name, s"$paramName->$cache.json"))
+    } else {
+      Nil
+    }
+  }
+
+  /**
+    * Gets the statements that add the hash tables of a message's indexed array fields
+    * @param message cDTO message
+    * @return Statements to measure the message's indexes, empty if it has no indexed fields
+    */
+  private def indexUsages(message: Message): Seq[String] = {
+    ArrayIndex.indexedFields(message).map(field => {
+      val index = s"$paramName->${ArrayIndex.memberName(field.name)}"
+      s"${blockFunction.name}( ${Allocator.paramName}, $index.slots, $index.cap * sizeof( *$index.slots ), $bytesParamName, $countParamName );"
+    })
+  }
+
+  /**
+    * Gets the statements that add the heap memory owned by an array field and its elements.
+    * The heap array of an inline array field is NULL while its elements are inline.
+    * @param member C expression of the field's array pointer
+    * @param elements C expression of the field's elements
+    * @param fieldName Name of the field
+    * @param elementType Type of the array's elements
+    * @return Statements to measure the array field
+    */
+  private def arrayUsage(member: String, elements: String, fieldName: String, elementType: SimpleFieldType): String = {
+    val count = s"$paramName->${MessageStruct.arrayCountFieldName(fieldName)}"
+    val blockUsage = s"${blockFunction.name}( ${Allocator.paramName}, $member, ( size_t )$count * sizeof( *$member ), $bytesParamName, $countParamName );"
+
+    elementUsage(elementType, s"$elements[$indexVariableName]") match {
+      case Some(usage) =>
+        s"""$blockUsage
+           |for( $indexVariableName = 0; $indexVariableName < $count; $indexVariableName++ )
+           |    {
+           |    $usage
+           |    }""".stripMargin
+      case None => blockUsage
+    }
+  }
+
+  /**
+    * Gets the statement that adds the heap memory owned by an array element, like
+    * ArrayFieldFreeFunction frees it
+    * @param elementType Type of the array's elements
+    * @param element C expression of the element
+    * @return Statement to measure the element if it owns heap memory, None otherwise
+    */
+  private def elementUsage(elementType: SimpleFieldType, element: String): Option[String] = {
+    elementType match {
+      case AliasedType(_, underlyingType) => elementUsage(underlyingType, element)
+      case ObjectType(objectName) => Some(s"${addName(objectName)}( &$element, $bytesParamName, $countParamName, ${Allocator.paramName} );")
+      case DynamicStringType | FixedStringType(_) | InlineStringType(_) => Some(stringUsage(stringFunction.name, element))
+      case InternedStringType => Some(stringUsage(internedStringFunction.name, element))
+      case BooleanType | NumberType | TimestampType | EnumType(_, _) => None
+    }
+  }
+
+  /**
+    * @param functionName Name of the string helper function
+    * @param string C expression of the string
+    * @return Statement to measure the string
+    */
+  private def stringUsage(functionName: String, string: String): String = {
+    s"$functionName( ${Allocator.paramName}, $string, $bytesParamName, $countParamName );"
+  }
+
+  /**
+    * @param simpleType Field or element type
+    * @return The type with any alias removed
+    */
+  private def baseType(simpleType: SimpleFieldType): SimpleFieldType = {
+    simpleType match {
+      case AliasedType(_, underlyingType) => underlyingType
+      case other => other
+    }
+  }
+
+  /**
+    * @param simpleType Field or element type without alias
+    * @return True if the type is stored as a heap string owned by the message
+    */
+  private def isString(simpleType: SimpleFieldType): Boolean = {
+    simpleType match {
+      case DynamicStringType | InlineStringType(_) => true
+      case _ => false
+    }
+  }
+}
@@ -14,7 +14,7 @@ object MessageStruct {
   def apply(message: Message): StructDefinition = {
     StructDefinition(
       name = message.name,
-      fields = message.fields.flatMap(structField)
+      fields = message.fields.flatMap(structField) ++ MessageCache.structFields(message) ++ ArrayIndex.structFields(message)
     )
   }
 
@@ -39,8 +39,11 @@ object MessageStruct {
       case ObjectType(objectName) => s"$objectName*"
       case BooleanType => s"${Constants.defaultBooleanCType}*"
       case DynamicStringType => s"${Constants.defaultCharacterCType}**"
-      case FixedStringType(_) => s"${Constants.defaultCharacterCType}**"
+      case InternedStringType => s"${Constants.defaultCharacterCType} const**"
+      case FixedStringType(_) | InlineStringType(_) => s"${Constants.defaultCharacterCType}**"
+      case EnumType(enumName, _) => s"$enumName*"
       case NumberType => s"${Constants.defaultNumberCType}*"
+      case TimestampType => s"${Constants.defaultTimestampCType}*"
     }
   }
 
@@ -65,6 +68,9 @@ object MessageStruct {
   private def structField(field: Field): Seq[StructField] = {
     field.fieldType match {
       case ArrayType(elementType) => arrayField(field.name, elementType)
+      case InlineArrayType(elementType, capacity) => InlineArray.structFields(field.name, elementType, capacity)
+      case InlineStringType(capacity) => InlineString.structFields(field.name, capacity)
+      case BytesType => List(Bytes.structField(field.name))
       case simpleType:SimpleFieldType => List(simpleField(field.name, simpleType))
     }
   }
@@ -97,8 +103,12 @@ object MessageStruct {
       case ObjectType(objectName) => SimpleStructField(fieldName, objectName)
       case BooleanType => SimpleStructField(fieldName, Constants.defaultBooleanCType)
       case DynamicStringType => SimpleStructField(fieldName, Constants.defaultCharacterCType + "*")
+      case InternedStringType => SimpleStructField(fieldName, Constants.defaultCharacterCType + " const*")
       case FixedStringType(maxLength) => FixedArrayStructField(fieldName, Constants.defaultCharacterCType, maxLength + 1) // include room for null-terminator
+      case InlineStringType(_) => SimpleStructField(fieldName, Constants.defaultCharacterCType + "*") // only the heap pointer, see structField
+      case EnumType(enumName, _) => SimpleStructField(fieldName, enumName)
       case NumberType => SimpleStructField(fieldName, Constants.defaultNumberCType)
+      case TimestampType => SimpleStructField(fieldName, Constants.defaultTimestampCType)
     }
   }
 }
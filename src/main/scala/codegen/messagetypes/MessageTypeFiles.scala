@@ -1,9 +1,11 @@
 package codegen.messagetypes
 
 import codegen.Constants
+import codegen.allocator.Allocator
 import codegen.functions._
 import codegen.sourcefile._
-import codegen.types.StructDefinition
+import codegen.timestamp.Timestamp
+import codegen.types.{EnumDefinition, StructDefinition}
 import datamodel._
 
 object MessageTypeFiles {
@@ -26,12 +28,43 @@ object MessageTypeFiles {
 
     // Get all of the functions to declare and define
     val initFunctions = protocol.messages.map(message => MessageInitFunction(message))
-    val freeFunctions = protocol.messages.map(message => MessageFreeFunction(message))
+    val freeFunctions = protocol.messages.flatMap(message => List(
+      MessageFreeFunction(message),
+      MessageFreeFunction.withAllocator(message)
+    ))
 
-    val allFunctions = initFunctions ++ freeFunctions ++ arrayFreeFunctions(protocol)
+    val memoryUsageFunctions = protocol.messages.flatMap(message => List(
+      MessageMemoryUsage(message),
+      MessageMemoryUsage.withAllocator(message),
+      MessageMemoryUsage.arrayFunction(message),
+      MessageMemoryUsage.arrayFunctionWithAllocator(message),
+      MessageMemoryUsage.addFunction(message)
+    )) ++ MessageMemoryUsage.helperFunctions(protocol)
+
+    val cacheFunctions = protocol.messages.flatMap(MessageCache.functions)
+
+    // Indexes hash their keys and allocate their tables zeroed
+    val messagesByName = protocol.messages.map(message => message.name -> message).toMap
+    val indexFunctions = protocol.messages.flatMap(ArrayIndex.functions(_, messagesByName))
+    val indexHelperFunctions = if(ArrayIndex.isUsed(protocol)) List(ArrayIndex.hashFunction, Allocator.callocFunction) else Nil
+
+    val allFunctions = initFunctions ++ freeFunctions ++ arrayFreeFunctions(protocol) ++ internFreeFunctions(protocol) ++ memoryUsageFunctions ++ cacheFunctions ++ indexFunctions ++ indexHelperFunctions :+ Allocator.freeFunction
+
+    val enums = MessageEnum.enumTypes(protocol.messages).map(MessageEnum(_))
+
+    val inlineStringDefinitions = if(InlineString.isUsed(protocol)) List(InlineString.macroDefinition) else Nil
+    val inlineArrayDefinitions = if(InlineArray.isUsed(protocol)) List(InlineArray.macroDefinition) else Nil
+    val cacheDefinitions = if(MessageCache.isUsed(protocol)) List(MessageCache.typeDefinition) else Nil
+    val bytesDefinitions = if(Bytes.isUsed(protocol.messages)) List(Bytes.typeDefinition) else Nil
+    val indexDefinitions = if(ArrayIndex.isUsed(protocol)) List(ArrayIndex.typeDefinition) else Nil
+    val definitions = Allocator.typeDefinition +: (inlineStringDefinitions ++ inlineArrayDefinitions ++ cacheDefinitions ++ bytesDefinitions ++ indexDefinitions)
+
+    // Bytes are stored as uint8_t and timestamps as int64_t
+    val usesStdint = Bytes.isUsed(protocol.messages) || Timestamp.isUsed(protocol.messages)
+    val typeHeaders = if(usesStdint) (Constants.stdintHeader +: aliasedTypeHeaders).distinct else aliasedTypeHeaders
 
     // Create the header and source files
-    val header = headerFile(protocol.name, aliasedTypeHeaders, structs, allFunctions)
+    val header = headerFile(protocol.name, typeHeaders, structs, enums, definitions, allFunctions)
     val sourceFile = cFile(protocol.name, allFunctions)
 
     SourceFilePair(header, sourceFile)
@@ -80,9 +113,30 @@ object MessageTypeFiles {
       field <- message.fields
     } yield field.fieldType
 
-    val arrayFields = fieldTypes.collect({ case array @ ArrayType(_) => array }).toSet
+    val elementTypes = fieldTypes.collect({
+      case ArrayType(elementType) => elementType
+      case InlineArrayType(elementType, _) => elementType
+    }).toSet
+    val inlineElementTypes = fieldTypes.collect({
+      case InlineArrayType(elementType, _) if ArrayFieldFreeFunction.freesElements(elementType) => elementType
+    }).toSet
+
+    // Several array types share a free function, e.g. arrays of dynamic and fixed-length strings
+    val freeFunctions = elementTypes.map(ArrayFieldFreeFunction(_)).toSeq ++ inlineElementTypes.map(ArrayFieldFreeFunction.inlineFunction).toSeq
+
+    freeFunctions.groupBy(_.name).values.map(_.head).toSeq
+  }
+
+  /**
+    * Gets the function to release interned strings if any field of the protocol interns
+    * its strings
+    * @param protocol Message protocol
+    * @return List containing the interned string release function, empty if no field uses it
+    */
+  private def internFreeFunctions(protocol: Protocol): Seq[FunctionDefinition] = {
+    val usesInterning = protocol.messages.exists(_.fields.exists(field => Allocator.isInterned(field.fieldType)))
 
-    arrayFields.map(array => ArrayFieldFreeFunction(array.elementType)).toSeq
+    if(usesInterning) List(Allocator.internFreeFunction) else Nil
   }
 
   /**
@@ -91,16 +145,20 @@ object MessageTypeFiles {
     * @param aliasedTypeHeaders Set of header files that contain type definitions for all aliased types
     *                           specified in the protocol
     * @param structs List of protocol message struct definitions to declare
+    * @param enums List of protocol enum definitions to declare
+    * @param definitions List of macro and type definitions to place in the header
     * @param functions List of protocol message functions to declare
     * @return Message protocol header file
     */
-  private def headerFile(protocolName: String, aliasedTypeHeaders: Seq[String], structs: Seq[StructDefinition], functions: Seq[FunctionDefinition]): FileDefinition = {
+  private def headerFile(protocolName: String, aliasedTypeHeaders: Seq[String], structs: Seq[StructDefinition], enums: Seq[EnumDefinition], definitions: Seq[String], functions: Seq[FunctionDefinition]): FileDefinition = {
     val headerContents = HeaderFile(
       name = headerFileName(protocolName),
       description =  s"Contains definitions for $protocolName types.",
-      includes = aliasedTypeHeaders,
+      includes = Constants.stddefHeader +: aliasedTypeHeaders,
       types = structs,
-      functions = functions
+      functions = functions,
+      definitions = definitions,
+      enums = enums
     )
 
     FileDefinition(name = headerFileName(protocolName), contents = headerContents)
@@ -113,12 +171,13 @@ object MessageTypeFiles {
     * @return Message protocol C source file
     */
   private def cFile(protocolName: String, functions: Seq[FunctionDefinition]): FileDefinition = {
-    // Need <stdlib.h> for free() and <string.h> for memset()
+    // Need <stdlib.h> for free() and <string.h> for memset() and strlen()
     val cFileContents = CFile(
       name = cFileName(protocolName),
       description =  s"Contains functions for working with $protocolName types.",
       includes = List(Constants.stdlibHeader, Constants.stringHeader, headerFileInclude(protocolName)),
-      functions = functions
+      functions = functions,
+      definitions = List(MessageMemoryUsage.sourceDefinitions)
     )
 
     FileDefinition(name = cFileName(protocolName), contents = cFileContents)
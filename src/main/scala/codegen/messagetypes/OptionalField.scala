@@ -0,0 +1,131 @@
+package codegen.messagetypes
+
+import codegen.Constants
+import datamodel._
+
+/**
+  * Describes fields declared with a default or with omitEmpty=true. Such fields are optional:
+  * the serializers leave them out while they hold their default or are empty, and the parsers
+  * accept messages without them, setting the field to its default. Empty values are the
+  * values that a missing field is parsed as, so leaving them out does not change the message:
+  * arrays without elements, NULL strings, fixed-length and inline strings without characters,
+  * bytes without data, and zero numbers, booleans, timestamps and enums. A field with a
+  * default is only left out while it holds the default.
+  */
+object OptionalField {
+
+  /**
+    * @param field Field of a message
+    * @return True if the field may be missing from serialized messages
+    */
+  def isOptional(field: Field): Boolean = {
+    field.default.isDefined || field.omitEmpty
+  }
+
+  /**
+    * @param messages Messages
+    * @return True if any field of the messages is optional
+    */
+  def isUsed(messages: Seq[Message]): Boolean = {
+    messages.exists(_.fields.exists(isOptional))
+  }
+
+  /**
+    * @param field Field of a message
+    * @return C expression of the field's default value, None if it has no default
+    */
+  def defaultValue(field: Field): Option[String] = {
+    field.default.map(value => baseType(field.fieldType) match {
+      case BooleanType => if(value == "true") "1" else "0"
+      case enumType: EnumType => MessageEnum.constantName(enumType, value)
+      case _ => value
+    })
+  }
+
+  /**
+    * @param field Field with a default value
+    * @return C type of the field's default value
+    */
+  def defaultCType(field: Field): String = {
+    field.fieldType match {
+      case AliasedType(alias, _) => alias
+      case BooleanType => Constants.defaultBooleanCType
+      case EnumType(enumName, _) => enumName
+      case _ => Constants.defaultNumberCType
+    }
+  }
+
+  /**
+    * Gets the statement that sets a field to its default when it is missing from the input
+    * @param obj C expression of the message pointer
+    * @param field Field of the message
+    * @return Assignment of the field's default, None if the field has no default
+    */
+  def defaultAssignment(obj: String, field: Field): Option[String] = {
+    defaultValue(field).map(value => s"$obj->${field.name} = $value;")
+  }
+
+  /**
+    * Gets the condition under which the serializers leave a field out
+    * @param obj C expression of the message pointer
+    * @param field Field of the message
+    * @return Condition that is true while the field holds its default or is empty, None if
+    *         the field is always serialized
+    */
+  def omitCondition(obj: String, field: Field): Option[String] = {
+    val member = s"$obj->${field.name}"
+
+    (defaultValue(field), field.fieldType) match {
+      case (Some(value), _) => Some(s"$value == $member")
+      case (None, _) if !field.omitEmpty => None
+      case (None, ArrayType(_) | InlineArrayType(_, _)) => Some(s"0 == $obj->${MessageStruct.arrayCountFieldName(field.name)}")
+      case (None, BytesType) => Some(s"0 == ${Bytes.length(member)}")
+      case (None, ObjectType(_)) => None
+      case (None, simpleType: SimpleFieldType) => Some(emptyCondition(member, baseType(simpleType)))
+    }
+  }
+
+  /**
+    * Surrounds the statements that serialize a field with the check whether to leave it out
+    * @param condition Condition under which the field is left out, see omitCondition
+    * @param snippet Statements serializing the field
+    * @return The statements, only run while the field is not left out
+    */
+  def guard(condition: Option[String], snippet: String): String = {
+    condition match {
+      case Some(omit) =>
+        val indentedSnippet = snippet.split("\n").map(line => if(line.isEmpty) line else "    " + line).mkString("\n")
+
+        s"""if( !( $omit ) )
+           |    {
+           |$indentedSnippet
+           |    }""".stripMargin
+      case None => snippet
+    }
+  }
+
+  /**
+    * @param member C expression of a field's struct member
+    * @param fieldType Type of the field
+    * @return Condition that is true if the field is empty
+    */
+  private def emptyCondition(member: String, fieldType: FieldType): String = {
+    fieldType match {
+      case DynamicStringType | InternedStringType => s"NULL == $member"
+      case FixedStringType(_) => s"'\\0' == $member[0]"
+      case InlineStringType(_) => s"'\\0' == ${InlineString.value(member)}[0]"
+      case _ => s"0 == $member"
+    }
+  }
+
+  /**
+    * @param fieldType Type of a field
+    * @return Underlying type of an aliased field, the field's own type otherwise
+    */
+  private def baseType(fieldType: FieldType): FieldType = {
+    fieldType match {
+      case AliasedType(_, underlyingType) => underlyingType
+      case _ => fieldType
+    }
+  }
+}
@@ -0,0 +1,67 @@
+package codegen.sourcefile
+
+object CMakeFragment {
+
+  /**
+    * Creates a CMake fragment listing the generated files of a protocol so that a build can
+    * pick up the generated sources with include(). The file paths are relative to the
+    * directory containing the fragment.
+    * @param protocolName Name of the protocol
+    * @param headerFiles Names of all generated header files
+    * @param cFiles Names of all generated C source files
+    * @return Definition of the protocol's CMake fragment
+    */
+  def apply(protocolName: String, headerFiles: Seq[String], cFiles: Seq[String]): FileDefinition = {
+    val name = fileName(protocolName)
+    val prefix = variablePrefix(protocolName)
+
+    val contents =
+      s"""#########################################################################
+         |#
+         |# THIS FILE IS AUTO-GENERATED. DO NOT EDIT DIRECTLY. ALL CHANGES WILL BE LOST.
+         |#
+         |#     $name - Lists the generated source files of the protocol
+         |#
+         |#########################################################################
+         |
+         |set( ${prefix}_INCLUDE_DIRS $${CMAKE_CURRENT_LIST_DIR} )
+         |
+         |set( ${prefix}_HEADERS
+         |${fileList(headerFiles)}
+         |    )
+         |
+         |set( ${prefix}_SOURCES
+         |${fileList(cFiles)}
+         |    )
+         |""".stripMargin
+
+    FileDefinition(name, contents)
+  }
+
+  /**
+    * Gets the name of the protocol's CMake fragment
+    * @param protocolName Name of the protocol
+    * @return Name of the CMake fragment
+    */
+  def fileName(protocolName: String): String = {
+    s"$protocolName.cmake"
+  }
+
+  /**
+    * Gets the prefix of the variables defined by the protocol's CMake fragment. The
+    * conversion will be: my_protocol.cdto -> MY_PROTOCOL_CDTO
+    * @param protocolName Name of the protocol
+    * @return Prefix of the CMake variable names
+    */
+  def variablePrefix(protocolName: String): String = {
+    protocolName.replaceAll("[^A-Za-z0-9_]", "_").toUpperCase
+  }
+
+  /**
+    * @param files File names relative to the fragment's directory
+    * @return One indented path per line
+    */
+  private def fileList(files: Seq[String]): String = {
+    files.map(file => s"    $${CMAKE_CURRENT_LIST_DIR}/$file").mkString("\n")
+  }
+}
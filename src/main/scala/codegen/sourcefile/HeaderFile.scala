@@ -11,25 +11,33 @@ object HeaderFile {
     * @param types Types to declare in the header file
     * @param functions Functions to declare in the header file. This will only declare non-static functions
     *                  inside of a header file.
+    * @param definitions List of macro and type definition strings to place before the type declarations,
+    *                    so that the message structs can use them
+    * @param enums Enums to declare in the header file, before the types that may use them
     * @return String containing the contents of the header file
     */
   def apply(name: String,
             description: String,
             includes: Seq[String],
             types: Seq[StructDefinition],
-            functions: Seq[FunctionDefinition]): String = {
+            functions: Seq[FunctionDefinition],
+            definitions: Seq[String] = Nil,
+            enums: Seq[EnumDefinition] = Nil): String = {
 
     // Declare the functions in alphabetical order and only declare
     // non-static functions in the header
     val orderedFunctions = functions.filterNot(_.prototype.isStatic).sortBy(_.name)
 
-    s"""${SourceFile.prelude(name, description)}
-       |${ifNotDefinedMacro(name)}
-       |${SourceFile.includeStatements(includes)}
-       |${SourceFile.typeDeclarations(types)}
-       |${SourceFile.functionDeclarations(orderedFunctions)}
-       |${endIfNotDefinedMacro(name)}
-     """.stripMargin
+    List(
+      SourceFile.prelude(name, description),
+      ifNotDefinedMacro(name),
+      SourceFile.includeStatements(includes),
+      SourceFile.definitions(definitions),
+      SourceFile.typeDeclarations(types, enums),
+      SourceFile.functionDeclarations(orderedFunctions),
+      endIfNotDefinedMacro(name),
+      ""
+    ).mkString("\n")
   }
 
   /**
@@ -7,21 +7,42 @@ import codegen.types._
   * By convention, headers and C files will always be grouped together one-to-one
   */
 case class SourceFilePair(headerFile: FileDefinition, cFile: FileDefinition)
+
+/**
+  * A public header whose functions are defined across several C source files, along with
+  * an internal header declaring the functions the C source files share with each other
+  */
+case class ShardedSourceFiles(headerFile: FileDefinition, internalHeaderFile: FileDefinition, cFiles: Seq[FileDefinition])
 case class FileDefinition(name: String, contents: String)
 
 object SourceFile {
 
+  /**
+    * First line of the banner at the top of each section. The last line is its reverse.
+    */
+  private val bannerLine = "/" + "*" * 72
+
   /**
     * Gets the string to define all function bodies
     * @param functions List of functions
     * @return String defining the bodies of all provided functions
     */
   def functionBodies(functions: Seq[FunctionDefinition]): String = {
-    val bodies = functions
-      .map(FunctionGenerator(_))
-      .map(_.implementation)
+    functions.map(FunctionGenerator.implementation).mkString("\n\n")
+  }
 
-    bodies.mkString("\n\n")
+  /**
+    * Gets the string containing all free-form definitions, e.g. macros and static
+    * variables, that must appear before any function declarations.
+    * @param definitions List of definition strings
+    * @return String containing all definitions, or an empty string if there are none
+    */
+  def definitions(definitions: Seq[String]): String = {
+    if(definitions.isEmpty) {
+      ""
+    } else {
+      section("DEFINITIONS", definitions)
+    }
   }
 
   /**
@@ -30,16 +51,7 @@ object SourceFile {
     * @return String to declare the prototypes of all functions
     */
   def functionDeclarations(functions: Seq[FunctionDefinition]): String = {
-    val declarations = functions
-      .map(FunctionGenerator(_))
-      .map(_.declaration)
-
-    s"""/************************************************************************
-       |                              PROCEDURES
-       |************************************************************************/
-       |
-       |${declarations.mkString("\n\n")}
-     """.stripMargin
+    section("PROCEDURES", functions.map(FunctionGenerator.declaration))
   }
 
   /**
@@ -49,14 +61,9 @@ object SourceFile {
     * @return String that will import all header files
     */
   def includeStatements(includes: Seq[String]): String = {
-    val allIncludes = includes.map(include => "#include " + include).mkString("\n")
+    val allIncludes = includes.map(include => "#include " + include)
 
-    s"""/************************************************************************
-       |                              INCLUDES
-       |************************************************************************/
-       |
-       |$allIncludes
-     """.stripMargin
+    section("INCLUDES", List(allIncludes.mkString("\n")))
   }
 
   /**
@@ -81,10 +88,12 @@ object SourceFile {
     * Gets the string to declare all user-defined struct types. This will ensure that
     * all structs are declared in the correct order so that if one struct contains
     * another struct as one of its fields, the contained struct is declared first.
+    * Enums are declared before all structs.
     * @param types Definitions of structs to declare.
+    * @param enums Definitions of enums to declare.
     * @return
     */
-  def typeDeclarations(types: Seq[StructDefinition]): String = {
+  def typeDeclarations(types: Seq[StructDefinition], enums: Seq[EnumDefinition] = Nil): String = {
     // Ensure the structs are declared in the correct order so that structs
     // that depend on the definition of other structs are declared after
     // the structs they depend on
@@ -94,12 +103,33 @@ object SourceFile {
     // this point.
     require(orderedDeclarations.isDefined)
 
-    val declarations = orderedDeclarations.get.map(structDefinition => StructGenerator(structDefinition))
-    s"""/************************************************************************
-       |                              TYPES
-       |************************************************************************/
-       |
-       |${declarations.mkString("\n\n")}
-     """.stripMargin
+    val declarations = enums.map(EnumGenerator(_)) ++ orderedDeclarations.get.map(structDefinition => StructGenerator(structDefinition))
+
+    section("TYPES", declarations)
+  }
+
+  /**
+    * Gets the string for a section of a source file: a banner with the section's title
+    * followed by the section's items separated by blank lines. The items are appended
+    * as-is rather than interpolated into a margin-stripped template, so building a
+    * section takes time linear in the size of its items.
+    * @param title Title of the section
+    * @param items Items contained in the section
+    * @return String containing the section
+    */
+  private def section(title: String, items: Seq[String]): String = {
+    val builder = new StringBuilder(items.map(_.length + 2).sum + 256)
+
+    builder ++= bannerLine ++= "\n"
+    builder ++= " " * 30 ++= title ++= "\n"
+    builder ++= bannerLine.reverse ++= "\n\n"
+
+    items.zipWithIndex.foreach({ case (item, index) =>
+      if(index > 0) builder ++= "\n\n"
+      builder ++= item
+    })
+
+    builder ++= "\n"
+    builder.toString
   }
 }
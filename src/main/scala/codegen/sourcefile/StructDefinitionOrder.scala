@@ -23,7 +23,7 @@ object StructDefinitionOrder {
     *         all dependencies
     */
   def apply(structs: Seq[StructDefinition]): Option[Seq[StructDefinition]] = {
-    val structNames = structs.map(_.name)
+    val structNames = structs.map(_.name).toSet
     val structDependencies = structs.map(struct => dependenciesForStruct(struct, structNames))
 
     definitionOrder(structDependencies)
@@ -32,27 +32,27 @@ object StructDefinitionOrder {
   /**
     * Gets the set of dependencies the given struct has on other user-defined structs.
     * @param struct Struct for which to get the dependencies
-    * @param allStructNames List of names of all structs to be defined
+    * @param allStructNames Set of names of all structs to be defined
     * @return The struct's dependencies
     */
-  private def dependenciesForStruct(struct: StructDefinition, allStructNames: Seq[String]): StructDependencies = {
+  private def dependenciesForStruct(struct: StructDefinition, allStructNames: Set[String]): StructDependencies = {
     val dependencies = struct.fields.flatMap({
       case SimpleStructField(_, typeDeclaration) if isStructField(typeDeclaration, allStructNames) => Some(removePointer(typeDeclaration))
       case FixedArrayStructField(_, elementType, _) if isStructField(elementType, allStructNames) => Some(elementType)
       case _ => None
     })
 
-    StructDependencies(struct, dependencies)
+    StructDependencies(struct, dependencies.distinct)
   }
 
   /**
     * Determines if the provided field references another struct and therefore indicates a
     * dependency on that other struct's definition based on the fields type declaration
     * @param typeDeclaration Type declaration string of the field
-    * @param allStructNames List of the names of all structs that are defined together
+    * @param allStructNames Set of the names of all structs that are defined together
     * @return True if the field reference's another struct
     */
-  private def isStructField(typeDeclaration: String, allStructNames: Seq[String]): Boolean = {
+  private def isStructField(typeDeclaration: String, allStructNames: Set[String]): Boolean = {
     val pointerLessType = removePointer(typeDeclaration)
     allStructNames.contains(pointerLessType)
   }
@@ -69,54 +69,47 @@ object StructDefinitionOrder {
 
   /**
     * Computes the order in which structs should be defined so that all dependency relations between
-    * structs are satisfied. Returns None if there are any circular dependencies
+    * structs are satisfied. Returns None if there are any circular dependencies. Structs are declared
+    * in rounds: each round declares, in their original order, all structs whose dependencies were
+    * declared in earlier rounds. Each dependency is visited once, so this runs in time linear in the
+    * number of structs and dependencies.
     * @param dependencies - List of all struct dependencies
     * @return None if there are circular dependencies, the list of struct definitions in the order that
     *         they should be declared otherwise
     */
   private def definitionOrder(dependencies: Seq[StructDependencies]): Option[Seq[StructDefinition]] = {
-
-    def definitionOrderRecursive(dependencies: Seq[StructDependencies], accumulatedOrdering: Seq[StructDefinition]): Option[Seq[StructDefinition]] = {
-      if(dependencies.isEmpty) {
-        Some(accumulatedOrdering)
-      } else {
-        // Get the list of struct definitions that are not dependent on the
-        // definitions of any other structs
-        val (nonDependentStructs, dependentStructs) = dependencies.partition(_.dependencies.isEmpty)
-
-        if(nonDependentStructs.isEmpty) {
-          // We were unable to find any structs that were not dependent on the
-          // definition of other structs which means there is a circular dependency
-          None
-        } else {
-          // The structs that do not have any dependencies can now be added to the
-          // end of the definition order list.
-          val newOrdering = accumulatedOrdering ++ nonDependentStructs.map(_.struct)
-
-          // Remove the structs that we added to the definition ordering as dependencies
-          // from the remaining structs since the dependencies on those structs have now
-          // been satisfied
-          val nonDependentStructNames = nonDependentStructs.map(_.struct.name)
-          val newDependencies = dependentStructs.map(oldDependencies => removeDependencies(oldDependencies, nonDependentStructNames))
-
-          definitionOrderRecursive(newDependencies, newOrdering)
-        }
-      }
+    val structs = dependencies.map(_.struct).toIndexedSeq
+
+    // Number of each struct's dependencies that have not been declared yet, by the struct's
+    // position in the original list
+    val remainingDependencies = dependencies.map(_.dependencies.length).toArray
+
+    // For each struct name, the positions of the structs that depend on it
+    val dependents = dependencies.zipWithIndex
+      .flatMap({ case (structDependencies, index) => structDependencies.dependencies.map(_ -> index) })
+      .groupBy(_._1)
+      .map({ case (name, dependentIndices) => name -> dependentIndices.map(_._2) })
+
+    val ordering = Vector.newBuilder[StructDefinition]
+    var orderedCount = 0
+    var round = remainingDependencies.indices.filter(remainingDependencies(_) == 0)
+
+    while(round.nonEmpty) {
+      round.foreach(index => ordering += structs(index))
+      orderedCount += round.length
+
+      // Declaring this round's structs satisfies those dependencies of the remaining structs
+      val nextRound = round
+        .flatMap(index => dependents.getOrElse(structs(index).name, Nil))
+        .filter(dependent => {
+          remainingDependencies(dependent) -= 1
+          remainingDependencies(dependent) == 0
+        })
+
+      round = nextRound.sorted
     }
 
-    definitionOrderRecursive(dependencies, Nil)
+    // Any struct that was never declared is part of a circular dependency
+    if(orderedCount == structs.length) Some(ordering.result()) else None
   }
-
-  /**
-    * Remove the given set of structs from the given set of struct dependencies
-    * @param structDependencies Set of dependencies from which to remove the set of structs
-    * @param toRemoveNames List of names of structs to remove from the dependency set
-    * @return A new dependency set with the specified struct names removed
-    */
-  private def removeDependencies(structDependencies: StructDependencies, toRemoveNames: Seq[String]): StructDependencies = {
-    val newDependencies = structDependencies.dependencies.filterNot(dependency => toRemoveNames.contains(dependency))
-
-    StructDependencies(structDependencies.struct, newDependencies)
-  }
-
 }
@@ -0,0 +1,331 @@
+package codegen.timestamp
+
+import codegen.Constants
+import codegen.functions._
+import datamodel._
+
+/**
+  * The codec of timestamp fields. Timestamps are stored as nanoseconds since the Unix epoch
+  * and written to JSON and XML as RFC 3339 date-times in UTC. The parser reads the fixed
+  * format directly instead of going through strptime(), so it neither allocates nor depends
+  * on the locale, and it accepts any time zone offset.
+  */
+object Timestamp {
+
+  val parseName = "cdto_timestamp_parse"
+  val formatName = "cdto_timestamp_format"
+
+  private val digitsName = "cdto_timestamp_digits"
+  private val putDigitsName = "cdto_timestamp_put_digits"
+
+  /**
+    * Size of a buffer that holds any formatted timestamp and its NUL terminator, e.g.
+    * 2017-02-20T12:34:56.123456789Z
+    */
+  val textSize = 32
+
+  /**
+    * Size of a buffer that holds the text of a timestamp to parse, which may have a time
+    * zone offset and more fraction digits than are kept. Longer texts are rejected.
+    */
+  val parseBufferSize = 64
+
+  /**
+    * @param messages Messages
+    * @return True if any field of the messages or any element of their arrays holds
+    *         timestamps
+    */
+  def isUsed(messages: Seq[Message]): Boolean = {
+    messages.exists(_.fields.exists(field => field.fieldType match {
+      case ArrayType(elementType) => isTimestamp(elementType)
+      case InlineArrayType(elementType, _) => isTimestamp(elementType)
+      case simpleType: SimpleFieldType => isTimestamp(simpleType)
+      case _ => false
+    }))
+  }
+
+  /**
+    * @param fieldType Type of a value
+    * @return True if the value is a timestamp, which may be aliased
+    */
+  private def isTimestamp(fieldType: SimpleFieldType): Boolean = {
+    fieldType match {
+      case TimestampType | AliasedType(_, TimestampType) => true
+      case _ => false
+    }
+  }
+
+  /**
+    * All codec functions
+    */
+  def functions: Seq[FunctionDefinition] = List(
+    digitsFunction,
+    putDigitsFunction,
+    parseFunction,
+    formatFunction
+  )
+
+  private val digitsFunction = FunctionDefinition(
+    name = digitsName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Read timestamp digits",
+      description = "Reads count decimal digits of the text as a number. Sets invalid to a non-zero value if any character is not a digit, without branching on the character."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = "int64_t",
+      parameters = List(
+        FunctionParameter("char const*", "text"),
+        FunctionParameter("size_t", "count"),
+        FunctionParameter("unsigned int*", "invalid")
+      )
+    ),
+    body =
+      s"""int64_t value;
+         |unsigned int digit;
+         |size_t i;
+         |
+         |value = 0;
+         |for( i = 0; i < count; i++ )
+         |    {
+         |    digit = ( unsigned int )( unsigned char )text[i] - '0';
+         |    *invalid |= ( digit > 9 );
+         |    value = value * 10 + digit;
+         |    }
+         |
+         |return value;""".stripMargin
+  )
+
+  private val putDigitsFunction = FunctionDefinition(
+    name = putDigitsName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Write timestamp digits",
+      description = "Writes the count lowest decimal digits of the non-negative value to the text, padded with zeros."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.voidCType,
+      parameters = List(
+        FunctionParameter("char*", "text"),
+        FunctionParameter("int64_t", "value"),
+        FunctionParameter("size_t", "count")
+      )
+    ),
+    body =
+      s"""while( count > 0 )
+         |    {
+         |    count--;
+         |    text[count] = ( char )( '0' + value % 10 );
+         |    value /= 10;
+         |    }""".stripMargin
+  )
+
+  private val parseFunction = FunctionDefinition(
+    name = parseName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Parse a timestamp",
+      description = "Parses text_len characters of an RFC 3339 date-time, e.g. 2017-02-20T12:34:56.5+01:00, into nanoseconds since the Unix epoch. Fractions finer than nanoseconds are truncated and a leap second counts as the first second of the next minute. Returns 1 if the text is a valid date-time between the years 1677 and 2262, 0 otherwise."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter("char const*", "text"),
+        FunctionParameter("size_t", "text_len"),
+        FunctionParameter(s"${Constants.defaultTimestampCType}*", "value_out")
+      )
+    ),
+    body =
+      s"""static unsigned char const month_days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+         |${Constants.defaultBooleanCType} success;
+         |unsigned int invalid;
+         |int64_t year;
+         |int64_t month;
+         |int64_t day;
+         |int64_t hour;
+         |int64_t minute;
+         |int64_t second;
+         |int64_t nanos;
+         |int64_t offset;
+         |int64_t offset_hours;
+         |int64_t offset_minutes;
+         |int64_t era;
+         |int64_t year_of_era;
+         |int64_t day_of_year;
+         |int64_t seconds;
+         |size_t digits;
+         |size_t i;
+         |
+         |year = 0;
+         |month = 0;
+         |day = 0;
+         |hour = 0;
+         |minute = 0;
+         |second = 0;
+         |nanos = 0;
+         |offset = 0;
+         |
+         |// The date and time have a fixed format, so their characters are checked without
+         |// branching on each one. The T between them may be lower case.
+         |success = ( text_len >= 20 );
+         |if( success )
+         |    {
+         |    invalid = ( '-' != text[4] ) | ( '-' != text[7] ) | ( 't' != ( text[10] | 0x20 ) ) | ( ':' != text[13] ) | ( ':' != text[16] );
+         |    year = $digitsName( text, 4, &invalid );
+         |    month = $digitsName( text + 5, 2, &invalid );
+         |    day = $digitsName( text + 8, 2, &invalid );
+         |    hour = $digitsName( text + 11, 2, &invalid );
+         |    minute = $digitsName( text + 14, 2, &invalid );
+         |    second = $digitsName( text + 17, 2, &invalid );
+         |    success = !invalid;
+         |    }
+         |
+         |// Digits of the fraction past nanoseconds are truncated
+         |i = 19;
+         |if( success && ( '.' == text[i] ) )
+         |    {
+         |    for( i++, digits = 0; ( i < text_len ) && ( ( unsigned int )( unsigned char )text[i] - '0' <= 9 ); i++, digits++ )
+         |        {
+         |        nanos = ( digits < 9 ) ? nanos * 10 + ( text[i] - '0' ) : nanos;
+         |        }
+         |
+         |    success = ( digits > 0 );
+         |    for( ; digits < 9; digits++ )
+         |        {
+         |        nanos *= 10;
+         |        }
+         |    }
+         |
+         |if( success && ( i < text_len ) && ( 'z' == ( text[i] | 0x20 ) ) )
+         |    {
+         |    i++;
+         |    }
+         |else if( success && ( i + 6 <= text_len ) && ( ( '+' == text[i] ) || ( '-' == text[i] ) ) )
+         |    {
+         |    invalid = ( ':' != text[i + 3] );
+         |    offset_hours = $digitsName( text + i + 1, 2, &invalid );
+         |    offset_minutes = $digitsName( text + i + 4, 2, &invalid );
+         |    success = !invalid && ( offset_hours <= 23 ) && ( offset_minutes <= 59 );
+         |    offset = ( offset_hours * 60 + offset_minutes ) * ( ( '-' == text[i] ) ? -60 : 60 );
+         |    i += 6;
+         |    }
+         |else
+         |    {
+         |    success = 0;
+         |    }
+         |
+         |success = success && ( i == text_len ) &&
+         |          ( month >= 1 ) && ( month <= 12 ) && ( day >= 1 ) && ( hour <= 23 ) && ( minute <= 59 ) && ( second <= 60 ) &&
+         |          ( day <= month_days[month - 1] + ( ( 2 == month ) && ( 0 == year % 4 ) && ( ( 0 != year % 100 ) || ( 0 == year % 400 ) ) ) );
+         |
+         |if( success )
+         |    {
+         |    // Count the days since the epoch in eras of 400 years, whose years start on March 1st
+         |    // so that leap days are the last days of their years
+         |    year -= ( month <= 2 );
+         |    era = ( ( year >= 0 ) ? year : year - 399 ) / 400;
+         |    year_of_era = year - era * 400;
+         |    day_of_year = ( 153 * ( ( month > 2 ) ? month - 3 : month + 9 ) + 2 ) / 5 + day - 1;
+         |    seconds = ( era * 146097 + year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year - 719468 ) * 86400 +
+         |              hour * 3600 + minute * 60 + second - offset;
+         |
+         |    // Nanoseconds since the epoch cover the years 1677 to 2262
+         |    success = ( seconds >= INT64_MIN / 1000000000 - 1 ) && ( seconds <= INT64_MAX / 1000000000 ) &&
+         |              ( ( seconds > INT64_MIN / 1000000000 - 1 ) || ( nanos >= INT64_MIN % 1000000000 + 1000000000 ) ) &&
+         |              ( ( seconds < INT64_MAX / 1000000000 ) || ( nanos <= INT64_MAX % 1000000000 ) );
+         |    }
+         |
+         |// The fraction of a negative time is added to the next second so that nothing overflows
+         |if( success )
+         |    {
+         |    *value_out = ( seconds < 0 ) ? ( seconds + 1 ) * 1000000000 - ( 1000000000 - nanos ) : seconds * 1000000000 + nanos;
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+
+  private val formatFunction = FunctionDefinition(
+    name = formatName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Format a timestamp",
+      description = s"Writes the nanoseconds since the Unix epoch to text as a NUL-terminated RFC 3339 date-time in UTC. The text must hold $textSize characters. The fraction has as many groups of three digits as it needs, if any. Returns the length of the text."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = "size_t",
+      parameters = List(
+        FunctionParameter(Constants.defaultTimestampCType, "value"),
+        FunctionParameter("char*", "text")
+      )
+    ),
+    body =
+      s"""int64_t seconds;
+         |int64_t nanos;
+         |int64_t days;
+         |int64_t era;
+         |int64_t day_of_era;
+         |int64_t year_of_era;
+         |int64_t day_of_year;
+         |int64_t month_index;
+         |int64_t month;
+         |size_t digits;
+         |size_t length;
+         |
+         |// Round towards negative infinity so that the fraction and the time of day are positive
+         |seconds = value / 1000000000;
+         |nanos = value % 1000000000;
+         |if( nanos < 0 )
+         |    {
+         |    seconds--;
+         |    nanos += 1000000000;
+         |    }
+         |
+         |days = seconds / 86400;
+         |seconds %= 86400;
+         |if( seconds < 0 )
+         |    {
+         |    days--;
+         |    seconds += 86400;
+         |    }
+         |
+         |// Inverse of the day count of the parser
+         |days += 719468;
+         |era = ( ( days >= 0 ) ? days : days - 146096 ) / 146097;
+         |day_of_era = days - era * 146097;
+         |year_of_era = ( day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096 ) / 365;
+         |day_of_year = day_of_era - ( 365 * year_of_era + year_of_era / 4 - year_of_era / 100 );
+         |month_index = ( 5 * day_of_year + 2 ) / 153;
+         |month = ( month_index < 10 ) ? month_index + 3 : month_index - 9;
+         |
+         |$putDigitsName( text, era * 400 + year_of_era + ( month <= 2 ), 4 );
+         |text[4] = '-';
+         |$putDigitsName( text + 5, month, 2 );
+         |text[7] = '-';
+         |$putDigitsName( text + 8, day_of_year - ( 153 * month_index + 2 ) / 5 + 1, 2 );
+         |text[10] = 'T';
+         |$putDigitsName( text + 11, seconds / 3600, 2 );
+         |text[13] = ':';
+         |$putDigitsName( text + 14, seconds / 60 % 60, 2 );
+         |text[16] = ':';
+         |$putDigitsName( text + 17, seconds % 60, 2 );
+         |length = 19;
+         |
+         |// Write milli-, micro- or nanoseconds, whichever is the shortest exact fraction
+         |if( 0 != nanos )
+         |    {
+         |    for( digits = 9; 0 == nanos % 1000; digits -= 3 )
+         |        {
+         |        nanos /= 1000;
+         |        }
+         |
+         |    text[length++] = '.';
+         |    $putDigitsName( text + length, nanos, digits );
+         |    length += digits;
+         |    }
+         |
+         |text[length++] = 'Z';
+         |text[length] = '\\0';
+         |
+         |return length;""".stripMargin
+  )
+}
@@ -0,0 +1,8 @@
+package codegen.types
+
+/**
+  * Contains information necessary to define a C enum
+  * @param name Name of enum
+  * @param constants Names of the enum's constants, in the order of their values
+  */
+case class EnumDefinition(name: String, constants: Seq[String])
@@ -0,0 +1,18 @@
+package codegen.types
+
+
+object EnumGenerator {
+
+  /**
+    * Generates a string to declare a C enum. The constants are numbered from zero in
+    * the order they are defined.
+    * @param definition Definition of the enum to generate
+    * @return String to declare the C enum
+    */
+  def apply(definition: EnumDefinition): String = {
+    s"""typedef enum
+       |    {
+       |${definition.constants.map(constant => s"    $constant").mkString(",\n")}
+       |    } ${definition.name};""".stripMargin
+  }
+}
@@ -0,0 +1,237 @@
+package codegen.xml
+
+import codegen.Constants
+import codegen.allocator.Allocator
+import codegen.base64.Base64
+import codegen.functions._
+import codegen.json.parsing.EnumJSONParser
+import codegen.json.serialization.EnumJSONSerializer
+import codegen.messagetypes._
+import codegen.sourcefile._
+import codegen.timestamp.Timestamp
+import datamodel._
+
+object MessageXMLFiles {
+
+  /**
+    * Gets the header and C source file definitions that contain functions to parse and
+    * serialize messages to and from XML. The XML functions do not depend on cJSON.
+    * @param protocol Message protocol
+    * @return Files containing functions to parse and serialize all messages in the
+    *         protocol to and from XML
+    */
+  def apply(protocol: Protocol): SourceFilePair = {
+    val functions = protocol.messages.flatMap(messageFunctions(protocol, _)) ++ fileFunctions(protocol.messages)
+
+    SourceFilePair(
+      headerFile = headerFile(protocol, functions),
+      cFile = cFile(protocol, functions)
+    )
+  }
+
+  /**
+    * Gets the name of the C source file containing the definitions of functions
+    * to parse and serialize messages to and from XML
+    * @param protocolName Name of the protocol
+    * @return Name of C source file containing XML parsing/serialization function definitions
+    */
+  def cFileName(protocolName: String): String = {
+    s"$protocolName.xml.c"
+  }
+
+  /**
+    * Gets the include string to include the protocol's XML parsing/serialization header
+    * @param protocolName Name of the protocol
+    * @return Name of the protocol's XML header file surrounded by quotes to be used
+    *         in include statements
+    */
+  def headerFileInclude(protocolName: String): String = {
+    s""""${headerFileName(protocolName)}""""
+  }
+
+  /**
+    * Gets the name of the header file containing the declarations of functions
+    * to parse and serialize messages to and from XML
+    * @param protocolName Name of the protocol
+    * @return Name of protocol's XML parsing/serialization header
+    */
+  def headerFileName(protocolName: String): String = {
+    s"$protocolName.xml.h"
+  }
+
+  /**
+    * Gets all functions that are specific to a single message: the public parse and
+    * serialize functions, the static object parse and write functions, and the function to
+    * parse arrays of the message if any field uses it
+    * @param protocol Message protocol
+    * @param message Message
+    * @return List of the message's XML functions
+    */
+  private def messageFunctions(protocol: Protocol, message: Message): Seq[FunctionDefinition] = {
+    val usedInArrays = messageFieldTypes(protocol.messages).exists({
+      case ArrayType(ObjectType(objectName)) => objectName == message.name
+      case InlineArrayType(ObjectType(objectName), _) => objectName == message.name
+      case _ => false
+    })
+
+    val arrayParser = if(usedInArrays) List(MessageXMLParser.arrayFunction(ObjectType(message.name))) else Nil
+
+    arrayParser ++ List(
+      MessageXMLParser.objectFunction(message),
+      MessageXMLParser(message),
+      MessageXMLParser.withAllocator(message),
+      MessageXMLSerializer.objectFunction(message),
+      MessageXMLSerializer(message),
+      MessageXMLSerializer.withAllocator(message),
+      MessageXMLSerializer.toBuffer(message)
+    )
+  }
+
+  /**
+    * Gets the static helper functions needed by the functions of the given messages: the
+    * reader and writer runtime, the value parsers and array parsers of the field types,
+    * the base64 codec of bytes fields, the timestamp codec, the allocation functions and the enum conversions
+    * shared with JSON. Several field types share the same helper, so each helper is only
+    * returned once.
+    * @param messages Messages defined in the C source file
+    * @return List of static helper functions
+    */
+  private def fileFunctions(messages: Seq[Message]): Seq[FunctionDefinition] = {
+    val fieldTypes = messageFieldTypes(messages)
+
+    val valueParseFunctions = fieldTypes.flatMap(XMLValueParser.parseFunction)
+    val arrayParseFunctions = fieldTypes.collect({
+      case ArrayType(elementType) if MessageXMLParser.usesText(elementType) => MessageXMLParser.arrayFunction(MessageXMLParser.arrayElementType(elementType))
+      case InlineArrayType(elementType, _) if MessageXMLParser.usesText(elementType) => MessageXMLParser.arrayFunction(MessageXMLParser.arrayElementType(elementType))
+    })
+
+    // Aliased numbers are parsed as numbers first, interned and inline strings may be
+    // decoded as dynamic strings first
+    val numberFunctions = if(fieldTypes.exists(usesAliasedNumbers)) XMLValueParser.parseFunction(NumberType).toSeq else Nil
+    val stringFunctions = if(fieldTypes.exists(usesDynamicStrings)) XMLValueParser.parseFunction(DynamicStringType).toSeq else Nil
+
+    val parseFunctions = valueParseFunctions.toSeq ++ numberFunctions ++ stringFunctions
+
+    // Decoded numbers, booleans and timestamps may be surrounded by whitespace
+    val trimmedNames = Set(XMLValueParser.numberName, XMLValueParser.booleanName, XMLValueParser.timestampName)
+    val usesTrim = parseFunctions.exists(function => trimmedNames.contains(function.name))
+    val trimFunctions = if(usesTrim) List(XMLValueParser.trimFunction) else Nil
+
+    val internFunctions = if(fieldTypes.exists(Allocator.isInterned)) List(Allocator.internFunction) else Nil
+    val bytesFunctions = if(Bytes.isUsed(messages)) Base64.decodeFunction +: XMLWriter.bytesFunctions else Nil
+    val timestampFunctions = if(Timestamp.isUsed(messages)) XMLWriter.timestampFunctions else Nil
+
+    val enumFunctions = MessageEnum.enumTypes(messages).flatMap(enumType => List(
+      EnumJSONParser.fromStringFunction(enumType),
+      EnumJSONSerializer.toStringFunction(enumType)
+    ))
+
+    val helperFunctions = parseFunctions ++ arrayParseFunctions ++ trimFunctions
+    val uniqueHelperFunctions = helperFunctions.groupBy(_.name).values.map(_.head).toSeq.sortBy(_.name)
+
+    uniqueHelperFunctions ++
+      XMLReader.functions ++
+      XMLWriter.functions ++
+      bytesFunctions ++
+      timestampFunctions ++
+      Allocator.allocationFunctions ++
+      (Allocator.freeFunction +: internFunctions) ++
+      enumFunctions
+  }
+
+  /**
+    * @param fieldType Field type
+    * @return True if the field or its elements are aliased numbers
+    */
+  private def usesAliasedNumbers(fieldType: FieldType): Boolean = {
+    fieldType match {
+      case ArrayType(elementType) => usesAliasedNumbers(elementType)
+      case InlineArrayType(elementType, _) => usesAliasedNumbers(elementType)
+      case AliasedType(_, NumberType) => true
+      case _ => false
+    }
+  }
+
+  /**
+    * @param fieldType Field type
+    * @return True if the field or its elements are interned or inline strings, whose
+    *         parsers decode dynamic strings
+    */
+  private def usesDynamicStrings(fieldType: FieldType): Boolean = {
+    fieldType match {
+      case ArrayType(elementType) => usesDynamicStrings(elementType)
+      case InlineArrayType(elementType, _) => usesDynamicStrings(elementType)
+      case AliasedType(_, underlyingType) => usesDynamicStrings(underlyingType)
+      case InternedStringType | InlineStringType(_) => true
+      case _ => false
+    }
+  }
+
+  /**
+    * Gets the definition of the protocol's XML parsing/serialization header file
+    * @param protocol Message protocol
+    * @param functions List of functions to declare
+    * @return Definition for the protocol's XML parsing/serialization header file
+    */
+  private def headerFile(protocol: Protocol, functions: Seq[FunctionDefinition]): FileDefinition = {
+    val name = headerFileName(protocol.name)
+
+    val contents = HeaderFile(
+      name = name,
+      description = "Declares functions for parsing and serializing messages to and from XML",
+      includes = List(MessageTypeFiles.headerFileInclude(protocol.name)),
+      types = Nil,
+      functions = functions,
+      definitions = Nil
+    )
+
+    FileDefinition(name, contents)
+  }
+
+  /**
+    * Gets the definition for the C source file containing the XML parsing/serialization
+    * functions for the protocol
+    * @param protocol Message protocol
+    * @param functions List of all function definitions to include in the C source file
+    * @return Definition for the protocol's XML parsing/serialization C source file
+    */
+  private def cFile(protocol: Protocol, functions: Seq[FunctionDefinition]): FileDefinition = {
+    val name = cFileName(protocol.name)
+
+    val contents = CFile(
+      name = name,
+      description = "Contains functions for parsing and serializing messages to and from XML",
+      includes = List(
+        Constants.ctypeHeader,
+        Constants.limitsHeader,
+        Constants.stdintHeader,
+        Constants.stdioHeader,
+        Constants.stdlibHeader,
+        Constants.stringHeader,
+        headerFileInclude(protocol.name)
+      ),
+      functions = functions,
+      definitions = List(
+        Base64.sourceDefinitions,
+        XMLReader.typeDefinition,
+        XMLWriter.typeDefinition
+      )
+    )
+
+    FileDefinition(name, contents)
+  }
+
+  /**
+    * Gets the set of all field types used by the given messages
+    * @param messages Messages
+    * @return Set of field types used in the messages
+    */
+  private def messageFieldTypes(messages: Seq[Message]): Set[FieldType] = {
+    val fieldTypes = for {
+      message <- messages
+      field <- message.fields
+    } yield field.fieldType
+
+    fieldTypes.toSet
+  }
+}
@@ -0,0 +1,469 @@
+package codegen.xml
+
+import codegen.Constants
+import codegen.allocator.Allocator
+import codegen.functions._
+import codegen.messagetypes._
+import datamodel._
+
+/**
+  * Creates the functions that parse messages from XML with the pull reader. A message is
+  * an element whose children are its fields, named after the fields' XML names, in any
+  * order. Arrays are elements whose children are all named item. Like in JSON, every field
+  * without a default or omitEmpty is required, and elements of unknown fields are skipped.
+  */
+object MessageXMLParser {
+
+  private val reader = XMLReader.paramName
+  private val xmlParam = "xml"
+  private val lengthParam = "xml_len"
+  private val messageOutputParam = "obj_out"
+  private val nameParam = "name"
+  private val nameLengthParam = "name_len"
+  private val emptyParam = "empty"
+  private val inlineArrayParam = "inline_array"
+  private val inlineCapacityParam = "inline_cap"
+  private val arrayOutputParam = "array_out"
+  private val countOutputParam = "array_cnt_out"
+
+  private val elementParameters = List(
+    XMLReader.parameter,
+    FunctionParameter("char const*", nameParam),
+    FunctionParameter("size_t", nameLengthParam),
+    FunctionParameter(Constants.defaultBooleanCType, emptyParam)
+  )
+
+  /**
+    * Byte order mark that UTF-8 documents may start with
+    */
+  private val byteOrderMark = "\\xEF\\xBB\\xBF"
+
+  /**
+    * @param messageName Name of message
+    * @return Name of the internal function to parse a message from an element
+    */
+  def objectName(messageName: String): String = {
+    s"${messageName}_xml_obj_parse"
+  }
+
+  /**
+    * @param messageName Name of message
+    * @return Name of the function to parse a message from an XML document
+    */
+  def name(messageName: String): String = {
+    s"${messageName}_xml_parse"
+  }
+
+  /**
+    * @param messageName Name of message
+    * @return Name of the function to parse a message from an XML document with an allocator
+    */
+  def exName(messageName: String): String = {
+    name(messageName) + Allocator.functionNameSuffix
+  }
+
+  /**
+    * Gets the name of the function to parse an array of the given element type. Element
+    * types that are stored alike share a function.
+    * @param elementType Type of the array's elements
+    * @return Name of the array parse function
+    */
+  def arrayName(elementType: SimpleFieldType): String = {
+    val suffix = "_array_xml_parse"
+
+    elementType match {
+      case AliasedType(alias, NumberType) => alias + suffix
+      case AliasedType(_, underlyingType) => arrayName(underlyingType)
+      case ObjectType(objectName) => objectName + suffix
+      case BooleanType => "boolean" + suffix
+      case DynamicStringType | FixedStringType(_) | InlineStringType(_) => "string" + suffix
+      case InternedStringType => "interned_string" + suffix
+      case NumberType => "number" + suffix
+      case TimestampType => "timestamp" + suffix
+      case EnumType(enumName, _) => enumName + suffix
+    }
+  }
+
+  /**
+    * Creates the public function to parse a message from an XML document
+    * @param message Message to parse
+    * @return Definition of the parse function
+    */
+  def apply(message: Message): FunctionDefinition = {
+    FunctionDefinition(
+      name = name(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Parse a ${message.name} from XML",
+        description = s"Parses the first $lengthParam bytes of $xmlParam, a document whose root element is named ${message.name}, into a ${message.name}. The buffer need not be NUL-terminated. The caller must call ${MessageFreeFunction.name(message.name)} on $messageOutputParam."
+      ),
+      prototype = prototype(message),
+      body = s"return ${exName(message.name)}( $xmlParam, $lengthParam, $messageOutputParam, ${Allocator.defaultAllocator} );"
+    )
+  }
+
+  /**
+    * Creates the public function to parse a message from an XML document with an allocator
+    * @param message Message to parse
+    * @return Definition of the parse function with an allocator
+    */
+  def withAllocator(message: Message): FunctionDefinition = {
+    val basePrototype = prototype(message)
+
+    FunctionDefinition(
+      name = exName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Parse a ${message.name} from XML with an allocator",
+        description = s"Parses the first $lengthParam bytes of $xmlParam, a document whose root element is named ${message.name}, into a ${message.name}, making all allocations through ${Allocator.paramName}. The buffer need not be NUL-terminated. The caller must call ${MessageFreeFunction.exName(message.name)} on $messageOutputParam with the same allocator."
+      ),
+      prototype = basePrototype.copy(parameters = basePrototype.parameters :+ Allocator.parameter),
+      body =
+        s"""${Constants.defaultBooleanCType} success;
+           |${XMLReader.typeName} $reader;
+           |char const* $nameParam;
+           |size_t $nameLengthParam;
+           |${Constants.defaultBooleanCType} $emptyParam;
+           |
+           |${XMLReader.initialize(reader, xmlParam, lengthParam)}
+           |${MessageInitFunction.name(message.name)}( $messageOutputParam );
+           |
+           |// Skip the byte order mark, the XML declaration and any comments before the root element
+           |${XMLReader.literalName}( &$reader, "$byteOrderMark" );
+           |success = ${XMLReader.miscName}( &$reader ) && ${XMLReader.startTagName}( &$reader, &$nameParam, &$nameLengthParam, &$emptyParam );
+           |success = success && ${XMLReader.nameEquals(nameParam, nameLengthParam, message.name)};
+           |success = success && ${objectName(message.name)}( &$reader, $nameParam, $nameLengthParam, $emptyParam, $messageOutputParam, ${Allocator.paramName} );
+           |
+           |// Only comments and processing instructions may follow the root element
+           |success = success && ${XMLReader.miscName}( &$reader ) && ( $reader.pos == $reader.len );
+           |
+           |// Reset the output on error
+           |if( !success )
+           |    {
+           |    ${MessageFreeFunction.exName(message.name)}( $messageOutputParam, ${Allocator.paramName} );
+           |    }
+           |
+           |return success;""".stripMargin
+    )
+  }
+
+  /**
+    * Creates the static function to parse a message from an element whose start tag was
+    * just read
+    * @param message Message to parse
+    * @return Definition of the object parse function
+    */
+  def objectFunction(message: Message): FunctionDefinition = {
+    val fieldCount = message.fields.length
+    val fieldBranches = message.fields.zipWithIndex.map({ case (field, index) =>
+      s"""if( ${XMLReader.nameEquals("child", "child_len", field.xmlElementName)} )
+         |    {
+         |    success = !seen[$index] && ${fieldParseCall(field)};
+         |    seen[$index] = 1;
+         |    }""".stripMargin
+    })
+    val textLocals = if(message.fields.exists(field => usesText(field.fieldType))) "\nchar const* text;\nsize_t text_len;" else ""
+    val (indexLocal, requiredCheck) = requiredFieldsCheck(message)
+    val indexSnippet = if(ArrayIndex.hasIndexes(message)) {
+      s"""
+         |
+         |// Index the arrays once all of their elements are parsed
+         |success = success && ${ArrayIndex.buildCall(message.name, messageOutputParam)};""".stripMargin
+    } else {
+      ""
+    }
+
+    FunctionDefinition(
+      name = objectName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Parse ${message.name} XML element",
+        description = s"Parses the content and end tag of the named element, whose start tag was just read, as a ${message.name}. Returns 1 if the parse was successful, 0 otherwise."
+      ),
+      prototype = FunctionPrototype(
+        isStatic = true,
+        returnType = Constants.defaultBooleanCType,
+        parameters = elementParameters ++ List(
+          FunctionParameter(s"${message.name}*", messageOutputParam),
+          Allocator.parameter
+        )
+      ),
+      body =
+        s"""${Constants.defaultBooleanCType} success;
+           |${Constants.defaultBooleanCType} seen[$fieldCount];
+           |${Constants.defaultBooleanCType} child_empty;$indexLocal
+           |char const* child;
+           |size_t child_len;$textLocals
+           |
+           |${MessageInitFunction.name(message.name)}( $messageOutputParam );
+           |memset( seen, 0, sizeof( seen ) );
+           |
+           |// Messages can contain themselves through arrays, so their nesting is limited
+           |$reader->depth++;
+           |success = ( $reader->depth <= ${XMLReader.nestingLimitMacro} );
+           |child = NULL;
+           |
+           |if( success && !$emptyParam )
+           |    {
+           |    success = ${XMLReader.childName}( $reader, $nameParam, $nameLengthParam, &child, &child_len, &child_empty );
+           |    }
+           |
+           |// Fields may appear in any order
+           |while( success && ( NULL != child ) )
+           |    {
+           |    ${indent(fieldBranches.mkString("\nelse "))}
+           |    else
+           |        {
+           |        // Unknown elements are skipped
+           |        success = ${XMLReader.skipElementName}( $reader, child_empty );
+           |        }
+           |
+           |    success = success && ${XMLReader.childName}( $reader, $nameParam, $nameLengthParam, &child, &child_len, &child_empty );
+           |    }
+           |
+           |$requiredCheck
+           |
+           |$reader->depth--;$indexSnippet
+           |
+           |// Reset the output on error
+           |if( !success )
+           |    {
+           |    ${MessageFreeFunction.exName(message.name)}( $messageOutputParam, ${Allocator.paramName} );
+           |    }
+           |
+           |return success;""".stripMargin
+    )
+  }
+
+  /**
+    * Gets the statements run once all children of a message element are read, which check
+    * that the required fields were seen and set missing fields to their default
+    * @param message Message to parse
+    * @return Declaration of the loop index the statements need, if any, and the statements
+    */
+  private def requiredFieldsCheck(message: Message): (String, String) = {
+    if(!message.fields.exists(OptionalField.isOptional)) {
+      (s"\n${Constants.defaultIntCType} i;",
+        s"""// Every field is required
+           |for( i = 0; success && ( i < ${message.fields.length} ); i++ )
+           |    {
+           |    success = seen[i];
+           |    }""".stripMargin)
+    } else {
+      val indexedFields = message.fields.zipWithIndex
+      val requiredSeen = indexedFields.filterNot({ case (field, _) => OptionalField.isOptional(field) }).map({ case (_, index) => s"seen[$index]" })
+      val requiredSnippet = if(requiredSeen.isEmpty) Nil else List(
+        s"""// Fields without a default or omitEmpty are required
+           |success = success && ${requiredSeen.mkString(" && ")};""".stripMargin
+      )
+      val defaultSnippets = indexedFields.flatMap({ case (field, index) =>
+        OptionalField.defaultAssignment(messageOutputParam, field).map(assignment =>
+          s"""// Set the missing ${field.name} to its default
+             |if( success && !seen[$index] )
+             |    {
+             |    $assignment
+             |    }""".stripMargin
+        )
+      })
+
+      val snippets = requiredSnippet ++ defaultSnippets
+
+      ("", if(snippets.isEmpty) "// Every field is optional" else snippets.mkString("\n\n"))
+    }
+  }
+
+  /**
+    * Creates the static function to parse an array of the given element type from an
+    * element whose start tag was just read. The items are counted first, so the array is
+    * allocated once. Arrays with up to inline_cap items are stored in the inline buffer.
+    * @param elementType Type of the array's elements
+    * @return Definition of the array parse function
+    */
+  def arrayFunction(elementType: SimpleFieldType): FunctionDefinition = {
+    val arrayType = MessageStruct.arrayFieldType(elementType)
+    val textLocals = if(usesText(elementType)) "\nchar const* text;\nsize_t text_len;" else ""
+
+    FunctionDefinition(
+      name = arrayName(elementType),
+      documentation = FunctionDocumentation(
+        shortSummary = "Parse XML array",
+        description = s"Parses the item children of the named element, whose start tag was just read, as an array. Up to $inlineCapacityParam items are stored in $inlineArrayParam and $arrayOutputParam is set to NULL, more items are stored in a heap array. Returns 1 if the parse was successful, 0 otherwise. The caller must free the parsed array"
+      ),
+      prototype = FunctionPrototype(
+        isStatic = true,
+        returnType = Constants.defaultBooleanCType,
+        parameters = elementParameters ++ List(
+          FunctionParameter(arrayType, inlineArrayParam),
+          FunctionParameter(Constants.defaultIntCType, inlineCapacityParam),
+          FunctionParameter(s"$arrayType*", arrayOutputParam),
+          FunctionParameter(s"${Constants.defaultIntCType}*", countOutputParam),
+          Allocator.parameter
+        )
+      ),
+      body =
+        s"""${Constants.defaultBooleanCType} success;
+           |${Constants.defaultBooleanCType} item_empty;
+           |$arrayType array;
+           |$arrayType element;
+           |${Constants.defaultIntCType} array_cnt;
+           |${Constants.defaultIntCType} i;
+           |char const* item;
+           |size_t item_len;$textLocals
+           |
+           |array = NULL;
+           |array_cnt = 0;
+           |success = $emptyParam || ${XMLReader.countItemsName}( $reader, $nameParam, $nameLengthParam, &array_cnt );
+           |
+           |// Allocate room for the items that do not fit inline. Initialize the array's memory
+           |// to all zeros, like the inline buffer was with the message, so it is safe to free
+           |// the array if an error occurs in the middle of parsing.
+           |if( success && ( array_cnt > $inlineCapacityParam ) )
+           |    {
+           |    array = ${Allocator.calloc("( size_t )array_cnt", "sizeof( *array )")};
+           |    success = ( NULL != array );
+           |    array_cnt = success ? array_cnt : 0;
+           |    }
+           |
+           |for( i = 0; success && ( i < array_cnt ); i++ )
+           |    {
+           |    element = ( NULL != array ) ? &array[i] : &$inlineArrayParam[i];
+           |    success = ${XMLReader.childName}( $reader, $nameParam, $nameLengthParam, &item, &item_len, &item_empty ) && ( NULL != item );
+           |    success = success && ${elementParseCall(elementType)};
+           |    }
+           |
+           |// Consume the end tag of the array
+           |if( success && !$emptyParam )
+           |    {
+           |    success = ${XMLReader.childName}( $reader, $nameParam, $nameLengthParam, &item, &item_len, &item_empty ) && ( NULL == item );
+           |    }
+           |
+           |*$arrayOutputParam = array;
+           |*$countOutputParam = array_cnt;
+           |
+           |return success;""".stripMargin
+    )
+  }
+
+  /**
+    * Gets the element type to generate an array parse function for. Arrays of aliased
+    * numbers are parsed with the width of the alias, other aliases share the function of
+    * their underlying type, like in JSON.
+    * @param elementType Type of an array's elements
+    * @return Element type of the array parse function
+    */
+  def arrayElementType(elementType: SimpleFieldType): SimpleFieldType = {
+    elementType match {
+      case AliasedType(_, NumberType) => elementType
+      case AliasedType(_, underlyingType) => underlyingType
+      case _ => elementType
+    }
+  }
+
+  /**
+    * @param fieldType Type of a field or of the elements of an array field
+    * @return True if the type's values are parsed from the text of an element
+    */
+  def usesText(fieldType: FieldType): Boolean = {
+    fieldType match {
+      case ArrayType(_) | InlineArrayType(_, _) | ObjectType(_) => false
+      case _ => true
+    }
+  }
+
+  /**
+    * @param message Message to parse
+    * @return Prototype of the public parse function
+    */
+  private def prototype(message: Message): FunctionPrototype = {
+    FunctionPrototype(
+      isStatic = false,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter("char const*", xmlParam),
+        FunctionParameter("size_t", lengthParam),
+        FunctionParameter(s"${message.name}*", messageOutputParam)
+      )
+    )
+  }
+
+  /**
+    * Gets the call to parse a field from the child element that was just read
+    * @param field Field to parse
+    * @return Call parsing the field
+    */
+  private def fieldParseCall(field: Field): String = {
+    val member = s"$messageOutputParam->${field.name}"
+    val elementArguments = s"$reader, child, child_len, child_empty"
+    val count = s"&$messageOutputParam->${MessageStruct.arrayCountFieldName(field.name)}"
+
+    field.fieldType match {
+      case ArrayType(elementType) =>
+        s"${arrayName(elementType)}( $elementArguments, NULL, 0, &$member, $count, ${Allocator.paramName} )"
+      case InlineArrayType(elementType, capacity) =>
+        s"${arrayName(elementType)}( $elementArguments, $messageOutputParam->${InlineArray.bufferName(field.name)}, $capacity, &$member, $count, ${Allocator.paramName} )"
+      case ObjectType(nestedName) =>
+        s"${objectName(nestedName)}( $elementArguments, &$member, ${Allocator.paramName} )"
+      case InlineStringType(_) =>
+        val buffer = s"$messageOutputParam->${InlineString.bufferName(field.name)}"
+        s"${readText(elementArguments)} && ${XMLValueParser.inlineStringName}( text, text_len, $buffer, sizeof( $buffer ), &$member, ${Allocator.paramName} )"
+      case FixedStringType(_) | AliasedType(_, FixedStringType(_)) =>
+        s"${readText(elementArguments)} && ${XMLReader.decodeName}( text, text_len, ( char* )$member, sizeof( $member ), NULL )"
+      case BytesType =>
+        s"${readText(elementArguments)} && ${XMLValueParser.bytesName}( text, text_len, &${Bytes.data(member)}, &${Bytes.length(member)}, ${Allocator.paramName} )"
+      case simpleType: SimpleFieldType =>
+        s"${readText(elementArguments)} && ${valueParseCall(simpleType, s"&$member")}"
+    }
+  }
+
+  /**
+    * Gets the call to parse an array item that was just read into the element pointer
+    * @param elementType Type of the array's elements
+    * @return Call parsing the item
+    */
+  private def elementParseCall(elementType: SimpleFieldType): String = {
+    val itemArguments = s"$reader, item, item_len, item_empty"
+
+    elementType match {
+      case ObjectType(nestedName) => s"${objectName(nestedName)}( $itemArguments, element, ${Allocator.paramName} )"
+      case _ => s"${readText(itemArguments)} && ${valueParseCall(elementType, "element")}"
+    }
+  }
+
+  /**
+    * @param elementArguments Arguments naming the element whose text to read
+    * @return Call reading the text of an element
+    */
+  private def readText(elementArguments: String): String = {
+    s"${XMLReader.textName}( $elementArguments, &text, &text_len )"
+  }
+
+  /**
+    * Gets the call to parse a value from the text of an element. In arrays, fixed-length and
+    * inline strings are dynamically-allocated.
+    * @param valueType Type of the value
+    * @param address Expression of the address to store the value at
+    * @return Call parsing the value
+    */
+  private def valueParseCall(valueType: SimpleFieldType, address: String): String = {
+    valueType match {
+      case AliasedType(alias, NumberType) => s"${XMLValueParser.aliasedNumberName(alias)}( text, text_len, $address )"
+      case AliasedType(_, BooleanType) => s"${XMLValueParser.booleanName}( text, text_len, ( ${Constants.defaultBooleanCType}* )$address )"
+      case AliasedType(_, TimestampType) => s"${XMLValueParser.timestampName}( text, text_len, ( ${Constants.defaultTimestampCType}* )$address )"
+      case AliasedType(_, InternedStringType) => s"${XMLValueParser.internedStringName}( text, text_len, ( char const** )$address, ${Allocator.paramName} )"
+      case AliasedType(_, _) => s"${XMLValueParser.stringName}( text, text_len, ( char** )$address, ${Allocator.paramName} )"
+      case ObjectType(_) => throw new IllegalArgumentException("Objects are not parsed from text")
+      case BooleanType => s"${XMLValueParser.booleanName}( text, text_len, $address )"
+      case DynamicStringType | FixedStringType(_) | InlineStringType(_) => s"${XMLValueParser.stringName}( text, text_len, $address, ${Allocator.paramName} )"
+      case InternedStringType => s"${XMLValueParser.internedStringName}( text, text_len, $address, ${Allocator.paramName} )"
+      case NumberType => s"${XMLValueParser.numberName}( text, text_len, $address )"
+      case TimestampType => s"${XMLValueParser.timestampName}( text, text_len, $address )"
+      case enumType: EnumType => s"${XMLValueParser.enumName(enumType)}( text, text_len, $address )"
+    }
+  }
+
+  /**
+    * Indents all but the first line of a snippet by one level
+    * @param snippet Snippet of code
+    * @return Indented snippet
+    */
+  private def indent(snippet: String): String = {
+    snippet.replace("\n", "\n    ")
+  }
+}
@@ -0,0 +1,281 @@
+package codegen.xml
+
+import codegen.Constants
+import codegen.allocator.Allocator
+import codegen.functions._
+import codegen.json.serialization.EnumJSONSerializer
+import codegen.messagetypes._
+import datamodel._
+
+/**
+  * Creates the functions that serialize messages to XML. The XML is written straight into
+  * the output buffer by the XML writer. The document's root element is named after the
+  * message, every field is an element named after the field's XML name, and the elements of
+  * arrays are item elements.
+  */
+object MessageXMLSerializer {
+
+  private val messageParam = "obj"
+  private val writer = XMLWriter.paramName
+  private val xmlOutputParam = "xml_out"
+  private val bufferParam = "buffer"
+  private val bufferSizeParam = "buffer_size"
+  private val lengthOutputParam = "xml_len_out"
+
+  /**
+    * @param messageName Name of message
+    * @return Name of the internal function to write a message's fields
+    */
+  def objectName(messageName: String): String = {
+    s"${messageName}_xml_obj_write"
+  }
+
+  /**
+    * @param messageName Name of message
+    * @return Name of the function to serialize a message to an XML document
+    */
+  def name(messageName: String): String = {
+    s"${messageName}_xml_serialize"
+  }
+
+  /**
+    * @param messageName Name of message
+    * @return Name of the function to serialize a message to an XML document with an allocator
+    */
+  def exName(messageName: String): String = {
+    name(messageName) + Allocator.functionNameSuffix
+  }
+
+  /**
+    * @param messageName Name of message
+    * @return Name of the function to serialize a message into a caller-provided buffer
+    */
+  def bufferName(messageName: String): String = {
+    s"${messageName}_xml_serialize_to_buffer"
+  }
+
+  /**
+    * Creates the public function to serialize a message to an XML document
+    * @param message Message to serialize
+    * @return Definition of the serialize function
+    */
+  def apply(message: Message): FunctionDefinition = {
+    FunctionDefinition(
+      name = name(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Serialize a ${message.name} to XML",
+        description = s"Serializes the ${message.name} to a NUL-terminated XML document whose root element is named ${message.name}. The caller must free $xmlOutputParam with free()."
+      ),
+      prototype = prototype(message),
+      body = s"return ${exName(message.name)}( $messageParam, $xmlOutputParam, ${Allocator.defaultAllocator} );"
+    )
+  }
+
+  /**
+    * Creates the public function to serialize a message to an XML document with an allocator
+    * @param message Message to serialize
+    * @return Definition of the serialize function with an allocator
+    */
+  def withAllocator(message: Message): FunctionDefinition = {
+    val basePrototype = prototype(message)
+
+    FunctionDefinition(
+      name = exName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Serialize a ${message.name} to XML with an allocator",
+        description = s"Serializes the ${message.name} to a NUL-terminated XML document whose root element is named ${message.name}, allocating the document through ${Allocator.paramName}. The caller must free $xmlOutputParam with the same allocator."
+      ),
+      prototype = basePrototype.copy(parameters = basePrototype.parameters :+ Allocator.parameter),
+      body =
+        s"""${Constants.defaultBooleanCType} success;
+           |${XMLWriter.typeName} $writer;
+           |
+           |${XMLWriter.initialize(writer, "NULL", "0", fixed = false)}
+           |*$xmlOutputParam = NULL;
+           |
+           |success = ${rootElement(message, s"&$writer")};
+           |
+           |// The writer always keeps room for the NUL terminator
+           |if( success )
+           |    {
+           |    $writer.data[$writer.len] = '\\0';
+           |    *$xmlOutputParam = $writer.data;
+           |    }
+           |else
+           |    {
+           |    ${Allocator.freeFunction.name}( ${Allocator.paramName}, $writer.data );
+           |    }
+           |
+           |return success;""".stripMargin
+    )
+  }
+
+  /**
+    * Creates the public function to serialize a message into a caller-provided buffer
+    * @param message Message to serialize
+    * @return Definition of the serialize to buffer function
+    */
+  def toBuffer(message: Message): FunctionDefinition = {
+    FunctionDefinition(
+      name = bufferName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Serialize a ${message.name} to XML in a buffer",
+        description = s"Serializes the ${message.name} into the caller's buffer of $bufferSizeParam bytes as a NUL-terminated XML document, without allocating. The length of the document, without the NUL terminator, is always stored in $lengthOutputParam, so if the buffer is too small the caller can retry with a buffer of $lengthOutputParam + 1 bytes. Returns 1 if the document fit into the buffer, 0 otherwise."
+      ),
+      prototype = FunctionPrototype(
+        isStatic = false,
+        returnType = Constants.defaultBooleanCType,
+        parameters = List(
+          FunctionParameter(s"${MessageStruct.structName(message)} const*", messageParam),
+          FunctionParameter("char*", bufferParam),
+          FunctionParameter("size_t", bufferSizeParam),
+          FunctionParameter("size_t*", lengthOutputParam)
+        )
+      ),
+      body =
+        s"""${Constants.defaultBooleanCType} success;
+           |${XMLWriter.typeName} $writer;
+           |${Allocator.typeName} const* ${Allocator.paramName};
+           |
+           |// A fixed writer never allocates
+           |${Allocator.paramName} = ${Allocator.defaultAllocator};
+           |${XMLWriter.initialize(writer, bufferParam, bufferSizeParam, fixed = true)}
+           |
+           |success = ${rootElement(message, s"&$writer")};
+           |
+           |*$lengthOutputParam = $writer.len;
+           |success = success && ( $writer.len < $bufferSizeParam );
+           |
+           |if( success )
+           |    {
+           |    $bufferParam[$writer.len] = '\\0';
+           |    }
+           |
+           |return success;""".stripMargin
+    )
+  }
+
+  /**
+    * Creates the static function to write the fields of a message as child elements
+    * @param message Message to serialize
+    * @return Definition of the object write function
+    */
+  def objectFunction(message: Message): FunctionDefinition = {
+    val hasArrays = message.fields.exists(field => field.fieldType match {
+      case ArrayType(_) | InlineArrayType(_, _) => true
+      case _ => false
+    })
+    val arrayLocals = if(hasArrays) s"\n${Constants.defaultIntCType} i;" else ""
+
+    FunctionDefinition(
+      name = objectName(message.name),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Write ${message.name} XML elements",
+        description = s"Writes the fields of the ${message.name} as child elements. Returns 1 if successful, 0 otherwise."
+      ),
+      prototype = FunctionPrototype(
+        isStatic = true,
+        returnType = Constants.defaultBooleanCType,
+        parameters = List(
+          FunctionParameter(s"${MessageStruct.structName(message)} const*", messageParam),
+          XMLWriter.parameter
+        )
+      ),
+      body =
+        s"""${Constants.defaultBooleanCType} success;$arrayLocals
+           |
+           |success = 1;
+           |
+           |${message.fields.map(fieldWrite).mkString("\n\n")}
+           |
+           |return success;""".stripMargin
+    )
+  }
+
+  /**
+    * @param message Message to serialize
+    * @return Prototype of the public serialize function
+    */
+  private def prototype(message: Message): FunctionPrototype = {
+    FunctionPrototype(
+      isStatic = false,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter(s"${MessageStruct.structName(message)} const*", messageParam),
+        FunctionParameter("char**", xmlOutputParam)
+      )
+    )
+  }
+
+  /**
+    * @param message Message to serialize
+    * @param writerPointer Expression of the writer pointer
+    * @return Expression writing the document's root element
+    */
+  private def rootElement(message: Message, writerPointer: String): String = {
+    s"${XMLWriter.write(writerPointer, s"<${message.name}>")} && ${objectName(message.name)}( $messageParam, $writerPointer ) && ${XMLWriter.write(writerPointer, s"</${message.name}>")}"
+  }
+
+  /**
+    * Gets the statements that write a field as an element
+    * @param field Field to write
+    * @return Statements writing the field
+    */
+  private def fieldWrite(field: Field): String = {
+    val member = s"$messageParam->${field.name}"
+    val count = s"$messageParam->${MessageStruct.arrayCountFieldName(field.name)}"
+    val startTag = XMLWriter.write(writer, s"<${field.xmlElementName}>")
+    val endTag = XMLWriter.write(writer, s"</${field.xmlElementName}>")
+
+    val write = field.fieldType match {
+      case ArrayType(elementType) => arrayWrite(startTag, endTag, elementType, member, count)
+      case InlineArrayType(elementType, _) => arrayWrite(startTag, endTag, elementType, InlineArray.elements(member), count)
+      case InlineStringType(_) => s"success = success && $startTag && ${XMLWriter.textName}( $writer, ${InlineString.value(member)} ) && $endTag;"
+      case BytesType => s"success = success && $startTag && ${XMLWriter.bytesName}( $writer, ${Bytes.data(member)}, ${Bytes.length(member)} ) && $endTag;"
+      case simpleType: SimpleFieldType => s"success = success && $startTag && ${valueWrite(simpleType, member)} && $endTag;"
+    }
+
+    // Optional fields are left out while they hold their default or are empty
+    OptionalField.guard(OptionalField.omitCondition(messageParam, field), write)
+  }
+
+  /**
+    * Gets the statements that write an array as an element of item elements
+    * @param startTag Call writing the array's start tag
+    * @param endTag Call writing the array's end tag
+    * @param elementType Type of the array's elements
+    * @param elements Expression of the array's elements
+    * @param count Expression of the number of elements
+    * @return Statements writing the array
+    */
+  private def arrayWrite(startTag: String, endTag: String, elementType: SimpleFieldType, elements: String, count: String): String = {
+    val itemStart = XMLWriter.write(writer, s"<${XMLReader.itemName}>")
+    val itemEnd = XMLWriter.write(writer, s"</${XMLReader.itemName}>")
+
+    s"""success = success && $startTag;
+       |for( i = 0; success && ( i < $count ); i++ )
+       |    {
+       |    success = $itemStart && ${valueWrite(elementType, s"$elements[i]")} && $itemEnd;
+       |    }
+       |success = success && $endTag;""".stripMargin
+  }
+
+  /**
+    * Gets the call to write a value as element text or child elements. In arrays, fixed-length
+    * and inline strings are dynamically-allocated.
+    * @param valueType Type of the value
+    * @param value Expression of the value
+    * @return Call writing the value
+    */
+  private def valueWrite(valueType: SimpleFieldType, value: String): String = {
+    valueType match {
+      case AliasedType(_, NumberType) | NumberType => s"${XMLWriter.numberName}( $writer, ( ${Constants.defaultNumberCType} )$value )"
+      case AliasedType(_, BooleanType) | BooleanType => s"${XMLWriter.booleanName}( $writer, $value )"
+      case AliasedType(_, TimestampType) | TimestampType => s"${XMLWriter.timestampName}( $writer, $value )"
+      case AliasedType(_, _) => s"${XMLWriter.textName}( $writer, ( char const* )$value )"
+      case ObjectType(nestedName) => s"${objectName(nestedName)}( &$value, $writer )"
+      case DynamicStringType | InternedStringType | FixedStringType(_) | InlineStringType(_) => s"${XMLWriter.textName}( $writer, $value )"
+      case enumType: EnumType => s"${XMLWriter.textName}( $writer, ${EnumJSONSerializer.toStringName(enumType)}( $value ) )"
+    }
+  }
+}
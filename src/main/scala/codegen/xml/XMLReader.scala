@@ -0,0 +1,702 @@
+package codegen.xml
+
+import codegen.Constants
+import codegen.functions._
+
+/**
+  * A pull reader that walks XML text element by element without building a tree or
+  * allocating any memory. The message parsers ask the reader for the next child element,
+  * for the character data of an element or to skip an element. Text is returned as a span
+  * of the input and decoded into the destination by cdto_xml_decode(), which resolves the
+  * predefined entities, character references and CDATA sections.
+  *
+  * The reader only accepts the subset of XML the generated serializers write: attributes
+  * are skipped without being interpreted, names are compared literally, so namespace
+  * prefixes are part of the name, and document type declarations are rejected so that no
+  * entity is ever expanded.
+  */
+object XMLReader {
+
+  val typeName = "cdto_xml_reader"
+  val paramName = "reader"
+
+  /**
+    * Maximum nesting depth of XML elements, matching the JSON nesting limit
+    */
+  val nestingLimitMacro = "CDTO_XML_NESTING_LIMIT"
+
+  val miscName = "cdto_xml_read_misc"
+  val startTagName = "cdto_xml_read_start_tag"
+  val childName = "cdto_xml_read_child"
+  val textName = "cdto_xml_read_text"
+  val skipElementName = "cdto_xml_skip_element"
+  val countItemsName = "cdto_xml_count_items"
+  val decodeName = "cdto_xml_decode"
+  val literalName = "cdto_xml_read_literal"
+
+  private val whitespaceName = "cdto_xml_read_whitespace"
+  private val pastName = "cdto_xml_read_past"
+  private val nameName = "cdto_xml_read_name"
+  private val endTagName = "cdto_xml_read_end_tag"
+  private val charDataName = "cdto_xml_read_char_data"
+  private val referenceName = "cdto_xml_decode_reference"
+
+  /**
+    * Name of the elements holding the values of arrays
+    */
+  val itemName = "item"
+
+  val parameter: FunctionParameter = FunctionParameter(s"$typeName*", paramName)
+
+  /**
+    * Definition of the reader type. It is shared by all protocols, so it is protected
+    * against multiple definitions.
+    */
+  val typeDefinition: String =
+    s"""#ifndef CDTO_XML_READER_DEFINED
+       |#define CDTO_XML_READER_DEFINED
+       |
+       |#ifndef $nestingLimitMacro
+       |#define $nestingLimitMacro 1000
+       |#endif
+       |
+       |typedef struct
+       |    {
+       |    char const*    xml;
+       |    size_t         len;
+       |    size_t         pos;
+       |    int            depth;
+       |    } $typeName;
+       |
+       |#endif /* #ifndef CDTO_XML_READER_DEFINED */""".stripMargin
+
+  /**
+    * Gets the statements that initialize a reader local variable over an XML string
+    * @param readerVar Name of the reader variable
+    * @param xml Expression of the XML text
+    * @param length Expression of the length of the XML text
+    * @return Statements to initialize the reader
+    */
+  def initialize(readerVar: String, xml: String, length: String): String = {
+    s"""$readerVar.xml = $xml;
+       |$readerVar.len = $length;
+       |$readerVar.pos = 0;
+       |$readerVar.depth = 0;""".stripMargin
+  }
+
+  /**
+    * Gets the expression that checks whether a name read from the XML equals a literal name
+    * @param name Expression of the name
+    * @param length Expression of the name's length
+    * @param expected Expected name
+    * @return Expression comparing the names
+    */
+  def nameEquals(name: String, length: String, expected: String): String = {
+    s"""( ${expected.length} == $length ) && ( 0 == memcmp( $name, "$expected", ${expected.length} ) )"""
+  }
+
+  /**
+    * All reader functions
+    */
+  def functions: Seq[FunctionDefinition] = List(
+    whitespaceFunction,
+    literalFunction,
+    pastFunction,
+    miscFunction,
+    nameFunction,
+    startTagFunction,
+    endTagFunction,
+    childFunction,
+    charDataFunction,
+    textFunction,
+    skipElementFunction,
+    countItemsFunction,
+    referenceFunction,
+    decodeFunction
+  )
+
+  private def readerFunction(name: String,
+                             shortSummary: String,
+                             description: String,
+                             returnType: String,
+                             parameters: Seq[FunctionParameter],
+                             body: String): FunctionDefinition = {
+    FunctionDefinition(
+      name = name,
+      documentation = FunctionDocumentation(shortSummary, description),
+      prototype = FunctionPrototype(isStatic = true, returnType = returnType, parameters = parameter +: parameters),
+      body = body
+    )
+  }
+
+  private val nameParameters = List(
+    FunctionParameter("char const*", "name"),
+    FunctionParameter("size_t", "name_len")
+  )
+
+  private val elementParameters = nameParameters :+ FunctionParameter(Constants.defaultBooleanCType, "empty")
+
+  private val nameOutputParameters = List(
+    FunctionParameter("char const**", "name_out"),
+    FunctionParameter("size_t*", "name_len_out"),
+    FunctionParameter(s"${Constants.defaultBooleanCType}*", "empty_out")
+  )
+
+  private val whitespaceFunction = readerFunction(
+    name = whitespaceName,
+    shortSummary = "Skip XML whitespace",
+    description = "Advances the reader past any whitespace.",
+    returnType = Constants.voidCType,
+    parameters = Nil,
+    body =
+      s"""while( ( $paramName->pos < $paramName->len ) &&
+         |       ( ( ' ' == $paramName->xml[$paramName->pos] ) ||
+         |         ( '\\t' == $paramName->xml[$paramName->pos] ) ||
+         |         ( '\\n' == $paramName->xml[$paramName->pos] ) ||
+         |         ( '\\r' == $paramName->xml[$paramName->pos] ) ) )
+         |    {
+         |    $paramName->pos++;
+         |    }""".stripMargin
+  )
+
+  private val literalFunction = readerFunction(
+    name = literalName,
+    shortSummary = "Read an XML literal",
+    description = "Consumes the given literal, e.g. <!--, if it is the next text. Returns 1 if the literal was consumed, 0 otherwise.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = List(FunctionParameter("char const*", "literal")),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |size_t length;
+         |
+         |length = strlen( literal );
+         |success = ( $paramName->len - $paramName->pos >= length ) && ( 0 == memcmp( $paramName->xml + $paramName->pos, literal, length ) );
+         |$paramName->pos += success ? length : 0;
+         |
+         |return success;""".stripMargin
+  )
+
+  private val pastFunction = readerFunction(
+    name = pastName,
+    shortSummary = "Read past an XML terminator",
+    description = "Advances the reader past the next occurrence of terminator, e.g. the --> ending a comment. Returns 1 if the terminator was found, 0 otherwise.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = List(FunctionParameter("char const*", "terminator")),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |
+         |success = 0;
+         |while( !success && ( $paramName->pos < $paramName->len ) )
+         |    {
+         |    success = $literalName( $paramName, terminator );
+         |    $paramName->pos += success ? 0 : 1;
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+
+  private val miscFunction = readerFunction(
+    name = miscName,
+    shortSummary = "Skip XML whitespace, comments and processing instructions",
+    description = "Advances the reader past any whitespace, comments and processing instructions, including the XML declaration. Returns 0 if a comment or processing instruction is not terminated, 1 otherwise.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = Nil,
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |${Constants.defaultBooleanCType} done;
+         |
+         |success = 1;
+         |done = 0;
+         |while( success && !done )
+         |    {
+         |    $whitespaceName( $paramName );
+         |    if( $literalName( $paramName, "<?" ) )
+         |        {
+         |        success = $pastName( $paramName, "?>" );
+         |        }
+         |    else if( $literalName( $paramName, "<!--" ) )
+         |        {
+         |        success = $pastName( $paramName, "-->" );
+         |        }
+         |    else
+         |        {
+         |        done = 1;
+         |        }
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+
+  private val nameFunction = readerFunction(
+    name = nameName,
+    shortSummary = "Read an XML name",
+    description = "Consumes an element name and stores it in name_out and name_len_out without copying. Names are read as they appear, so a namespace prefix is part of the name. Returns 1 if a name was consumed, 0 otherwise.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = List(
+      FunctionParameter("char const**", "name_out"),
+      FunctionParameter("size_t*", "name_len_out")
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |size_t start;
+         |unsigned char c;
+         |
+         |start = $paramName->pos;
+         |success = 1;
+         |while( success && ( $paramName->pos < $paramName->len ) )
+         |    {
+         |    // Any non-ASCII character may be part of a name
+         |    c = ( unsigned char )$paramName->xml[$paramName->pos];
+         |    success = ( c >= 0x80 ) || isalnum( c ) || ( '_' == c ) || ( ':' == c ) || ( '-' == c ) || ( '.' == c );
+         |    $paramName->pos += success ? 1 : 0;
+         |    }
+         |
+         |// Names may not start with a digit, a hyphen or a period
+         |success = ( $paramName->pos > start );
+         |c = success ? ( unsigned char )$paramName->xml[start] : 0;
+         |success = success && !isdigit( c ) && ( '-' != c ) && ( '.' != c );
+         |
+         |*name_out = $paramName->xml + start;
+         |*name_len_out = $paramName->pos - start;
+         |
+         |return success;""".stripMargin
+  )
+
+  private val startTagFunction = readerFunction(
+    name = startTagName,
+    shortSummary = "Read an XML start tag",
+    description = "Consumes a start tag or an empty-element tag and stores its name in name_out and name_len_out without copying. Attributes are skipped. empty_out is set to 1 for empty-element tags, which have no content or end tag. Returns 1 if a tag was consumed, 0 otherwise.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = nameOutputParameters,
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |${Constants.defaultBooleanCType} done;
+         |char c;
+         |
+         |*empty_out = 0;
+         |success = $literalName( $paramName, "<" ) && $nameName( $paramName, name_out, name_len_out );
+         |
+         |// Skip the attributes, which are not interpreted
+         |done = 0;
+         |while( success && !done )
+         |    {
+         |    $whitespaceName( $paramName );
+         |    c = ( $paramName->pos < $paramName->len ) ? $paramName->xml[$paramName->pos] : '<';
+         |    if( $literalName( $paramName, "/>" ) )
+         |        {
+         |        *empty_out = 1;
+         |        done = 1;
+         |        }
+         |    else if( ( '"' == c ) || ( '\\'' == c ) )
+         |        {
+         |        $paramName->pos++;
+         |        success = $pastName( $paramName, ( '"' == c ) ? "\\"" : "'" );
+         |        }
+         |    else
+         |        {
+         |        success = ( '<' != c );
+         |        done = ( '>' == c );
+         |        $paramName->pos++;
+         |        }
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+
+  private val endTagFunction = readerFunction(
+    name = endTagName,
+    shortSummary = "Read an XML end tag",
+    description = "Consumes the end tag of the element with the given name. Returns 1 if the end tag was consumed, 0 otherwise.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = nameParameters,
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |char const* end_name;
+         |size_t end_name_len;
+         |
+         |success = $literalName( $paramName, "</" ) && $nameName( $paramName, &end_name, &end_name_len );
+         |success = success && ( end_name_len == name_len ) && ( 0 == memcmp( end_name, name, name_len ) );
+         |
+         |$whitespaceName( $paramName );
+         |success = success && $literalName( $paramName, ">" );
+         |
+         |return success;""".stripMargin
+  )
+
+  private val childFunction = readerFunction(
+    name = childName,
+    shortSummary = "Read the next XML child element",
+    description = "Consumes the start tag of the next child element of the named element, skipping whitespace, comments and processing instructions. Once the children are exhausted, the parent's end tag is consumed and name_out is set to NULL. Returns 0 if the element contains text or is malformed, 1 otherwise.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = nameParameters ++ nameOutputParameters,
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |
+         |*name_out = NULL;
+         |*name_len_out = 0;
+         |*empty_out = 0;
+         |success = $miscName( $paramName );
+         |
+         |if( success && ( $paramName->len - $paramName->pos >= 2 ) && ( 0 == memcmp( $paramName->xml + $paramName->pos, "</", 2 ) ) )
+         |    {
+         |    success = $endTagName( $paramName, name, name_len );
+         |    }
+         |else if( success )
+         |    {
+         |    success = $startTagName( $paramName, name_out, name_len_out, empty_out );
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+
+  private val charDataFunction = readerFunction(
+    name = charDataName,
+    shortSummary = "Skip XML character data",
+    description = "Advances the reader to the next tag, skipping character data, CDATA sections, comments and processing instructions. Returns 0 if a CDATA section, comment or processing instruction is not terminated, 1 otherwise.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = Nil,
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |${Constants.defaultBooleanCType} done;
+         |
+         |success = 1;
+         |done = 0;
+         |while( success && !done && ( $paramName->pos < $paramName->len ) )
+         |    {
+         |    if( $literalName( $paramName, "<![CDATA[" ) )
+         |        {
+         |        success = $pastName( $paramName, "]]>" );
+         |        }
+         |    else if( $literalName( $paramName, "<!--" ) )
+         |        {
+         |        success = $pastName( $paramName, "-->" );
+         |        }
+         |    else if( $literalName( $paramName, "<?" ) )
+         |        {
+         |        success = $pastName( $paramName, "?>" );
+         |        }
+         |    else
+         |        {
+         |        done = ( '<' == $paramName->xml[$paramName->pos] );
+         |        $paramName->pos += done ? 0 : 1;
+         |        }
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+
+  private val textFunction = readerFunction(
+    name = textName,
+    shortSummary = "Read the text of an XML element",
+    description = s"Consumes the content and end tag of the named element, whose start tag was just read, and stores the raw content in text_out and text_len_out without copying. The content may contain CDATA sections, comments and processing instructions but no elements. Decode it with $decodeName(). Returns 1 if the text was consumed, 0 otherwise.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = elementParameters ++ List(
+      FunctionParameter("char const**", "text_out"),
+      FunctionParameter("size_t*", "text_len_out")
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |size_t start;
+         |
+         |start = $paramName->pos;
+         |success = empty || $charDataName( $paramName );
+         |
+         |*text_out = $paramName->xml + start;
+         |*text_len_out = $paramName->pos - start;
+         |
+         |success = success && ( empty || $endTagName( $paramName, name, name_len ) );
+         |
+         |return success;""".stripMargin
+  )
+
+  private val skipElementFunction = readerFunction(
+    name = skipElementName,
+    shortSummary = "Skip an XML element",
+    description = s"Consumes the content and end tag of an element whose start tag was just read, including all of its descendants. The descendants are only counted, not matched by name, and count towards $nestingLimitMacro. Returns 1 if the element was skipped, 0 otherwise.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = List(FunctionParameter(Constants.defaultBooleanCType, "empty")),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |${Constants.defaultBooleanCType} child_empty;
+         |${Constants.defaultIntCType} depth;
+         |char const* child_name;
+         |size_t child_name_len;
+         |
+         |success = 1;
+         |depth = empty ? 0 : 1;
+         |while( success && ( depth > 0 ) )
+         |    {
+         |    success = $charDataName( $paramName );
+         |    if( success && $literalName( $paramName, "</" ) )
+         |        {
+         |        success = $nameName( $paramName, &child_name, &child_name_len );
+         |        $whitespaceName( $paramName );
+         |        success = success && $literalName( $paramName, ">" );
+         |        depth--;
+         |        }
+         |    else if( success )
+         |        {
+         |        success = $startTagName( $paramName, &child_name, &child_name_len, &child_empty );
+         |        depth += child_empty ? 0 : 1;
+         |        success = success && ( $paramName->depth + depth <= $nestingLimitMacro );
+         |        }
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+
+  private val countItemsFunction = readerFunction(
+    name = countItemsName,
+    shortSummary = "Count XML array items",
+    description = s"Counts the $itemName children of the named element, whose start tag was just read, without consuming them. Returns 0 and a count of 0 if the element has children with other names or is malformed, 1 otherwise.",
+    returnType = Constants.defaultBooleanCType,
+    parameters = nameParameters :+ FunctionParameter(s"${Constants.defaultIntCType}*", "count_out"),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |${Constants.defaultBooleanCType} item_empty;
+         |${Constants.defaultIntCType} count;
+         |size_t start;
+         |char const* item_name;
+         |size_t item_name_len;
+         |
+         |start = $paramName->pos;
+         |count = 0;
+         |
+         |success = $childName( $paramName, name, name_len, &item_name, &item_name_len, &item_empty );
+         |while( success && ( NULL != item_name ) )
+         |    {
+         |    success = ${nameEquals("item_name", "item_name_len", itemName)} && ( count < INT_MAX );
+         |    success = success && $skipElementName( $paramName, item_empty );
+         |    success = success && $childName( $paramName, name, name_len, &item_name, &item_name_len, &item_empty );
+         |    count++;
+         |    }
+         |
+         |*count_out = success ? count : 0;
+         |
+         |// Rewind, so the items can be parsed
+         |$paramName->pos = start;
+         |
+         |return success;""".stripMargin
+  )
+
+  private val referenceFunction = FunctionDefinition(
+    name = referenceName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Decode an XML reference",
+      description = "Decodes the entity or character reference starting at the & at text[*pos_inout] and stores the UTF-8 encoding of its character in bytes_out. Only the predefined entities are known, since document type declarations are not supported. Advances *pos_inout past the reference and returns the number of bytes stored, or -1 if the reference is invalid."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultIntCType,
+      parameters = List(
+        FunctionParameter("char const*", "text"),
+        FunctionParameter("size_t", "text_len"),
+        FunctionParameter("size_t*", "pos_inout"),
+        FunctionParameter("unsigned char*", "bytes_out")
+      )
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |${Constants.defaultIntCType} byte_cnt;
+         |char const* name;
+         |size_t name_len;
+         |size_t i;
+         |unsigned long base;
+         |unsigned long digit;
+         |unsigned long codepoint;
+         |unsigned char c;
+         |
+         |name = text + *pos_inout + 1;
+         |name_len = 0;
+         |while( ( *pos_inout + 1 + name_len < text_len ) && ( ';' != name[name_len] ) && ( name_len < 16 ) )
+         |    {
+         |    name_len++;
+         |    }
+         |
+         |success = ( *pos_inout + 1 + name_len < text_len ) && ( ';' == name[name_len] );
+         |*pos_inout += name_len + 2;
+         |codepoint = 0;
+         |
+         |if( !success )
+         |    {
+         |    // Not terminated
+         |    }
+         |else if( ${nameEquals("name", "name_len", "lt")} )
+         |    {
+         |    codepoint = '<';
+         |    }
+         |else if( ${nameEquals("name", "name_len", "gt")} )
+         |    {
+         |    codepoint = '>';
+         |    }
+         |else if( ${nameEquals("name", "name_len", "amp")} )
+         |    {
+         |    codepoint = '&';
+         |    }
+         |else if( ${nameEquals("name", "name_len", "quot")} )
+         |    {
+         |    codepoint = '"';
+         |    }
+         |else if( ${nameEquals("name", "name_len", "apos")} )
+         |    {
+         |    codepoint = '\\'';
+         |    }
+         |else if( ( name_len > 1 ) && ( '#' == name[0] ) )
+         |    {
+         |    // &#decimal; or &#xhexadecimal;
+         |    base = ( 'x' == name[1] ) ? 16 : 10;
+         |    i = ( 16 == base ) ? 2 : 1;
+         |    success = ( i < name_len );
+         |    for( ; success && ( i < name_len ); i++ )
+         |        {
+         |        c = ( unsigned char )name[i];
+         |        success = ( 16 == base ) ? ( 0 != isxdigit( c ) ) : ( 0 != isdigit( c ) );
+         |        digit = ( unsigned long )( isdigit( c ) ? c - '0' : tolower( c ) - 'a' + 10 );
+         |        codepoint = codepoint * base + digit;
+         |        success = success && ( codepoint <= 0x10FFFF );
+         |        }
+         |
+         |    // NUL and surrogates are not characters
+         |    success = success && ( 0 != codepoint ) && !( ( codepoint >= 0xD800 ) && ( codepoint <= 0xDFFF ) );
+         |    }
+         |else
+         |    {
+         |    success = 0;
+         |    }
+         |
+         |if( !success )
+         |    {
+         |    byte_cnt = -1;
+         |    }
+         |else if( codepoint < 0x80 )
+         |    {
+         |    bytes_out[0] = ( unsigned char )codepoint;
+         |    byte_cnt = 1;
+         |    }
+         |else if( codepoint < 0x800 )
+         |    {
+         |    bytes_out[0] = ( unsigned char )( 0xC0 | ( codepoint >> 6 ) );
+         |    bytes_out[1] = ( unsigned char )( 0x80 | ( codepoint & 0x3F ) );
+         |    byte_cnt = 2;
+         |    }
+         |else if( codepoint < 0x10000 )
+         |    {
+         |    bytes_out[0] = ( unsigned char )( 0xE0 | ( codepoint >> 12 ) );
+         |    bytes_out[1] = ( unsigned char )( 0x80 | ( ( codepoint >> 6 ) & 0x3F ) );
+         |    bytes_out[2] = ( unsigned char )( 0x80 | ( codepoint & 0x3F ) );
+         |    byte_cnt = 3;
+         |    }
+         |else
+         |    {
+         |    bytes_out[0] = ( unsigned char )( 0xF0 | ( codepoint >> 18 ) );
+         |    bytes_out[1] = ( unsigned char )( 0x80 | ( ( codepoint >> 12 ) & 0x3F ) );
+         |    bytes_out[2] = ( unsigned char )( 0x80 | ( ( codepoint >> 6 ) & 0x3F ) );
+         |    bytes_out[3] = ( unsigned char )( 0x80 | ( codepoint & 0x3F ) );
+         |    byte_cnt = 4;
+         |    }
+         |
+         |return byte_cnt;""".stripMargin
+  )
+
+  private val decodeFunction = FunctionDefinition(
+    name = decodeName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Decode XML text",
+      description = s"Decodes the raw element content read by $textName() into the NUL-terminated string out. References are resolved, CDATA sections are copied verbatim, comments and processing instructions are dropped and line breaks are normalized to \\n. The decoded text is never longer than the raw text. Stores the decoded length in out_len, if not NULL. Returns 0 if the text contains an invalid reference or a NUL character, or if it does not fit into out_size bytes, 1 otherwise."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = List(
+        FunctionParameter("char const*", "text"),
+        FunctionParameter("size_t", "text_len"),
+        FunctionParameter("char*", "out"),
+        FunctionParameter("size_t", "out_size"),
+        FunctionParameter("size_t*", "out_len")
+      )
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |${Constants.defaultIntCType} byte_cnt;
+         |size_t length;
+         |size_t start;
+         |size_t cdata_len;
+         |$typeName raw;
+         |unsigned char bytes[4];
+         |
+         |// Read the raw text like an element's content to find the markup inside it
+         |raw.xml = text;
+         |raw.len = text_len;
+         |raw.pos = 0;
+         |raw.depth = 0;
+         |
+         |success = ( out_size > 0 );
+         |length = 0;
+         |while( success && ( raw.pos < raw.len ) )
+         |    {
+         |    byte_cnt = 0;
+         |    if( $literalName( &raw, "<![CDATA[" ) )
+         |        {
+         |        start = raw.pos;
+         |        success = $pastName( &raw, "]]>" );
+         |        cdata_len = success ? raw.pos - start - 3 : 0;
+         |
+         |        // Copied verbatim, keeping room for the NUL terminator
+         |        success = success && ( cdata_len < out_size - length );
+         |        if( success )
+         |            {
+         |            memcpy( out + length, text + start, cdata_len );
+         |            length += cdata_len;
+         |            }
+         |        }
+         |    else if( $literalName( &raw, "<!--" ) )
+         |        {
+         |        success = $pastName( &raw, "-->" );
+         |        }
+         |    else if( $literalName( &raw, "<?" ) )
+         |        {
+         |        success = $pastName( &raw, "?>" );
+         |        }
+         |    else if( '&' == raw.xml[raw.pos] )
+         |        {
+         |        byte_cnt = $referenceName( raw.xml, raw.len, &raw.pos, bytes );
+         |        success = ( byte_cnt > 0 );
+         |        }
+         |    else if( '\\r' == raw.xml[raw.pos] )
+         |        {
+         |        // \\r\\n and \\r are line breaks like \\n
+         |        bytes[0] = '\\n';
+         |        byte_cnt = 1;
+         |        raw.pos++;
+         |        $literalName( &raw, "\\n" );
+         |        }
+         |    else
+         |        {
+         |        bytes[0] = ( unsigned char )raw.xml[raw.pos];
+         |        byte_cnt = 1;
+         |        raw.pos++;
+         |        success = ( '\\0' != bytes[0] );
+         |        }
+         |
+         |    // Keep room for the NUL terminator
+         |    success = success && ( ( size_t )byte_cnt < out_size - length );
+         |    if( success && ( byte_cnt > 0 ) )
+         |        {
+         |        memcpy( out + length, bytes, ( size_t )byte_cnt );
+         |        length += ( size_t )byte_cnt;
+         |        }
+         |    }
+         |
+         |if( out_size > 0 )
+         |    {
+         |    out[success ? length : 0] = '\\0';
+         |    }
+         |
+         |if( NULL != out_len )
+         |    {
+         |    *out_len = success ? length : 0;
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+}
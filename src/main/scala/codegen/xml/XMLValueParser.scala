@@ -0,0 +1,393 @@
+package codegen.xml
+
+import codegen.Constants
+import codegen.allocator.Allocator
+import codegen.base64.Base64
+import codegen.functions._
+import codegen.json.parsing.{AliasedNumberJSONParser, EnumJSONParser}
+import codegen.timestamp.Timestamp
+import datamodel._
+
+/**
+  * Defines the functions that parse the text of XML elements into field values. Each
+  * function takes the raw element content read by the XML reader and decodes it into the
+  * value's storage.
+  */
+object XMLValueParser {
+
+  private val textParam = "text"
+  private val lengthParam = "text_len"
+  private val outputParam = "value_out"
+
+  val stringName = "cdto_xml_parse_string"
+  val internedStringName = "cdto_xml_parse_interned_string"
+  val inlineStringName = "cdto_xml_parse_inline_string"
+  val numberName = "cdto_xml_parse_number"
+  val booleanName = "cdto_xml_parse_boolean"
+  val bytesName = "cdto_xml_parse_bytes"
+  val timestampName = "cdto_xml_parse_timestamp"
+
+  private val trimName = "cdto_xml_trim"
+
+  private val textParameters = List(
+    FunctionParameter(s"${Constants.defaultCharacterCType} const*", textParam),
+    FunctionParameter("size_t", lengthParam)
+  )
+
+  /**
+    * @param alias C type of the values
+    * @return Name of the function to parse numbers of an aliased type
+    */
+  def aliasedNumberName(alias: String): String = {
+    s"${alias}_xml_parse"
+  }
+
+  /**
+    * @param enumType Enum type
+    * @return Name of the function to parse enum values
+    */
+  def enumName(enumType: EnumType): String = {
+    s"${enumType.name}_xml_parse"
+  }
+
+  /**
+    * Gets the function to parse the values of the given type, if the type has one. Objects
+    * are parsed by their message's parser and fixed-length strings are decoded in place.
+    * In arrays, fixed-length and inline strings are dynamically-allocated.
+    * @param fieldType Type of a field or of the elements of an array field
+    * @return Definition of the function to parse the type's values, if any
+    */
+  def parseFunction(fieldType: FieldType): Option[FunctionDefinition] = {
+    fieldType match {
+      case ArrayType(FixedStringType(_) | InlineStringType(_)) => Some(stringFunction)
+      case ArrayType(elementType) => parseFunction(elementType)
+      case InlineArrayType(elementType, _) => parseFunction(ArrayType(elementType))
+      case BytesType => Some(bytesFunction)
+      case AliasedType(alias, NumberType) => Some(aliasedNumberFunction(alias))
+      case AliasedType(_, underlyingType) => parseFunction(underlyingType)
+      case ObjectType(_) => None
+      case BooleanType => Some(booleanFunction)
+      case DynamicStringType => Some(stringFunction)
+      case InternedStringType => Some(internedStringFunction)
+      case FixedStringType(_) => None
+      case InlineStringType(_) => Some(inlineStringFunction)
+      case NumberType => Some(numberFunction)
+      case TimestampType => Some(timestampFunction)
+      case enumType: EnumType => Some(enumFunction(enumType))
+    }
+  }
+
+  /**
+    * Function to trim whitespace from decoded values, needed by the number and boolean parsers
+    */
+  val trimFunction: FunctionDefinition = FunctionDefinition(
+    name = trimName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Trim XML whitespace",
+      description = "Removes the trailing whitespace of the NUL-terminated string and returns a pointer to its first character that is not whitespace."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = s"${Constants.defaultCharacterCType}*",
+      parameters = List(FunctionParameter(s"${Constants.defaultCharacterCType}*", "string"))
+    ),
+    body =
+      s"""size_t length;
+         |
+         |// Line breaks were normalized to \\n when decoding
+         |length = strlen( string );
+         |while( ( length > 0 ) && ( NULL != strchr( " \\t\\n", string[length - 1] ) ) )
+         |    {
+         |    length--;
+         |    }
+         |
+         |string[length] = '\\0';
+         |
+         |return string + strspn( string, " \\t\\n" );""".stripMargin
+  )
+
+  private val stringFunction = FunctionDefinition(
+    name = stringName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Parse XML string",
+      description = s"Decodes the element text into a new string. Returns 1 if the parse was successful, 0 otherwise. The caller must free $outputParam with the allocator."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = textParameters ++ List(
+        FunctionParameter(s"${Constants.defaultCharacterCType}**", outputParam),
+        Allocator.parameter
+      )
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |
+         |// The decoded text is never longer than the raw text
+         |*$outputParam = ${Allocator.malloc(s"$lengthParam + 1")};
+         |success = ( NULL != *$outputParam ) && ${XMLReader.decodeName}( $textParam, $lengthParam, *$outputParam, $lengthParam + 1, NULL );
+         |
+         |if( !success )
+         |    {
+         |    ${Allocator.free(s"*$outputParam")};
+         |    *$outputParam = NULL;
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+
+  private val internedStringFunction = FunctionDefinition(
+    name = internedStringName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Parse interned XML string",
+      description = s"Decodes the element text and interns it through the allocator. Returns 1 if the parse was successful, 0 otherwise. The caller must release $outputParam with the allocator."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = textParameters ++ List(
+        FunctionParameter(s"${Constants.defaultCharacterCType} const**", outputParam),
+        Allocator.parameter
+      )
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |${Constants.defaultCharacterCType}* decoded;
+         |
+         |*$outputParam = NULL;
+         |success = $stringName( $textParam, $lengthParam, &decoded, ${Allocator.paramName} );
+         |
+         |if( success )
+         |    {
+         |    *$outputParam = ${Allocator.intern("decoded")};
+         |    success = ( NULL != *$outputParam );
+         |    ${Allocator.free("decoded")};
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+
+  private val inlineStringFunction = FunctionDefinition(
+    name = inlineStringName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Parse inline XML string",
+      description = "Decodes the element text into buffer if it fits into buffer_size bytes, or into a new string stored in heap_out otherwise. heap_out is only set if the value does not fit into the buffer. Returns 1 if the parse was successful, 0 otherwise. The caller must free heap_out with the allocator."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = textParameters ++ List(
+        FunctionParameter(s"${Constants.defaultCharacterCType}*", "buffer"),
+        FunctionParameter("size_t", "buffer_size"),
+        FunctionParameter(s"${Constants.defaultCharacterCType}**", "heap_out"),
+        Allocator.parameter
+      )
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |
+         |*heap_out = NULL;
+         |success = ${XMLReader.decodeName}( $textParam, $lengthParam, buffer, buffer_size, NULL );
+         |
+         |// Too long to store inline, or invalid, which the heap parse also reports
+         |if( !success )
+         |    {
+         |    success = $stringName( $textParam, $lengthParam, heap_out, ${Allocator.paramName} );
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+
+  private val numberFunction = FunctionDefinition(
+    name = numberName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Parse XML number",
+      description = "Parses the element text as a decimal number, which may be surrounded by whitespace. Returns 1 if the parse was successful, 0 otherwise."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = textParameters :+ FunctionParameter(s"${Constants.defaultNumberCType}*", outputParam)
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |${Constants.defaultNumberCType} value;
+         |${Constants.defaultCharacterCType} number[64];
+         |${Constants.defaultCharacterCType}* trimmed;
+         |${Constants.defaultCharacterCType}* end;
+         |
+         |success = ${XMLReader.decodeName}( $textParam, $lengthParam, number, sizeof( number ), NULL );
+         |trimmed = $trimName( number );
+         |
+         |// Only accept decimal numbers, which excludes the hexadecimal, infinite and NaN
+         |// values strtod() also reads
+         |success = success && ( '\\0' != *trimmed ) && ( strlen( trimmed ) == strspn( trimmed, "0123456789+-.eE" ) );
+         |
+         |if( success )
+         |    {
+         |    value = strtod( trimmed, &end );
+         |    success = ( '\\0' == *end );
+         |    }
+         |
+         |if( success )
+         |    {
+         |    *$outputParam = value;
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+
+  private val timestampFunction = FunctionDefinition(
+    name = timestampName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Parse XML timestamp",
+      description = "Parses the element text as an RFC 3339 date-time, which may be surrounded by whitespace. Returns 1 if the parse was successful, 0 otherwise."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = textParameters :+ FunctionParameter(s"${Constants.defaultTimestampCType}*", outputParam)
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |${Constants.defaultCharacterCType} timestamp[${Timestamp.parseBufferSize}];
+         |${Constants.defaultCharacterCType}* trimmed;
+         |
+         |success = ${XMLReader.decodeName}( $textParam, $lengthParam, timestamp, sizeof( timestamp ), NULL );
+         |trimmed = $trimName( timestamp );
+         |
+         |return success && ${Timestamp.parseName}( trimmed, strlen( trimmed ), $outputParam );""".stripMargin
+  )
+
+  private val booleanFunction = FunctionDefinition(
+    name = booleanName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Parse XML boolean",
+      description = "Parses the element text as an XML Schema boolean: true, false, 1 or 0, which may be surrounded by whitespace. Returns 1 if the parse was successful, 0 otherwise."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = textParameters :+ FunctionParameter(s"${Constants.defaultBooleanCType}*", outputParam)
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |${Constants.defaultCharacterCType} value[8];
+         |${Constants.defaultCharacterCType}* trimmed;
+         |
+         |success = ${XMLReader.decodeName}( $textParam, $lengthParam, value, sizeof( value ), NULL );
+         |trimmed = $trimName( value );
+         |
+         |if( success && ( ( 0 == strcmp( trimmed, "true" ) ) || ( 0 == strcmp( trimmed, "1" ) ) ) )
+         |    {
+         |    *$outputParam = 1;
+         |    }
+         |else if( success && ( ( 0 == strcmp( trimmed, "false" ) ) || ( 0 == strcmp( trimmed, "0" ) ) ) )
+         |    {
+         |    *$outputParam = 0;
+         |    }
+         |else
+         |    {
+         |    success = 0;
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+
+  private val bytesFunction = FunctionDefinition(
+    name = bytesName,
+    documentation = FunctionDocumentation(
+      shortSummary = "Parse XML bytes",
+      description = s"Decodes the element text as base64, which may be surrounded by whitespace. The base64 alphabet needs no escaping, so the raw text is decoded without copying it. Returns 1 if the parse was successful, 0 otherwise. The caller must free $outputParam with the allocator."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = textParameters ++ List(
+        FunctionParameter("uint8_t**", outputParam),
+        FunctionParameter("size_t*", "len_out"),
+        Allocator.parameter
+      )
+    ),
+    body =
+      s"""// The raw text has not been normalized, so carriage returns are whitespace too
+         |while( ( $lengthParam > 0 ) && ( NULL != memchr( " \\t\\r\\n", $textParam[$lengthParam - 1], 4 ) ) )
+         |    {
+         |    $lengthParam--;
+         |    }
+         |
+         |while( ( $lengthParam > 0 ) && ( NULL != memchr( " \\t\\r\\n", *$textParam, 4 ) ) )
+         |    {
+         |    $textParam++;
+         |    $lengthParam--;
+         |    }
+         |
+         |return ${Base64.decodeName}( $textParam, $lengthParam, $outputParam, len_out, ${Allocator.paramName} );""".stripMargin
+  )
+
+  /**
+    * Creates the function to parse numbers of an aliased type, which rejects values the
+    * type cannot represent like the JSON parse function of the type
+    * @param alias C type of the values
+    * @return Definition of the parse function
+    */
+  def aliasedNumberFunction(alias: String): FunctionDefinition = FunctionDefinition(
+    name = aliasedNumberName(alias),
+    documentation = FunctionDocumentation(
+      shortSummary = s"Parse XML number as $alias",
+      description = s"Parses the element text as a number and stores it as a $alias. Integer types only accept whole numbers within their range. Returns 1 if the parse was successful, 0 otherwise."
+    ),
+    prototype = FunctionPrototype(
+      isStatic = true,
+      returnType = Constants.defaultBooleanCType,
+      parameters = textParameters :+ FunctionParameter(s"$alias*", outputParam)
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |${Constants.defaultNumberCType} value;
+         |
+         |value = 0.0;
+         |success = $numberName( $textParam, $lengthParam, &value );
+         |
+         |${AliasedNumberJSONParser.rangeCheck(alias, "value")}
+         |
+         |if( success )
+         |    {
+         |    *$outputParam = ( $alias )value;
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+
+  /**
+    * Creates the function to parse the values of an enum, which are the same strings as in JSON
+    * @param enumType Enum type
+    * @return Definition of the parse function
+    */
+  def enumFunction(enumType: EnumType): FunctionDefinition = {
+    val bufferSize = enumType.values.map(_.length).max + 1
+
+    FunctionDefinition(
+      name = enumName(enumType),
+      documentation = FunctionDocumentation(
+        shortSummary = s"Parse XML ${enumType.name}",
+        description = s"Parses the element text as one of the ${enumType.name} values. Returns 1 if the parse was successful, 0 otherwise."
+      ),
+      prototype = FunctionPrototype(
+        isStatic = true,
+        returnType = Constants.defaultBooleanCType,
+        parameters = textParameters :+ FunctionParameter(s"${enumType.name}*", outputParam)
+      ),
+      body =
+        s"""${Constants.defaultBooleanCType} success;
+           |${Constants.defaultCharacterCType} value[$bufferSize];
+           |size_t length;
+           |
+           |// Text too long to decode is not a value
+           |success = ${XMLReader.decodeName}( $textParam, $lengthParam, value, sizeof( value ), &length );
+           |success = success && ${EnumJSONParser.fromStringName(enumType)}( value, length, $outputParam );
+           |
+           |return success;""".stripMargin
+    )
+  }
+}
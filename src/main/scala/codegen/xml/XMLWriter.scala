@@ -0,0 +1,295 @@
+package codegen.xml
+
+import codegen.Constants
+import codegen.allocator.Allocator
+import codegen.base64.Base64
+import codegen.functions._
+import codegen.timestamp.Timestamp
+
+/**
+  * The runtime of the XML serializers. The serializers write the XML text straight into
+  * the writer's buffer without building a tree first. A writer either grows its buffer
+  * through an allocator, or writes into a caller-provided buffer of fixed size. A fixed
+  * writer keeps counting the length of the output once the buffer is full, so the caller
+  * learns how large a buffer the XML needs.
+  */
+object XMLWriter {
+
+  val typeName = "cdto_xml_writer"
+  val paramName = "writer"
+
+  val writeName = "cdto_xml_write"
+  val textName = "cdto_xml_write_text"
+  val numberName = "cdto_xml_write_number"
+  val booleanName = "cdto_xml_write_boolean"
+  val bytesName = "cdto_xml_write_bytes"
+  val timestampName = "cdto_xml_write_timestamp"
+
+  val parameter: FunctionParameter = FunctionParameter(s"$typeName*", paramName)
+
+  /**
+    * Definition of the writer type. It is shared by all protocols, so it is protected
+    * against multiple definitions.
+    */
+  val typeDefinition: String =
+    s"""#ifndef CDTO_XML_WRITER_DEFINED
+       |#define CDTO_XML_WRITER_DEFINED
+       |
+       |typedef struct
+       |    {
+       |    char*                    data;
+       |    size_t                   len;
+       |    size_t                   cap;
+       |    int                      fixed;
+       |    ${Allocator.typeName} const*    ${Allocator.paramName};
+       |    } $typeName;
+       |
+       |#endif /* #ifndef CDTO_XML_WRITER_DEFINED */""".stripMargin
+
+  /**
+    * Gets the statements that initialize a writer local variable
+    * @param writerVar Name of the writer variable
+    * @param buffer Expression of the caller's buffer, or NULL to allocate the buffer
+    * @param size Expression of the size of the caller's buffer
+    * @param fixed Whether the writer is limited to the caller's buffer
+    * @return Statements to initialize the writer
+    */
+  def initialize(writerVar: String, buffer: String, size: String, fixed: Boolean): String = {
+    s"""$writerVar.data = $buffer;
+       |$writerVar.len = 0;
+       |$writerVar.cap = $size;
+       |$writerVar.fixed = ${if(fixed) 1 else 0};
+       |$writerVar.${Allocator.paramName} = ${Allocator.paramName};""".stripMargin
+  }
+
+  /**
+    * Gets the call to write literal text, such as a tag
+    * @param writer Expression of the writer pointer
+    * @param text Text to write, which must not need escaping
+    * @return Call writing the text
+    */
+  def write(writer: String, text: String): String = {
+    s"""$writeName( $writer, "$text", ${text.length} )"""
+  }
+
+  /**
+    * Functions to write bytes as base64 text, needed if any field holds bytes
+    */
+  def bytesFunctions: Seq[FunctionDefinition] = List(
+    Base64.encodeFunction,
+    bytesFunction
+  )
+
+  /**
+    * Functions to write timestamps as RFC 3339 text, needed if any field holds timestamps
+    */
+  def timestampFunctions: Seq[FunctionDefinition] = Timestamp.functions :+ timestampFunction
+
+  /**
+    * All writer functions
+    */
+  def functions: Seq[FunctionDefinition] = List(
+    writeFunction,
+    textFunction,
+    numberFunction,
+    booleanFunction
+  )
+
+  private def writerFunction(name: String,
+                             shortSummary: String,
+                             description: String,
+                             parameters: Seq[FunctionParameter],
+                             body: String): FunctionDefinition = {
+    FunctionDefinition(
+      name = name,
+      documentation = FunctionDocumentation(shortSummary, description),
+      prototype = FunctionPrototype(isStatic = true, returnType = Constants.defaultBooleanCType, parameters = parameter +: parameters),
+      body = body
+    )
+  }
+
+  private val writeFunction = writerFunction(
+    name = writeName,
+    shortSummary = "Write XML text",
+    description = "Appends length bytes of text to the output, keeping room for a NUL terminator. A growing writer doubles its buffer as needed, a fixed writer only counts the bytes that no longer fit. Returns 0 if the buffer could not be grown, 1 otherwise.",
+    parameters = List(
+      FunctionParameter("char const*", "text"),
+      FunctionParameter("size_t", "length")
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |size_t cap;
+         |char* data;
+         |
+         |success = ( length < ( size_t )-1 - $paramName->len );
+         |
+         |if( success && ( $paramName->len + length >= $paramName->cap ) && !$paramName->fixed )
+         |    {
+         |    cap = ( 0 == $paramName->cap ) ? 256 : $paramName->cap;
+         |    while( ( cap <= $paramName->len + length ) && ( cap < ( size_t )-1 / 2 ) )
+         |        {
+         |        cap *= 2;
+         |        }
+         |
+         |    data = ${Allocator.mallocFunction.name}( $paramName->${Allocator.paramName}, cap );
+         |    success = ( NULL != data ) && ( cap > $paramName->len + length );
+         |    if( success && ( $paramName->len > 0 ) )
+         |        {
+         |        memcpy( data, $paramName->data, $paramName->len );
+         |        }
+         |
+         |    if( success )
+         |        {
+         |        ${Allocator.freeFunction.name}( $paramName->${Allocator.paramName}, $paramName->data );
+         |        $paramName->data = data;
+         |        $paramName->cap = cap;
+         |        }
+         |    else
+         |        {
+         |        ${Allocator.freeFunction.name}( $paramName->${Allocator.paramName}, data );
+         |        }
+         |    }
+         |
+         |// Once a fixed buffer is full, later text is only counted
+         |if( success && ( $paramName->len + length < $paramName->cap ) )
+         |    {
+         |    memcpy( $paramName->data + $paramName->len, text, length );
+         |    }
+         |
+         |$paramName->len += success ? length : 0;
+         |
+         |return success;""".stripMargin
+  )
+
+  private val textFunction = writerFunction(
+    name = textName,
+    shortSummary = "Write escaped XML text",
+    description = "Appends the string as character data, escaping &, < and > as entities and carriage returns as a character reference so they survive line break normalization. Returns 0 if the string is NULL or contains control characters, which cannot be represented in XML 1.0, 1 otherwise.",
+    parameters = List(FunctionParameter("char const*", "string")),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |char const* start;
+         |char const* end;
+         |char const* escaped;
+         |unsigned char c;
+         |
+         |success = ( NULL != string );
+         |start = string;
+         |
+         |// Write runs of characters that need no escaping at once
+         |for( end = string; success && ( '\\0' != *end ); end++ )
+         |    {
+         |    c = ( unsigned char )*end;
+         |    switch( c )
+         |        {
+         |        case '&':
+         |            escaped = "&amp;";
+         |            break;
+         |
+         |        case '<':
+         |            escaped = "&lt;";
+         |            break;
+         |
+         |        case '>':
+         |            escaped = "&gt;";
+         |            break;
+         |
+         |        case '\\r':
+         |            escaped = "&#13;";
+         |            break;
+         |
+         |        default:
+         |            escaped = NULL;
+         |            success = ( c >= 0x20 ) || ( '\\t' == c ) || ( '\\n' == c );
+         |            break;
+         |        }
+         |
+         |    if( success && ( NULL != escaped ) )
+         |        {
+         |        success = $writeName( $paramName, start, ( size_t )( end - start ) ) && $writeName( $paramName, escaped, strlen( escaped ) );
+         |        start = end + 1;
+         |        }
+         |    }
+         |
+         |success = success && $writeName( $paramName, start, ( size_t )( end - start ) );
+         |
+         |return success;""".stripMargin
+  )
+
+  private val numberFunction = writerFunction(
+    name = numberName,
+    shortSummary = "Write an XML number",
+    description = "Appends the number, formatted like cJSON formats numbers. Returns 0 if the number is infinite or NaN, which JSON cannot represent either, 1 otherwise.",
+    parameters = List(FunctionParameter(Constants.defaultNumberCType, "value")),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |char number[32];
+         |
+         |success = ( ( value - value ) == 0 );
+         |
+         |// Use the shortest format that reads back as the same value
+         |if( success )
+         |    {
+         |    sprintf( number, "%1.15g", value );
+         |
+         |    if( strtod( number, NULL ) != value )
+         |        {
+         |        sprintf( number, "%1.17g", value );
+         |        }
+         |
+         |    success = $writeName( $paramName, number, strlen( number ) );
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+
+  private val booleanFunction = writerFunction(
+    name = booleanName,
+    shortSummary = "Write an XML boolean",
+    description = "Appends true if the value is non-zero, false otherwise. Returns 0 if the buffer could not be grown, 1 otherwise.",
+    parameters = List(FunctionParameter(Constants.defaultBooleanCType, "value")),
+    body = s"""return value ? $writeName( $paramName, "true", 4 ) : $writeName( $paramName, "false", 5 );"""
+  )
+
+  private val bytesFunction = writerFunction(
+    name = bytesName,
+    shortSummary = "Write XML bytes",
+    description = "Appends len bytes of data as base64 text, which needs no escaping. The text is encoded in chunks on the stack, so the data is not copied to an intermediate buffer. Returns 0 if data is NULL while len is not 0 or if the buffer could not be grown, 1 otherwise.",
+    parameters = List(
+      FunctionParameter("uint8_t const*", "data"),
+      FunctionParameter("size_t", "len")
+    ),
+    body =
+      s"""${Constants.defaultBooleanCType} success;
+         |char text[256];
+         |size_t chunk;
+         |
+         |success = ( NULL != data ) || ( 0 == len );
+         |
+         |// A chunk of 192 bytes fills the text buffer exactly
+         |while( success && ( len > 0 ) )
+         |    {
+         |    chunk = ( len < 192 ) ? len : 192;
+         |    ${Base64.encodeName}( data, chunk, text );
+         |    success = $writeName( $paramName, text, ${Base64.encodedLength("chunk")} );
+         |    data += chunk;
+         |    len -= chunk;
+         |    }
+         |
+         |return success;""".stripMargin
+  )
+
+  private val timestampFunction = writerFunction(
+    name = timestampName,
+    shortSummary = "Write an XML timestamp",
+    description = "Appends the timestamp as an RFC 3339 date-time in UTC, which needs no escaping. Returns 0 if the buffer could not be grown, 1 otherwise.",
+    parameters = List(FunctionParameter(Constants.defaultTimestampCType, "value")),
+    body =
+      s"""char text[${Timestamp.textSize}];
+         |size_t length;
+         |
+         |length = ${Timestamp.formatName}( value, text );
+         |
+         |return $writeName( $paramName, text, length );""".stripMargin
+  )
+}
@@ -12,6 +12,8 @@ sealed trait CompilerError
 case class DuplicateMessagesError(duplicateMessages: Seq[String]) extends SemanticError
 case class MessageErrors(errors: Seq[InvalidMessageError]) extends SemanticError
 case class ObjectTypesNotDefinedError(objectNames: Seq[String]) extends SemanticError
+case class IndexKeysNotValidError(indexedFields: Seq[String]) extends SemanticError
+case class DuplicateFieldPathNamesError(fieldPaths: Seq[String]) extends SemanticError
 
 /**
   * Decorates a message definition error with the name of the message to provide
@@ -25,7 +27,9 @@ case class InvalidMessageError(messageName: String, error: MessageDefinitionErro
 sealed trait MessageDefinitionError extends SemanticError
 case class DuplicateFieldsError(fields: Seq[String]) extends MessageDefinitionError
 case class DuplicateJSONKeysError(jsonKeys: Seq[String]) extends MessageDefinitionError
+case class DuplicateXMLNamesError(xmlNames: Seq[String]) extends MessageDefinitionError
 case class FieldErrors(errors: Seq[InvalidFieldError]) extends MessageDefinitionError
+case class DuplicateMessageAttributeError(attribute: String) extends MessageDefinitionError
 
 /**
   * Decorates a field definition error with the name of the field to provide more
@@ -39,6 +43,13 @@ case class InvalidFieldError(fieldName: String, error: FieldDefinitionError)
 sealed trait FieldDefinitionError extends SemanticError
 case class DuplicateAttributeError(attribute: String) extends FieldDefinitionError
 case class TypeAliasNotAllowedError(underlyingType: String) extends FieldDefinitionError
+case class InternNotAllowedError(fieldType: String) extends FieldDefinitionError
+case class InlineNotAllowedError(fieldType: String) extends FieldDefinitionError
+case class IndexNotAllowedError(fieldType: String) extends FieldDefinitionError
+case class DefaultNotAllowedError(fieldType: String) extends FieldDefinitionError
+case class DefaultNotValidError(value: String) extends FieldDefinitionError
+case class OmitEmptyNotAllowedError(fieldType: String) extends FieldDefinitionError
+case class DuplicateEnumValuesError(values: Seq[String]) extends FieldDefinitionError
 
 /**
   * Contains information about a syntax error encountered by the parser
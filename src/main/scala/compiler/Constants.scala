@@ -7,4 +7,11 @@ package compiler
 object Constants {
   val JSON_KEY_ATTRIBUTE = "jsonKey"
   val C_TYPE_ATTRIBUTE = "cType"
+  val INTERN_ATTRIBUTE = "intern"
+  val INLINE_ATTRIBUTE = "inline"
+  val CACHE_ATTRIBUTE = "cache"
+  val XML_NAME_ATTRIBUTE = "xmlName"
+  val INDEX_ATTRIBUTE = "index"
+  val DEFAULT_ATTRIBUTE = "default"
+  val OMIT_EMPTY_ATTRIBUTE = "omitEmpty"
 }
@@ -8,17 +8,43 @@ import datamodel._
   */
 object FieldDefinitionAnalyzer {
 
+  /**
+    * Ranges of the integer C types that numbers may be aliased to, by type name. Types whose
+    * width depends on the platform get the range they have on every common platform. Numbers
+    * aliased to other types, such as float or types from custom headers, are not checked.
+    */
+  private val integerCTypeRanges: Map[String, (BigInt, BigInt)] = Map(
+    "int8_t" -> (BigInt(-128), BigInt(127)),
+    "uint8_t" -> (BigInt(0), BigInt(255)),
+    "int16_t" -> (BigInt(-32768), BigInt(32767)),
+    "uint16_t" -> (BigInt(0), BigInt(65535)),
+    "int32_t" -> (BigInt(Int.MinValue), BigInt(Int.MaxValue)),
+    "uint32_t" -> (BigInt(0), BigInt(4294967295L)),
+    "int64_t" -> (BigInt(Long.MinValue), BigInt(Long.MaxValue)),
+    "uint64_t" -> (BigInt(0), BigInt(2).pow(64) - 1),
+    "short" -> (BigInt(-32768), BigInt(32767)),
+    "int" -> (BigInt(Int.MinValue), BigInt(Int.MaxValue)),
+    "unsigned" -> (BigInt(0), BigInt(4294967295L)),
+    "long" -> (BigInt(Int.MinValue), BigInt(Int.MaxValue)),
+    "size_t" -> (BigInt(0), BigInt(4294967295L))
+  )
+
   /**
     * Analyzes and validates the provided parsed field definition
     * @param definition - Parsed field definition
+    * @param messageName - Name of the message containing the field
     * @return Field that corresponds to the definition or an error if the definition
     *         is invalid
     */
-  def apply(definition: FieldDefinition): Either[InvalidFieldError, Field] = {
+  def apply(definition: FieldDefinition, messageName: String): Either[InvalidFieldError, Field] = {
      val field = for {
-       fieldType <- fieldTypeGet(definition).right
+       fieldType <- fieldTypeGet(definition, messageName).right
        jsonKey <- jsonKeyGet(definition).right
-     } yield Field(definition.name, fieldType, jsonKey)
+       xmlName <- xmlNameGet(definition).right
+       index <- indexGet(definition, fieldType).right
+       default <- defaultGet(definition, fieldType).right
+       omitEmpty <- omitEmptyGet(definition, fieldType).right
+     } yield Field(definition.name, fieldType, jsonKey, xmlName, index, default, omitEmpty)
 
       field.fold(
         error => Left(InvalidFieldError(definition.name, error)),
@@ -29,12 +55,16 @@ object FieldDefinitionAnalyzer {
   /**
     * Returns the type to use for the field based on the definition
     * @param definition - Field definition
+    * @param messageName - Name of the message containing the field
     * @return Type of field or an error if the field definition is invalid
     */
-  private def fieldTypeGet(definition: FieldDefinition): Either[FieldDefinitionError, FieldType] = {
+  private def fieldTypeGet(definition: FieldDefinition, messageName: String): Either[FieldDefinitionError, FieldType] = {
+    val enumName = defaultEnumNameGet(definition, messageName)
+
     definition.fieldType match {
-      case ArrayTypeDefinition(elementTypeDef) => arrayFieldTypeGet(elementTypeDef, definition.attributes)
-      case simpleTypeDef:SimpleTypeDefinition => simpleFieldTypeGet(simpleTypeDef, definition.attributes)
+      case ArrayTypeDefinition(elementTypeDef) => arrayFieldTypeGet(elementTypeDef, definition.attributes, enumName)
+      case BytesTypeDefinition() => bytesFieldTypeGet(definition.attributes)
+      case simpleTypeDef:SimpleTypeDefinition => simpleFieldTypeGet(simpleTypeDef, definition.attributes, enumName)
     }
   }
 
@@ -42,29 +72,141 @@ object FieldDefinitionAnalyzer {
     * Gets the field type for array field.
     * @param attributes - Field attributes provided in the field definition
     * @param elementTypeDef - Definition of the array's element type
+    * @param enumName - Name of the C enum to generate if the elements are enum values
     * @return An array type with the defined element type or an error if the definition is invalid.
     */
-  private def arrayFieldTypeGet(elementTypeDef: SimpleTypeDefinition, attributes: Seq[FieldAttribute]) = {
-    simpleFieldTypeGet(elementTypeDef, attributes)
-      .right.map(elementType => ArrayType(elementType))
+  private def arrayFieldTypeGet(elementTypeDef: SimpleTypeDefinition, attributes: Seq[FieldAttribute], enumName: String): Either[FieldDefinitionError, FieldType] = {
+    // Inline storage applies to the array, not to its elements
+    val inlineAttributes = attributes.collect({ case InlineAttribute(capacity) => capacity })
+    val elementType = simpleFieldTypeGet(elementTypeDef, attributes.filterNot(_.isInstanceOf[InlineAttribute]), enumName)
+
+    inlineAttributes match {
+      case Seq() => elementType.right.map(validElementType => ArrayType(validElementType))
+      case Seq(capacity) => elementType.right.map(validElementType => InlineArrayType(validElementType, capacity))
+      case _ => Left(DuplicateAttributeError(Constants.INLINE_ATTRIBUTE))
+    }
+  }
+
+  /**
+    * Gets the field type for a bytes field. Bytes are always stored as a heap buffer, so
+    * they cannot be aliased, interned or stored inline.
+    * @param attributes - Field attributes provided in the field definition
+    * @return The bytes type or an error if the definition is invalid
+    */
+  private def bytesFieldTypeGet(attributes: Seq[FieldAttribute]): Either[FieldDefinitionError, FieldType] = {
+    val typeString = BytesType.toString
+
+    attributes.collectFirst({
+      case CTypeAttribute(_) => TypeAliasNotAllowedError(typeString)
+      case InternAttribute(true) => InternNotAllowedError(typeString)
+      case InlineAttribute(_) => InlineNotAllowedError(typeString)
+    }).toLeft(BytesType)
   }
 
   /**
     * Gets the field type for a simple non-array field
     * @param attributes - Field attributes provided in the field definition
     * @param typeDefinition - Definition of the field's type
+    * @param enumName - Name of the C enum to generate if the field holds enum values
     * @return Type of the field corresponding to the definition or an error if the definition is invalid
     */
-  private def simpleFieldTypeGet(typeDefinition: SimpleTypeDefinition, attributes: Seq[FieldAttribute]) = {
-    val simpleFieldType = typeDefinition match {
-      case BooleanTypeDefinition() => BooleanType
-      case DynamicStringTypeDefinition() => DynamicStringType
-      case FixedStringTypeDefinition(maxLength) => FixedStringType(maxLength)
-      case NumberTypeDefinition() => NumberType
-      case ObjectTypeDefinition(objectName) => ObjectType(objectName)
+  private def simpleFieldTypeGet(typeDefinition: SimpleTypeDefinition, attributes: Seq[FieldAttribute], enumName: String) = {
+    val simpleFieldType: Either[FieldDefinitionError, SimpleFieldType] = typeDefinition match {
+      case BooleanTypeDefinition() => Right(BooleanType)
+      case DynamicStringTypeDefinition() => Right(DynamicStringType)
+      case EnumTypeDefinition(values) => enumTypeGet(enumName, values)
+      case FixedStringTypeDefinition(maxLength) => Right(FixedStringType(maxLength))
+      case NumberTypeDefinition() => Right(NumberType)
+      case ObjectTypeDefinition(objectName) => Right(ObjectType(objectName))
+      case TimestampTypeDefinition() => Right(TimestampType)
     }
 
-    typeCheckAlias(simpleFieldType, attributes)
+    for {
+      simpleType <- simpleFieldType.right
+      internedType <- typeCheckIntern(simpleType, attributes).right
+      inlineType <- typeCheckInline(internedType, attributes).right
+      aliasedType <- typeCheckAlias(inlineType, attributes).right
+    } yield aliasedType
+  }
+
+  /**
+    * Creates an enum type with the provided values
+    * @param enumName - Name of the C enum
+    * @param values - Values of the enum, as they appear in JSON
+    * @return The enum type or an error if values are duplicated. Values are also
+    *         duplicates if they only differ in case, since they would produce the same C
+    *         constant.
+    */
+  private def enumTypeGet(enumName: String, values: Seq[String]): Either[FieldDefinitionError, SimpleFieldType] = {
+    val valuesByConstant = values.groupBy(_.toUpperCase)
+    val duplicateValues = values.filter(value => valuesByConstant(value.toUpperCase).size > 1).distinct
+
+    duplicateValues match {
+      case Nil => Right(EnumType(enumName, values))
+      case _ => Left(DuplicateEnumValuesError(duplicateValues))
+    }
+  }
+
+  /**
+    * Checks whether the field's strings should be interned based on whether an
+    * intern field attribute was provided.
+    * @param attributes - Field attributes provided in the field definition
+    * @param fieldType - Type of the field
+    * @return An interned string type if interning was requested, the unmodified field type
+    *         otherwise, or an error if the definition is invalid
+    */
+  private def typeCheckIntern(fieldType: SimpleFieldType, attributes: Seq[FieldAttribute]): Either[FieldDefinitionError, SimpleFieldType] = {
+    val internAttributes = attributes.collect({ case InternAttribute(intern) => intern })
+
+    internAttributes match {
+      case Nil => Right(fieldType)
+      case false :: Nil => Right(fieldType)
+      case true :: Nil => typeSetInterned(fieldType)
+      case _ => Left(DuplicateAttributeError(Constants.INTERN_ATTRIBUTE))
+    }
+  }
+
+  /**
+    * Gets the interned version of the provided type
+    * @param underlyingType - Type whose values should be interned
+    * @return The interned string type or an error if the type cannot be interned
+    */
+  private def typeSetInterned(underlyingType: SimpleFieldType): Either[FieldDefinitionError, SimpleFieldType] = {
+    underlyingType match {
+      case DynamicStringType => Right(InternedStringType)
+      case _ => Left(InternNotAllowedError(underlyingType.toString))
+    }
+  }
+
+  /**
+    * Checks whether the field's strings should be stored inline based on whether an
+    * inline field attribute was provided.
+    * @param attributes - Field attributes provided in the field definition
+    * @param fieldType - Type of the field
+    * @return An inline string type if inline storage was requested, the unmodified field
+    *         type otherwise, or an error if the definition is invalid
+    */
+  private def typeCheckInline(fieldType: SimpleFieldType, attributes: Seq[FieldAttribute]): Either[FieldDefinitionError, SimpleFieldType] = {
+    val inlineAttributes = attributes.collect({ case InlineAttribute(capacity) => capacity })
+
+    inlineAttributes match {
+      case Nil => Right(fieldType)
+      case capacity :: Nil => typeSetInline(capacity, fieldType)
+      case _ => Left(DuplicateAttributeError(Constants.INLINE_ATTRIBUTE))
+    }
+  }
+
+  /**
+    * Gets the version of the provided type that stores short values inline
+    * @param capacity - Length of the longest value stored inline
+    * @param underlyingType - Type whose values should be stored inline
+    * @return The inline string type or an error if the type cannot be stored inline
+    */
+  private def typeSetInline(capacity: Int, underlyingType: SimpleFieldType): Either[FieldDefinitionError, SimpleFieldType] = {
+    underlyingType match {
+      case DynamicStringType => Right(InlineStringType(capacity))
+      case _ => Left(InlineNotAllowedError(underlyingType.toString))
+    }
   }
 
   /**
@@ -95,6 +237,8 @@ object FieldDefinitionAnalyzer {
     underlyingType match {
       case AliasedType(_, _) => Left(TypeAliasNotAllowedError(underlyingType.toString))
       case ObjectType(_) => Left(TypeAliasNotAllowedError(underlyingType.toString))
+      case EnumType(_, _) => Left(TypeAliasNotAllowedError(underlyingType.toString))
+      case InlineStringType(_) => Left(TypeAliasNotAllowedError(underlyingType.toString))
       case baseType:BaseFieldType => Right(AliasedType(cTypeAlias, baseType))
     }
   }
@@ -117,6 +261,128 @@ object FieldDefinitionAnalyzer {
     }
   }
 
+  /**
+    * Returns the XML element name provided in the field definition, if any. Fields without
+    * an XML name attribute use their JSON key as element name.
+    * @param definition - Field definition
+    * @return Either the field's XML name or an error if duplicate XML name attributes were
+    *         provided
+    */
+  private def xmlNameGet(definition: FieldDefinition): Either[FieldDefinitionError, Option[String]] = {
+    val xmlNameAttribute = definition.attributes.collect({ case XMLNameAttribute(name) => name })
+
+    xmlNameAttribute match {
+      case Nil => Right(None)
+      case name :: Nil => Right(Some(name))
+      case _ => Left(DuplicateAttributeError(Constants.XML_NAME_ATTRIBUTE))
+    }
+  }
+
+  /**
+    * Returns the key field of the field's lookup index, if any. Only arrays of messages can
+    * be indexed. Whether the key names a string field of the element message is checked
+    * once all messages are known.
+    * @param definition - Field definition
+    * @param fieldType - Type of the field
+    * @return Either the name of the key field or an error if the field cannot be indexed
+    *         or duplicate index attributes were provided
+    */
+  private def indexGet(definition: FieldDefinition, fieldType: FieldType): Either[FieldDefinitionError, Option[String]] = {
+    val indexAttribute = definition.attributes.collect({ case IndexAttribute(keyField) => keyField })
+
+    (indexAttribute, fieldType) match {
+      case (Nil, _) => Right(None)
+      case (keyField :: Nil, ArrayType(ObjectType(_)) | InlineArrayType(ObjectType(_), _)) => Right(Some(keyField))
+      case (_ :: Nil, _) => Left(IndexNotAllowedError(fieldType.toString))
+      case _ => Left(DuplicateAttributeError(Constants.INDEX_ATTRIBUTE))
+    }
+  }
+
+  /**
+    * Returns the default value of the field, if any. Defaults are literals of numbers,
+    * booleans and enum values, so only such fields can have one.
+    * @param definition - Field definition
+    * @param fieldType - Type of the field
+    * @return Either the literal of the default value or an error if the field cannot have a
+    *         default, the value does not match the field's type or duplicate default
+    *         attributes were provided
+    */
+  private def defaultGet(definition: FieldDefinition, fieldType: FieldType): Either[FieldDefinitionError, Option[String]] = {
+    val defaultAttribute = definition.attributes.collect({ case DefaultAttribute(value) => value })
+
+    val baseType = fieldType match {
+      case AliasedType(_, underlyingType) => underlyingType
+      case _ => fieldType
+    }
+
+    (defaultAttribute, baseType) match {
+      case (Nil, _) => Right(None)
+      case (value :: Nil, NumberType) if isNumberLiteral(value) && fitsCType(value, fieldType) => Right(Some(value))
+      case (value :: Nil, BooleanType) if value == "true" || value == "false" => Right(Some(value))
+      case (value :: Nil, EnumType(_, values)) if values.contains(value) => Right(Some(value))
+      case (value :: Nil, NumberType | BooleanType | EnumType(_, _)) => Left(DefaultNotValidError(value))
+      case (_ :: Nil, _) => Left(DefaultNotAllowedError(fieldType.toString))
+      case _ => Left(DuplicateAttributeError(Constants.DEFAULT_ATTRIBUTE))
+    }
+  }
+
+  /**
+    * @param value - Literal of a default value
+    * @return True if the literal is a number, as opposed to an identifier
+    */
+  private def isNumberLiteral(value: String): Boolean = {
+    value.headOption.exists(c => c == '-' || c.isDigit)
+  }
+
+  /**
+    * @param value - Literal of a number
+    * @param fieldType - Type of a number field
+    * @return True if the number can be stored in the field's C type: a whole number within
+    *         the type's range if the field is aliased to an integer type
+    */
+  private def fitsCType(value: String, fieldType: FieldType): Boolean = {
+    val range = fieldType match {
+      case AliasedType(alias, _) => integerCTypeRanges.get(alias)
+      case _ => None
+    }
+
+    range.forall({ case (min, max) =>
+      val number = BigDecimal(value)
+      number.isWhole && number >= BigDecimal(min) && number <= BigDecimal(max)
+    })
+  }
+
+  /**
+    * Returns whether the field is left out of serialized messages while it is empty. Nested
+    * messages are never empty.
+    * @param definition - Field definition
+    * @param fieldType - Type of the field
+    * @return Either whether the field omits empty values or an error if the field cannot be
+    *         empty or duplicate omitEmpty attributes were provided
+    */
+  private def omitEmptyGet(definition: FieldDefinition, fieldType: FieldType): Either[FieldDefinitionError, Boolean] = {
+    val omitEmptyAttribute = definition.attributes.collect({ case OmitEmptyAttribute(omitEmpty) => omitEmpty })
+
+    (omitEmptyAttribute, fieldType) match {
+      case (Nil, _) => Right(false)
+      case (true :: Nil, ObjectType(_)) => Left(OmitEmptyNotAllowedError(fieldType.toString))
+      case (omitEmpty :: Nil, _) => Right(omitEmpty)
+      case _ => Left(DuplicateAttributeError(Constants.OMIT_EMPTY_ATTRIBUTE))
+    }
+  }
+
+  /**
+    * Returns the name of the C enum generated for an enum field. Enums are named after
+    * the message and field that define them, so that fields of different messages with
+    * the same name do not clash.
+    * @param definition - Field definition
+    * @param messageName - Name of the message containing the field
+    * @return Name of the field's C enum
+    */
+  private def defaultEnumNameGet(definition: FieldDefinition, messageName: String): String = {
+    s"${messageName}_${definition.name}"
+  }
+
   /**
     * Returns the default JSON key to use for the provided field if no JSON key attribute
     * was provided in the field definition. In this case, it simply falls back to using the
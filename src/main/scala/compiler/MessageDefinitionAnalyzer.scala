@@ -19,7 +19,10 @@ object MessageDefinitionAnalyzer {
       fields <- fieldsGetAll(definition).right
       fields <- fieldsCheckDuplicates(fields).right
       fields <- jsonKeysCheckDuplicates(fields).right
-    } yield Message(definition.name, fields)
+      fields <- xmlNamesCheckDuplicates(fields).right
+      cached <- cacheGet(definition).right
+      omitEmpty <- omitEmptyGet(definition).right
+    } yield Message(definition.name, fieldsOmitEmpty(definition, fields, omitEmpty), cached)
 
     message.fold(
       error => Left(InvalidMessageError(definition.name, error)),
@@ -34,7 +37,7 @@ object MessageDefinitionAnalyzer {
     *         of fields corresponding to the definition
     */
   def fieldsGetAll(definition: MessageDefinition): Either[MessageDefinitionError, Seq[Field]] = {
-    val fields =  definition.fields.map(field => FieldDefinitionAnalyzer(field))
+    val fields =  definition.fields.map(field => FieldDefinitionAnalyzer(field, definition.name))
 
     val errors = fields.flatMap(field => field.left.toOption)
     val validFields = fields.flatMap(field => field.right.toOption)
@@ -45,6 +48,58 @@ object MessageDefinitionAnalyzer {
     }
   }
 
+  /**
+    * Gets whether the message keeps its serialized JSON
+    * @param definition - Parsed message definition
+    * @return Either an error if the cache attribute is given more than once, or whether the
+    *         message is cached
+    */
+  def cacheGet(definition: MessageDefinition): Either[MessageDefinitionError, Boolean] = {
+    val cacheAttributes = definition.attributes.collect({ case CacheAttribute(cache) => cache })
+
+    cacheAttributes match {
+      case Seq() => Right(false)
+      case Seq(cache) => Right(cache)
+      case _ => Left(DuplicateMessageAttributeError(Constants.CACHE_ATTRIBUTE))
+    }
+  }
+
+  /**
+    * Gets whether the fields of the message omit empty values unless they say otherwise
+    * @param definition - Parsed message definition
+    * @return Either an error if the omitEmpty attribute is given more than once, or whether
+    *         the message's fields omit empty values
+    */
+  def omitEmptyGet(definition: MessageDefinition): Either[MessageDefinitionError, Boolean] = {
+    val omitEmptyAttributes = definition.attributes.collect({ case MessageOmitEmptyAttribute(omitEmpty) => omitEmpty })
+
+    omitEmptyAttributes match {
+      case Seq() => Right(false)
+      case Seq(omitEmpty) => Right(omitEmpty)
+      case _ => Left(DuplicateMessageAttributeError(Constants.OMIT_EMPTY_ATTRIBUTE))
+    }
+  }
+
+  /**
+    * Applies the message's omitEmpty attribute to its fields. Fields with an omitEmpty
+    * attribute of their own keep it, and nested messages are never empty.
+    * @param definition - Parsed message definition
+    * @param fields - Fields of the message, in the order they are defined
+    * @param omitEmpty - Whether the message's fields omit empty values
+    * @return The fields with omitEmpty set where the message's attribute applies
+    */
+  def fieldsOmitEmpty(definition: MessageDefinition, fields: Seq[Field], omitEmpty: Boolean): Seq[Field] = {
+    definition.fields.zip(fields).map({ case (fieldDefinition, field) =>
+      val hasOwnAttribute = fieldDefinition.attributes.exists(_.isInstanceOf[OmitEmptyAttribute])
+
+      field.fieldType match {
+        case ObjectType(_) => field
+        case _ if omitEmpty && !hasOwnAttribute => field.copy(omitEmpty = true)
+        case _ => field
+      }
+    })
+  }
+
   /**
     * Check for duplicate fields
     * @param fields - List of fields contained within a message
@@ -78,4 +133,21 @@ object MessageDefinitionAnalyzer {
       case _ => Left(DuplicateJSONKeysError(duplicateKeys))
     }
   }
+
+  /**
+    * Check for duplicate XML element names
+    * @param fields List of fields contained within a message
+    * @return If there are no duplicate XML names, the provided fields sequence is returned
+    *         unmodified. Otherwise, an error is returned with the set of duplicate names.
+    */
+  def xmlNamesCheckDuplicates(fields: Seq[Field]): Either[MessageDefinitionError, Seq[Field]] = {
+    val fieldsByNames = fields.groupBy(_.xmlElementName)
+
+    val duplicateNames = fieldsByNames.keys.filter(xmlName => fieldsByNames(xmlName).size > 1).toSeq
+
+    duplicateNames match {
+      case Nil => Right(fields)
+      case _ => Left(DuplicateXMLNamesError(duplicateNames))
+    }
+  }
 }
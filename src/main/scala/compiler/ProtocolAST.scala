@@ -8,23 +8,36 @@ import scala.util.parsing.input.Positional
 
 case class ProtocolAST(messages: Seq[MessageDefinition]) extends Positional
 
-case class MessageDefinition(name: String, fields: Seq[FieldDefinition]) extends Positional
+case class MessageDefinition(name: String, fields: Seq[FieldDefinition], attributes: Seq[MessageAttribute] = Nil) extends Positional
 
 case class FieldDefinition(name: String, fieldType: FieldTypeDefinition, attributes: Seq[FieldAttribute]) extends Positional
 
 sealed trait FieldTypeDefinition extends Positional
 case class ArrayTypeDefinition(elementType: SimpleTypeDefinition) extends FieldTypeDefinition
+case class BytesTypeDefinition() extends FieldTypeDefinition
 
 sealed trait SimpleTypeDefinition extends FieldTypeDefinition
 case class BooleanTypeDefinition() extends SimpleTypeDefinition
 case class DynamicStringTypeDefinition() extends SimpleTypeDefinition
+case class EnumTypeDefinition(values: Seq[String]) extends SimpleTypeDefinition
 case class FixedStringTypeDefinition(maxLength: Int) extends SimpleTypeDefinition
 case class NumberTypeDefinition() extends SimpleTypeDefinition
 case class ObjectTypeDefinition(objectName: String) extends SimpleTypeDefinition
+case class TimestampTypeDefinition() extends SimpleTypeDefinition
+
+sealed trait MessageAttribute extends Positional
+case class CacheAttribute(cache: Boolean) extends MessageAttribute
+case class MessageOmitEmptyAttribute(omitEmpty: Boolean) extends MessageAttribute
 
 sealed trait FieldAttribute extends Positional
 case class CTypeAttribute(cType: String) extends FieldAttribute
 case class JSONKeyAttribute(key: String) extends FieldAttribute
+case class XMLNameAttribute(name: String) extends FieldAttribute
+case class InternAttribute(intern: Boolean) extends FieldAttribute
+case class InlineAttribute(capacity: Int) extends FieldAttribute
+case class IndexAttribute(keyField: String) extends FieldAttribute
+case class DefaultAttribute(value: String) extends FieldAttribute
+case class OmitEmptyAttribute(omitEmpty: Boolean) extends FieldAttribute
 
 /*
  Tokens
@@ -32,11 +45,15 @@ case class JSONKeyAttribute(key: String) extends FieldAttribute
 case class ArrayClose() extends Positional
 case class ArrayKeyword() extends Positional
 case class ArrayOpen() extends Positional
+case class BooleanLiteral(value: Boolean) extends Positional
 case class CloseBrace() extends Positional
+case class Comma() extends Positional
+case class EnumKeyword() extends Positional
 case class Equals() extends Positional
 case class Identifier(id: String) extends Positional
 case class IntegerLiteral(value: Int) extends Positional
 case class JSONKey() extends Positional
 case class LineEnd() extends Positional
+case class NumberLiteral(value: String) extends Positional
 case class OpenBrace() extends Positional
 case class StringType() extends Positional
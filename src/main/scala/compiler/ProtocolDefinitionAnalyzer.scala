@@ -21,6 +21,8 @@ object ProtocolDefinitionAnalyzer {
       messages <- messagesGetAll(ast).right
       messages <- messagesCheckDuplicates(messages).right
       messages <- messagesCheckUndefinedFields(messages).right
+      messages <- messagesCheckIndexKeys(messages).right
+      messages <- messagesCheckFieldPathNames(messages).right
     } yield Protocol(protocolName, messages)
   }
 
@@ -88,4 +90,71 @@ object ProtocolDefinitionAnalyzer {
       Left(ObjectTypesNotDefinedError(undefinedObjects.toSeq))
     }
   }
+
+  /**
+    * Checks whether the key of every indexed array field is a string field of the array's
+    * element message. Indexes hash and compare the keys as NUL-terminated strings.
+    * @param messages - List of messages in the protocol
+    * @return An error listing every indexed field, as message.field, whose key is not a
+    *         string field of its elements, otherwise the input sequence of messages is
+    *         returned unmodified.
+    */
+  private def messagesCheckIndexKeys(messages: Seq[Message]): Either[SemanticError, Seq[Message]] = {
+    val messagesByName = messages.map(message => message.name -> message).toMap
+
+    val invalidFields = for {
+      message <- messages
+      field <- message.fields
+      keyField <- field.index
+      objectName <- field.fieldType match {
+        case ArrayType(ObjectType(objectName)) => Some(objectName)
+        case InlineArrayType(ObjectType(objectName), _) => Some(objectName)
+        case _ => None
+      }
+      if !messagesByName(objectName).fields.exists(element => element.name == keyField && isStringKey(element.fieldType))
+    } yield s"${message.name}.${field.name}"
+
+    invalidFields match {
+      case Nil => Right(messages)
+      case _ => Left(IndexKeysNotValidError(invalidFields))
+    }
+  }
+
+  /**
+    * Checks whether different field paths of a message get the same name when the names of
+    * their fields are joined with underscores, like a field a_b and the field b of a nested
+    * message a. The extractors of the paths are named this way, so their C functions would
+    * clash.
+    * @param messages - List of messages in the protocol
+    * @return An error listing every path, as message.field.field, whose name is shared with
+    *         another path, otherwise the input sequence of messages is returned unmodified.
+    */
+  private def messagesCheckFieldPathNames(messages: Seq[Message]): Either[SemanticError, Seq[Message]] = {
+    val messagesByName = messages.map(message => message.name -> message).toMap
+
+    val duplicatePaths = for {
+      message <- messages
+      pathsByName = FieldPaths(message, messagesByName).groupBy(_.map(_.name).mkString("_"))
+      (_, paths) <- pathsByName.toSeq.sortBy(_._1)
+      if paths.size > 1
+      path <- paths
+    } yield (message.name +: path.map(_.name)).mkString(".")
+
+    duplicatePaths match {
+      case Nil => Right(messages)
+      case _ => Left(DuplicateFieldPathNamesError(duplicatePaths))
+    }
+  }
+
+  /**
+    * @param fieldType - Type of a field
+    * @return True if the field holds a string that can key an index
+    */
+  private def isStringKey(fieldType: FieldType): Boolean = {
+    fieldType match {
+      case DynamicStringType | InternedStringType | FixedStringType(_) | InlineStringType(_) => true
+      case AliasedType(_, DynamicStringType | InternedStringType | FixedStringType(_)) => true
+      case _ => false
+    }
+  }
 }
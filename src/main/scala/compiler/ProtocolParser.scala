@@ -1,5 +1,7 @@
 package compiler
 
+import java.nio.CharBuffer
+
 import scala.util.parsing.combinator.RegexParsers
 
 
@@ -11,7 +13,10 @@ object ProtocolParser extends RegexParsers {
     * @return An error if parsing failed or the AST obtained from the parsed protocol definition
     */
   def apply(input: String): Either[CompilerError,ProtocolAST] = {
-    parse(protocol, input) match {
+    // RegexParsers matches each token against the remainder of the input through subSequence,
+    // which copies a String but is a constant-time view of a CharBuffer. Wrapping the input
+    // keeps parsing linear in the size of the protocol definition.
+    parse(protocol, CharBuffer.wrap(input)) match {
       case NoSuccess(msg, next) => Left(ParserError(Location(next.pos.line, next.pos.column), msg))
       case Success(ast, _) => Right(ast)
     }
@@ -22,11 +27,26 @@ object ProtocolParser extends RegexParsers {
   }
 
   private def message: Parser[MessageDefinition] = {
-    identifier ~ openBrace ~ rep1(field) ~ closeBrace ^^ {
-      case Identifier(name) ~ _ ~ fields ~ _ => MessageDefinition(name, fields)
+    identifier ~ rep(messageAttribute) ~ openBrace ~ rep1(field) ~ closeBrace ^^ {
+      case Identifier(name) ~ attributes ~ _ ~ fields ~ _ => MessageDefinition(name, fields, attributes)
     }
   }
 
+  /*
+  * Parsers for message attributes
+  */
+  private def messageAttribute: Parser[MessageAttribute] = {
+    cacheAttribute | messageOmitEmptyAttribute
+  }
+
+  private def cacheAttribute: Parser[CacheAttribute] = {
+    Constants.CACHE_ATTRIBUTE ~ equals ~ booleanLiteral ^^ { case _ ~ _ ~ BooleanLiteral(cache) => CacheAttribute(cache) }
+  }
+
+  private def messageOmitEmptyAttribute: Parser[MessageOmitEmptyAttribute] = {
+    Constants.OMIT_EMPTY_ATTRIBUTE ~ equals ~ booleanLiteral ^^ { case _ ~ _ ~ BooleanLiteral(omitEmpty) => MessageOmitEmptyAttribute(omitEmpty) }
+  }
+
   private def field: Parser[FieldDefinition] = {
     identifier ~ fieldType ~ rep(fieldAttribute) ~ lineEnd ^^ {
       case Identifier(name) ~ fType ~ attributes ~ _ => FieldDefinition(name, fType, attributes)
@@ -37,7 +57,7 @@ object ProtocolParser extends RegexParsers {
   * Parsers for field attributes
   */
   private def fieldAttribute: Parser[FieldAttribute] = {
-    cTypeAttribute | jsonKeyAttribute
+    cTypeAttribute | jsonKeyAttribute | xmlNameAttribute | internAttribute | inlineAttribute | indexAttribute | defaultAttribute | omitEmptyAttribute
   }
 
   private def cTypeAttribute: Parser[CTypeAttribute] = {
@@ -48,11 +68,39 @@ object ProtocolParser extends RegexParsers {
     Constants.JSON_KEY_ATTRIBUTE ~ equals ~ identifier ^^ { case _ ~ _ ~ Identifier(key) => JSONKeyAttribute(key) }
   }
 
+  private def xmlNameAttribute: Parser[XMLNameAttribute] = {
+    Constants.XML_NAME_ATTRIBUTE ~ equals ~ xmlName ^^ { case _ ~ _ ~ Identifier(name) => XMLNameAttribute(name) }
+  }
+
+  private def internAttribute: Parser[InternAttribute] = {
+    Constants.INTERN_ATTRIBUTE ~ equals ~ booleanLiteral ^^ { case _ ~ _ ~ BooleanLiteral(intern) => InternAttribute(intern) }
+  }
+
+  private def inlineAttribute: Parser[InlineAttribute] = {
+    Constants.INLINE_ATTRIBUTE ~ equals ~ integerLiteral ^^ { case _ ~ _ ~ IntegerLiteral(capacity) => InlineAttribute(capacity) }
+  }
+
+  private def indexAttribute: Parser[IndexAttribute] = {
+    Constants.INDEX_ATTRIBUTE ~ equals ~ identifier ^^ { case _ ~ _ ~ Identifier(keyField) => IndexAttribute(keyField) }
+  }
+
+  // The value is checked against the field's type when the field is analyzed
+  private def defaultAttribute: Parser[DefaultAttribute] = {
+    Constants.DEFAULT_ATTRIBUTE ~ equals ~ (numberLiteral | identifier) ^^ {
+      case _ ~ _ ~ NumberLiteral(value) => DefaultAttribute(value)
+      case _ ~ _ ~ Identifier(value) => DefaultAttribute(value)
+    }
+  }
+
+  private def omitEmptyAttribute: Parser[OmitEmptyAttribute] = {
+    Constants.OMIT_EMPTY_ATTRIBUTE ~ equals ~ booleanLiteral ^^ { case _ ~ _ ~ BooleanLiteral(omitEmpty) => OmitEmptyAttribute(omitEmpty) }
+  }
+
   /*
   * Parsers and recognizers for field types
   */
   private def fieldType: Parser[FieldTypeDefinition] = {
-    arrayType | simpleFieldType
+    arrayType | bytesType | simpleFieldType
   }
 
   private def arrayType: Parser[ArrayTypeDefinition] = {
@@ -62,7 +110,11 @@ object ProtocolParser extends RegexParsers {
   }
 
   private def simpleFieldType: Parser[SimpleTypeDefinition] = {
-    numberType | booleanType | fixedStringType | dynamicStringType | objectType
+    numberType | booleanType | fixedStringType | dynamicStringType | enumType | timestampType | objectType
+  }
+
+  private def bytesType: Parser[BytesTypeDefinition] = {
+    "Bytes" ^^ { _ => BytesTypeDefinition() }
   }
 
   private def booleanType: Parser[BooleanTypeDefinition] = {
@@ -73,6 +125,12 @@ object ProtocolParser extends RegexParsers {
     stringType ^^ { _ => DynamicStringTypeDefinition() }
   }
 
+  private def enumType: Parser[EnumTypeDefinition] = {
+    enumKeyword ~ arrayOpen ~ rep1sep(identifier, comma) ~ arrayClose ^^ {
+      case _ ~ _ ~ values ~ _ => EnumTypeDefinition(values.map(_.id))
+    }
+  }
+
   private def fixedStringType: Parser[FixedStringTypeDefinition] = {
     stringType ~ arrayOpen ~ integerLiteral ~ arrayClose ^^ {
       case  _ ~ _ ~ IntegerLiteral(maxLength) ~ _ => FixedStringTypeDefinition(maxLength)
@@ -83,6 +141,10 @@ object ProtocolParser extends RegexParsers {
     "Number" ^^ { _ => NumberTypeDefinition() }
   }
 
+  private def timestampType: Parser[TimestampTypeDefinition] = {
+    "Timestamp" ^^ { _ => TimestampTypeDefinition() }
+  }
+
   private def objectType: Parser[ObjectTypeDefinition] = {
     identifier ^^ { case Identifier(objectName) => ObjectTypeDefinition(objectName) }
   }
@@ -102,10 +164,22 @@ object ProtocolParser extends RegexParsers {
     "[" ^^ { _ => ArrayOpen() }
   }
 
+  private def booleanLiteral: Parser[BooleanLiteral] = {
+    ("true" | "false") ^^ { value => BooleanLiteral(value.toBoolean) }
+  }
+
   private def closeBrace: Parser[CloseBrace] = {
     "}" ^^ { _ => CloseBrace() }
   }
 
+  private def comma: Parser[Comma] = {
+    "," ^^ { _ => Comma() }
+  }
+
+  private def enumKeyword: Parser[EnumKeyword] = {
+    "Enum" ^^ { _ => EnumKeyword() }
+  }
+
   private def equals: Parser[Equals] = {
     "=" ^^ { _ => Equals() }
   }
@@ -114,10 +188,18 @@ object ProtocolParser extends RegexParsers {
     """[_a-zA-Z][_a-zA-Z0-9]*""".r ^^ { id => Identifier(id) }
   }
 
+  private def xmlName: Parser[Identifier] = {
+    """[_a-zA-Z][-_.:a-zA-Z0-9]*""".r ^^ { name => Identifier(name) }
+  }
+
   private def integerLiteral: Parser[IntegerLiteral] = {
     """[1-9][0-9]*""".r ^^ { value => IntegerLiteral(value.toInt) }
   }
 
+  private def numberLiteral: Parser[NumberLiteral] = {
+    """-?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][-+]?[0-9]+)?""".r ^^ { value => NumberLiteral(value) }
+  }
+
   private def lineEnd: Parser[LineEnd] = {
     ";" ^^ { _ => LineEnd() }
   }
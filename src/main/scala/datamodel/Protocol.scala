@@ -6,20 +6,49 @@ package datamodel
 
 case class Protocol(name: String, messages: Seq[Message])
 
-case class Message(name: String, fields: Seq[Field])
+/**
+  * A message of the protocol. Messages declared with cache=true keep their last
+  * serialized JSON so that it can be reused until one of their fields changes.
+  */
+case class Message(name: String, fields: Seq[Field], cached: Boolean = false)
+
+/**
+  * A field of a message. Fields are named jsonKey in JSON and xmlName, which defaults to the
+  * JSON key, in XML. An array of messages may have an index, the name of the string field of
+  * its elements that the parsers build a hash index over. A field with a default, the literal
+  * of a number, boolean or enum value, or with omitEmpty set is left out of the serialized
+  * message while it holds that default or is empty, and may be missing when parsing.
+  */
+case class Field(name: String,
+                 fieldType: FieldType,
+                 jsonKey: String,
+                 xmlName: Option[String] = None,
+                 index: Option[String] = None,
+                 default: Option[String] = None,
+                 omitEmpty: Boolean = false) {
 
-case class Field(name: String, fieldType: FieldType, jsonKey: String)
+  /**
+    * @return Name of the field's XML element
+    */
+  def xmlElementName: String = xmlName.getOrElse(jsonKey)
+}
 
 /**
   * The FieldType trait represents all possible message field types. At the
   * root level is the ArrayType which can contain any other type except
-  * another nested array. At the next level down is the AliasedType and
-  * ObjectType. These types can be contained in arrays, but they cannot
-  * be aliased. Finally, at the bottom level, are the base field types.
-  * These types can be contained in arrays, aliased, or both.
+  * another nested array, along with the InlineArrayType, an array that stores
+  * up to capacity elements inside its message, and the BytesType, binary data
+  * that is base64-encoded in JSON and XML and cannot be contained in arrays or
+  * aliased. At the next level down is the AliasedType and ObjectType. These
+  * types can be contained in arrays, but they cannot be aliased. Finally, at
+  * the bottom level, are the base field types. These types can be contained in
+  * arrays, aliased, or both. The TimestampType holds RFC 3339 date-times as
+  * nanoseconds since the Unix epoch.
   */
 sealed trait FieldType
 case class ArrayType(elementType: SimpleFieldType) extends FieldType
+case class InlineArrayType(elementType: SimpleFieldType, capacity: Int) extends FieldType
+case object BytesType extends FieldType
 
 sealed trait SimpleFieldType extends FieldType
 case class AliasedType(alias: String, underlyingType: BaseFieldType) extends SimpleFieldType
@@ -28,6 +57,46 @@ case class ObjectType(objectName: String) extends SimpleFieldType
 sealed trait BaseFieldType extends SimpleFieldType
 case object BooleanType extends BaseFieldType
 case object DynamicStringType extends BaseFieldType
+case object InternedStringType extends BaseFieldType
+case class InlineStringType(capacity: Int) extends BaseFieldType
 case class FixedStringType(maxLength: Int) extends BaseFieldType
+case class EnumType(name: String, values: Seq[String]) extends BaseFieldType
 case object NumberType extends BaseFieldType
+case object TimestampType extends BaseFieldType
+
+
+/**
+  * The paths of fields that can be read from a message on their own, which lead through
+  * nested messages to a boolean, number, string, enum or timestamp field. Array fields, the
+  * fields of messages inside of arrays, and bytes fields cannot be read on their own. Paths
+  * are at most maxLength fields long, so a message has a bounded number of them no matter
+  * how deeply messages nest or how many routes lead to the same message.
+  */
+object FieldPaths {
+
+  val maxLength = 3
+
+  /**
+    * @param message Message to read fields from
+    * @param messagesByName All messages of the protocol, by name
+    * @return Paths of fields leading from the message to each field that can be read
+    */
+  def apply(message: Message, messagesByName: Map[String, Message]): Seq[Seq[Field]] = {
+    paths(message, messagesByName, maxLength)
+  }
 
+  /**
+    * @param message Message to read fields from
+    * @param messagesByName All messages of the protocol, by name
+    * @param length Maximum length of the paths
+    * @return Paths of at most length fields leading from the message to each field that can
+    *         be read
+    */
+  private def paths(message: Message, messagesByName: Map[String, Message], length: Int): Seq[Seq[Field]] = {
+    message.fields.flatMap(field => field.fieldType match {
+      case ObjectType(objectName) if length > 1 => paths(messagesByName(objectName), messagesByName, length - 1).map(field +: _)
+      case ObjectType(_) | ArrayType(_) | InlineArrayType(_, _) | BytesType => Nil
+      case _ => List(List(field))
+    })
+  }
+}
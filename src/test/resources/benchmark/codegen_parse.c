@@ -0,0 +1,95 @@
+/*
+ * Driver of the codegen benchmark. Generates a page with the given number of issues,
+ * parses it the given number of times and prints the elapsed time of all the parses in
+ * milliseconds.
+ *
+ * Usage: codegen_parse <issue count> <repetition count>
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "codegen_parse.cdto.json.h"
+
+static double now_millis( void )
+{
+struct timespec now;
+
+clock_gettime( CLOCK_MONOTONIC, &now );
+return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+static char* generate_page( int issue_cnt )
+{
+char* json;
+size_t length;
+int i;
+
+json = malloc( 200 * ( size_t )issue_cnt + 64 );
+if( NULL == json )
+    {
+    return NULL;
+    }
+
+length = sprintf( json, "{\"title\":\"benchmark\",\"issues\":[" );
+for( i = 0; i < issue_cnt; i++ )
+    {
+    length += sprintf( json + length,
+                       "%s{\"number\":%d,\"title\":\"Issue number %d\",\"labels\":[{\"name\":\"bug\",\"color\":\"ff0000\"},{\"name\":\"p%d\",\"color\":\"00ff00\"}]}",
+                       ( 0 == i ) ? "" : ",", i, i, i % 4 );
+    }
+
+sprintf( json + length, "]}" );
+
+return json;
+}
+
+int main( int argc, char** argv )
+{
+char* json;
+page parsed;
+double start;
+int issue_cnt;
+int repetition_cnt;
+int success;
+int i;
+
+if( argc < 3 )
+    {
+    fprintf( stderr, "Usage: %s <issue count> <repetition count>\n", argv[0] );
+    return 2;
+    }
+
+issue_cnt = atoi( argv[1] );
+repetition_cnt = atoi( argv[2] );
+json = generate_page( issue_cnt );
+if( NULL == json )
+    {
+    return 1;
+    }
+
+success = 1;
+start = now_millis();
+for( i = 0; success && ( i < repetition_cnt ); i++ )
+    {
+    success = page_json_parse( json, &parsed );
+    if( success )
+        {
+        // Every parse must produce the whole page
+        success = ( parsed.issues_cnt == ( size_t )issue_cnt ) &&
+                  ( 0 == strcmp( parsed.issues[issue_cnt - 1].labels[0].name, "bug" ) );
+
+        page_free( &parsed );
+        }
+    }
+
+printf( "%.1f\n", now_millis() - start );
+
+free( json );
+
+return success ? 0 : 1;
+}
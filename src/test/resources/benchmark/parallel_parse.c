@@ -0,0 +1,101 @@
+/*
+ * Driver of the parallel parse benchmark. Generates a page with the given number of
+ * issues, parses it serially and then in parallel with each of the given thread counts,
+ * and prints one line per parse: the thread count (0 for the serial parse) followed by
+ * the elapsed time in milliseconds.
+ *
+ * Usage: parallel_parse <issue count> <thread count>...
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "parallel_parse.cdto.json.h"
+
+static double now_millis( void )
+{
+struct timespec now;
+
+clock_gettime( CLOCK_MONOTONIC, &now );
+return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+static char* generate_page( int issue_cnt )
+{
+char* json;
+size_t length;
+int i;
+
+json = malloc( 200 * ( size_t )issue_cnt + 64 );
+if( NULL == json )
+    {
+    return NULL;
+    }
+
+length = sprintf( json, "{\"title\":\"benchmark\",\"issues\":[" );
+for( i = 0; i < issue_cnt; i++ )
+    {
+    length += sprintf( json + length,
+                       "%s{\"number\":%d,\"title\":\"Issue number %d\",\"labels\":[{\"name\":\"bug\",\"color\":\"ff0000\"},{\"name\":\"p%d\",\"color\":\"00ff00\"}]}",
+                       ( 0 == i ) ? "" : ",", i, i, i % 4 );
+    }
+
+sprintf( json + length, "]}" );
+
+return json;
+}
+
+int main( int argc, char** argv )
+{
+char* json;
+page serial;
+page parallel;
+double start;
+int issue_cnt;
+int thread_cnt;
+int success;
+int i;
+
+if( argc < 3 )
+    {
+    fprintf( stderr, "Usage: %s <issue count> <thread count>...\n", argv[0] );
+    return 2;
+    }
+
+issue_cnt = atoi( argv[1] );
+json = generate_page( issue_cnt );
+if( NULL == json )
+    {
+    return 1;
+    }
+
+start = now_millis();
+success = page_json_parse( json, &serial );
+printf( "0 %.1f\n", now_millis() - start );
+
+for( i = 2; success && ( i < argc ); i++ )
+    {
+    thread_cnt = atoi( argv[i] );
+
+    start = now_millis();
+    success = page_json_parse_parallel( json, &parallel, thread_cnt );
+    printf( "%d %.1f\n", thread_cnt, now_millis() - start );
+
+    // Both parses must produce the same page
+    success = success &&
+              ( parallel.issues_cnt == serial.issues_cnt ) &&
+              ( parallel.issues[issue_cnt - 1].number == serial.issues[issue_cnt - 1].number ) &&
+              ( 0 == strcmp( parallel.issues[issue_cnt - 1].labels[1].name, serial.issues[issue_cnt - 1].labels[1].name ) );
+
+    page_free( &parallel );
+    }
+
+page_free( &serial );
+free( json );
+
+return success ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+package benchmark
+
+import codegen.json.{JSONCodegen, MessageJSONFiles, SpecializedJSONCodegen, TableJSONCodegen}
+import codegen.messagetypes.MessageTypeFiles
+import codegen.sourcefile.FileDefinition
+import compiler.ProtocolCompiler
+import dto.UnitSpec
+
+import java.nio.charset.StandardCharsets
+import java.nio.file.{Files, Path, Paths}
+
+import scala.io.Source
+import scala.sys.process._
+import scala.util.Try
+
+/**
+  * Compares the specialized and the table-driven JSON code generation. The generated code
+  * of the same protocol is compiled in both modes, and the size of the JSON object file is
+  * reported along with the time a driver program takes to parse a page with many issues.
+  * Requires a C compiler named cc and the example/cJSON submodule.
+  */
+class CodegenBenchmarkSpec extends UnitSpec {
+
+  private val protocolName = "codegen_parse.cdto"
+  private val cJSONDirectory = Paths.get("example", "cJSON")
+  private val issueCount = 100000
+  private val repetitionCount = 10
+
+  private val definition =
+    """page {
+      |    title String;
+      |    issues Array[issue];
+      |}
+      |
+      |issue {
+      |    number Number cType=uint32_t;
+      |    title String;
+      |    labels Array[label];
+      |}
+      |
+      |label {
+      |    name String;
+      |    color String[6];
+      |}
+      |""".stripMargin
+
+  /**
+    * Writes a generated file into the directory
+    * @param directory Directory to write the file into
+    * @param file File to write
+    * @return Path of the written file
+    */
+  private def writeFile(directory: Path, file: FileDefinition): Path = {
+    Files.write(directory.resolve(file.name), file.contents.getBytes(StandardCharsets.UTF_8))
+  }
+
+  /**
+    * Compiles the generated code of the protocol in the given mode
+    * @param codegen Code generation mode
+    * @return Size of the JSON object file in bytes and the milliseconds taken by the parses
+    */
+  private def measure(codegen: JSONCodegen): (Long, Double) = {
+    val cJSONSource = cJSONDirectory.resolve("cJSON.c")
+    val protocol = ProtocolCompiler(definition, protocolName).right.get
+    val typeFiles = MessageTypeFiles(protocol, List("<stdint.h>"))
+    val jsonFiles = MessageJSONFiles(protocol, codegen)
+
+    val directory = Files.createTempDirectory("cdto-codegen-parse")
+    List(typeFiles.headerFile, jsonFiles.headerFile).foreach(writeFile(directory, _))
+    val typeSource = writeFile(directory, typeFiles.cFile)
+    val jsonSource = writeFile(directory, jsonFiles.cFile)
+
+    val jsonObject = directory.resolve("json.o")
+    Seq("cc", "-O2", "-c", s"-I$cJSONDirectory", s"-I$directory", "-o", jsonObject.toString, jsonSource.toString).! shouldBe 0
+
+    val driver = directory.resolve("codegen_parse.c")
+    val driverSource = Source.fromResource("benchmark/codegen_parse.c")
+    Files.write(driver, driverSource.mkString.getBytes(StandardCharsets.UTF_8))
+    driverSource.close()
+
+    val executable = directory.resolve("codegen_parse")
+    Seq("cc", "-O2", s"-I$cJSONDirectory", s"-I$directory", "-o", executable.toString, driver.toString,
+      typeSource.toString, jsonObject.toString, cJSONSource.toString, "-lm").! shouldBe 0
+
+    val output = Seq(executable.toString, issueCount.toString, repetitionCount.toString).!!
+    (Files.size(jsonObject), output.trim.toDouble)
+  }
+
+  "Table-driven codegen" should "be compared with specialized codegen" taggedAs Benchmark in {
+    val hasCompiler = Try(Process(Seq("cc", "--version")).!(ProcessLogger(_ => ())) == 0).getOrElse(false)
+    if(!hasCompiler || !Files.exists(cJSONDirectory.resolve("cJSON.c"))) {
+      cancel("Requires a C compiler and the example/cJSON submodule")
+    }
+
+    val (specializedSize, specializedMillis) = measure(SpecializedJSONCodegen)
+    val (tableSize, tableMillis) = measure(TableJSONCodegen)
+
+    info(s"specialized: $specializedSize byte object, " + f"$specializedMillis%.1f ms for $repetitionCount parses")
+    info(s"tables: $tableSize byte object, " + f"$tableMillis%.1f ms for $repetitionCount parses")
+    info(f"tables: ${tableSize.toDouble / specializedSize}%.2fx size, ${tableMillis / specializedMillis}%.2fx parse time")
+  }
+}
@@ -0,0 +1,113 @@
+package benchmark
+
+import codegen.json.MessageJSONFiles
+import codegen.messagetypes.MessageTypeFiles
+import compiler.ProtocolCompiler
+import dto.UnitSpec
+import org.scalatest.Tag
+
+/**
+  * Benchmarks compiling synthetic protocols and generating all of their source files. They
+  * are excluded from sbt test by default; run only the benchmarks with:
+  * sbt -Dbenchmark "testOnly -- -n Benchmark"
+  */
+object Benchmark extends Tag("Benchmark")
+
+class CompilerBenchmarkSpec extends UnitSpec {
+
+  private val protocolName = "benchmark.cdto"
+
+  private val smallMessageCount = 1000
+  private val largeMessageCount = 10000
+
+  /**
+    * Bound of the ratio between the times of the large and the small protocol, which is
+    * twice the ratio of their sizes. Linear work stays below it, while work that grows with
+    * the square of the protocol's size takes 100 times as long for the large protocol.
+    */
+  private val maxTimeRatio = 2.0 * largeMessageCount / smallMessageCount
+
+  /**
+    * Number of times each protocol is compiled. The fastest run is used, since slower ones
+    * are caused by garbage collection and other processes.
+    */
+  private val runCount = 3
+
+  /**
+    * Generates a protocol definition with the given number of messages. Every message
+    * after the first refers to an earlier message both directly and through an array, so
+    * every struct depends on another one. The references form a tree in which every message
+    * is referred to by up to 4 others, so the messages nest only a few levels deep and can
+    * be written with the default CDTO_JSON_WRITER_MAX_DEPTH.
+    * @param messageCount Number of messages to generate
+    * @return Protocol definition string
+    */
+  private def syntheticProtocol(messageCount: Int): String = {
+    val messages = (0 until messageCount).map(index => {
+      val references = if(index == 0) {
+        ""
+      } else {
+        s"""    parent message_${(index - 1) / 4};
+           |    siblings Array[message_${(index - 1) / 4}];
+           |""".stripMargin
+      }
+
+      s"""message_$index {
+         |    id Number cType=uint32_t;
+         |    name String jsonKey=displayName;
+         |    code String[8];
+         |    tags Array[String];
+         |    enabled Boolean;
+         |$references}
+         |""".stripMargin
+    })
+
+    messages.mkString("\n")
+  }
+
+  /**
+    * Compiles the protocol definition and generates all of its source files
+    * @param definition Protocol definition string
+    * @return Total size of the generated files, in characters
+    */
+  private def compileAndGenerate(definition: String): Int = {
+    val protocol = ProtocolCompiler(definition, protocolName).right.get
+
+    val typeFiles = MessageTypeFiles(protocol, List("<stdint.h>"))
+    val jsonFiles = MessageJSONFiles(protocol)
+
+    List(typeFiles.headerFile, typeFiles.cFile, jsonFiles.headerFile, jsonFiles.cFile).map(_.contents.length).sum
+  }
+
+  /**
+    * @param messageCount Number of messages of the protocol
+    * @return Fastest time to compile and generate the protocol, in milliseconds
+    */
+  private def timeMillis(messageCount: Int): Double = {
+    val definition = syntheticProtocol(messageCount)
+
+    val runs = (1 to runCount).map(_ => {
+      val startTime = System.nanoTime
+      val generatedSize = compileAndGenerate(definition)
+      val elapsedMillis = (System.nanoTime - startTime) / 1e6
+
+      info(f"$messageCount messages: $elapsedMillis%.0f ms, $generatedSize characters generated")
+      elapsedMillis
+    })
+
+    runs.min
+  }
+
+  "Compiler" should "compile and generate synthetic protocols in time linear in their size" taggedAs Benchmark in {
+    // Warm up the JIT so the small protocol is not dominated by class loading
+    compileAndGenerate(syntheticProtocol(100))
+
+    val smallMillis = timeMillis(smallMessageCount)
+    val largeMillis = timeMillis(largeMessageCount)
+    val ratio = largeMillis / smallMillis
+
+    info(f"$largeMessageCount / $smallMessageCount messages: $ratio%.1fx the time")
+
+    ratio should be <= maxTimeRatio
+  }
+}
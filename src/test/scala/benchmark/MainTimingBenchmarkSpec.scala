@@ -0,0 +1,73 @@
+package benchmark
+
+import cdto.Main
+import dto.UnitSpec
+
+import java.io.ByteArrayOutputStream
+import java.nio.charset.StandardCharsets
+import java.nio.file.{Files, Path}
+
+/**
+  * Compares the --timing output of a serial and a parallel run of the command line over a
+  * directory of synthetic protocols. Each run writes into a new output directory so that
+  * no run skips writing unchanged files.
+  */
+class MainTimingBenchmarkSpec extends UnitSpec {
+
+  private val protocolCount = 64
+  private val messageCount = 50
+
+  /**
+    * Generates a protocol definition with the given number of messages, each referring to
+    * the previous one
+    * @param messageCount Number of messages to generate
+    * @return Protocol definition string
+    */
+  private def syntheticProtocol(messageCount: Int): String = {
+    val messages = (0 until messageCount).map(index => {
+      val reference = if(index == 0) "" else s"    previous Array[message_${index - 1}];\n"
+
+      s"""message_$index {
+         |    id Number cType=uint32_t;
+         |    name String;
+         |    tags Array[String];
+         |$reference}
+         |""".stripMargin
+    })
+
+    messages.mkString("\n")
+  }
+
+  /**
+    * Runs the command line over the protocols with --timing
+    * @param protocolDir Directory of the protocol definition files
+    * @param jobs Number of protocols to compile in parallel
+    * @return The line printed by --timing
+    */
+  private def timingOutput(protocolDir: Path, jobs: Int): String = {
+    val outputDir = Files.createTempDirectory("cdto-timing-output")
+    val output = new ByteArrayOutputStream()
+
+    Console.withOut(output) {
+      Main.main(Array("--protocol", protocolDir.toString, "--outputDir", outputDir.toString, "--jobs", jobs.toString, "--timing"))
+    }
+
+    output.toString(StandardCharsets.UTF_8.name).trim
+  }
+
+  "Command line" should "report the time of a serial and a parallel run" taggedAs Benchmark in {
+    val protocolDir = Files.createTempDirectory("cdto-timing-protocols")
+    val definition = syntheticProtocol(messageCount).getBytes(StandardCharsets.UTF_8)
+    for(index <- 0 until protocolCount) {
+      Files.write(protocolDir.resolve(s"protocol_$index.cdto"), definition)
+    }
+
+    val processors = Runtime.getRuntime.availableProcessors
+
+    // Warm up the JIT so the serial run is not dominated by class loading
+    timingOutput(protocolDir, processors)
+
+    info(s"serial: ${timingOutput(protocolDir, 1)}")
+    info(s"parallel: ${timingOutput(protocolDir, processors)}")
+  }
+}
@@ -0,0 +1,94 @@
+package benchmark
+
+import codegen.json.MessageJSONFiles
+import codegen.messagetypes.MessageTypeFiles
+import codegen.sourcefile.FileDefinition
+import compiler.ProtocolCompiler
+import dto.UnitSpec
+
+import java.nio.charset.StandardCharsets
+import java.nio.file.{Files, Path, Paths}
+
+import scala.io.Source
+import scala.sys.process._
+import scala.util.Try
+
+/**
+  * Measures how the parallel parse scales with the number of threads. The generated code
+  * of a protocol with a large array of issues is compiled with the cJSON submodule and a
+  * driver program that parses the same page serially and with each thread count. Requires
+  * a C compiler named cc and the example/cJSON submodule.
+  */
+class ParallelParseBenchmarkSpec extends UnitSpec {
+
+  private val protocolName = "parallel_parse.cdto"
+  private val cJSONDirectory = Paths.get("example", "cJSON")
+  private val issueCount = 1000000
+  private val threadCounts = List(1, 2, 4, 8)
+
+  private val definition =
+    """page {
+      |    title String;
+      |    issues Array[issue];
+      |}
+      |
+      |issue {
+      |    number Number cType=uint32_t;
+      |    title String;
+      |    labels Array[label];
+      |}
+      |
+      |label {
+      |    name String;
+      |    color String[6];
+      |}
+      |""".stripMargin
+
+  /**
+    * Writes a generated file into the directory
+    * @param directory Directory to write the file into
+    * @param file File to write
+    * @return Path of the written file
+    */
+  private def writeFile(directory: Path, file: FileDefinition): Path = {
+    Files.write(directory.resolve(file.name), file.contents.getBytes(StandardCharsets.UTF_8))
+  }
+
+  "Parallel parse" should "scale with the number of threads" taggedAs Benchmark in {
+    val cJSONSource = cJSONDirectory.resolve("cJSON.c")
+    val hasCompiler = Try(Process(Seq("cc", "--version")).!(ProcessLogger(_ => ())) == 0).getOrElse(false)
+    if(!hasCompiler || !Files.exists(cJSONSource)) {
+      cancel("Requires a C compiler and the example/cJSON submodule")
+    }
+
+    val protocol = ProtocolCompiler(definition, protocolName).right.get
+    val typeFiles = MessageTypeFiles(protocol, List("<stdint.h>"))
+    val jsonFiles = MessageJSONFiles(protocol)
+
+    val directory = Files.createTempDirectory("cdto-parallel-parse")
+    val sources = List(typeFiles.headerFile, typeFiles.cFile, jsonFiles.headerFile, jsonFiles.cFile)
+      .map(writeFile(directory, _))
+      .filter(_.toString.endsWith(".c"))
+
+    val driver = directory.resolve("parallel_parse.c")
+    val driverSource = Source.fromResource("benchmark/parallel_parse.c")
+    Files.write(driver, driverSource.mkString.getBytes(StandardCharsets.UTF_8))
+    driverSource.close()
+
+    val executable = directory.resolve("parallel_parse")
+    val compile = Seq("cc", "-O2", "-DCDTO_PARALLEL", "-pthread", s"-I$cJSONDirectory", s"-I$directory", "-o", executable.toString, driver.toString) ++
+      sources.map(_.toString) :+ cJSONSource.toString :+ "-lm"
+
+    compile.! shouldBe 0
+
+    val output = (executable.toString +: issueCount.toString +: threadCounts.map(_.toString)).!!
+    val millisByThreads = output.split("\n").map(_.split(" ")).map(columns => columns(0).toInt -> columns(1).toDouble).toMap
+    val serialMillis = millisByThreads(0)
+
+    info(f"serial: $serialMillis%.1f ms")
+    for(threads <- threadCounts) {
+      val millis = millisByThreads(threads)
+      info(f"$threads thread(s): $millis%.1f ms, ${serialMillis / millis}%.2fx")
+    }
+  }
+}
@@ -0,0 +1,142 @@
+package cdto
+
+import codegen.json.{MessageJSONFiles, SpecializedJSONCodegen}
+import codegen.messagetypes.MessageTypeFiles
+import dto.UnitSpec
+
+import java.nio.charset.StandardCharsets
+import java.nio.file.{Files, Path}
+
+class MainSpec extends UnitSpec {
+
+  private val options = Main.OutputOptions(
+    typeHeaders = Nil,
+    shards = None,
+    codegen = SpecializedJSONCodegen,
+    features = Set.empty,
+    cppHeader = false,
+    xmlFiles = false
+  )
+
+  private val validDefinition =
+    """issue {
+      |    number Number cType=uint32_t;
+      |    title String;
+      |}
+      |""".stripMargin
+
+  private val invalidDefinition =
+    """issue {
+      |    creator user;
+      |}
+      |""".stripMargin
+
+  /**
+    * Writes a protocol definition file
+    * @param directory Directory to write the file into
+    * @param name File name of the protocol
+    * @param definition Protocol definition
+    * @return Path of the written file
+    */
+  private def writeProtocol(directory: Path, name: String, definition: String): String = {
+    Files.write(directory.resolve(name), definition.getBytes(StandardCharsets.UTF_8)).toString
+  }
+
+  /**
+    * @param outputDir Directory of the generated files
+    * @param protocolName Name of a protocol
+    * @return True if the type and JSON files of the protocol were generated
+    */
+  private def isGenerated(outputDir: Path, protocolName: String): Boolean = {
+    List(
+      MessageTypeFiles.headerFileName(protocolName),
+      MessageTypeFiles.cFileName(protocolName),
+      MessageJSONFiles.headerFileName(protocolName),
+      MessageJSONFiles.cFileName(protocolName)
+    ).forall(fileName => Files.isRegularFile(outputDir.resolve(fileName)))
+  }
+
+  "Main" should "compile every protocol given" in {
+    val inputDir = Files.createTempDirectory("cdto-main-input")
+    val outputDir = Files.createTempDirectory("cdto-main-output")
+    val protocolFiles = List(
+      writeProtocol(inputDir, "first.cdto", validDefinition),
+      writeProtocol(inputDir, "second.cdto", validDefinition)
+    )
+
+    Main.compileProtocols(protocolFiles, options, outputDir.toString, jobs = 2) shouldBe empty
+
+    isGenerated(outputDir, "first.cdto") shouldBe true
+    isGenerated(outputDir, "second.cdto") shouldBe true
+  }
+
+  it should "expand a directory into its protocol definition files in name order" in {
+    val inputDir = Files.createTempDirectory("cdto-main-input")
+    val second = writeProtocol(inputDir, "second.cdto", validDefinition)
+    val first = writeProtocol(inputDir, "first.cdto", validDefinition)
+    writeProtocol(inputDir, "notes.txt", "")
+    Files.createDirectory(inputDir.resolve("nested.cdto"))
+
+    Main.protocolFilesFromPath(inputDir.toString) shouldBe List(first, second)
+  }
+
+  it should "use a protocol definition file path as is" in {
+    val inputDir = Files.createTempDirectory("cdto-main-input")
+    val protocolFile = writeProtocol(inputDir, "protocol.cdto", validDefinition)
+    val missingFile = inputDir.resolve("missing.cdto").toString
+
+    Main.protocolFilesFromPath(protocolFile) shouldBe List(protocolFile)
+    Main.protocolFilesFromPath(missingFile) shouldBe List(missingFile)
+  }
+
+  it should "default the job count to the number of available processors" in {
+    val defaultArgs = new Main.ArgConfig(List("--protocol", "protocol.cdto", "--outputDir", "generated"))
+    val jobArgs = new Main.ArgConfig(List("--protocol", "protocol.cdto", "--outputDir", "generated", "--jobs", "3"))
+
+    Main.jobCount(defaultArgs) shouldBe Runtime.getRuntime.availableProcessors
+    Main.jobCount(jobArgs) shouldBe 3
+  }
+
+  it should "generate the same files with any job count" in {
+    val inputDir = Files.createTempDirectory("cdto-main-input")
+    val serialDir = Files.createTempDirectory("cdto-main-serial")
+    val parallelDir = Files.createTempDirectory("cdto-main-parallel")
+    val protocolFiles = (1 to 8).map(index => writeProtocol(inputDir, s"protocol$index.cdto", validDefinition))
+
+    Main.compileProtocols(protocolFiles, options, serialDir.toString, jobs = 1) shouldBe empty
+    Main.compileProtocols(protocolFiles, options, parallelDir.toString, jobs = 4) shouldBe empty
+
+    for(protocolIndex <- 1 to 8; fileName <- List(MessageTypeFiles.cFileName _, MessageJSONFiles.cFileName _)) {
+      val name = fileName(s"protocol$protocolIndex.cdto")
+      Files.readAllBytes(parallelDir.resolve(name)) shouldBe Files.readAllBytes(serialDir.resolve(name))
+    }
+  }
+
+  it should "report the errors of each protocol and still compile the others" in {
+    val inputDir = Files.createTempDirectory("cdto-main-input")
+    val outputDir = Files.createTempDirectory("cdto-main-output")
+    val invalid = writeProtocol(inputDir, "invalid.cdto", invalidDefinition)
+    val valid = writeProtocol(inputDir, "valid.cdto", validDefinition)
+    val missing = inputDir.resolve("missing.cdto").toString
+
+    val errors = Main.compileProtocols(List(invalid, valid, missing), options, outputDir.toString, jobs = 2)
+
+    errors should have length 2
+    errors(0) should startWith(s"$invalid: ")
+    errors(1) should startWith(s"$missing: ")
+    isGenerated(outputDir, "valid.cdto") shouldBe true
+    isGenerated(outputDir, "invalid.cdto") shouldBe false
+  }
+
+  it should "report protocol definition files with the same name" in {
+    val firstDir = Files.createTempDirectory("cdto-main-first")
+    val secondDir = Files.createTempDirectory("cdto-main-second")
+    val first = writeProtocol(firstDir, "protocol.cdto", validDefinition)
+    val second = writeProtocol(secondDir, "protocol.cdto", validDefinition)
+    val other = writeProtocol(secondDir, "other.cdto", validDefinition)
+
+    Main.duplicateProtocolNameErrors(List(first, other, second)) shouldBe
+      List(s"Multiple protocol definitions named protocol.cdto: $first, $second")
+    Main.duplicateProtocolNameErrors(List(first, other)) shouldBe empty
+  }
+}
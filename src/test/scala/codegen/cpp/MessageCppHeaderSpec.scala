@@ -0,0 +1,40 @@
+package codegen.cpp
+
+import datamodel._
+import dto.UnitSpec
+
+class MessageCppHeaderSpec extends UnitSpec {
+
+  private val label = Message("label", List(
+    Field("name", DynamicStringType, "name"),
+    Field("color", FixedStringType(6), "color")
+  ))
+
+  private val issue = Message("issue", List(
+    Field("number", AliasedType("uint32_t", NumberType), "number"),
+    Field("labels", ArrayType(ObjectType("label")), "labels"),
+    Field("parse", BooleanType, "parse")
+  ))
+
+  private val header = MessageCppHeader(Protocol("github_issues.cdto", List(label, issue)))
+
+  "C++ header" should "wrap each message in a move-only class in the protocol's namespace" in {
+    header.name shouldBe "github_issues.cdto.hpp"
+    header.contents should include ("namespace github_issues_cdto\n{")
+    header.contents should include ("    ~issue() { ::issue_free( &m_obj ); }")
+    header.contents should include ("    issue( issue const& ) = delete;")
+    header.contents should include ("    issue( issue&& other ) noexcept : m_obj( other.m_obj ) { ::issue_init( &other.m_obj ); }")
+  }
+
+  it should "expose fields through views of the C struct" in {
+    header.contents should include ("    std::string_view name() const noexcept { return ( nullptr == m_obj.name ) ? std::string_view() : std::string_view( m_obj.name ); }")
+    header.contents should include ("    std::string_view color() const noexcept { return std::string_view( m_obj.color ); }")
+    header.contents should include ("    uint32_t number() const noexcept { return m_obj.number; }")
+    header.contents should include ("    cdto::span<::label const> labels() const noexcept { return cdto::span<::label const>( m_obj.labels, static_cast<std::size_t>( m_obj.labels_cnt ) ); }")
+  }
+
+  it should "rename accessors that collide with the wrapper's methods" in {
+    MessageCppHeader.accessorName(issue, issue.fields(2)) shouldBe "parse_field"
+    header.contents should include ("    bool parse_field() const noexcept { return 0 != m_obj.parse; }")
+  }
+}
@@ -158,4 +158,43 @@ class FunctionGeneratorSpec extends UnitSpec {
 
     FunctionGenerator(functionDefinition) shouldBe expectedFunction
   }
+
+  it should "surround a guarded function with preprocessor directives" in {
+
+    val functionDefinition = FunctionDefinition(name = "stats_reset",
+      documentation = FunctionDocumentation("Reset statistics", "Zeros out all statistics"),
+      prototype = FunctionPrototype(isStatic = false, returnType = "void", parameters = List()),
+      body = "memset( &stats, 0, sizeof( stats ) );",
+      preprocessorGuard = Some("ENABLE_STATS")
+    )
+
+    val expectedFunction = CFunction(
+      declaration =
+        """#ifdef ENABLE_STATS
+          |void stats_reset
+          |    (
+          |    void
+          |    );
+          |#endif /* #ifdef ENABLE_STATS */""".stripMargin,
+      implementation =
+        """#ifdef ENABLE_STATS
+          |/**************************************************
+          |*
+          |*    stats_reset - Reset statistics
+          |*
+          |*    Zeros out all statistics
+          |*
+          |**************************************************/
+          |void stats_reset
+          |    (
+          |    void
+          |    )
+          |{
+          |memset( &stats, 0, sizeof( stats ) );
+          |}    /* stats_reset()    */
+          |#endif /* #ifdef ENABLE_STATS */""".stripMargin
+    )
+
+    FunctionGenerator(functionDefinition) shouldBe expectedFunction
+  }
 }
@@ -0,0 +1,357 @@
+package codegen.json
+
+import datamodel._
+import dto.UnitSpec
+
+class MessageJSONFilesSpec extends UnitSpec {
+
+  private val protocol = Protocol(
+    name = "github_issues.cdto",
+    messages = List(
+      Message("issue", List(
+        Field("number", NumberType, "number"),
+        Field("creator", ObjectType("user"), "user"),
+        Field("labels", ArrayType(ObjectType("label")), "labels")
+      )),
+      Message("user", List(
+        Field("name", DynamicStringType, "login")
+      )),
+      Message("label", List(
+        Field("name", DynamicStringType, "name"),
+        Field("color", FixedStringType(6), "color")
+      ))
+    )
+  )
+
+  "Sharded JSON files" should "define each message's functions in exactly one shard" in {
+    val files = MessageJSONFiles.sharded(protocol, 2)
+
+    files.cFiles.map(_.name) shouldBe List("github_issues.cdto.json.0.c", "github_issues.cdto.json.1.c")
+
+    for(message <- protocol.messages) {
+      val definingShards = files.cFiles.filter(_.contents.contains(s"int ${message.name}_json_parse\n"))
+
+      definingShards should have length 1
+    }
+  }
+
+  it should "declare the functions shared between shards in the internal header" in {
+    val files = MessageJSONFiles.sharded(protocol, 2)
+
+    files.internalHeaderFile.name shouldBe "github_issues.cdto.json.internal.h"
+    files.internalHeaderFile.contents should include ("user_json_obj_parse")
+    files.internalHeaderFile.contents should include ("label_array_json_parse")
+    files.headerFile.contents should not include "user_json_obj_parse"
+  }
+
+  it should "produce the same public header as the unsharded files" in {
+    MessageJSONFiles.sharded(protocol, 3).headerFile shouldBe MessageJSONFiles(protocol).headerFile
+  }
+
+  "JSON files" should "only generate the functions of the enabled features" in {
+    val files = MessageJSONFiles(protocol)
+
+    files.headerFile.contents should include ("int issue_json_parse\n")
+    files.headerFile.contents should include ("int issue_json_serialize_pretty\n")
+    files.headerFile.contents should not include "cdto_json_limits"
+    files.headerFile.contents should not include "cdto_json_writer"
+    files.headerFile.contents should not include "CDTO_MMAP"
+    files.cFile.contents should not include "issue_json_validate"
+    files.cFile.contents should not include "issue_json_parse_n"
+    files.cFile.contents should not include "issue_json_extract_creator_name"
+
+    val allFiles = MessageJSONFiles(protocol, features = JSONFeature.all)
+
+    allFiles.headerFile.contents should include ("int issue_json_validate\n")
+    allFiles.headerFile.contents should include ("int issue_json_extract_creator_name\n")
+    allFiles.headerFile.contents should include ("int issue_json_writer_fill\n")
+  }
+
+  it should "only define the static helpers that its functions call" in {
+    val cFile = MessageJSONFiles(protocol).cFile.contents
+
+    cFile should include ("static int label_json_obj_parse\n")
+    cFile should not include "cdto_json_scan_fixed_string"
+    cFile should not include "cdto_json_writer_"
+    cFile should not include "cdto_json_budget_"
+    cFile should not include "cdto_cjson_parse_n"
+  }
+
+  it should "place static helpers that are only called under a guard under the same guard" in {
+    // Only the parallel parse functions of issue's label array scan JSON by default
+    val cFile = MessageJSONFiles(protocol).cFile.contents
+    cFile should include ("#ifdef CDTO_PARALLEL\nstatic int cdto_json_skip_value\n")
+
+    val validatingCFile = MessageJSONFiles(protocol, features = Set(ValidateJSONFeature)).cFile.contents
+    validatingCFile should include ("static int cdto_json_skip_value\n")
+    validatingCFile should not include "#ifdef CDTO_PARALLEL\nstatic int cdto_json_skip_value\n"
+  }
+
+  "Table-driven JSON files" should "describe every field in the message descriptors" in {
+    val cFile = MessageJSONFiles(protocol, TableJSONCodegen).cFile.contents
+
+    cFile should include ("static const cdto_json_message_descriptor issue_json_descriptor =")
+    cFile should include ("""{ "login", offsetof( user, name ), 0, 0, CDTO_JSON_DYNAMIC_STRING""")
+    cFile should include ("offsetof( issue, labels_cnt ), CDTO_JSON_OBJECT")
+    cFile should not include "label_array_json_parse"
+  }
+
+  it should "produce the same public header as the specialized files" in {
+    MessageJSONFiles(protocol, TableJSONCodegen).headerFile shouldBe MessageJSONFiles(protocol).headerFile
+  }
+
+  "JSON validators" should "be declared in the public header in both codegen modes" in {
+    for(codegen <- List(SpecializedJSONCodegen, TableJSONCodegen)) {
+      val files = MessageJSONFiles(protocol, codegen, Set(ValidateJSONFeature))
+
+      files.headerFile.contents should include (
+        """int issue_json_validate
+          |    (
+          |    char const* json,
+          |    size_t json_len,
+          |    size_t* error_offset_out
+          |    );""".stripMargin
+      )
+      files.cFile.contents should include (
+        """static int issue_json_obj_validate
+          |    (
+          |    cdto_json_scanner* scanner,
+          |    int depth
+          |    );""".stripMargin
+      )
+    }
+  }
+
+  it should "validate each field's value against its type" in {
+    val cFile = MessageJSONFiles(protocol, features = Set(ValidateJSONFeature)).cFile.contents
+
+    cFile should include ("""else if( !name_seen && cdto_json_string_matches( &key, "login" ) )""")
+    cFile should include ("success = cdto_json_scan_fixed_string( scanner, 6 );")
+    cFile should include ("success = user_json_obj_validate( scanner, depth + 1 );")
+    cFile should include ("success = label_json_obj_validate( scanner, depth + 2 ) && cdto_json_scan_container_next( scanner, ']', &more_items );")
+  }
+
+  "Buffer parsers" should "parse length-delimited input without a NUL terminator" in {
+    val cFile = MessageJSONFiles(protocol, features = Set(BuffersJSONFeature)).cFile.contents
+
+    cFile should include ("return issue_json_parse_n_ex( json, json_len, obj_out, NULL );")
+    cFile should include ("json_root = cdto_cjson_parse_n( json, json_len, allocator );")
+  }
+
+  "Limited parsers" should "check the input against the limits before parsing it" in {
+    // The limited parsers build on the buffer parsers, which are generated along with them
+    val files = MessageJSONFiles(protocol, features = Set(LimitsJSONFeature))
+
+    files.headerFile.contents should include ("} cdto_json_limits;")
+    files.headerFile.contents should include ("cdto_json_error issue_json_parse_limited_ex\n")
+    files.cFile.contents should include ("error = cdto_json_limits_check( json, json_len, limits );")
+    files.cFile.contents should include ("if( !issue_json_parse_n_ex( json, json_len, obj_out, &budget_allocator ) )")
+  }
+
+  "File parsers" should "only be available where files can be memory-mapped" in {
+    val files = MessageJSONFiles(protocol, features = Set(BuffersJSONFeature))
+
+    files.headerFile.contents should include ("#ifdef CDTO_MMAP\nint issue_json_parse_file\n")
+    files.cFile.contents should include ("success = issue_json_parse_n_ex( ( char const* )mapping, file_size, obj_out, allocator );")
+  }
+
+  "Enum fields" should "be converted to and from their strings in both codegen modes" in {
+    val state = EnumType("issue_state", List("open", "closed"))
+    val enumProtocol = Protocol(
+      name = "issue_states.cdto",
+      messages = List(
+        Message("issue", List(
+          Field("state", state, "state"),
+          Field("history", ArrayType(state), "history")
+        ))
+      )
+    )
+
+    val specialized = MessageJSONFiles(enumProtocol).cFile.contents
+    specialized should include ("( issue_state_json_parse( json_item, &obj_out->state ) )")
+    specialized should include ("if( 0 == memcmp( str, \"closed\", 6 ) )")
+    specialized should include ("json_item = cJSON_CreateString( issue_state_json_to_string( obj->state ) );")
+    specialized should include ("success = issue_state_array_json_serialize( obj->history, obj->history_cnt, &json_item );")
+
+    val tableDriven = MessageJSONFiles(enumProtocol, TableJSONCodegen).cFile.contents
+    tableDriven should include ("static char const* const issue_state_json_values[] =")
+    tableDriven should include ("CDTO_JSON_ENUM, sizeof( ( ( issue* )0 )->state ), CDTO_JSON_NUMBER_FORMAT( issue_state ), NULL, issue_state_json_values, 2, 0, 0 }")
+  }
+
+  "Aliased numbers" should "be parsed and serialized with the width of their C type" in {
+    val aliasedProtocol = Protocol(
+      name = "telemetry.cdto",
+      messages = List(
+        Message("sample", List(
+          Field("id", AliasedType("uint32_t", NumberType), "id"),
+          Field("values", ArrayType(AliasedType("int16_t", NumberType)), "values")
+        ))
+      )
+    )
+
+    val cFile = MessageJSONFiles(aliasedProtocol).cFile.contents
+    cFile should include ("( uint32_t_json_parse( json_item, &obj_out->id ) )")
+    cFile should include ("success = int16_t_json_parse( array_item, &array[i] );")
+    cFile should include ("success = int16_t_array_json_serialize( obj->values, obj->values_cnt, &json_item );")
+    cFile should not include "number_json_parse"
+    cFile should not include "cJSON_CreateDoubleArray( obj->values"
+  }
+
+  "Cached messages" should "reuse the JSON of unchanged messages and array fields" in {
+    val cachedProtocol = Protocol(
+      name = "pages.cdto",
+      messages = List(
+        Message("page", List(
+          Field("title", DynamicStringType, "title"),
+          Field("items", ArrayType(ObjectType("item")), "items")
+        ), cached = true),
+        Message("item", List(
+          Field("name", DynamicStringType, "name")
+        ), cached = true)
+      )
+    )
+
+    val specialized = MessageJSONFiles(cachedProtocol).cFile.contents
+    specialized should include ("valid = valid && item_array_json_cache_valid( obj->items, obj->items_cnt );")
+    specialized should include ("if( success && obj->items_json_cache.valid && item_array_json_cache_valid( obj->items, obj->items_cnt ) )")
+    specialized should include ("success = item_array_json_serialize_cached( obj->items, obj->items_cnt, &json_item );")
+    specialized should include ("cdto_json_cache_store( &( ( page* )obj )->json_cache, json_root );")
+    specialized should include ("memcpy( *json_out, obj->json_cache.json, obj->json_cache.json_len + 1 );")
+    specialized should include ("cdto_free( cache->allocator, cache->json );")
+
+    val tableDriven = MessageJSONFiles(cachedProtocol, TableJSONCodegen).cFile.contents
+    tableDriven should not include "json_cache"
+  }
+
+  it should "only use the caches on one thread at a time" in {
+    val cachedProtocol = Protocol(
+      name = "pages.cdto",
+      messages = List(
+        Message("page", List(
+          Field("title", DynamicStringType, "title")
+        ), cached = true)
+      )
+    )
+
+    val cFile = MessageJSONFiles(cachedProtocol).cFile.contents
+    cFile should include ("CDTO_SHARED CDTO_ATOMIC_INT cdto_json_cache_lock;")
+    cFile should include ("locked = CDTO_ATOMIC_EXCHANGE_IF( &cdto_json_cache_lock, &unlocked, 1 );")
+    cFile should include (
+      """if( !locked )
+        |    {
+        |    success = page_json_obj_serialize( obj, &json_root );
+        |    }
+        |else if( !page_json_cache_valid( obj ) )
+        |    {
+        |    success = page_json_obj_serialize_cached( obj, &json_root );
+        |    }""".stripMargin
+    )
+    cFile should include ("CDTO_ATOMIC_STORE( &cdto_json_cache_lock, 0 );")
+  }
+
+  it should "count cJSON's allocations in the allocation hooks" in {
+    val cFile = MessageJSONFiles(protocol).cFile.contents
+
+    cFile should include (
+      """memory = cdto_malloc( cdto_cjson_allocator, size );
+        |CDTO_STATS_ALLOCATED( memory )""".stripMargin
+    )
+    cFile should include (
+      """CDTO_STATS_FREED( ptr )
+        |cdto_free( cdto_cjson_allocator, ptr );""".stripMargin
+    )
+    cFile should include ("#ifdef CDTO_STATS\n// The hooks count cJSON's allocations, so they are needed even without an allocator\ninstall = 1;")
+
+    // Serializations that fail for other reasons than memory are not memory failures
+    cFile should not include ("CDTO_STATS_ADD_IF( !success, failures_memory, 1 )")
+  }
+
+  it should "encode bytes fields as base64 strings" in {
+    val bytesProtocol = Protocol(
+      name = "avatars.cdto",
+      messages = List(
+        Message("avatar", List(
+          Field("image", BytesType, "image")
+        ))
+      )
+    )
+
+    val specialized = MessageJSONFiles(bytesProtocol).cFile.contents
+    specialized should include ("success = ( NULL != json_item ) && ( bytes_json_parse( json_item, &obj_out->image.data, &obj_out->image.len, allocator ) );")
+    specialized should include ("success = bytes_json_serialize( obj->image.data, obj->image.len, &json_item );")
+    specialized should include ("static int cdto_base64_decode")
+    specialized should include ("#if defined( __SSSE3__ ) && !defined( CDTO_BASE64_NO_SIMD )")
+
+    val tableDriven = MessageJSONFiles(bytesProtocol, TableJSONCodegen).cFile.contents
+    tableDriven should include ("CDTO_JSON_BYTES")
+  }
+
+  it should "convert timestamp fields to and from RFC 3339 strings" in {
+    val timestampProtocol = Protocol(
+      name = "events.cdto",
+      messages = List(
+        Message("event", List(
+          Field("created_at", TimestampType, "createdAt"),
+          Field("closed_at", AliasedType("epoch_ns_t", TimestampType), "closedAt"),
+          Field("edits", ArrayType(TimestampType), "edits")
+        ))
+      )
+    )
+
+    val specialized = MessageJSONFiles(timestampProtocol, features = Set(WriterJSONFeature)).cFile.contents
+    specialized should include ("timestamp_json_parse( json_item, &obj_out->created_at )")
+    specialized should include ("timestamp_json_parse( json_item, (int64_t*)&obj_out->closed_at )")
+    specialized should include ("json_item = timestamp_json_serialize( obj->created_at );")
+    specialized should include ("success = timestamp_array_json_serialize( obj->edits, obj->edits_cnt, &json_item );")
+    specialized should include ("static int cdto_timestamp_parse")
+    specialized should include ("cdto_json_writer_timestamp( writer, ")
+
+    val tableDriven = MessageJSONFiles(timestampProtocol, TableJSONCodegen).cFile.contents
+    tableDriven should include ("CDTO_JSON_TIMESTAMP")
+  }
+
+  it should "leave out optional fields and parse them when missing in both codegen modes" in {
+    val optionalProtocol = Protocol(
+      name = "issues.cdto",
+      messages = List(
+        Message("issue", List(
+          Field("state", EnumType("issue_state", List("open", "closed")), "state", default = Some("open")),
+          Field("labels", ArrayType(DynamicStringType), "labels", omitEmpty = true)
+        ))
+      )
+    )
+
+    val specialized = MessageJSONFiles(optionalProtocol).cFile.contents
+    specialized should include ("obj_out->state = ISSUE_STATE_OPEN;")
+    specialized should include ("success = ( NULL == json_item ) || ( ")
+    specialized should include ("if( !( ISSUE_STATE_OPEN == obj->state ) )")
+    specialized should include ("if( !( 0 == obj->labels_cnt ) )")
+
+    val tableDriven = MessageJSONFiles(optionalProtocol, TableJSONCodegen).cFile.contents
+    tableDriven should include ("static const issue_state issue_state_json_default = ISSUE_STATE_OPEN;")
+    tableDriven should include ("0, &issue_state_json_default }")
+    tableDriven should include ("1, NULL }")
+    tableDriven should include ("if( cdto_json_table_is_omitted( obj, field ) )")
+  }
+
+  it should "index parsed arrays in both codegen modes" in {
+    val indexProtocol = Protocol(
+      name = "issues.cdto",
+      messages = List(
+        Message("label", List(
+          Field("name", DynamicStringType, "name")
+        )),
+        Message("issue", List(
+          Field("labels", ArrayType(ObjectType("label")), "labels", index = Some("name"))
+        ))
+      )
+    )
+
+    val specialized = MessageJSONFiles(indexProtocol).cFile.contents
+    specialized should include ("success = success && issue_index_ex( obj_out, allocator );")
+
+    val tableDriven = MessageJSONFiles(indexProtocol, TableJSONCodegen).cFile.contents
+    tableDriven should include ("return issue_index_ex( ( issue* )obj, allocator );")
+    tableDriven should include ("success = descriptor->index( obj, allocator );")
+  }
+}
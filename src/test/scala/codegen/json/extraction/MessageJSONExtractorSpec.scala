@@ -0,0 +1,104 @@
+package codegen.json.extraction
+
+import datamodel._
+import dto.UnitSpec
+
+class MessageJSONExtractorSpec extends UnitSpec {
+
+  private val user = Message("user", List(
+    Field("name", DynamicStringType, "login"),
+    Field("id", AliasedType("uint32_t", NumberType), "id")
+  ))
+
+  private val label = Message("label", List(
+    Field("color", FixedStringType(6), "color")
+  ))
+
+  private val issue = Message("issue", List(
+    Field("number", NumberType, "number"),
+    Field("creator", ObjectType("user"), "user"),
+    Field("labels", ArrayType(ObjectType("label")), "labels")
+  ))
+
+  private val messagesByName = List(user, label, issue).map(message => message.name -> message).toMap
+
+  "Field extractors" should "be generated for every field path outside of arrays" in {
+    MessageJSONExtractor(issue, messagesByName).map(_.name) shouldBe List(
+      "issue_json_extract_number",
+      "issue_json_extract_creator_name",
+      "issue_json_extract_creator_id"
+    )
+  }
+
+  it should "seek through the JSON keys of each object on the path" in {
+    val creatorName = MessageJSONExtractor(issue, messagesByName)(1)
+
+    creatorName.prototype.parameters.map(_.paramName) shouldBe List("json", "json_len", "value_out", "value_size")
+    creatorName.body should include (
+      """success = cdto_json_seek_member( &scanner, "user", 1 ) &&
+        |          cdto_json_seek_member( &scanner, "login", 2 ) &&
+        |          cdto_json_scan_string_copy( &scanner, value_out, value_size );""".stripMargin
+    )
+  }
+
+  it should "convert values of aliased types" in {
+    val creatorId = MessageJSONExtractor(issue, messagesByName)(2)
+
+    creatorId.prototype.parameters.last.paramType shouldBe "uint32_t*"
+    creatorId.body should include ("*value_out = ( uint32_t )value;")
+  }
+
+  it should "report aliased numbers out of the alias' range as failures" in {
+    val creatorId = MessageJSONExtractor(issue, messagesByName)(2)
+
+    // Negative values do not fit an unsigned alias, so success is cleared before the store
+    creatorId.body should include (
+      """success = success && ( value >= 0.0 ) && ( value < 2.0 * ( double )( 1ULL << ( sizeof( uint32_t ) * CHAR_BIT - 1 ) ) );
+        |    success = success && ( ( double )( unsigned long long )value == value );
+        |    }
+        |
+        |if( success )
+        |    {
+        |    *value_out = ( uint32_t )value;
+        |    }
+        |
+        |return success;""".stripMargin
+    )
+  }
+
+  it should "copy fixed-length strings into buffers of the field's size" in {
+    MessageJSONExtractor(label, messagesByName).head.body should include ("cdto_json_scan_string_copy( &scanner, value_out, 7 )")
+  }
+
+  it should "only follow paths of up to three fields" in {
+    // Every message of the chain nests the previous one
+    val chain = (0 until 100).map(i => Message(s"message_$i", List(
+      Field("id", NumberType, "id")
+    ) ++ (if(i > 0) List(Field("parent", ObjectType(s"message_${i - 1}"), "parent")) else Nil)))
+    val chainByName = chain.map(message => message.name -> message).toMap
+
+    MessageJSONExtractor(chain.last, chainByName).map(_.name) shouldBe List(
+      "message_99_json_extract_id",
+      "message_99_json_extract_parent_id",
+      "message_99_json_extract_parent_parent_id"
+    )
+  }
+
+  it should "generate a bounded number of extractors for messages reachable on several paths" in {
+    // Every message nests the next one twice, so there are 2^n paths to the last one
+    val diamond = (0 until 20).map(i => Message(s"message_$i", List(
+      Field("id", NumberType, "id")
+    ) ++ (if(i < 19) List(Field("left", ObjectType(s"message_${i + 1}"), "left"), Field("right", ObjectType(s"message_${i + 1}"), "right")) else Nil)))
+    val diamondByName = diamond.map(message => message.name -> message).toMap
+
+    MessageJSONExtractor(diamond.head, diamondByName).map(_.name) shouldBe List(
+      "message_0_json_extract_id",
+      "message_0_json_extract_left_id",
+      "message_0_json_extract_left_left_id",
+      "message_0_json_extract_left_right_id",
+      "message_0_json_extract_right_id",
+      "message_0_json_extract_right_left_id",
+      "message_0_json_extract_right_right_id"
+    )
+  }
+}
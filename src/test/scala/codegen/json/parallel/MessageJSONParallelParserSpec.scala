@@ -0,0 +1,45 @@
+package codegen.json.parallel
+
+import codegen.json.MessageJSONFiles
+import datamodel._
+import dto.UnitSpec
+
+class MessageJSONParallelParserSpec extends UnitSpec {
+
+  private val label = Message("label", List(
+    Field("name", DynamicStringType, "name")
+  ))
+
+  private val issue = Message("issue", List(
+    Field("number", AliasedType("uint32_t", NumberType), "number"),
+    Field("tags", ArrayType(DynamicStringType), "tags"),
+    Field("labels", ArrayType(ObjectType("label")), "labels")
+  ))
+
+  private val page = Message("page", List(
+    Field("issues", ArrayType(ObjectType("issue")), "Issues")
+  ))
+
+  private val protocol = Protocol("issues.cdto", List(page, issue, label))
+
+  "Parallel parsers" should "index only the message array fields" in {
+    MessageJSONParallelParser.parallelFields(issue).map(_._1.name) shouldBe List("labels")
+    MessageJSONParallelParser.parallelFields(label) shouldBe Nil
+  }
+
+  it should "parse the elements of each indexed array into the preallocated array" in {
+    val body = MessageJSONParallelParser.withAllocator(page).body
+
+    body should include ("""else if( ( 0 == indexes[0].range.end ) && cdto_json_string_matches( &key, "Issues" ) )""")
+    body should include ("obj_out->issues = cdto_calloc( allocator, ( size_t )indexes[0].element_cnt, sizeof( *obj_out->issues ) );")
+    body should include ("cdto_json_parse_elements( json_str, &indexes[0], obj_out->issues, sizeof( *obj_out->issues ), issue_json_element_parse, thread_cnt, allocator )")
+  }
+
+  it should "only be compiled with CDTO_PARALLEL defined" in {
+    val files = MessageJSONFiles(protocol)
+
+    files.headerFile.contents should include ("#ifdef CDTO_PARALLEL\nint page_json_parse_parallel\n")
+    files.cFile.contents should include ("#ifdef CDTO_PARALLEL\nstatic int issue_json_element_parse\n")
+    files.cFile.contents should not include ("int label_json_parse_parallel")
+  }
+}
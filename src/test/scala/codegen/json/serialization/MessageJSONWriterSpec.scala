@@ -0,0 +1,66 @@
+package codegen.json.serialization
+
+import datamodel._
+import dto.UnitSpec
+
+class MessageJSONWriterSpec extends UnitSpec {
+
+  private val user = Message("user", List(
+    Field("name", DynamicStringType, "login")
+  ))
+
+  private val label = Message("label", List(
+    Field("name", DynamicStringType, "name")
+  ))
+
+  private val issue = Message("issue", List(
+    Field("number", AliasedType("uint32_t", NumberType), "number"),
+    Field("creator", ObjectType("user"), "user"),
+    Field("labels", ArrayType(ObjectType("label")), "labels")
+  ))
+
+  private val empty = Message("empty", Nil)
+
+  "Message writers" should "write each field in its own state" in {
+    val body = MessageJSONWriter.step(issue).body
+
+    body should include (
+      """    case 0:
+        |        cdto_json_writer_number( writer, "{\"number\":", ( double )obj->number );
+        |        frame->state++;
+        |        break;""".stripMargin
+    )
+    body should include ("""cdto_json_writer_push( writer, ",\"user\":", user_json_write_step, &obj->creator );""")
+    body should include ("""cdto_json_writer_push( writer, ( 0 == frame->index ) ? ",\"labels\":[" : ",", label_json_write_step, &obj->labels[frame->index] );""")
+    body should include ("""cdto_json_writer_put( writer, "", "}" );""")
+  }
+
+  it should "write messages without fields as empty objects" in {
+    MessageJSONWriter.step(empty).body should include ("""cdto_json_writer_put( writer, "", "{}" );""")
+  }
+
+  it should "open the object with the first optional field that is written" in {
+    val optional = Message("label", List(
+      Field("name", DynamicStringType, "name", omitEmpty = true),
+      Field("priority", NumberType, "priority", default = Some("1"))
+    ))
+    val body = MessageJSONWriter.step(optional).body
+
+    body should include (
+      """    case 0:
+        |        if( !( NULL == obj->name ) )
+        |            {
+        |            success = cdto_json_writer_string( writer, "{\"name\":", obj->name );
+        |            }
+        |        frame->state++;
+        |        break;""".stripMargin
+    )
+    body should include ("""( ( !( NULL == obj->name ) ) ? ",\"priority\":" : "{\"priority\":" )""")
+    body should include ("""( ( !( NULL == obj->name ) || !( 1 == obj->priority ) ) ? "}" : "{}" )""")
+  }
+
+  it should "need one frame per level of message nesting" in {
+    MessageJSONWriter.maxDepth(Protocol("github_issues.cdto", List(issue, user, label, empty))) shouldBe 2
+    MessageJSONWriter.maxDepth(Protocol("empty.cdto", List(empty))) shouldBe 1
+  }
+}
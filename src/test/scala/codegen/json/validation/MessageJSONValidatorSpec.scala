@@ -0,0 +1,76 @@
+package codegen.json.validation
+
+import codegen.json.scanning.JSONScanner
+import datamodel._
+import dto.UnitSpec
+
+class MessageJSONValidatorSpec extends UnitSpec {
+
+  private val sensor = Message("sensor", List(
+    Field("level", AliasedType("uint8_t", NumberType), "level"),
+    Field("history", ArrayType(AliasedType("int16_t", NumberType)), "history"),
+    Field("ratio", NumberType, "ratio")
+  ))
+
+  "JSON object validators" should "reject aliased numbers that the alias cannot hold" in {
+    val body = MessageJSONValidator.objectValidator(sensor).body
+
+    body should include ("double value;")
+    body should include (
+      """        success = cdto_json_scan_number( scanner, &value );
+        |
+        |        // Check the range before converting, since converting an out-of-range floating
+        |        // value to an integer is undefined""".stripMargin
+    )
+    body should include ("            success = success && ( value >= 0.0 ) && ( value < 2.0 * ( double )( 1ULL << ( sizeof( uint8_t ) * CHAR_BIT - 1 ) ) );")
+    body should include ("            success = success && ( ( double )( unsigned long long )value == value );")
+  }
+
+  it should "check the range of each element of aliased number arrays" in {
+    val body = MessageJSONValidator.objectValidator(sensor).body
+
+    body should include (
+      """        while( success && more_items )
+        |            {
+        |            success = cdto_json_scan_number( scanner, &value );""".stripMargin
+    )
+    body should include ("                success = success && ( value >= -( double )( 1ULL << ( sizeof( int16_t ) * CHAR_BIT - 1 ) ) ) && ( value < ( double )( 1ULL << ( sizeof( int16_t ) * CHAR_BIT - 1 ) ) );")
+    body should include (
+      """            success = success && cdto_json_scan_container_next( scanner, ']', &more_items );
+        |            }""".stripMargin
+    )
+  }
+
+  it should "scan plain numbers without a range check" in {
+    val plain = Message("point", List(Field("x", NumberType, "x")))
+    val body = MessageJSONValidator.objectValidator(plain).body
+
+    body should include ("success = cdto_json_scan_number( scanner, NULL );")
+    body should not include ("double value;")
+    body should not include ("CHAR_BIT")
+  }
+
+  it should "reject bytes whose text is not valid base64" in {
+    val avatar = Message("avatar", List(Field("image", BytesType, "image")))
+    val body = MessageJSONValidator.objectValidator(avatar).body
+    val base64Scan = JSONScanner.functions.find(_.name == "cdto_json_scan_base64").get.body
+
+    body should include ("success = cdto_json_scan_base64( scanner );")
+
+    // Invalid lengths, padding before the end and characters outside the alphabet
+    base64Scan should include ("return success && ( 0 == text_len % 4 );")
+    base64Scan should include ("success = ( padding <= 2 );")
+    base64Scan should include (
+      """        success = ( 0 == padding ) &&
+        |                  ( ( ( c >= 'A' ) && ( c <= 'Z' ) ) ||""".stripMargin
+    )
+  }
+
+  it should "only declare the array locals when the message has arrays" in {
+    val avatar = Message("avatar", List(Field("image", BytesType, "image")))
+    val gallery = Message("gallery", List(Field("images", ArrayType(DynamicStringType), "images")))
+
+    MessageJSONValidator.objectValidator(avatar).body should not include ("more_items")
+    MessageJSONValidator.objectValidator(gallery).body should include ("int more_items;")
+  }
+}
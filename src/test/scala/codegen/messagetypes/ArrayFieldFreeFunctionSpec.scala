@@ -10,13 +10,14 @@ class ArrayFieldFreeFunctionSpec extends UnitSpec {
     val arrayFreeFunction = FunctionDefinition(
       name = "string_array_free",
       documentation = FunctionDocumentation(shortSummary = "Free array",
-        description = "Cleans up all resources owned by the array and its elements."),
+        description = "Cleans up all resources owned by the array and its elements using the allocator."),
       prototype = FunctionPrototype(
         isStatic = true,
         returnType = "void",
         parameters = List(
           FunctionParameter(paramType = "char**", paramName = "array"),
-          FunctionParameter(paramType = "int", paramName = "array_cnt")
+          FunctionParameter(paramType = "int", paramName = "array_cnt"),
+          FunctionParameter(paramType = "cdto_allocator const*", paramName = "allocator")
         )
       ),
       body =
@@ -24,29 +25,58 @@ class ArrayFieldFreeFunctionSpec extends UnitSpec {
           |
           |for( i = 0; i < array_cnt; i++ )
           |    {
-          |    free( array[i] );
+          |    cdto_free( allocator, array[i] );
           |    }
           |
-          |free( array );""".stripMargin
+          |cdto_free( allocator, array );""".stripMargin
     )
 
     ArrayFieldFreeFunction(DynamicStringType) shouldBe arrayFreeFunction
   }
 
+  it should "generate a free function that releases interned elements" in {
+    val arrayFreeFunction = FunctionDefinition(
+      name = "interned_string_array_free",
+      documentation = FunctionDocumentation(shortSummary = "Free array",
+        description = "Cleans up all resources owned by the array and its elements using the allocator."),
+      prototype = FunctionPrototype(
+        isStatic = true,
+        returnType = "void",
+        parameters = List(
+          FunctionParameter(paramType = "char const**", paramName = "array"),
+          FunctionParameter(paramType = "int", paramName = "array_cnt"),
+          FunctionParameter(paramType = "cdto_allocator const*", paramName = "allocator")
+        )
+      ),
+      body =
+        """int i;
+          |
+          |for( i = 0; i < array_cnt; i++ )
+          |    {
+          |    cdto_strintern_free( allocator, array[i] );
+          |    }
+          |
+          |cdto_free( allocator, array );""".stripMargin
+    )
+
+    ArrayFieldFreeFunction(InternedStringType) shouldBe arrayFreeFunction
+  }
+
   it should "generate a free function for arrays with non-dynamic elements" in {
     val arrayFreeFunction = FunctionDefinition(
       name = "number_array_free",
       documentation = FunctionDocumentation(shortSummary = "Free array",
-        description = "Cleans up all resources owned by the array and its elements."),
+        description = "Cleans up all resources owned by the array and its elements using the allocator."),
       prototype = FunctionPrototype(
         isStatic = true,
         returnType = "void",
         parameters = List(
           FunctionParameter(paramType = "uint32_t*", paramName = "array"),
-          FunctionParameter(paramType = "int", paramName = "array_cnt")
+          FunctionParameter(paramType = "int", paramName = "array_cnt"),
+          FunctionParameter(paramType = "cdto_allocator const*", paramName = "allocator")
         )
       ),
-      body = "free( array );"
+      body = "cdto_free( allocator, array );"
     )
 
     ArrayFieldFreeFunction(AliasedType("uint32_t", NumberType)) shouldBe arrayFreeFunction
@@ -56,13 +86,14 @@ class ArrayFieldFreeFunctionSpec extends UnitSpec {
     val arrayFreeFunction = FunctionDefinition(
       name = "user_array_free",
       documentation = FunctionDocumentation(shortSummary = "Free array",
-        description = "Cleans up all resources owned by the array and its elements."),
+        description = "Cleans up all resources owned by the array and its elements using the allocator."),
       prototype = FunctionPrototype(
         isStatic = true,
         returnType = "void",
         parameters = List(
           FunctionParameter(paramType = "user*", paramName = "array"),
-          FunctionParameter(paramType = "int", paramName = "array_cnt")
+          FunctionParameter(paramType = "int", paramName = "array_cnt"),
+          FunctionParameter(paramType = "cdto_allocator const*", paramName = "allocator")
         )
       ),
       body =
@@ -70,10 +101,10 @@ class ArrayFieldFreeFunctionSpec extends UnitSpec {
           |
           |for( i = 0; i < array_cnt; i++ )
           |    {
-          |    user_free( &array[i] );
+          |    user_free_ex( &array[i], allocator );
           |    }
           |
-          |free( array );""".stripMargin
+          |cdto_free( allocator, array );""".stripMargin
     )
 
     ArrayFieldFreeFunction(ObjectType("user")) shouldBe arrayFreeFunction
@@ -86,13 +117,14 @@ class ArrayFieldFreeFunctionSpec extends UnitSpec {
     val arrayFreeFunction = FunctionDefinition(
       name = "string_array_free",
       documentation = FunctionDocumentation(shortSummary = "Free array",
-        description = "Cleans up all resources owned by the array and its elements."),
+        description = "Cleans up all resources owned by the array and its elements using the allocator."),
       prototype = FunctionPrototype(
         isStatic = true,
         returnType = "void",
         parameters = List(
           FunctionParameter(paramType = "char**", paramName = "array"),
-          FunctionParameter(paramType = "int", paramName = "array_cnt")
+          FunctionParameter(paramType = "int", paramName = "array_cnt"),
+          FunctionParameter(paramType = "cdto_allocator const*", paramName = "allocator")
         )
       ),
       body =
@@ -100,10 +132,10 @@ class ArrayFieldFreeFunctionSpec extends UnitSpec {
           |
           |for( i = 0; i < array_cnt; i++ )
           |    {
-          |    free( array[i] );
+          |    cdto_free( allocator, array[i] );
           |    }
           |
-          |free( array );""".stripMargin
+          |cdto_free( allocator, array );""".stripMargin
     )
 
     ArrayFieldFreeFunction(FixedStringType(6)) shouldBe arrayFreeFunction
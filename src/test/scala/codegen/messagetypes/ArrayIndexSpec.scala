@@ -0,0 +1,56 @@
+package codegen.messagetypes
+
+import codegen.types._
+import datamodel._
+import dto.UnitSpec
+
+class ArrayIndexSpec extends UnitSpec {
+
+  private val label = Message("label", List(
+    Field("name", DynamicStringType, "name"),
+    Field("color", FixedStringType(6), "color")
+  ))
+
+  private val issue = Message("issue", List(
+    Field("title", DynamicStringType, "title"),
+    Field("labels", ArrayType(ObjectType("label")), "labels", index = Some("name")),
+    Field("palette", InlineArrayType(ObjectType("label"), 4), "palette", index = Some("color"))
+  ))
+
+  private val messagesByName = Map("label" -> label, "issue" -> issue)
+
+  "Array index" should "add index members to messages with indexed arrays" in {
+    ArrayIndex.structFields(issue) shouldBe List(
+      SimpleStructField("labels_index", "cdto_index"),
+      SimpleStructField("palette_index", "cdto_index")
+    )
+    ArrayIndex.structFields(label) shouldBe Nil
+  }
+
+  it should "free the index tables" in {
+    ArrayIndex.freeCalls(issue, "obj") shouldBe List(
+      "cdto_free( allocator, obj->labels_index.slots );",
+      "cdto_free( allocator, obj->palette_index.slots );"
+    )
+  }
+
+  it should "generate index and find functions per indexed field" in {
+    ArrayIndex.functions(issue, messagesByName).map(_.name) shouldBe List(
+      "issue_index",
+      "issue_index_ex",
+      "issue_labels_index_build",
+      "issue_labels_find",
+      "issue_palette_index_build",
+      "issue_palette_find"
+    )
+    ArrayIndex.functions(label, messagesByName) shouldBe Nil
+  }
+
+  it should "only check keys that may be NULL" in {
+    val functions = ArrayIndex.functions(issue, messagesByName).map(function => function.name -> function).toMap
+
+    functions("issue_labels_index_build").body should include("if( NULL != key )")
+    functions("issue_palette_index_build").body should not include "if( NULL != key )"
+    functions("issue_palette_find").body should include("return &CDTO_INLINE_ARRAY( obj->palette )[i];")
+  }
+}
@@ -0,0 +1,70 @@
+package codegen.messagetypes
+
+import codegen.functions._
+import codegen.types._
+import datamodel._
+import dto.UnitSpec
+
+class MessageCacheSpec extends UnitSpec {
+
+  private val message = Message("page", List(
+    Field("title", DynamicStringType, "title"),
+    Field("count", AliasedType("uint32_t", NumberType), "count"),
+    Field("tags", ArrayType(DynamicStringType), "tags")
+  ), cached = true)
+
+  "Message cache" should "add cache members to cached messages" in {
+    MessageCache.structFields(message) shouldBe List(
+      SimpleStructField("tags_json_cache", "cdto_json_cache"),
+      SimpleStructField("json_cache", "cdto_json_cache")
+    )
+    MessageCache.structFields(message.copy(cached = false)) shouldBe Nil
+  }
+
+  it should "invalidate the message and field caches" in {
+    MessageCache.markDirtyFunction(message).body shouldBe
+      """obj->tags_json_cache.valid = 0;
+        |obj->json_cache.valid = 0;""".stripMargin
+    MessageCache.fieldMarkDirtyFunction(message, message.fields(2)).body shouldBe
+      """obj->tags_json_cache.valid = 0;
+        |obj->json_cache.valid = 0;""".stripMargin
+  }
+
+  it should "only generate setters for scalar fields" in {
+    val setter = FunctionDefinition(
+      name = "page_count_set",
+      documentation = FunctionDocumentation(
+        shortSummary = "Set page count",
+        description = "Sets the count field of the provided page and discards its cached JSON."
+      ),
+      prototype = FunctionPrototype(
+        isStatic = false,
+        returnType = "void",
+        parameters = List(
+          FunctionParameter(paramType = "page*", paramName = "obj"),
+          FunctionParameter(paramType = "uint32_t", paramName = "value")
+        )
+      ),
+      body =
+        """obj->count = value;
+          |obj->json_cache.valid = 0;""".stripMargin
+    )
+
+    MessageCache.setterFunction(message, message.fields(1)) shouldBe Some(setter)
+    MessageCache.setterFunction(message, message.fields.head) shouldBe None
+    MessageCache.functions(message).map(_.name) shouldBe List(
+      "page_mark_dirty",
+      "page_title_mark_dirty",
+      "page_count_mark_dirty",
+      "page_count_set",
+      "page_tags_mark_dirty"
+    )
+  }
+
+  it should "free each cache through the allocator that filled it" in {
+    MessageCache.freeCalls(message, "obj") shouldBe List(
+      "cdto_free( obj->tags_json_cache.allocator, obj->tags_json_cache.json );",
+      "cdto_free( obj->json_cache.allocator, obj->json_cache.json );"
+    )
+  }
+}
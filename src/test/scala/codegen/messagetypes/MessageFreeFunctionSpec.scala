@@ -6,7 +6,31 @@ import dto.UnitSpec
 
 class MessageFreeFunctionSpec extends UnitSpec {
 
-    "Message free function" should "generate a free function for messages with dynamic members" in {
+    "Message free function" should "free messages with the default allocator" in {
+      val message = Message("my_message_t", List(
+        Field("dynamic_string_field", DynamicStringType, "dynamicStringField")
+      ))
+
+      val freeFunction = FunctionDefinition(
+        name = "my_message_t_free",
+        documentation = FunctionDocumentation(
+          shortSummary = "Free my_message_t",
+          description = "Cleans up all resources owned by the provided my_message_t."
+        ),
+        prototype = FunctionPrototype(
+          isStatic = false,
+          returnType = "void",
+          parameters = List(
+            FunctionParameter(paramType = "my_message_t*", paramName = "obj")
+          )
+        ),
+        body = "my_message_t_free_ex( obj, NULL );"
+      )
+
+      MessageFreeFunction(message) shouldBe freeFunction
+    }
+
+  it should "generate a free function for messages with dynamic members" in {
       val message = Message("my_message_t", List(
         Field("boolean_field", BooleanType, "booleanField"),
         Field("number_field", NumberType, "numberField"),
@@ -17,27 +41,28 @@ class MessageFreeFunctionSpec extends UnitSpec {
       ))
 
       val freeFunction = FunctionDefinition(
-        name = "my_message_t_free",
+        name = "my_message_t_free_ex",
         documentation = FunctionDocumentation(
-          shortSummary = "Free my_message_t",
-          description = "Cleans up all resources owned by the provided my_message_t."
+          shortSummary = "Free my_message_t with an allocator",
+          description = "Cleans up all resources owned by the provided my_message_t using the allocator it was created with."
         ),
         prototype = FunctionPrototype(
           isStatic = false,
           returnType = "void",
           parameters = List(
-            FunctionParameter(paramType = "my_message_t*", paramName = "obj")
+            FunctionParameter(paramType = "my_message_t*", paramName = "obj"),
+            FunctionParameter(paramType = "cdto_allocator const*", paramName = "allocator")
           )
         ),
         body =
-          """free( obj->dynamic_string_field );
-            |issue_free( &obj->issue_field );
-            |user_array_free( obj->array_field, obj->array_field_cnt );
+          """cdto_free( allocator, obj->dynamic_string_field );
+            |issue_free_ex( &obj->issue_field, allocator );
+            |user_array_free( obj->array_field, obj->array_field_cnt, allocator );
             |
             |my_message_t_init( obj );""".stripMargin
       )
 
-      MessageFreeFunction(message) shouldBe freeFunction
+      MessageFreeFunction.withAllocator(message) shouldBe freeFunction
     }
 
   it should "generate a free function for messages with no dynamic members" in {
@@ -48,21 +73,22 @@ class MessageFreeFunctionSpec extends UnitSpec {
     ))
 
     val freeFunction = FunctionDefinition(
-      name = "my_message_t_free",
+      name = "my_message_t_free_ex",
       documentation = FunctionDocumentation(
-        shortSummary = "Free my_message_t",
-        description = "Cleans up all resources owned by the provided my_message_t."
+        shortSummary = "Free my_message_t with an allocator",
+        description = "Cleans up all resources owned by the provided my_message_t using the allocator it was created with."
       ),
       prototype = FunctionPrototype(
         isStatic = false,
         returnType = "void",
         parameters = List(
-          FunctionParameter(paramType = "my_message_t*", paramName = "obj")
+          FunctionParameter(paramType = "my_message_t*", paramName = "obj"),
+          FunctionParameter(paramType = "cdto_allocator const*", paramName = "allocator")
         )
       ),
       body = "my_message_t_init( obj );"
     )
 
-    MessageFreeFunction(message) shouldBe freeFunction
+    MessageFreeFunction.withAllocator(message) shouldBe freeFunction
   }
 }
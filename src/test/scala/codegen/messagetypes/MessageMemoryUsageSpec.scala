@@ -0,0 +1,84 @@
+package codegen.messagetypes
+
+import codegen.functions._
+import datamodel._
+import dto.UnitSpec
+
+class MessageMemoryUsageSpec extends UnitSpec {
+
+  "Message memory usage" should "measure messages with the default allocator" in {
+    val message = Message("my_message_t", List(
+      Field("dynamic_string_field", DynamicStringType, "dynamicStringField")
+    ))
+
+    val memoryUsageFunction = FunctionDefinition(
+      name = "my_message_t_memory_usage",
+      documentation = FunctionDocumentation(
+        shortSummary = "Get my_message_t memory usage",
+        description = "Gets the number of heap bytes and allocations owned by the provided my_message_t, not counting the my_message_t itself."
+      ),
+      prototype = FunctionPrototype(
+        isStatic = false,
+        returnType = "void",
+        parameters = List(
+          FunctionParameter(paramType = "my_message_t const*", paramName = "obj"),
+          FunctionParameter(paramType = "size_t*", paramName = "heap_bytes"),
+          FunctionParameter(paramType = "size_t*", paramName = "alloc_cnt")
+        )
+      ),
+      body = "my_message_t_memory_usage_ex( obj, heap_bytes, alloc_cnt, NULL );"
+    )
+
+    MessageMemoryUsage(message) shouldBe memoryUsageFunction
+  }
+
+  it should "walk the fields that own heap memory" in {
+    val message = Message("my_message_t", List(
+      Field("boolean_field", BooleanType, "booleanField"),
+      Field("number_field", NumberType, "numberField"),
+      Field("dynamic_string_field", DynamicStringType, "dynamicStringField"),
+      Field("interned_string_field", InternedStringType, "internedStringField"),
+      Field("fixed_string_field", FixedStringType(32), "fixedStringField"),
+      Field("issue_field", ObjectType("issue"), "issue"),
+      Field("array_field", ArrayType(ObjectType("user")), "arrayField"),
+      Field("number_array_field", ArrayType(NumberType), "numberArrayField"),
+      Field("inline_array_field", InlineArrayType(DynamicStringType, 2), "inlineArrayField")
+    ))
+
+    val body =
+      """int i;
+        |
+        |cdto_memory_usage_add_string( allocator, obj->dynamic_string_field, heap_bytes, alloc_cnt );
+        |cdto_memory_usage_add_interned( allocator, obj->interned_string_field, heap_bytes, alloc_cnt );
+        |issue_memory_usage_add( &obj->issue_field, heap_bytes, alloc_cnt, allocator );
+        |cdto_memory_usage_add( allocator, obj->array_field, ( size_t )obj->array_field_cnt * sizeof( *obj->array_field ), heap_bytes, alloc_cnt );
+        |for( i = 0; i < obj->array_field_cnt; i++ )
+        |    {
+        |    user_memory_usage_add( &obj->array_field[i], heap_bytes, alloc_cnt, allocator );
+        |    }
+        |cdto_memory_usage_add( allocator, obj->number_array_field, ( size_t )obj->number_array_field_cnt * sizeof( *obj->number_array_field ), heap_bytes, alloc_cnt );
+        |cdto_memory_usage_add( allocator, obj->inline_array_field, ( size_t )obj->inline_array_field_cnt * sizeof( *obj->inline_array_field ), heap_bytes, alloc_cnt );
+        |for( i = 0; i < obj->inline_array_field_cnt; i++ )
+        |    {
+        |    cdto_memory_usage_add_string( allocator, CDTO_INLINE_ARRAY( obj->inline_array_field )[i], heap_bytes, alloc_cnt );
+        |    }""".stripMargin
+
+    MessageMemoryUsage.addFunction(message).body shouldBe body
+  }
+
+  it should "only include the helpers the protocol uses" in {
+    val numbers = Protocol("numbers", List(Message("point", List(
+      Field("x", NumberType, "x")
+    ))))
+    val strings = Protocol("strings", List(Message("label", List(
+      Field("name", DynamicStringType, "name")
+    ))))
+    val interned = Protocol("interned", List(Message("label", List(
+      Field("names", ArrayType(InternedStringType), "names")
+    ))))
+
+    MessageMemoryUsage.helperFunctions(numbers) shouldBe Nil
+    MessageMemoryUsage.helperFunctions(strings).map(_.name) shouldBe List("cdto_memory_usage_add", "cdto_memory_usage_add_string")
+    MessageMemoryUsage.helperFunctions(interned).map(_.name) shouldBe List("cdto_memory_usage_add", "cdto_memory_usage_add_string", "cdto_memory_usage_add_interned")
+  }
+}
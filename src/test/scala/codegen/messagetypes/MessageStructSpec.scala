@@ -35,4 +35,37 @@ class MessageStructSpec extends UnitSpec {
 
     MessageStruct(message) shouldBe struct
   }
+
+  it should "store inline strings in a heap pointer and an inline buffer" in {
+    val message = Message("label", List(
+      Field("name", InlineStringType(15), "name")
+    ))
+
+    val struct = StructDefinition(
+      name = "label",
+      fields = List(
+        SimpleStructField("name", "char*"),
+        FixedArrayStructField("name_inline", "char", 16)
+      )
+    )
+
+    MessageStruct(message) shouldBe struct
+  }
+
+  it should "store inline arrays in a heap pointer, a count and an inline buffer" in {
+    val message = Message("issue", List(
+      Field("labels", InlineArrayType(ObjectType("label"), 4), "labels")
+    ))
+
+    val struct = StructDefinition(
+      name = "issue",
+      fields = List(
+        SimpleStructField("labels", "label*"),
+        SimpleStructField("labels_cnt", "int"),
+        FixedArrayStructField("labels_inline", "label", 4)
+      )
+    )
+
+    MessageStruct(message) shouldBe struct
+  }
 }
@@ -0,0 +1,57 @@
+package codegen.xml
+
+import datamodel._
+import dto.UnitSpec
+
+class MessageXMLFilesSpec extends UnitSpec {
+
+  private val label = Message("label", List(
+    Field("name", DynamicStringType, "name"),
+    Field("color", FixedStringType(6), "color", Some("gh:color"))
+  ))
+
+  private val issue = Message("issue", List(
+    Field("number", AliasedType("uint32_t", NumberType), "number"),
+    Field("labels", ArrayType(ObjectType("label")), "labels")
+  ))
+
+  private val files = MessageXMLFiles(Protocol("github_issues.cdto", List(label, issue)))
+
+  "XML files" should "declare the parse and serialize functions of every message" in {
+    files.headerFile.name shouldBe "github_issues.cdto.xml.h"
+    files.headerFile.contents should include ("int issue_xml_parse_ex")
+    files.headerFile.contents should include ("int label_xml_serialize_to_buffer")
+    files.headerFile.contents should not include "label_xml_obj_parse"
+    files.headerFile.contents should not include "cJSON"
+  }
+
+  it should "read and write fields as elements named after their XML names" in {
+    files.cFile.contents should include ("if( ( 8 == child_len ) && ( 0 == memcmp( child, \"gh:color\", 8 ) ) )")
+    files.cFile.contents should include ("cdto_xml_decode( text, text_len, ( char* )obj_out->color, sizeof( obj_out->color ), NULL )")
+    files.cFile.contents should include ("success = success && cdto_xml_write( writer, \"<gh:color>\", 10 ) && cdto_xml_write_text( writer, obj->color ) && cdto_xml_write( writer, \"</gh:color>\", 11 );")
+  }
+
+  it should "read and write arrays as item elements" in {
+    files.cFile.contents should include ("success = label_array_xml_parse( reader, child, child_len, child_empty, NULL, 0, &obj_out->labels, &obj_out->labels_cnt, allocator );")
+    files.cFile.contents should include ("success = cdto_xml_write( writer, \"<item>\", 6 ) && label_xml_obj_write( &obj->labels[i], writer ) && cdto_xml_write( writer, \"</item>\", 7 );")
+    files.cFile.contents should include ("uint32_t_xml_parse( text, text_len, &obj_out->number )")
+  }
+
+  it should "read and write bytes as base64 text" in {
+    val avatar = Message("avatar", List(Field("image", BytesType, "image")))
+    val bytesFiles = MessageXMLFiles(Protocol("avatars.cdto", List(avatar)))
+
+    bytesFiles.cFile.contents should include ("cdto_xml_parse_bytes( text, text_len, &obj_out->image.data, &obj_out->image.len, allocator )")
+    bytesFiles.cFile.contents should include ("cdto_xml_write_bytes( writer, obj->image.data, obj->image.len )")
+    files.cFile.contents should not include "cdto_base64"
+  }
+
+  it should "read and write timestamps as RFC 3339 text" in {
+    val event = Message("event", List(Field("created_at", TimestampType, "createdAt")))
+    val timestampFiles = MessageXMLFiles(Protocol("events.cdto", List(event)))
+
+    timestampFiles.cFile.contents should include ("cdto_xml_parse_timestamp( text, text_len, &obj_out->created_at )")
+    timestampFiles.cFile.contents should include ("cdto_xml_write_timestamp( writer, obj->created_at )")
+    files.cFile.contents should not include "cdto_timestamp"
+  }
+}
@@ -9,55 +9,200 @@ class FieldDefinitionAnalyzerSpec extends UnitSpec {
     val validFieldDef = FieldDefinition("user_name", DynamicStringTypeDefinition(), List(JSONKeyAttribute("userName")))
     val validField = Field("user_name", DynamicStringType, "userName")
 
-    FieldDefinitionAnalyzer(validFieldDef) shouldBe Right(validField)
+    FieldDefinitionAnalyzer(validFieldDef, "issue") shouldBe Right(validField)
   }
 
   it should "accept valid C-type aliases" in {
     val aliasedTypeFieldDef = FieldDefinition("user_id", NumberTypeDefinition(), List(JSONKeyAttribute("userId"), CTypeAttribute("uint32_t")))
     val aliasedTypeField = Field("user_id", AliasedType("uint32_t", NumberType), "userId")
 
-    FieldDefinitionAnalyzer(aliasedTypeFieldDef) shouldBe Right(aliasedTypeField)
+    FieldDefinitionAnalyzer(aliasedTypeFieldDef, "issue") shouldBe Right(aliasedTypeField)
   }
 
   it should "accept valid C-type aliases of array elements" in {
     val aliasedArrayFieldDef = FieldDefinition("user_ids", ArrayTypeDefinition(NumberTypeDefinition()), List(CTypeAttribute("uint32_t"), JSONKeyAttribute("userIds")))
     val aliasedArrayField = Field("user_ids", ArrayType(AliasedType("uint32_t", NumberType)), "userIds")
 
-    FieldDefinitionAnalyzer(aliasedArrayFieldDef) shouldBe Right(aliasedArrayField)
+    FieldDefinitionAnalyzer(aliasedArrayFieldDef, "issue") shouldBe Right(aliasedArrayField)
   }
 
   it should "use a default value for the JSON key if none was provided" in {
     val noJsonKeyFieldDef = FieldDefinition("user", ObjectTypeDefinition("user"), List())
     val noJsonKeyField = Field("user", ObjectType("user"), "user")
 
-    FieldDefinitionAnalyzer(noJsonKeyFieldDef) shouldBe Right(noJsonKeyField)
+    FieldDefinitionAnalyzer(noJsonKeyFieldDef, "issue") shouldBe Right(noJsonKeyField)
   }
 
   it should "not accept a definition with duplicate JSON key attributes" in {
     val duplicateJsonKeyDef = FieldDefinition("user_id", NumberTypeDefinition(), List(JSONKeyAttribute("userId"), CTypeAttribute("uint32_t"), JSONKeyAttribute("id")))
     val duplicateJsonKeyError = InvalidFieldError("user_id", DuplicateAttributeError(Constants.JSON_KEY_ATTRIBUTE))
 
-    FieldDefinitionAnalyzer(duplicateJsonKeyDef) shouldBe Left(duplicateJsonKeyError)
+    FieldDefinitionAnalyzer(duplicateJsonKeyDef, "issue") shouldBe Left(duplicateJsonKeyError)
   }
 
   it should "not accept a definition with duplicate C-type attributes" in {
     val duplicateCTypeDef = FieldDefinition("is_logged_in", BooleanTypeDefinition(), List(JSONKeyAttribute("isLoggedIn"), CTypeAttribute("boolean"), CTypeAttribute("int")))
     val duplicateCTypeError = InvalidFieldError("is_logged_in", DuplicateAttributeError(Constants.C_TYPE_ATTRIBUTE))
 
-    FieldDefinitionAnalyzer(duplicateCTypeDef) shouldBe Left(duplicateCTypeError)
+    FieldDefinitionAnalyzer(duplicateCTypeDef, "issue") shouldBe Left(duplicateCTypeError)
   }
 
   it should "not accept a definition with an invalid C-type alias" in {
     val badAliasDef = FieldDefinition("user", ObjectTypeDefinition("user"), List(CTypeAttribute("user_type")))
     val badAliasError = InvalidFieldError("user", TypeAliasNotAllowedError(ObjectType("user").toString))
 
-    FieldDefinitionAnalyzer(badAliasDef) shouldBe Left(badAliasError)
+    FieldDefinitionAnalyzer(badAliasDef, "issue") shouldBe Left(badAliasError)
   }
 
   it should "not accept a definition with an invalid C-type array alias" in {
     val badArrayAliasDef = FieldDefinition("users", ArrayTypeDefinition(ObjectTypeDefinition("user")), List(CTypeAttribute("user_t"), JSONKeyAttribute("users")))
     val badArrayAliasError = InvalidFieldError("users", TypeAliasNotAllowedError(ObjectType("user").toString))
 
-    FieldDefinitionAnalyzer(badArrayAliasDef) shouldBe Left(badArrayAliasError)
+    FieldDefinitionAnalyzer(badArrayAliasDef, "issue") shouldBe Left(badArrayAliasError)
+  }
+
+  it should "accept interned dynamic strings and arrays of them" in {
+    val internedFieldDef = FieldDefinition("color", DynamicStringTypeDefinition(), List(InternAttribute(true), CTypeAttribute("color_t")))
+    val internedField = Field("color", AliasedType("color_t", InternedStringType), "color")
+    val internedArrayFieldDef = FieldDefinition("tags", ArrayTypeDefinition(DynamicStringTypeDefinition()), List(InternAttribute(true)))
+    val internedArrayField = Field("tags", ArrayType(InternedStringType), "tags")
+
+    FieldDefinitionAnalyzer(internedFieldDef, "issue") shouldBe Right(internedField)
+    FieldDefinitionAnalyzer(internedArrayFieldDef, "issue") shouldBe Right(internedArrayField)
+  }
+
+  it should "not accept interning of types other than dynamic strings" in {
+    val badInternDef = FieldDefinition("color", FixedStringTypeDefinition(6), List(InternAttribute(true)))
+    val badInternError = InvalidFieldError("color", InternNotAllowedError(FixedStringType(6).toString))
+    val duplicateInternDef = FieldDefinition("name", DynamicStringTypeDefinition(), List(InternAttribute(true), InternAttribute(false)))
+    val duplicateInternError = InvalidFieldError("name", DuplicateAttributeError(Constants.INTERN_ATTRIBUTE))
+
+    FieldDefinitionAnalyzer(badInternDef, "issue") shouldBe Left(badInternError)
+    FieldDefinitionAnalyzer(duplicateInternDef, "issue") shouldBe Left(duplicateInternError)
+  }
+
+  it should "name enums after the message and field" in {
+    val enumFieldDef = FieldDefinition("state", EnumTypeDefinition(List("open", "closed")), List())
+    val enumField = Field("state", EnumType("issue_state", List("open", "closed")), "state")
+
+    FieldDefinitionAnalyzer(enumFieldDef, "issue") shouldBe Right(enumField)
+  }
+
+  it should "not accept enums with duplicate values" in {
+    val duplicateValuesDef = FieldDefinition("states", ArrayTypeDefinition(EnumTypeDefinition(List("open", "closed", "Open"))), List())
+    val duplicateValuesError = InvalidFieldError("states", DuplicateEnumValuesError(List("open", "Open")))
+
+    FieldDefinitionAnalyzer(duplicateValuesDef, "issue") shouldBe Left(duplicateValuesError)
+  }
+
+  it should "store dynamic strings inline when requested" in {
+    val inlineFieldDef = FieldDefinition("name", DynamicStringTypeDefinition(), List(InlineAttribute(15)))
+    val inlineField = Field("name", InlineStringType(15), "name")
+
+    FieldDefinitionAnalyzer(inlineFieldDef, "label") shouldBe Right(inlineField)
+  }
+
+  it should "not accept inline storage of other types" in {
+    val badInlineDef = FieldDefinition("color", FixedStringTypeDefinition(6), List(InlineAttribute(15)))
+    val badInlineError = InvalidFieldError("color", InlineNotAllowedError(FixedStringType(6).toString))
+    val aliasedInlineDef = FieldDefinition("name", DynamicStringTypeDefinition(), List(InlineAttribute(15), CTypeAttribute("name_t")))
+    val aliasedInlineError = InvalidFieldError("name", TypeAliasNotAllowedError(InlineStringType(15).toString))
+
+    FieldDefinitionAnalyzer(badInlineDef, "label") shouldBe Left(badInlineError)
+    FieldDefinitionAnalyzer(aliasedInlineDef, "label") shouldBe Left(aliasedInlineError)
+  }
+
+  it should "store arrays inline when requested" in {
+    val inlineArrayDef = FieldDefinition("labels", ArrayTypeDefinition(ObjectTypeDefinition("label")), List(InlineAttribute(4)))
+    val inlineArray = Field("labels", InlineArrayType(ObjectType("label"), 4), "labels")
+    val duplicateDef = FieldDefinition("labels", ArrayTypeDefinition(ObjectTypeDefinition("label")), List(InlineAttribute(4), InlineAttribute(8)))
+    val duplicateError = InvalidFieldError("labels", DuplicateAttributeError(Constants.INLINE_ATTRIBUTE))
+
+    FieldDefinitionAnalyzer(inlineArrayDef, "issue") shouldBe Right(inlineArray)
+    FieldDefinitionAnalyzer(duplicateDef, "issue") shouldBe Left(duplicateError)
+  }
+
+  it should "only index arrays of messages" in {
+    val indexedDef = FieldDefinition("labels", ArrayTypeDefinition(ObjectTypeDefinition("label")), List(IndexAttribute("name")))
+    val indexed = Field("labels", ArrayType(ObjectType("label")), "labels", index = Some("name"))
+    val stringsDef = FieldDefinition("tags", ArrayTypeDefinition(DynamicStringTypeDefinition()), List(IndexAttribute("name")))
+    val stringsError = InvalidFieldError("tags", IndexNotAllowedError(ArrayType(DynamicStringType).toString))
+    val duplicateDef = FieldDefinition("labels", ArrayTypeDefinition(ObjectTypeDefinition("label")), List(IndexAttribute("name"), IndexAttribute("id")))
+    val duplicateError = InvalidFieldError("labels", DuplicateAttributeError(Constants.INDEX_ATTRIBUTE))
+
+    FieldDefinitionAnalyzer(indexedDef, "issue") shouldBe Right(indexed)
+    FieldDefinitionAnalyzer(stringsDef, "issue") shouldBe Left(stringsError)
+    FieldDefinitionAnalyzer(duplicateDef, "issue") shouldBe Left(duplicateError)
+  }
+
+  it should "only accept defaults matching the field's type" in {
+    val numberDef = FieldDefinition("comments", NumberTypeDefinition(), List(CTypeAttribute("uint32_t"), DefaultAttribute("0")))
+    val number = Field("comments", AliasedType("uint32_t", NumberType), "comments", default = Some("0"))
+    val enumDef = FieldDefinition("state", EnumTypeDefinition(List("open", "closed")), List(DefaultAttribute("open")))
+    val enum = Field("state", EnumType("issue_state", List("open", "closed")), "state", default = Some("open"))
+    val badBooleanDef = FieldDefinition("locked", BooleanTypeDefinition(), List(DefaultAttribute("0")))
+    val badBooleanError = InvalidFieldError("locked", DefaultNotValidError("0"))
+    val badEnumDef = FieldDefinition("state", EnumTypeDefinition(List("open", "closed")), List(DefaultAttribute("merged")))
+    val badEnumError = InvalidFieldError("state", DefaultNotValidError("merged"))
+    val stringDef = FieldDefinition("title", DynamicStringTypeDefinition(), List(DefaultAttribute("untitled")))
+    val stringError = InvalidFieldError("title", DefaultNotAllowedError(DynamicStringType.toString))
+
+    FieldDefinitionAnalyzer(numberDef, "issue") shouldBe Right(number)
+    FieldDefinitionAnalyzer(enumDef, "issue") shouldBe Right(enum)
+    FieldDefinitionAnalyzer(badBooleanDef, "issue") shouldBe Left(badBooleanError)
+    FieldDefinitionAnalyzer(badEnumDef, "issue") shouldBe Left(badEnumError)
+    FieldDefinitionAnalyzer(stringDef, "issue") shouldBe Left(stringError)
+  }
+
+  it should "only accept number defaults that fit the field's integer C type" in {
+    def numberDef(cType: String, value: String) = FieldDefinition("count", NumberTypeDefinition(), List(CTypeAttribute(cType), DefaultAttribute(value)))
+
+    FieldDefinitionAnalyzer(numberDef("uint8_t", "255"), "issue").map(_.default) shouldBe Right(Some("255"))
+    FieldDefinitionAnalyzer(numberDef("int32_t", "-1e3"), "issue").map(_.default) shouldBe Right(Some("-1e3"))
+    FieldDefinitionAnalyzer(numberDef("double", "1.5"), "issue").map(_.default) shouldBe Right(Some("1.5"))
+    FieldDefinitionAnalyzer(numberDef("uint8_t", "300"), "issue") shouldBe Left(InvalidFieldError("count", DefaultNotValidError("300")))
+    FieldDefinitionAnalyzer(numberDef("uint32_t", "-1"), "issue") shouldBe Left(InvalidFieldError("count", DefaultNotValidError("-1")))
+    FieldDefinitionAnalyzer(numberDef("int32_t", "1.5"), "issue") shouldBe Left(InvalidFieldError("count", DefaultNotValidError("1.5")))
+  }
+
+  it should "not omit nested messages while empty" in {
+    val arrayDef = FieldDefinition("labels", ArrayTypeDefinition(ObjectTypeDefinition("label")), List(OmitEmptyAttribute(true)))
+    val array = Field("labels", ArrayType(ObjectType("label")), "labels", omitEmpty = true)
+    val objectDef = FieldDefinition("creator", ObjectTypeDefinition("user"), List(OmitEmptyAttribute(true)))
+    val objectError = InvalidFieldError("creator", OmitEmptyNotAllowedError(ObjectType("user").toString))
+
+    FieldDefinitionAnalyzer(arrayDef, "issue") shouldBe Right(array)
+    FieldDefinitionAnalyzer(objectDef, "issue") shouldBe Left(objectError)
+  }
+
+  it should "name XML elements after the JSON key unless an XML name is given" in {
+    val defaultNameDef = FieldDefinition("number", NumberTypeDefinition(), List(JSONKeyAttribute("issueNumber")))
+    val xmlNameDef = FieldDefinition("number", NumberTypeDefinition(), List(XMLNameAttribute("num")))
+    val duplicateDef = FieldDefinition("number", NumberTypeDefinition(), List(XMLNameAttribute("num"), XMLNameAttribute("n")))
+    val duplicateError = InvalidFieldError("number", DuplicateAttributeError(Constants.XML_NAME_ATTRIBUTE))
+
+    FieldDefinitionAnalyzer(defaultNameDef, "issue").map(_.xmlElementName) shouldBe Right("issueNumber")
+    FieldDefinitionAnalyzer(xmlNameDef, "issue") shouldBe Right(Field("number", NumberType, "number", Some("num")))
+    FieldDefinitionAnalyzer(duplicateDef, "issue") shouldBe Left(duplicateError)
+  }
+
+  it should "accept bytes fields without storage attributes" in {
+    val bytesDef = FieldDefinition("avatar", BytesTypeDefinition(), List(JSONKeyAttribute("avatarImage")))
+    val aliasedDef = FieldDefinition("avatar", BytesTypeDefinition(), List(CTypeAttribute("blob_t")))
+    val aliasedError = InvalidFieldError("avatar", TypeAliasNotAllowedError(BytesType.toString))
+    val inlineDef = FieldDefinition("avatar", BytesTypeDefinition(), List(InlineAttribute(64)))
+    val inlineError = InvalidFieldError("avatar", InlineNotAllowedError(BytesType.toString))
+
+    FieldDefinitionAnalyzer(bytesDef, "user") shouldBe Right(Field("avatar", BytesType, "avatarImage"))
+    FieldDefinitionAnalyzer(aliasedDef, "user") shouldBe Left(aliasedError)
+    FieldDefinitionAnalyzer(inlineDef, "user") shouldBe Left(inlineError)
+  }
+
+  it should "accept timestamp fields with a C type" in {
+    val timestampDef = FieldDefinition("created_at", TimestampTypeDefinition(), Nil)
+    val aliasedDef = FieldDefinition("created_at", TimestampTypeDefinition(), List(CTypeAttribute("epoch_ns_t")))
+
+    FieldDefinitionAnalyzer(timestampDef, "issue") shouldBe Right(Field("created_at", TimestampType, "created_at"))
+    FieldDefinitionAnalyzer(aliasedDef, "issue") shouldBe Right(Field("created_at", AliasedType("epoch_ns_t", TimestampType), "created_at"))
   }
 }
@@ -86,4 +86,47 @@ class MessageDefinitionAnalyzerSpec extends UnitSpec {
 
     MessageDefinitionAnalyzer(message) shouldBe Left(error)
   }
+
+  it should "not accept a definition with duplicate XML names" in {
+    val message = MessageDefinition("issue", List(
+      FieldDefinition("url", DynamicStringTypeDefinition(), List()),
+      FieldDefinition("link", DynamicStringTypeDefinition(), List(XMLNameAttribute("url")))
+    ))
+
+    val error = InvalidMessageError("issue", DuplicateXMLNamesError(List("url")))
+
+    MessageDefinitionAnalyzer(message) shouldBe Left(error)
+  }
+
+  it should "mark messages declared with cache=true as cached" in {
+    val message = MessageDefinition("label", List(
+      FieldDefinition("name", DynamicStringTypeDefinition(), List())
+    ), List(CacheAttribute(true)))
+
+    MessageDefinitionAnalyzer(message) shouldBe Right(Message("label", List(Field("name", DynamicStringType, "name")), cached = true))
+  }
+
+  it should "omit empty fields of messages declared with omitEmpty=true" in {
+    val message = MessageDefinition("issue", List(
+      FieldDefinition("title", DynamicStringTypeDefinition(), List()),
+      FieldDefinition("body", DynamicStringTypeDefinition(), List(OmitEmptyAttribute(false))),
+      FieldDefinition("creator", ObjectTypeDefinition("user"), List())
+    ), List(MessageOmitEmptyAttribute(true)))
+
+    MessageDefinitionAnalyzer(message) shouldBe Right(Message("issue", List(
+      Field("title", DynamicStringType, "title", omitEmpty = true),
+      Field("body", DynamicStringType, "body"),
+      Field("creator", ObjectType("user"), "creator")
+    )))
+  }
+
+  it should "not accept a definition with duplicate cache attributes" in {
+    val message = MessageDefinition("label", List(
+      FieldDefinition("name", DynamicStringTypeDefinition(), List())
+    ), List(CacheAttribute(true), CacheAttribute(false)))
+
+    val error = InvalidMessageError("label", DuplicateMessageAttributeError("cache"))
+
+    MessageDefinitionAnalyzer(message) shouldBe Left(error)
+  }
 }
@@ -85,4 +85,20 @@ class ProtocolDefinitionAnalyzerSpec extends UnitSpec{
 
     ProtocolDefinitionAnalyzer(invalidMessagesAST, protocolName) shouldBe Left(invalidMessagesError)
   }
+
+  it should "not accept an AST with field paths that get the same name" in {
+    val clashingPathsAST = ProtocolAST(List(
+      MessageDefinition("issue", List(
+        FieldDefinition("creator_name", DynamicStringTypeDefinition(), List()),
+        FieldDefinition("creator", ObjectTypeDefinition("user"), List())
+      )),
+      MessageDefinition("user", List(
+        FieldDefinition("name", DynamicStringTypeDefinition(), List())
+      ))
+    ))
+
+    val clashingPathsError = DuplicateFieldPathNamesError(List("issue.creator_name", "issue.creator.name"))
+
+    ProtocolDefinitionAnalyzer(clashingPathsAST, protocolName) shouldBe Left(clashingPathsError)
+  }
 }
@@ -68,6 +68,173 @@ class ProtocolParserSpec extends UnitSpec {
     ProtocolParser(arrayOfFixedStrings) shouldBe Right(arrayOfFixedStringsAST)
   }
 
+  it should "successfully parse intern attributes" in {
+    val internedStrings =
+      """
+        | label {
+        |   name String intern=true;
+        |   aliases Array[String] jsonKey=names intern=false;
+        | }
+      """.stripMargin
+
+    val internedStringsAST = ProtocolAST(List(
+      MessageDefinition("label", List(
+        FieldDefinition("name", DynamicStringTypeDefinition(), List(InternAttribute(true))),
+        FieldDefinition("aliases", ArrayTypeDefinition(DynamicStringTypeDefinition()), List(JSONKeyAttribute("names"), InternAttribute(false)))
+      ))
+    ))
+
+    ProtocolParser(internedStrings) shouldBe Right(internedStringsAST)
+  }
+
+  it should "successfully parse inline attributes" in {
+    val inlineStrings =
+      """
+        | label {
+        |   name String inline=15;
+        | }
+      """.stripMargin
+
+    val inlineStringsAST = ProtocolAST(List(
+      MessageDefinition("label", List(
+        FieldDefinition("name", DynamicStringTypeDefinition(), List(InlineAttribute(15)))
+      ))
+    ))
+
+    ProtocolParser(inlineStrings) shouldBe Right(inlineStringsAST)
+  }
+
+  it should "successfully parse xmlName attributes" in {
+    val xmlNames =
+      """
+        | label {
+        |   name String xmlName=gh:label-name;
+        | }
+      """.stripMargin
+
+    val xmlNamesAST = ProtocolAST(List(
+      MessageDefinition("label", List(
+        FieldDefinition("name", DynamicStringTypeDefinition(), List(XMLNameAttribute("gh:label-name")))
+      ))
+    ))
+
+    ProtocolParser(xmlNames) shouldBe Right(xmlNamesAST)
+  }
+
+  it should "successfully parse index attributes" in {
+    val indexedArray =
+      """
+        | issue {
+        |   labels [label] index=name;
+        | }
+      """.stripMargin
+
+    val indexedArrayAST = ProtocolAST(List(
+      MessageDefinition("issue", List(
+        FieldDefinition("labels", ArrayTypeDefinition(ObjectTypeDefinition("label")), List(IndexAttribute("name")))
+      ))
+    ))
+
+    ProtocolParser(indexedArray) shouldBe Right(indexedArrayAST)
+  }
+
+  it should "successfully parse default and omitEmpty attributes" in {
+    val optionalFields =
+      """
+        | issue omitEmpty=true {
+        |   comments Number cType=uint32_t default=0;
+        |   score Number default=-2.5e3;
+        |   state Enum[open, closed] default=open;
+        |   locked Boolean default=false;
+        |   title String omitEmpty=false;
+        | }
+      """.stripMargin
+
+    val optionalFieldsAST = ProtocolAST(List(
+      MessageDefinition("issue", List(
+        FieldDefinition("comments", NumberTypeDefinition(), List(CTypeAttribute("uint32_t"), DefaultAttribute("0"))),
+        FieldDefinition("score", NumberTypeDefinition(), List(DefaultAttribute("-2.5e3"))),
+        FieldDefinition("state", EnumTypeDefinition(List("open", "closed")), List(DefaultAttribute("open"))),
+        FieldDefinition("locked", BooleanTypeDefinition(), List(DefaultAttribute("false"))),
+        FieldDefinition("title", DynamicStringTypeDefinition(), List(OmitEmptyAttribute(false)))
+      ), List(MessageOmitEmptyAttribute(true)))
+    ))
+
+    ProtocolParser(optionalFields) shouldBe Right(optionalFieldsAST)
+  }
+
+  it should "successfully parse message attributes" in {
+    val cachedMessage =
+      """
+        | label cache=true {
+        |   name String;
+        | }
+      """.stripMargin
+
+    val cachedMessageAST = ProtocolAST(List(
+      MessageDefinition("label", List(
+        FieldDefinition("name", DynamicStringTypeDefinition(), List())
+      ), List(CacheAttribute(true)))
+    ))
+
+    ProtocolParser(cachedMessage) shouldBe Right(cachedMessageAST)
+  }
+
+  it should "successfully parse enum types" in {
+    val enums =
+      """
+        | issue {
+        |   state Enum[open, closed];
+        |   reactions Array[Enum[heart,rocket]] jsonKey=reactionTypes;
+        | }
+      """.stripMargin
+
+    val enumsAST = ProtocolAST(List(
+      MessageDefinition("issue", List(
+        FieldDefinition("state", EnumTypeDefinition(List("open", "closed")), List()),
+        FieldDefinition("reactions", ArrayTypeDefinition(EnumTypeDefinition(List("heart", "rocket"))), List(JSONKeyAttribute("reactionTypes")))
+      ))
+    ))
+
+    ProtocolParser(enums) shouldBe Right(enumsAST)
+  }
+
+  it should "successfully parse bytes types" in {
+    val bytes =
+      """
+        | user {
+        |   avatar Bytes jsonKey=avatarImage;
+        | }
+      """.stripMargin
+
+    val bytesAST = ProtocolAST(List(
+      MessageDefinition("user", List(
+        FieldDefinition("avatar", BytesTypeDefinition(), List(JSONKeyAttribute("avatarImage")))
+      ))
+    ))
+
+    ProtocolParser(bytes) shouldBe Right(bytesAST)
+  }
+
+  it should "successfully parse timestamp types" in {
+    val timestamps =
+      """
+        | issue {
+        |   created_at Timestamp jsonKey=createdAt;
+        |   edits Array[Timestamp];
+        | }
+      """.stripMargin
+
+    val timestampsAST = ProtocolAST(List(
+      MessageDefinition("issue", List(
+        FieldDefinition("created_at", TimestampTypeDefinition(), List(JSONKeyAttribute("createdAt"))),
+        FieldDefinition("edits", ArrayTypeDefinition(TimestampTypeDefinition()), Nil)
+      ))
+    ))
+
+    ProtocolParser(timestamps) shouldBe Right(timestampsAST)
+  }
+
   it should "fail to parse when a message id is missing" in {
     val noMessageId =
       """